@@ -0,0 +1,75 @@
+#include "arena.hpp"
+
+#include <cstdint>
+
+
+Arena::Arena()
+{}
+
+
+void* Arena::Allocate(size_t size, size_t align)
+{
+	_used += size;
+	const uintptr_t next {reinterpret_cast<uintptr_t>(_next)};
+	const size_t padding {(align - next % align) % align};
+	if (_next != nullptr
+		&& static_cast<size_t>(_end - _next) >= padding + size)
+	{
+		std::byte* const out {_next + padding};
+		_next = out + size;
+		return out;
+	}
+
+	if (size > _blockSize / 4)
+	{
+		// Large allocations get a block of their own, so the remaining space
+		// of the current block is still handed out.
+		_large.emplace_back(new std::byte[size]);
+		_largeBytes += size;
+		return _large.back().get();
+	}
+
+	if (_spare.empty()) _blocks.emplace_back(new std::byte[_blockSize]);
+	else
+	{
+		_blocks.push_back(std::move(_spare.back()));
+		_spare.pop_back();
+	}
+	_next = _blocks.back().get() + size;
+	_end = _blocks.back().get() + _blockSize;
+	return _blocks.back().get();
+}
+
+
+Arena::Mark Arena::GetMark() const
+{
+	return Mark {
+		_blocks.size(), _large.size(), _next, _end, _used, _largeBytes};
+}
+
+
+void Arena::Release(const Mark& mark)
+{
+	while (_blocks.size() > mark._blocks)
+	{
+		_spare.push_back(std::move(_blocks.back()));
+		_blocks.pop_back();
+	}
+	_large.resize(mark._large);
+	_next = mark._next;
+	_end = mark._end;
+	_used = mark._used;
+	_largeBytes = mark._largeBytes;
+}
+
+
+size_t Arena::GetBytesUsed() const
+{
+	return _used;
+}
+
+
+size_t Arena::GetBytesReserved() const
+{
+	return (_blocks.size() + _spare.size()) * _blockSize + _largeBytes;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+// A fixed-size list of pointers whose storage is owned by an Arena.
+template <typename T>
+struct ArenaList
+{
+	T** _items {nullptr};	// The listed pointers.
+	size_t _size {0};		// Number of listed pointers.
+
+	/**
+	 * @return Number of listed pointers.
+	 */
+	size_t size() const { return _size; }
+
+	/**
+	 * @return true if the list is empty; false otherwise.
+	 */
+	bool empty() const { return _size == 0; }
+
+	/**
+	 * @param i Index of a listed pointer.
+	 * @return The pointer at the specified index.
+	 */
+	T*& operator[](size_t i) const { return _items[i]; }
+
+	// Iterators over the listed pointers.
+	T** begin() const { return _items; }
+	T** end() const { return _items + _size; }
+};
+
+
+// Bump allocator that places objects contiguously in allocation order. All
+// storage is released at once when the arena is destroyed and destructors are
+// never run, so objects placed in an arena must not own other resources.
+// Storage handed out after a mark may also be released back to it, so an
+// arena can be reused for a sequence of short-lived trees.
+class Arena
+{
+	using Block = std::unique_ptr<std::byte[]>;
+
+	static const size_t _blockSize {65536};		// Default block size.
+	std::vector<Block> _blocks;	// Allocated blocks of the default size.
+	std::vector<Block> _large;	// Blocks of single large allocations.
+	std::vector<Block> _spare;	// Released blocks kept for reuse.
+	std::byte* _next {nullptr};	// Next free byte in the current block.
+	std::byte* _end {nullptr};	// End of the current block.
+	size_t _used {0};			// Bytes handed out so far.
+	size_t _largeBytes {0};		// Bytes of the large blocks.
+
+public:
+	// Position in an arena that its storage can be released back to.
+	struct Mark
+	{
+		size_t _blocks;		// Number of default-size blocks in use.
+		size_t _large;		// Number of large blocks in use.
+		std::byte* _next;	// Next free byte in the current block.
+		std::byte* _end;	// End of the current block.
+		size_t _used;		// Bytes handed out.
+		size_t _largeBytes;	// Bytes of the large blocks in use.
+	};
+
+	// Default constructor.
+	Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	/**
+	 * Allocates uninitialized storage.
+	 * @param size Number of bytes to allocate.
+	 * @param align Required alignment of the storage. Must not exceed the
+	 * alignment guaranteed by operator new.
+	 * @return Pointer to the storage.
+	 */
+	void* Allocate(size_t size, size_t align);
+
+	/**
+	 * Constructs an object in the arena.
+	 * @param args Arguments forwarded to the object's constructor.
+	 * @return Pointer to the new object.
+	 */
+	template <typename T, typename... Args>
+	T* Create(Args&&... args)
+	{
+		return new (Allocate(sizeof(T), alignof(T)))
+			T(std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Copies a list of pointers into the arena.
+	 * @param items Pointers to be copied.
+	 * @return List referring to the copy.
+	 */
+	template <typename T>
+	ArenaList<T> CreateList(const std::vector<T*>& items)
+	{
+		ArenaList<T> list;
+		list._size = items.size();
+		if (list._size == 0) return list;
+		list._items = static_cast<T**>(
+			Allocate(sizeof(T*) * list._size, alignof(T*)));
+		std::memcpy(list._items, items.data(), sizeof(T*) * list._size);
+		return list;
+	}
+
+	/**
+	 * @return The current position of the arena.
+	 */
+	Mark GetMark() const;
+
+	/**
+	 * Releases all storage handed out since a mark was taken, invalidating
+	 * the objects placed in it. Blocks are kept for reuse, so an arena that
+	 * is repeatedly released holds only as many as its largest use needs.
+	 * @param mark Mark taken earlier of this arena, with no release back to
+	 * an earlier mark in between.
+	 */
+	void Release(const Mark& mark);
+
+	/**
+	 * @return Number of bytes handed out by the arena.
+	 */
+	size_t GetBytesUsed() const;
+
+	/**
+	 * @return Number of bytes of blocks held by the arena, whether in use or
+	 * kept for reuse.
+	 */
+	size_t GetBytesReserved() const;
+};
@@ -0,0 +1,412 @@
+#include "cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <system_error>
+#include <vector>
+
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+
+// Identifies an entry file, and its format version.
+static const uint32_t entryMagic {0x3143434C};	// "LCC1" in little endian.
+// Extension of entry files.
+static const std::string_view entryExt {".entry"sv};
+// Infix of the temporary files entries are written to.
+static const std::string_view tempInfix {".tmp"sv};
+// Age after which a temporary file is deemed abandoned by its writer.
+static const std::chrono::hours tempMaxAge {1};
+// Name of the file holding the estimate of the entries' size.
+static const std::string_view estimateName {"size.estimate"sv};
+// Identifies an estimate file, and its format version.
+static const uint32_t estimateMagic {0x3153434C};	// "LCS1" in little endian.
+// Stores after which the entries are measured anew, correcting the estimate
+// for updates lost when processes stored concurrently.
+static const uint64_t measureInterval {1000};
+// Characters of a key naming the subdirectory holding its entry.
+static const size_t fanOutChars {2};
+
+
+// Header of an entry file, followed by the output and diagnostics.
+struct EntryHeader
+{
+	uint32_t _magic;		// entryMagic.
+	int32_t _status;		// Exit status of the compilation.
+	uint64_t _outSize;		// Length of the standard output.
+	uint64_t _errSize;		// Length of the diagnostics.
+};
+
+
+// Contents of the estimate file.
+struct EstimateRecord
+{
+	uint32_t _magic;		// estimateMagic.
+	uint32_t _reserved;		// Zero.
+	uint64_t _bytes;		// Estimated size of the entries.
+	uint64_t _stores;		// Stores since the entries were last measured.
+};
+
+
+// Computes SHA-256 digests (FIPS 180-4) of data given in pieces.
+class SHA256
+{
+	static constexpr uint32_t _k[64] {
+		0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1,
+		0x923F82A4, 0xAB1C5ED5, 0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+		0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174, 0xE49B69C1, 0xEFBE4786,
+		0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+		0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147,
+		0x06CA6351, 0x14292967, 0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+		0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85, 0xA2BFE8A1, 0xA81A664B,
+		0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+		0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A,
+		0x5B9CCA4F, 0x682E6FF3, 0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+		0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+	uint32_t _h[8] {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+		0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+	uint8_t _block[64];		// Data not yet compressed.
+	size_t _used {0};		// Bytes of _block in use.
+	uint64_t _length {0};	// Bytes hashed so far.
+
+	/**
+	 * @param x A word.
+	 * @param n Number of bits to rotate by, in [1, 31].
+	 * @return The word rotated right.
+	 */
+	static uint32_t Rotate(uint32_t x, int n)
+	{
+		return (x >> n) | (x << (32 - n));
+	}
+
+	// Compresses the full block into the state.
+	void Compress()
+	{
+		uint32_t w[64];
+		for (int i {0}; i < 16; ++ i)
+		{
+			w[i] = static_cast<uint32_t>(_block[i * 4]) << 24
+				| static_cast<uint32_t>(_block[i * 4 + 1]) << 16
+				| static_cast<uint32_t>(_block[i * 4 + 2]) << 8
+				| static_cast<uint32_t>(_block[i * 4 + 3]);
+		}
+		for (int i {16}; i < 64; ++ i)
+		{
+			const uint32_t s0 {Rotate(w[i - 15], 7) ^ Rotate(w[i - 15], 18)
+				^ (w[i - 15] >> 3)};
+			const uint32_t s1 {Rotate(w[i - 2], 17) ^ Rotate(w[i - 2], 19)
+				^ (w[i - 2] >> 10)};
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t v[8];
+		std::copy(_h, _h + 8, v);
+		for (int i {0}; i < 64; ++ i)
+		{
+			const uint32_t s1 {Rotate(v[4], 6) ^ Rotate(v[4], 11)
+				^ Rotate(v[4], 25)};
+			const uint32_t ch {(v[4] & v[5]) ^ (~v[4] & v[6])};
+			const uint32_t t1 {v[7] + s1 + ch + _k[i] + w[i]};
+			const uint32_t s0 {Rotate(v[0], 2) ^ Rotate(v[0], 13)
+				^ Rotate(v[0], 22)};
+			const uint32_t maj {(v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2])};
+			std::copy_backward(v, v + 7, v + 8);
+			v[4] += t1;
+			v[0] = t1 + s0 + maj;
+		}
+		for (int i {0}; i < 8; ++ i) _h[i] += v[i];
+	}
+
+public:
+	/**
+	 * Appends data to that hashed.
+	 * @param data The data.
+	 */
+	void Update(std::string_view data)
+	{
+		_length += data.size();
+		for (char c : data)
+		{
+			_block[_used ++] = static_cast<uint8_t>(c);
+			if (_used == 64)
+			{
+				Compress();
+				_used = 0;
+			}
+		}
+	}
+
+	/**
+	 * Appends data to that hashed, preceded by its length, so the pieces
+	 * hashed cannot be told apart only by where one ends and the next begins.
+	 * @param data The data.
+	 */
+	void UpdateSized(std::string_view data)
+	{
+		char size[8];
+		for (int i {0}; i < 8; ++ i)
+			size[i] = static_cast<char>(data.size() >> (8 * i));
+		Update(std::string_view(size, 8));
+		Update(data);
+	}
+
+	/**
+	 * Completes the digest. The object must not be updated afterwards.
+	 * @return The digest, in hexadecimal.
+	 */
+	std::string HexDigest()
+	{
+		const uint64_t bits {_length * 8};
+		Update("\x80"sv);
+		while (_used != 56) Update(std::string_view("\0", 1));
+		for (int i {7}; i >= 0; -- i)
+		{
+			const char byte {static_cast<char>(bits >> (8 * i))};
+			Update(std::string_view(&byte, 1));
+		}
+
+		static const char digits[] {"0123456789abcdef"};
+		std::string hex;
+		for (uint32_t word : _h)
+		{
+			for (int shift {28}; shift >= 0; shift -= 4)
+				hex += digits[(word >> shift) & 0xF];
+		}
+		return hex;
+	}
+};
+
+
+/**
+ * @param path Path of a file to be replaced.
+ * @return Path of a temporary file in the same directory, to be written and
+ * renamed to the path. Each writer has its own, named by a number drawn once
+ * per process and a count of the files it named.
+ */
+static fs::path tempPathOf(const fs::path& path)
+{
+	static const uint64_t process {(static_cast<uint64_t>(
+		std::random_device {}()) << 32) | std::random_device {}()};
+	static std::atomic<uint64_t> count {0};
+	fs::path temp {path};
+	temp += std::string(tempInfix) + std::to_string(process) + '.'
+		+ std::to_string(count ++);
+	return temp;
+}
+
+
+fs::path CompileCache::PathOf(std::string_view key) const
+{
+	return _dir / std::string(key.substr(0, fanOutChars))
+		/ (std::string(key) + std::string(entryExt));
+}
+
+
+bool CompileCache::ReadEstimate(uint64_t& bytes, uint64_t& stores) const
+{
+	std::ifstream in {_dir / estimateName, std::ios::binary};
+	EstimateRecord rec {};
+	in.read(reinterpret_cast<char*>(&rec), sizeof(rec));
+	if (!in || rec._magic != estimateMagic) return false;
+	bytes = rec._bytes;
+	stores = rec._stores;
+	return true;
+}
+
+
+void CompileCache::WriteEstimate(uint64_t bytes, uint64_t stores) const
+{
+	const fs::path path {_dir / estimateName};
+	const fs::path temp {tempPathOf(path)};
+	const EstimateRecord rec {estimateMagic, 0, bytes, stores};
+	std::error_code ec;
+	{
+		std::ofstream out {temp, std::ios::binary};
+		out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+		out.close();
+		if (!out)
+		{
+			fs::remove(temp, ec);
+			return;
+		}
+	}
+	fs::rename(temp, path, ec);
+	if (ec) fs::remove(temp, ec);
+}
+
+
+void CompileCache::Evict()
+{
+	// An entry's modification time is when it was last stored or found.
+	struct Item
+	{
+		fs::file_time_type _time;	// Time the entry was last used.
+		uint64_t _size;				// Size of the entry's file.
+		fs::path _path;				// Path of the entry's file.
+	};
+
+	std::error_code ec;
+	std::vector<Item> items;
+	const fs::file_time_type now {fs::file_time_type::clock::now()};
+	uint64_t bytes {0};
+	for (fs::recursive_directory_iterator it {_dir, ec}, end;
+		!ec && it != end; it.increment(ec))
+	{
+		if (!it->is_regular_file(ec)) continue;
+		const fs::path path {it->path()};
+		const std::string name {path.filename().string()};
+		const uint64_t size {it->file_size(ec)};
+		const fs::file_time_type time {it->last_write_time(ec)};
+		if (ec)
+		{
+			ec.clear();		// Removed by another process meanwhile.
+			continue;
+		}
+		if (name.ends_with(entryExt))
+		{
+			items.push_back(Item {time, size, path});
+			bytes += size;
+		}
+		else if (name.find(tempInfix) != std::string::npos
+			&& now - time > tempMaxAge)
+		{
+			fs::remove(path, ec);
+			ec.clear();
+		}
+	}
+
+	// Leave some room, so the next few stores do not each measure anew.
+	if (bytes > _maxBytes)
+	{
+		const uint64_t target {_maxBytes - _maxBytes / 10};
+		std::sort(items.begin(), items.end(), [](const Item& a, const Item& b)
+			{ return a._time < b._time; });
+		for (const Item& item : items)
+		{
+			if (bytes <= target) break;
+			if (fs::remove(item._path, ec)) ++ _evictions;
+			bytes -= item._size;
+		}
+	}
+	WriteEstimate(bytes, 0);
+}
+
+
+CompileCache::CompileCache(fs::path dir, uint64_t max_bytes)
+	: _dir {std::move(dir)}, _maxBytes {max_bytes}
+{
+	fs::create_directories(_dir);
+}
+
+
+std::string CompileCache::Key(
+	std::string_view config, std::string_view path, std::string_view src)
+{
+	SHA256 hash;
+	hash.UpdateSized(config);
+	hash.UpdateSized(path);
+	hash.UpdateSized(src);
+	return hash.HexDigest();
+}
+
+
+bool CompileCache::Find(std::string_view key, Entry& entry)
+{
+	const fs::path path {PathOf(key)};
+	std::ifstream in {path, std::ios::binary | std::ios::ate};
+	if (!in)
+	{
+		++ _misses;
+		return false;
+	}
+
+	const uint64_t size {static_cast<uint64_t>(in.tellg())};
+	EntryHeader header {};
+	in.seekg(0);
+	in.read(reinterpret_cast<char*>(&header), sizeof(header));
+	const bool valid {in && header._magic == entryMagic
+		&& header._outSize <= size - sizeof(header)
+		&& header._errSize == size - sizeof(header) - header._outSize};
+	if (valid)
+	{
+		entry._out.resize(header._outSize);
+		entry._err.resize(header._errSize);
+		in.read(entry._out.data(), static_cast<std::streamsize>(
+			header._outSize));
+		in.read(entry._err.data(), static_cast<std::streamsize>(
+			header._errSize));
+		entry._status = header._status;
+	}
+	std::error_code ec;
+	if (!valid || !in)
+	{
+		in.close();
+		fs::remove(path, ec);
+		++ _misses;
+		return false;
+	}
+
+	fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+	++ _hits;
+	return true;
+}
+
+
+void CompileCache::Store(std::string_view key, const Entry& entry)
+{
+	const fs::path path {PathOf(key)};
+	const fs::path temp {tempPathOf(path)};
+	const EntryHeader header {entryMagic, entry._status,
+		entry._out.size(), entry._err.size()};
+	std::error_code ec;
+	fs::create_directory(path.parent_path(), ec);
+	{
+		std::ofstream out {temp, std::ios::binary};
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(entry._out.data(),
+			static_cast<std::streamsize>(entry._out.size()));
+		out.write(entry._err.data(),
+			static_cast<std::streamsize>(entry._err.size()));
+		out.close();
+		if (!out)
+		{
+			fs::remove(temp, ec);
+			return;
+		}
+	}
+	// Renaming replaces any entry atomically, so readers see a whole one.
+	// An entry replaced only adds the difference in size to the estimate.
+	uint64_t replaced {fs::file_size(path, ec)};
+	if (ec) replaced = 0;
+	fs::rename(temp, path, ec);
+	if (ec)
+	{
+		fs::remove(temp, ec);
+		return;
+	}
+	++ _stores;
+
+	std::lock_guard<std::mutex> guard {_lock};
+	uint64_t bytes;
+	uint64_t stores;
+	if (!ReadEstimate(bytes, stores) || stores >= measureInterval)
+	{
+		Evict();
+		return;
+	}
+	const uint64_t size {sizeof(header) + entry._out.size()
+		+ entry._err.size()};
+	bytes = bytes + size > replaced ? bytes + size - replaced : 0;
+	if (bytes > _maxBytes) Evict();
+	else WriteEstimate(bytes, stores + 1);
+}
+
+
+CompileCache::Stats CompileCache::GetStats() const
+{
+	return Stats {_hits, _misses, _stores, _evictions};
+}
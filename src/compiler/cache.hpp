@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+
+// Stores the results of compilations in a directory shared by any number of
+// compiler processes, keyed by a hash of everything that determines them: the
+// compiler version, the options affecting output, the path reported in
+// diagnostics and the source itself. Each result is a file written under a
+// temporary name and renamed into place, so readers only ever see complete
+// entries. Reading an entry marks it as recently used, and once the entries
+// outgrow the size bound the least recently used are removed. Entries are
+// spread over subdirectories named by the first two characters of their keys,
+// and an estimate of their total size is kept in a file of its own, updated
+// by each store, so the entries are only measured when the estimate exceeds
+// the bound or has not been measured for many stores.
+class CompileCache
+{
+public:
+	// Result of a compilation.
+	struct Entry
+	{
+		std::string _out;	// Standard output of the compilation.
+		std::string _err;	// Rendered diagnostics.
+		int _status {0};	// Exit status of the compilation.
+	};
+
+	// Counts of cache operations performed through this object.
+	struct Stats
+	{
+		size_t _hits {0};		// Lookups that found an entry.
+		size_t _misses {0};		// Lookups that found none.
+		size_t _stores {0};		// Entries written.
+		size_t _evictions {0};	// Entries removed to respect the bound.
+	};
+
+private:
+	std::filesystem::path _dir;		// Directory holding the entries.
+	uint64_t _maxBytes;				// Bound on the size of the entries.
+	std::mutex _lock;				// Serializes updates of the estimate.
+	std::atomic<size_t> _hits {0};
+	std::atomic<size_t> _misses {0};
+	std::atomic<size_t> _stores {0};
+	std::atomic<size_t> _evictions {0};
+
+	/**
+	 * @param key Key of an entry.
+	 * @return Path of the entry's file.
+	 */
+	std::filesystem::path PathOf(std::string_view key) const;
+
+	/**
+	 * Reads the estimate of the entries' size.
+	 * @param bytes Destination of the estimated size.
+	 * @param stores Destination of the number of stores since the entries
+	 * were last measured.
+	 * @return false if there is no valid estimate; true otherwise.
+	 */
+	bool ReadEstimate(uint64_t& bytes, uint64_t& stores) const;
+
+	/**
+	 * Replaces the estimate of the entries' size. Failures are ignored.
+	 * @param bytes Estimated size.
+	 * @param stores Number of stores since the entries were last measured.
+	 */
+	void WriteEstimate(uint64_t bytes, uint64_t stores) const;
+
+	/**
+	 * Measures the entries and removes the least recently used until they
+	 * fit the bound, along with temporary files abandoned by processes that
+	 * stopped while writing, then records the size of those left as the
+	 * estimate. Must be called with _lock held.
+	 */
+	void Evict();
+
+public:
+	/**
+	 * Construct a cache over a directory, creating it if needed.
+	 * @param dir Directory holding the entries.
+	 * @param max_bytes Bound on the total size of the entries.
+	 * @throws std::filesystem::filesystem_error If the directory cannot be
+	 * created.
+	 */
+	CompileCache(std::filesystem::path dir, uint64_t max_bytes);
+
+	CompileCache(const CompileCache&) = delete;
+	CompileCache& operator=(const CompileCache&) = delete;
+
+	/**
+	 * Computes the key of a compilation.
+	 * @param config Compiler version and options affecting the output.
+	 * @param path Path of the source, as reported in diagnostics.
+	 * @param src The source.
+	 * @return Key of the compilation: a SHA-256 digest, in hexadecimal.
+	 */
+	static std::string Key(
+		std::string_view config, std::string_view path, std::string_view src);
+
+	/**
+	 * Looks up the result of a compilation and marks it as recently used.
+	 * Unreadable or damaged entries are removed and count as misses.
+	 * @param key Key of the compilation.
+	 * @param entry Destination of the result.
+	 * @return true if the result was found; false otherwise.
+	 */
+	bool Find(std::string_view key, Entry& entry);
+
+	/**
+	 * Stores the result of a compilation, replacing any stored under the
+	 * same key. Failures to write are ignored, as the cache is only an aid.
+	 * @param key Key of the compilation.
+	 * @param entry The result.
+	 */
+	void Store(std::string_view key, const Entry& entry);
+
+	/**
+	 * @return Counts of the operations performed so far.
+	 */
+	Stats GetStats() const;
+};
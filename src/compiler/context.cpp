@@ -0,0 +1,176 @@
+#include "context.hpp"
+
+#include "parser/parserTools.hpp"
+#include "syntaxTree/globals.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std::string_view_literals;
+
+
+CompilerContext::CompilerContext(size_t error_limit, LexerKind lexer)
+	: _diag{nullptr, error_limit}, _lexer {lexer}
+{}
+
+
+AST& CompilerContext::GetAST()
+{
+	return _ast;
+}
+
+
+DiagnosticEngine& CompilerContext::GetDiagnosticEngine()
+{
+	return _diag;
+}
+
+
+std::string CompilerContext::GetDiagnostics() const
+{
+	return _diag.ToString();
+}
+
+
+bool CompilerContext::Parse(carb_stack& stack, TU& tu)
+{
+	_diag.SetSource(&tu);
+	try { return Parser::getAST(stack, tu, _ast, _diag, _lexer); }
+	catch (std::runtime_error& e) { _diag.Error(DiagID::Internal, {e.what()}); }
+	return false;
+}
+
+
+bool CompilerContext::CheckMain(const SymbolTable& globals)
+{
+	const Name main {_ast._names.Find("main"sv)};
+	if (main.IsNull() || dyn_cast<Function>(globals.Lookup(main)) == nullptr)
+	{
+		_diag.Error(DiagID::MainUndefined);
+		return false;
+	}
+	return true;
+}
+
+
+bool CompilerContext::Check(TU& tu, size_t workers)
+{
+	const size_t count {_ast.size()};
+	_diag.SetSource(&tu);
+	std::vector<DiagnosticEngine> diags (count, DiagnosticEngine {&tu});
+	// Success of each global; not vector<bool> as workers write concurrently.
+	std::vector<char> ok (count, true);
+
+	// Define the globals in source order, resolving global initializers.
+	SymbolTable globals;
+	globals.Enter();
+	std::vector<size_t> functions;
+	// Number of global definitions visible within each function.
+	std::vector<uint32_t> visible (count);
+	for (size_t i {0}; i < count; ++ i)
+	{
+		ScopeData scope {&tu, diags[i]};
+		if (Function* fn {dyn_cast<Function>(_ast[i])})
+		{
+			ok[i] = fn->Define(globals, scope);
+			visible[i] = globals.GetDefinitionCount();
+			functions.push_back(i);
+		}
+		else ok[i] = _ast[i]->Scope(globals, scope);
+	}
+
+	// Resolve each body in a table that sees only the preceding globals.
+	parallelFor(functions.size(), workers, [&](size_t j)
+	{
+		const size_t i {functions[j]};
+		SymbolTable symbols {&globals, visible[i]};
+		ScopeData scope {&tu, diags[i]};
+		ok[i] = cast<Function>(_ast[i])->ScopeBody(symbols, scope) && ok[i];
+	});
+	for (DiagnosticEngine& diag : diags) _diag.Merge(diag);
+	if (std::find(ok.begin(), ok.end(), false) != ok.end()) return false;
+	if (!CheckMain(globals)) return false;
+
+	parallelFor(count, workers, [&](size_t i)
+	{
+		ValidateData dat {&tu, &_ast._types, diags[i]};
+		ok[i] = _ast[i]->Validate(dat);
+	});
+	for (DiagnosticEngine& diag : diags) _diag.Merge(diag);
+	return std::find(ok.begin(), ok.end(), false) == ok.end();
+}
+
+
+bool CompilerContext::CheckFused(TU& tu)
+{
+	_diag.SetSource(&tu);
+	SymbolTable symbols;
+	symbols.Enter();
+	ScopeData scope {&tu, _diag};
+	DiagnosticEngine validation {&tu};
+	ValidateData dat {&tu, &_ast._types, validation};
+	dat._symbols = &symbols;
+	dat._scope = &scope;
+
+	bool success {true};
+	for (SyntaxTreeNode* node : _ast)
+	{
+		if (_diag.ShouldAbort()) return false;
+		success = node->Check(dat) && success;
+	}
+	if (!dat._resolved || !CheckMain(symbols)) return false;
+	_diag.Merge(validation);
+	return success;
+}
+
+
+bool CompilerContext::Stream(carb_stack& stack, TU& tu,
+	const std::function<void(SyntaxTreeNode*)>& emit)
+{
+	SymbolTable globals;
+	globals.Enter();
+	// Check diagnostics are held back until parsing succeeds, and validation
+	// diagnostics until resolution of the whole program does, as Parse()
+	// and Check() would only then report them.
+	DiagnosticEngine resolution {&tu};
+	DiagnosticEngine validation {&tu};
+	bool resolved {true};
+	bool valid {true};
+	const Arena::Mark start {_ast._arena.GetMark()};
+	_ast._consumer = [&](SyntaxTreeNode* node)
+	{
+		if (_diag.GetErrorCount() == 0)
+		{
+			ScopeData scope {&tu, resolution};
+			bool ok;
+			if (Function* fn {dyn_cast<Function>(node)})
+			{
+				ok = fn->Define(globals, scope);
+				SymbolTable symbols {&globals, globals.GetDefinitionCount()};
+				ok = fn->ScopeBody(symbols, scope) && ok;
+			}
+			else ok = node->Scope(globals, scope);
+			resolved = resolved && ok;
+			if (ok)
+			{
+				ValidateData dat {&tu, &_ast._types, validation};
+				valid = node->Validate(dat) && valid;
+			}
+		}
+		emit(node);
+
+		// Later globals refer to a copy of the signature in place of the node.
+		Declaration* decl {cast<Declaration>(node)};
+		if (globals.Lookup(decl->_name->_id) == decl)
+			globals.Rebind(decl->_name->_id, decl->CopySignature(_decls));
+		_ast._arena.Release(start);
+	};
+	const bool parsed {Parse(stack, tu)};
+	_ast._consumer = nullptr;
+	if (!parsed) return false;
+
+	_diag.Merge(resolution);
+	if (!resolved || !CheckMain(globals)) return false;
+	_diag.Merge(validation);
+	return valid;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "diagnostics.hpp"
+#include "parser/lexer.hpp"
+#include "parser/parser.h"
+#include "syntaxTree/base.hpp"
+#include "utilities.hpp"
+
+#include <functional>
+#include <string>
+
+
+// Owns all mutable state of the compilation of one program: its interned
+// names, types and node arena (through its AST) and the engine its
+// diagnostics are reported to. Nothing is shared between contexts, so any
+// number of them may compile independently on separate threads.
+class CompilerContext
+{
+	AST _ast;					// Names, types and nodes of the program.
+	DiagnosticEngine _diag;		// Diagnostics reported so far.
+	Arena _decls;				// Signatures of streamed globals.
+	LexerKind _lexer;			// Scanner sources are split with.
+
+	/**
+	 * Reports an error if the program does not define the function 'main'.
+	 * @param globals Symbol table of the program's global symbols.
+	 * @return true if 'main' is defined; false otherwise.
+	 */
+	bool CheckMain(const SymbolTable& globals);
+
+public:
+	/**
+	 * Construct a context.
+	 * @param error_limit Number of errors after which the compilation stops;
+	 * 0 for no limit.
+	 * @param lexer Scanner sources are split into tokens with.
+	 */
+	CompilerContext(size_t error_limit = 0,
+		LexerKind lexer = LexerKind::Carburetta);
+
+	CompilerContext(const CompilerContext&) = delete;
+	CompilerContext& operator=(const CompilerContext&) = delete;
+
+	/**
+	 * @return The AST of the program.
+	 */
+	AST& GetAST();
+
+	/**
+	 * @return Engine diagnostics of this compilation are reported to.
+	 */
+	DiagnosticEngine& GetDiagnosticEngine();
+
+	/**
+	 * @return The diagnostics reported so far, rendered as text.
+	 */
+	std::string GetDiagnostics() const;
+
+	/**
+	 * Parses the complete source of a translation unit into the AST.
+	 * @param stack Parser stack to use. Each thread must use its own.
+	 * @param tu Translation unit to parse.
+	 * @return true if parsing succeeded; false otherwise.
+	 */
+	bool Parse(carb_stack& stack, TU& tu);
+
+	/**
+	 * Performs scope resolution and validation of the AST, and checks that
+	 * the program defines the function 'main'. Global symbols are defined in
+	 * source order first; function bodies are then resolved, and every global
+	 * validated, concurrently. Diagnostics are reported in source order, as a
+	 * serial check would report them.
+	 * @param tu Translation unit the AST was parsed from.
+	 * @param workers Maximum number of threads to use.
+	 * @return true if no errors were discovered; false otherwise.
+	 */
+	bool Check(TU& tu, size_t workers = 1);
+
+	/**
+	 * Performs the same checks as Check(), reporting the same diagnostics,
+	 * in a single serial traversal of the AST that validates each node as
+	 * soon as it and its children are resolved, while they are still in
+	 * cache. Validation diagnostics are held back until resolution of the
+	 * whole program succeeds, as a separate validation pass would only then
+	 * report them. Stops early once errors exceed the error limit.
+	 * @param tu Translation unit the AST was parsed from.
+	 * @return true if no errors were discovered; false otherwise.
+	 */
+	bool CheckFused(TU& tu);
+
+	/**
+	 * Parses and checks the program one global at a time, as the parser
+	 * completes each, instead of holding the whole AST. Each global is
+	 * resolved against the signatures of the preceding ones, validated and
+	 * handed to a callback, then released but for its signature, so memory
+	 * held is proportional to the largest global rather than the program.
+	 * Checking stops at the first parse error, after which globals are only
+	 * handed on. Diagnostics are those of Parse() followed by Check().
+	 * GetAST() holds no globals afterwards.
+	 * @param stack Parser stack to use. Each thread must use its own.
+	 * @param tu Translation unit to parse.
+	 * @param emit Receives each global once it is checked. The global is
+	 * released when it returns.
+	 * @return true if no errors were discovered; false otherwise.
+	 */
+	bool Stream(carb_stack& stack, TU& tu,
+		const std::function<void(SyntaxTreeNode*)>& emit);
+};
@@ -0,0 +1,323 @@
+#include "diagnostics.hpp"
+
+#include "json.hpp"
+
+#include <iterator>
+#include <sstream>
+#include <utility>
+
+using namespace std::string_view_literals;
+
+
+// Name and message format of a DiagID.
+struct DiagMessage
+{
+	std::string_view _name;		// Stable name used in JSON output.
+	std::string_view _format;	// Message format.
+};
+
+
+// Messages of each DiagID, in declaration order.
+static const DiagMessage messages[] {
+	{"internal"sv, "%0"sv},
+	{"too-many-errors"sv, "Too many errors emitted, stopping now."sv},
+	{"unexpected-token"sv, "Unexpected token: %0"sv},
+	{"syntax-error"sv, "Syntax error: %0"sv},
+	{"main-undefined"sv, "The function 'main' is undefined."sv},
+
+	{"symbol-collision"sv, "Symbol collision: %0"sv},
+	{"collision-previous"sv, "Redefines on line %0:"sv},
+	{"unknown-variable"sv, "Unkown variable: %0"sv},
+	{"unknown-symbol"sv, "Unkown symbol: %0"sv},
+	{"misused-function"sv, "Misuse of function identifier: %0"sv},
+	{"unknown-function"sv, "Unknown function: %0"sv},
+
+	{"assignment-type"sv,
+		"Expected assignment expression of type %0, found: %1"sv},
+	{"missing-return"sv,
+		"Non-void function does not return in all control paths: \n%0"sv},
+	{"int-out-of-range"sv, "Ingeger literal is out of range of u32: %0"sv},
+	{"operand-type"sv, "Expected %0 operand of type %1, found: %2"sv},
+	{"mismatched-operands"sv,
+		"Expected operands of matching types, found: %0 and %1"sv},
+	{"unary-operand-type"sv, "Expected operand of type int, found: %0"sv},
+	{"argument-count"sv, "Incorrect number of arguments in call to %0. "
+		"Expected %1, found %2."sv},
+	{"argument-type"sv,
+		"Expected %0 for argument%1 in call to %2, found: %3"sv},
+	{"unreachable-code"sv, "Unreachable code after a returning statement."sv},
+	{"void-variable"sv, "Variable cannot be type void: %0"sv},
+	{"initializer-type"sv, "Expected initializer of type %0, found: %1"sv},
+	{"condition-type"sv,
+		"Expected if statement condition of type bool, found: %0"sv},
+	{"break-depth"sv, "Break count exceeds breakable depth: %0"sv},
+	{"break-type"sv, "Expected break expression of type %0, found: %1"sv},
+	{"missing-break-value"sv, "Expected break expression, none provided."sv},
+	{"return-outside-function"sv,
+		"Return statement occurs outside of a function body."sv},
+	{"missing-return-value"sv,
+		"Return from a function of type %0 is missing a return expression."sv},
+	{"unexpected-return-value"sv,
+		"Unexpected return expression in a void function."sv},
+	{"return-type"sv, "Expected return expression of type %0, found: %1"sv},
+	{"unevaluated-expression"sv, "Evaluation never occurs as it appears "
+		"after a return statement."sv},
+};
+
+static_assert(std::size(messages) == static_cast<size_t>(DiagID::Count),
+	"Every DiagID needs a message.");
+
+
+/**
+ * @param id A message ID.
+ * @return The name and format of the message.
+ */
+static const DiagMessage& getMessage(DiagID id)
+{
+	return messages[static_cast<size_t>(id)];
+}
+
+
+/**
+ * @param severity A severity.
+ * @return Lowercase name of the severity.
+ */
+static std::string_view getSeverityName(Severity severity)
+{
+	switch (severity)
+	{
+		case Severity::Note:	return "note"sv;
+		case Severity::Warning:	return "warning"sv;
+		case Severity::Error:	return "error"sv;
+		case Severity::Fatal:	return "fatal"sv;
+	}
+
+	return ""sv; // Shouldn't ever reach this but the compiler complains.
+}
+
+
+/**
+ * @param lhs A location.
+ * @param rhs Another location.
+ * @return true if both locations span the same characters; false otherwise.
+ */
+static bool isSameSpan(const SourceLocation& lhs, const SourceLocation& rhs)
+{
+	return lhs._file == rhs._file && lhs._off == rhs._off
+		&& lhs._len == rhs._len;
+}
+
+
+bool operator==(const Diagnostic& lhs, const Diagnostic& rhs)
+{
+	return lhs._severity == rhs._severity && lhs._id == rhs._id
+		&& lhs._located == rhs._located && isSameSpan(lhs._loc, rhs._loc)
+		&& isSameSpan(lhs._highlight, rhs._highlight)
+		&& lhs._args == rhs._args;
+}
+
+
+DiagnosticEngine::DiagnosticEngine(const TU* src, size_t error_limit)
+	: _src{src}, _errorLimit{error_limit}
+{}
+
+
+void DiagnosticEngine::SetSource(const TU* src)
+{
+	_src = src;
+}
+
+
+void DiagnosticEngine::SetErrorLimit(size_t error_limit)
+{
+	_errorLimit = error_limit;
+}
+
+
+void DiagnosticEngine::Report(Diagnostic diag)
+{
+	if (diag._severity == Severity::Note)
+	{
+		if (!_dropping) _diags.push_back(std::move(diag));
+		return;
+	}
+
+	// Compare with the last diagnostic kept that is not a note.
+	auto last {_diags.rbegin()};
+	while (last != _diags.rend() && last->_severity == Severity::Note) ++ last;
+	_dropping = last != _diags.rend() && *last == diag;
+	if (_dropping) return;
+
+	if (diag._severity >= Severity::Error)
+	{
+		if (_errorLimit != 0 && _errors >= _errorLimit)
+		{
+			if (!_limited)
+			{
+				_diags.push_back(Diagnostic {Severity::Fatal,
+					DiagID::TooManyErrors});
+				_limited = true;
+			}
+			_dropping = true;
+			return;
+		}
+		++ _errors;
+	}
+	_diags.push_back(std::move(diag));
+}
+
+
+void DiagnosticEngine::Error(DiagID id, const SourceLocation& loc,
+	std::initializer_list<std::string_view> args)
+{
+	ErrorAt(id, loc, loc, args);
+}
+
+
+void DiagnosticEngine::ErrorAt(DiagID id, const SourceLocation& loc,
+	const SourceLocation& highlight,
+	std::initializer_list<std::string_view> args)
+{
+	Report(Diagnostic {Severity::Error, id, true, loc, highlight,
+		std::vector<std::string> (args.begin(), args.end())});
+}
+
+
+void DiagnosticEngine::Error(
+	DiagID id, std::initializer_list<std::string_view> args)
+{
+	Report(Diagnostic {Severity::Error, id, false, {}, {},
+		std::vector<std::string> (args.begin(), args.end())});
+}
+
+
+void DiagnosticEngine::Note(DiagID id, const SourceLocation& loc,
+	std::initializer_list<std::string_view> args)
+{
+	Report(Diagnostic {Severity::Note, id, true, loc, loc,
+		std::vector<std::string> (args.begin(), args.end())});
+}
+
+
+void DiagnosticEngine::Merge(DiagnosticEngine& other)
+{
+	for (Diagnostic& diag : other._diags) Report(std::move(diag));
+	other.Clear();
+}
+
+
+bool DiagnosticEngine::ShouldAbort() const
+{
+	return _limited;
+}
+
+
+size_t DiagnosticEngine::GetErrorCount() const
+{
+	return _errors;
+}
+
+
+const std::vector<Diagnostic>& DiagnosticEngine::GetDiagnostics() const
+{
+	return _diags;
+}
+
+
+std::string DiagnosticEngine::GetMessage(const Diagnostic& diag)
+{
+	std::ostringstream out;
+	WriteMessage(out, diag);
+	return out.str();
+}
+
+
+std::string_view DiagnosticEngine::GetName(DiagID id)
+{
+	return getMessage(id)._name;
+}
+
+
+void DiagnosticEngine::WriteMessage(std::ostream& os, const Diagnostic& diag)
+{
+	const std::string_view format {getMessage(diag._id)._format};
+	size_t start {0};
+	for (size_t i {0}; i + 1 < format.size(); ++ i)
+	{
+		if (format[i] != '%' || format[i + 1] < '0' || format[i + 1] > '9')
+			continue;
+		const size_t arg {static_cast<size_t>(format[i + 1] - '0')};
+		os << format.substr(start, i - start);
+		if (arg < diag._args.size()) os << diag._args[arg];
+		start = ++ i + 1;
+	}
+	os << format.substr(start);
+}
+
+
+void DiagnosticEngine::Render(std::ostream& os) const
+{
+	std::ostringstream out;
+	for (const Diagnostic& diag : _diags)
+	{
+		if (diag._severity == Severity::Note) out << "# "sv;
+		else if (diag._located) out << _src->Locate(diag._loc) << ": "sv;
+		WriteMessage(out, diag);
+		out << '\n';
+		if (diag._located) _src->HighlightError(out, diag._highlight);
+	}
+	os << out.view();
+}
+
+
+void DiagnosticEngine::RenderJSON(std::ostream& os) const
+{
+	std::ostringstream out;
+	std::ostringstream message;
+	for (const Diagnostic& diag : _diags)
+	{
+		message.str({});
+		WriteMessage(message, diag);
+		out << "{\"severity\":"sv;
+		writeJSONString(out, getSeverityName(diag._severity));
+		out << ",\"id\":"sv;
+		writeJSONString(out, getMessage(diag._id)._name);
+		out << ",\"message\":"sv;
+		writeJSONString(out, message.view());
+		out << ",\"args\":["sv;
+		for (size_t i {0}; i < diag._args.size(); ++ i)
+		{
+			if (i != 0) out << ',';
+			writeJSONString(out, diag._args[i]);
+		}
+		out << ']';
+		if (diag._located)
+		{
+			const SourcePosition pos {_src->Locate(diag._loc)};
+			out << ",\"file\":"sv;
+			writeJSONString(out, _src->GetPath());
+			out << ",\"line\":"sv << pos._row << ",\"column\":"sv << pos._col
+				<< ",\"offset\":"sv << diag._loc._off
+				<< ",\"length\":"sv << diag._loc._len;
+		}
+		out << "}\n"sv;
+	}
+	os << out.view();
+}
+
+
+std::string DiagnosticEngine::ToString() const
+{
+	std::ostringstream out;
+	Render(out);
+	return out.str();
+}
+
+
+void DiagnosticEngine::Clear()
+{
+	_diags.clear();
+	_errors = 0;
+	_dropping = false;
+	_limited = false;
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "utilities.hpp"
+
+#include <cstdint>
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Severity of a diagnostic.
+enum class Severity : uint8_t
+{
+	Note,		// Adds detail to the preceding diagnostic.
+	Warning,	// Reports a likely mistake that does not fail compilation.
+	Error,		// Reports a mistake that fails compilation.
+	Fatal,		// Reports that compilation was abandoned.
+};
+
+
+// Identifies the message of a diagnostic. Each message is a format in which
+// "%0" to "%9" are replaced with the diagnostic's arguments.
+enum class DiagID : uint16_t
+{
+	// Reported by the driver and parser.
+	Internal,				// "%0"
+	TooManyErrors,			// Error limit reached.
+	UnexpectedToken,		// Lexical error.
+	SyntaxError,			// Syntactic error.
+	MainUndefined,			// Program does not define 'main'.
+
+	// Reported by scope resolution.
+	SymbolCollision,		// Name defined twice in one scope.
+	CollisionPrevious,		// Note locating the first definition.
+	UnknownVariable,		// Assignment to an undefined name.
+	UnknownSymbol,			// Use of an undefined name.
+	MisusedFunction,		// Function used as a variable.
+	UnknownFunction,		// Call of an undefined function.
+
+	// Reported by validation.
+	AssignmentType,			// Assigned value has the wrong type.
+	MissingReturn,			// Non-void function may not return.
+	IntOutOfRange,			// Integer literal exceeds u32.
+	OperandType,			// Binary operand has the wrong type.
+	MismatchedOperands,		// Compared operands differ in type.
+	UnaryOperandType,		// Unary operand is not an int.
+	ArgumentCount,			// Call has the wrong number of arguments.
+	ArgumentType,			// Call argument has the wrong type.
+	UnreachableCode,		// Statement follows a returning one.
+	VoidVariable,			// Variable declared void.
+	InitializerType,		// Initializer has the wrong type.
+	ConditionType,			// If condition is not a bool.
+	BreakDepth,				// Break leaves more loops than enclose it.
+	BreakType,				// Break value has the wrong type.
+	MissingBreakValue,		// Break without a value from a valued loop.
+	ReturnOutsideFunction,	// Return outside of a function body.
+	MissingReturnValue,		// Return without a value from a non-void one.
+	UnexpectedReturnValue,	// Return with a value from a void function.
+	ReturnType,				// Returned value has the wrong type.
+	UnevaluatedExpression,	// Block value follows a return.
+
+	Count,					// Number of messages.
+};
+
+
+// A diagnostic as it was reported, rendered to text or JSON only on output.
+struct Diagnostic
+{
+	Severity _severity {Severity::Error};	// Severity of the diagnostic.
+	DiagID _id {DiagID::Internal};			// Message of the diagnostic.
+	bool _located {false};		// Indicates _loc and _highlight are set.
+	SourceLocation _loc;		// Location the message refers to.
+	SourceLocation _highlight;	// Span highlighted beneath the message.
+	std::vector<std::string> _args;	// Arguments of the message.
+
+	// Equality operator overload.
+	friend bool operator==(const Diagnostic& lhs, const Diagnostic& rhs);
+};
+
+
+// Collects the diagnostics of the compilation of one TU so they can be
+// rendered in a single write once the compilation is done. An engine is used
+// by one thread at a time. Work split over threads reports to separate
+// engines instead, one per unit of work, which are merged in order so the
+// error limit keeps the same errors however the work was scheduled.
+class DiagnosticEngine
+{
+	const TU* _src {nullptr};		// Source the diagnostics refer to.
+	size_t _errorLimit {0};			// Maximum errors kept; 0 if none.
+	size_t _errors {0};				// Number of errors kept.
+	bool _dropping {false};			// Indicates notes are discarded.
+	bool _limited {false};			// Indicates errors are discarded.
+	std::vector<Diagnostic> _diags;	// Diagnostics kept, in order.
+
+	/**
+	 * Writes the message of a diagnostic, with its arguments substituted.
+	 * @param os Stream to write to.
+	 * @param diag Diagnostic whose message is written.
+	 */
+	static void WriteMessage(std::ostream& os, const Diagnostic& diag);
+
+public:
+	/**
+	 * Construct an engine.
+	 * @param src Source the diagnostics refer to. May be set later.
+	 * @param error_limit Number of errors after which further ones are
+	 * discarded and the compilation should stop; 0 for no limit.
+	 */
+	DiagnosticEngine(const TU* src = nullptr, size_t error_limit = 0);
+
+	/**
+	 * @param src Source the diagnostics refer to.
+	 */
+	void SetSource(const TU* src);
+
+	/**
+	 * @param error_limit Number of errors after which further ones are
+	 * discarded and the compilation should stop; 0 for no limit.
+	 */
+	void SetErrorLimit(size_t error_limit);
+
+	/**
+	 * Records a diagnostic unless it repeats the last one recorded, adds
+	 * detail to a discarded one or exceeds the error limit.
+	 * @param diag Diagnostic to be recorded.
+	 */
+	void Report(Diagnostic diag);
+
+	/**
+	 * Records an error about a span of the source, which is highlighted.
+	 * @param id Message of the error.
+	 * @param loc Location of the span.
+	 * @param args Arguments of the message.
+	 */
+	void Error(DiagID id, const SourceLocation& loc,
+		std::initializer_list<std::string_view> args = {});
+
+	/**
+	 * Records an error about a location of the source, highlighting a span
+	 * that differs from it.
+	 * @param id Message of the error.
+	 * @param loc Location the message refers to.
+	 * @param highlight Span highlighted beneath the message.
+	 * @param args Arguments of the message.
+	 */
+	void ErrorAt(DiagID id, const SourceLocation& loc,
+		const SourceLocation& highlight,
+		std::initializer_list<std::string_view> args = {});
+
+	/**
+	 * Records an error that does not refer to the source.
+	 * @param id Message of the error.
+	 * @param args Arguments of the message.
+	 */
+	void Error(DiagID id, std::initializer_list<std::string_view> args = {});
+
+	/**
+	 * Records a note adding detail to the preceding diagnostic, highlighting
+	 * a span of the source.
+	 * @param id Message of the note.
+	 * @param loc Location of the span.
+	 * @param args Arguments of the message.
+	 */
+	void Note(DiagID id, const SourceLocation& loc,
+		std::initializer_list<std::string_view> args = {});
+
+	/**
+	 * Records the diagnostics of another engine, in order, and clears them
+	 * from it. The error limit of this engine applies.
+	 * @param other Engine whose diagnostics are recorded.
+	 */
+	void Merge(DiagnosticEngine& other);
+
+	/**
+	 * @return true if errors past the error limit were discarded, so the
+	 * compilation should stop; false otherwise.
+	 */
+	bool ShouldAbort() const;
+
+	/**
+	 * @return Number of errors kept.
+	 */
+	size_t GetErrorCount() const;
+
+	/**
+	 * @return The diagnostics kept, in order.
+	 */
+	const std::vector<Diagnostic>& GetDiagnostics() const;
+
+	/**
+	 * @param diag A diagnostic.
+	 * @return Message of the diagnostic, with its arguments substituted.
+	 */
+	static std::string GetMessage(const Diagnostic& diag);
+
+	/**
+	 * @param id A message ID.
+	 * @return Stable name of the message, as used in JSON output.
+	 */
+	static std::string_view GetName(DiagID id);
+
+	/**
+	 * Renders the diagnostics kept as text in a single write. Located ones
+	 * begin with their position and are followed by the highlighted line.
+	 * @param os Stream to write to.
+	 */
+	void Render(std::ostream& os) const;
+
+	/**
+	 * Renders the diagnostics kept as JSON Lines in a single write: one
+	 * object per line, with the members "severity", "id", "message" and
+	 * "args", and for located ones "file", "line", "column", "offset" and
+	 * "length".
+	 * @param os Stream to write to.
+	 */
+	void RenderJSON(std::ostream& os) const;
+
+	/**
+	 * @return The diagnostics kept, rendered as text.
+	 */
+	std::string ToString() const;
+
+	// Discards the diagnostics kept and resets the error count.
+	void Clear();
+};
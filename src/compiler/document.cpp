@@ -0,0 +1,451 @@
+#include "document.hpp"
+
+#include "parser/parserTools.hpp"
+#include "syntaxTree/common.hpp"
+#include "syntaxTree/globals.hpp"
+#include "syntaxTree/traverse.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std::string_view_literals;
+
+
+/**
+ * @param node A node.
+ * @return The declaration a variable, invocation or assignment refers to, or
+ * nullptr if the node is none of these or is unresolved.
+ */
+static Declaration* getDefinition(const SyntaxTreeNode* node)
+{
+	switch (node->_kind)
+	{
+		case NodeKind::Variable:
+			return cast<const Variable>(node)->_def;
+		case NodeKind::Invocation:
+			return cast<const Invocation>(node)->_def;
+		case NodeKind::AssignmentExpr:
+			return cast<const AssignmentExpr>(node)->_def;
+		default:
+			return nullptr;
+	}
+}
+
+
+/**
+ * Points a variable, invocation or assignment at a declaration, as its scope
+ * resolution would.
+ * @param node The variable, invocation or assignment.
+ * @param decl The declaration; may be nullptr.
+ * @return true if the declaration is of a kind the node may refer to; false
+ * otherwise, in which case the node is unchanged.
+ */
+static bool setDefinition(SyntaxTreeNode* node, Declaration* decl)
+{
+	switch (node->_kind)
+	{
+		case NodeKind::Variable:
+			if (decl == nullptr || isa<Function>(decl)) return false;
+			cast<Variable>(node)->_def = decl;
+			return true;
+		case NodeKind::Invocation:
+			if (dyn_cast<Function>(decl) == nullptr) return false;
+			cast<Invocation>(node)->_def = cast<Function>(decl);
+			return true;
+		case NodeKind::AssignmentExpr:
+			if (dyn_cast<VariableDef>(decl) == nullptr) return false;
+			cast<AssignmentExpr>(node)->_def = cast<VariableDef>(decl);
+			return true;
+		default:
+			return false;
+	}
+}
+
+
+/**
+ * Describes a declaration as its source would: "<type> <name>" for a
+ * variable or parameter, "<name>(<parameters>) -> <type>" for a function.
+ * @param decl The declaration.
+ * @return The description.
+ */
+static std::string describe(const Declaration& decl)
+{
+	std::string text;
+	const Function* fn {dyn_cast<const Function>(&decl)};
+	if (fn == nullptr)
+	{
+		text += Type::NameOf(decl._type);
+		text += ' ';
+	}
+	text += decl._name->_id.View();
+	if (fn == nullptr) return text;
+
+	text += '(';
+	for (size_t i {0}; i < fn->_params.size(); ++ i)
+	{
+		if (i != 0) text += ", "sv;
+		text += describe(*fn->_params[i]);
+	}
+	text += ") -> "sv;
+	text += Type::NameOf(fn->_type);
+	return text;
+}
+
+
+// Visitor listing the nodes of a function that refer to globals.
+struct RefVisitor
+{
+	const std::unordered_set<const SyntaxTreeNode*>& _globals;	// Globals.
+	std::vector<SyntaxTreeNode*>& _refs;	// Nodes found so far.
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		const Declaration* def {getDefinition(node)};
+		if (def != nullptr && _globals.count(def) != 0) _refs.push_back(node);
+		return true;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i) { return true; }
+	void After(SyntaxTreeNode* node, size_t i) {}
+	void Leave(SyntaxTreeNode* node) {}
+};
+
+
+/**
+ * Lists the distinct globals a function's nodes refer to.
+ * @param refs Nodes of the function that refer to globals.
+ * @param uses Destination of the globals.
+ */
+static void listUses(const std::vector<SyntaxTreeNode*>& refs,
+	std::vector<const Declaration*>& uses)
+{
+	uses.clear();
+	for (const SyntaxTreeNode* ref : refs) uses.push_back(getDefinition(ref));
+	std::sort(uses.begin(), uses.end());
+	uses.erase(std::unique(uses.begin(), uses.end()), uses.end());
+}
+
+
+Document::Document(std::string_view path, uint32_t id)
+	: _path{path}, _id{id}, _tu{std::make_unique<TU>(""sv, path, id)},
+	_ast{std::make_unique<AST>()}, _diag{_tu.get()}
+{}
+
+
+void Document::Parse(carb_stack& stack)
+{
+	_cache.clear();
+	_signatures.clear();
+	_ast = std::make_unique<AST>();
+	_diag = DiagnosticEngine {_tu.get()};
+	try { _parsed = Parser::getAST(stack, *_tu, *_ast, _diag); }
+	catch (std::runtime_error& e)
+	{
+		_diag.Error(DiagID::Internal, {e.what()});
+		_parsed = false;
+	}
+	_liveBytes = _ast->_arena.GetBytesUsed();
+}
+
+
+void Document::Open(carb_stack& stack, std::string_view text)
+{
+	_tu = std::make_unique<TU>(text, _path, _id);
+	Parse(stack);
+	Check();
+}
+
+
+void Document::Edit(carb_stack& stack, const std::vector<TextEdit>& edits)
+{
+	std::unique_ptr<TU> tu {std::make_unique<TU>(*_tu, edits)};
+
+	// Replaced globals stay in the arena, so parse anew once they dominate.
+	if (!_parsed
+		|| _ast->_arena.GetBytesUsed() > _liveBytes * 2 + _compactSlack)
+	{
+		_tu = std::move(tu);
+		Parse(stack);
+	}
+	else
+	{
+		_diag = DiagnosticEngine {tu.get()};
+		try
+		{
+			_parsed = Parser::reparse(stack, *_tu, *tu, *_ast, edits, _diag);
+		}
+		catch (std::runtime_error& e)
+		{
+			_diag.Error(DiagID::Internal, {e.what()});
+			_parsed = false;
+		}
+		_tu = std::move(tu);
+	}
+	Check();
+}
+
+
+bool Document::Redirect(GlobalCache& cache, const SymbolTable& symbols,
+	const std::unordered_set<const SyntaxTreeNode*>& replaced)
+{
+	bool stale {false};
+	for (const Declaration* decl : cache._uses)
+		stale = stale || replaced.count(decl) != 0;
+	if (!stale) return true;
+
+	// Replaced globals remain in the arena, so their names can be read.
+	for (SyntaxTreeNode* ref : cache._refs)
+	{
+		const Declaration* def {getDefinition(ref)};
+		if (replaced.count(def) == 0) continue;
+		if (!setDefinition(ref, symbols.Lookup(def->_name->_id))) return false;
+	}
+	listUses(cache._refs, cache._uses);
+	return true;
+}
+
+
+void Document::CheckFunction(Function& fn, SymbolTable& symbols,
+	GlobalCache& cache,
+	const std::unordered_set<const SyntaxTreeNode*>& globals)
+{
+	++ _checked;
+	DiagnosticEngine resolution {_tu.get()};
+	DiagnosticEngine validation {_tu.get()};
+	ScopeData scope {_tu.get(), resolution};
+	cache._resolved = fn.ScopeBody(symbols, scope);
+	if (cache._resolved)
+	{
+		ValidateData dat {_tu.get(), &_ast->_types, validation};
+		fn.Validate(dat);
+	}
+	cache._checked = true;
+	cache._resolution = resolution.GetDiagnostics();
+	cache._validation = validation.GetDiagnostics();
+	cache._start = fn._off;
+	cache._index = NodeIndex {&fn};
+
+	cache._refs.clear();
+	RefVisitor visitor {globals, cache._refs};
+	traverse(&fn, visitor);
+	listUses(cache._refs, cache._uses);
+}
+
+
+void Document::ReportMoved(DiagnosticEngine& diag,
+	const std::vector<Diagnostic>& diags, int64_t delta) const
+{
+	for (Diagnostic moved : diags)
+	{
+		if (moved._located)
+		{
+			moved._loc._off = static_cast<uint32_t>(moved._loc._off + delta);
+			moved._highlight._off =
+				static_cast<uint32_t>(moved._highlight._off + delta);
+			// Lines may have been added or removed before the global.
+			if (moved._id == DiagID::CollisionPrevious)
+				moved._args[0] = std::to_string(_tu->Locate(moved._loc)._row);
+		}
+		diag.Report(std::move(moved));
+	}
+}
+
+
+void Document::Check()
+{
+	_checked = 0;
+	_starts.clear();
+	if (!_parsed)
+	{
+		_cache.clear();
+		_signatures.clear();
+		return;
+	}
+
+	// Forget the globals the AST no longer holds. The globals are read as
+	// they are, not moved, so those whose results are reused stay unvisited.
+	const std::vector<SyntaxTreeNode*>& nodes {_ast->_globals};
+	const size_t count {nodes.size()};
+	const std::unordered_set<const SyntaxTreeNode*> globals
+		{nodes.begin(), nodes.end()};
+	std::unordered_set<const SyntaxTreeNode*> replaced;
+	for (auto it {_cache.begin()}; it != _cache.end();)
+	{
+		if (globals.count(it->first) != 0) ++ it;
+		else
+		{
+			replaced.insert(it->first);
+			it = _cache.erase(it);
+		}
+	}
+
+	// Functions past the first global whose signature changed may resolve
+	// differently, so only those before it may keep their results.
+	std::vector<Signature> signatures;
+	signatures.reserve(count);
+	for (SyntaxTreeNode* node : nodes)
+	{
+		const Declaration* decl {cast<Declaration>(node)};
+		Signature& sig {signatures.emplace_back(
+			Signature {node->_kind, decl->_name->_id, decl->_type, {}})};
+		if (const Function* fn {dyn_cast<const Function>(node)})
+			for (const Parameter* param : fn->_params)
+				sig._params.push_back(param->_type);
+	}
+	const size_t same {static_cast<size_t>(std::mismatch(
+		signatures.begin(), signatures.end(),
+		_signatures.begin(), _signatures.end()).first - signatures.begin())};
+	_signatures = std::move(signatures);
+
+	// New globals are moved to where they are to be indexed.
+	std::vector<GlobalCache*> caches (count);
+	for (size_t i {0}; i < count; ++ i)
+	{
+		auto [it, inserted] = _cache.try_emplace(nodes[i]);
+		caches[i] = &it->second;
+		caches[i]->_order = i;
+		if (inserted)
+		{
+			SyntaxTreeNode* node {(*_ast)[i]};
+			caches[i]->_start = node->_off;
+			caches[i]->_index = NodeIndex {node};
+		}
+	}
+
+	// Define the globals in source order, as CompilerContext::Check() does.
+	// A function's definition locates nothing unless its name collides, so
+	// it is moved only then, along with the global it collides with.
+	TU* tu {_tu.get()};
+	std::vector<DiagnosticEngine> diags (count, DiagnosticEngine {tu});
+	std::vector<DiagnosticEngine> checks (count, DiagnosticEngine {tu});
+	std::vector<char> ok (count, true);
+	std::vector<uint32_t> visible (count);
+	SymbolTable defined;
+	defined.Enter();
+	for (size_t i {0}; i < count; ++ i)
+	{
+		SyntaxTreeNode* node {nodes[i]};
+		const Declaration* pre
+			{defined.Lookup(cast<Declaration>(node)->_name->_id)};
+		if (pre != nullptr) _ast->Settle(_cache.at(pre)._order);
+		if (pre != nullptr || !isa<Function>(node)) _ast->Settle(i);
+
+		ScopeData scope {tu, diags[i]};
+		if (Function* fn {dyn_cast<Function>(node)})
+		{
+			ok[i] = fn->Define(defined, scope);
+			visible[i] = defined.GetDefinitionCount();
+		}
+		else ok[i] = node->Scope(defined, scope);
+	}
+
+	// Resolve and validate each global, reusing cached function results.
+	for (size_t i {0}; i < count; ++ i)
+	{
+		SyntaxTreeNode* node {nodes[i]};
+		GlobalCache& cache {*caches[i]};
+		if (Function* fn {dyn_cast<Function>(node)})
+		{
+			SymbolTable symbols {&defined, visible[i]};
+			if (!cache._checked || i >= same
+				|| !Redirect(cache, symbols, replaced))
+			{
+				_ast->Settle(i);
+				CheckFunction(*fn, symbols, cache, globals);
+			}
+			const int64_t delta
+				{static_cast<int64_t>(_ast->GetOffset(i)) - cache._start};
+			ReportMoved(diags[i], cache._resolution, delta);
+			ReportMoved(checks[i], cache._validation, delta);
+			ok[i] = cache._resolved && ok[i];
+		}
+		else if (ok[i])
+		{
+			ValidateData dat {tu, &_ast->_types, checks[i]};
+			node->Validate(dat);
+		}
+
+		const int64_t delta
+			{static_cast<int64_t>(_ast->GetOffset(i)) - cache._start};
+		const uint32_t start {cache._index.GetStart()};
+		_starts.push_back(start == UINT32_MAX
+			? _ast->GetOffset(i) : static_cast<uint32_t>(start + delta));
+	}
+
+	for (DiagnosticEngine& diag : diags) _diag.Merge(diag);
+	if (std::find(ok.begin(), ok.end(), false) != ok.end()) return;
+	const Name main {_ast->_names.Find("main"sv)};
+	if (main.IsNull() || dyn_cast<Function>(defined.Lookup(main)) == nullptr)
+	{
+		_diag.Error(DiagID::MainUndefined);
+		return;
+	}
+	for (DiagnosticEngine& diag : checks) _diag.Merge(diag);
+}
+
+
+const TU& Document::GetTU() const
+{
+	return *_tu;
+}
+
+
+const DiagnosticEngine& Document::GetDiagnosticEngine() const
+{
+	return _diag;
+}
+
+
+size_t Document::GetCheckedCount() const
+{
+	return _checked;
+}
+
+
+const SyntaxTreeNode* Document::Find(uint32_t off) const
+{
+	if (!_parsed) return nullptr;
+	auto next = std::upper_bound(_starts.begin(), _starts.end(), off);
+	if (next == _starts.begin()) return nullptr;
+	const SyntaxTreeNode* node {(*_ast)[next - _starts.begin() - 1]};
+	const GlobalCache& cache {_cache.at(node)};
+
+	// The index locates the global where it was when the index was built.
+	const int64_t moved {static_cast<int64_t>(off)
+		- (static_cast<int64_t>(node->_off) - cache._start)};
+	if (moved < 0 || moved >= UINT32_MAX) return nullptr;
+	return cache._index.Find(static_cast<uint32_t>(moved));
+}
+
+
+const Declaration* Document::FindDefinition(uint32_t off) const
+{
+	const SyntaxTreeNode* node {Find(off)};
+	if (node == nullptr) return nullptr;
+	if (const Declaration* decl {dyn_cast<const Declaration>(node)})
+		return decl;
+
+	// A global referred to lies elsewhere, so it is moved as well.
+	const Declaration* decl {getDefinition(node)};
+	const auto global {_cache.find(decl)};
+	if (global != _cache.end()) _ast->Settle(global->second._order);
+	return decl;
+}
+
+
+bool Document::Describe(
+	uint32_t off, std::string& text, SourceLocation& loc) const
+{
+	const SyntaxTreeNode* node {Find(off)};
+	if (node == nullptr) return false;
+	loc = *node;
+	if (const Declaration* decl {FindDefinition(off)})
+	{
+		text = describe(*decl);
+		return true;
+	}
+	const Expression* expr {dyn_cast<const Expression>(node)};
+	if (expr == nullptr || expr->_type == nullptr) return false;
+	text = Type::NameOf(expr->_type);
+	return true;
+}
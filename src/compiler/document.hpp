@@ -0,0 +1,187 @@
+#pragma once
+
+#include "diagnostics.hpp"
+#include "parser/parser.h"
+#include "syntaxTree/base.hpp"
+#include "syntaxTree/nodeIndex.hpp"
+#include "utilities.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+// A source file open in an editor, kept parsed and checked as it is edited so
+// the type and definition of whatever lies at an offset are found quickly.
+// Edits reparse only the globals they touch. The results of checking each
+// function, along with an index of its nodes, are cached and reused for as
+// long as neither the function nor a global visible to it changes, so an
+// edit within a function's body checks that function alone. Diagnostics are
+// those CompilerContext::Check() would report.
+class Document
+{
+	// Results of checking a global and an index of its nodes, located where
+	// the global was when they were produced.
+	struct GlobalCache
+	{
+		uint32_t _start {0};	// Offset of the global at the time.
+		size_t _order {0};		// Index of the global in the AST.
+		NodeIndex _index;		// Index of the global's nodes.
+		bool _checked {false};	// Indicates a function's results are set.
+		bool _resolved {false};	// Indicates the body was resolved.
+		std::vector<Diagnostic> _resolution;	// Diagnostics of resolution.
+		std::vector<Diagnostic> _validation;	// Diagnostics of validation.
+		std::vector<SyntaxTreeNode*> _refs;		// Nodes naming globals.
+		std::vector<const Declaration*> _uses;	// Globals named, unique.
+	};
+
+	// The part of a global that other globals can see.
+	struct Signature
+	{
+		NodeKind _kind;						// Kind of the global.
+		Name _name;							// Declared name.
+		const Type* _type;					// Declared type.
+		std::vector<const Type*> _params;	// A function's parameter types.
+
+		// Equality operator overload.
+		friend bool operator==(const Signature&, const Signature&) = default;
+	};
+
+	// Arena bytes an AST may use beyond twice those of its last full parse
+	// before it is parsed anew to release the globals reparsing replaced.
+	static const size_t _compactSlack {65536};
+
+	std::string _path;				// Path reported for the source.
+	uint32_t _id;					// ID recorded in the source's locations.
+	std::unique_ptr<TU> _tu;		// The current source.
+	std::unique_ptr<AST> _ast;		// AST of the current source.
+	bool _parsed {false};			// Indicates _ast was parsed without error.
+	size_t _liveBytes {0};			// Arena bytes used by the last full parse.
+	DiagnosticEngine _diag;			// Diagnostics of the current source.
+	// Cached results of each global, keyed by its node.
+	std::unordered_map<const SyntaxTreeNode*, GlobalCache> _cache;
+	std::vector<Signature> _signatures;	// Signatures of the globals, in order.
+	std::vector<uint32_t> _starts;	// First offset indexed for each global.
+	size_t _checked {0};			// Functions checked by the last update.
+
+	/**
+	 * Parses the current source into a new AST, discarding all cached
+	 * results.
+	 * @param stack Parser stack to use.
+	 */
+	void Parse(carb_stack& stack);
+
+	/**
+	 * Checks the AST, reusing the cached results of each function that is
+	 * unchanged and sees only unchanged globals, and replaces the
+	 * diagnostics.
+	 */
+	void Check();
+
+	/**
+	 * Resolves and validates a function's body and caches the results.
+	 * @param fn The function.
+	 * @param symbols Symbol table seeing the globals visible to the function.
+	 * @param cache Cache of the function.
+	 * @param globals The top-level nodes of the AST.
+	 */
+	void CheckFunction(Function& fn, SymbolTable& symbols, GlobalCache& cache,
+		const std::unordered_set<const SyntaxTreeNode*>& globals);
+
+	/**
+	 * Points the nodes of a cached function that refer to replaced globals
+	 * at the globals now bearing their names.
+	 * @param cache Cache of the function.
+	 * @param symbols Symbol table seeing the globals visible to the function.
+	 * @param replaced Globals no longer in the AST.
+	 * @return true if every such node now refers to a global of the kind it
+	 * requires; false if the function must be checked again.
+	 */
+	static bool Redirect(GlobalCache& cache, const SymbolTable& symbols,
+		const std::unordered_set<const SyntaxTreeNode*>& replaced);
+
+	/**
+	 * Reports cached diagnostics, moved to where their global now is.
+	 * @param diag Engine the diagnostics are reported to.
+	 * @param diags The cached diagnostics.
+	 * @param delta Distance the global moved since they were reported.
+	 */
+	void ReportMoved(DiagnosticEngine& diag,
+		const std::vector<Diagnostic>& diags, int64_t delta) const;
+
+public:
+	/**
+	 * Construct a document holding an empty source.
+	 * @param path Path reported for the source.
+	 * @param id ID recorded in the locations of tokens from the source.
+	 */
+	Document(std::string_view path, uint32_t id = 0);
+
+	Document(const Document&) = delete;
+	Document& operator=(const Document&) = delete;
+
+	/**
+	 * Replaces the entire source, then parses and checks it.
+	 * @param stack Parser stack to use.
+	 * @param text The new source.
+	 */
+	void Open(carb_stack& stack, std::string_view text);
+
+	/**
+	 * Edits the source, then reparses and rechecks what the edits affect.
+	 * @param stack Parser stack to use.
+	 * @param edits Edits to be applied, located in the current source.
+	 * @throws std::out_of_range If an edit lies outside the source or the
+	 * edits are unsorted or overlap.
+	 */
+	void Edit(carb_stack& stack, const std::vector<TextEdit>& edits);
+
+	/**
+	 * @return The current source.
+	 */
+	const TU& GetTU() const;
+
+	/**
+	 * @return Engine holding the diagnostics of the current source.
+	 */
+	const DiagnosticEngine& GetDiagnosticEngine() const;
+
+	/**
+	 * @return Number of functions checked by the last update; the others
+	 * reused their cached results.
+	 */
+	size_t GetCheckedCount() const;
+
+	/**
+	 * Finds the innermost node at an offset in the current source. The
+	 * names of declarations, invocations and assignments belong to the node
+	 * naming them.
+	 * @param off Offset of a character.
+	 * @return The node, or nullptr if there is none or the source failed to
+	 * parse.
+	 */
+	const SyntaxTreeNode* Find(uint32_t off) const;
+
+	/**
+	 * Finds the declaration of the symbol at an offset in the current source:
+	 * the declaration referred to by a variable, invocation or assignment, or
+	 * a declaration itself.
+	 * @param off Offset of a character.
+	 * @return The declaration, or nullptr if there is none.
+	 */
+	const Declaration* FindDefinition(uint32_t off) const;
+
+	/**
+	 * Describes the symbol or expression at an offset in the current source:
+	 * the signature of a declaration, or of the one a node refers to, or
+	 * else the type of an expression.
+	 * @param off Offset of a character.
+	 * @param text Destination of the description.
+	 * @param loc Destination of the location of the node described.
+	 * @return true if there is something to describe; false otherwise.
+	 */
+	bool Describe(uint32_t off, std::string& text, SourceLocation& loc) const;
+};
@@ -0,0 +1,310 @@
+#include "driver.hpp"
+
+#include "context.hpp"
+#include "syntaxTree/base.hpp"
+#include "utilities.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+
+/**
+ * Identifies the build of the compiler by the size and modification time of
+ * its executable, so results cached by another build are not reused.
+ * @param argv0 Path the compiler was invoked by, should the platform not
+ * tell where its executable is.
+ * @return Identity of the build.
+ */
+static std::string identifyBuild(const char* argv0)
+{
+	std::error_code ec;
+	std::filesystem::path exe
+		{std::filesystem::read_symlink("/proc/self/exe", ec)};
+	if (ec) exe = argv0;
+	const uintmax_t size {std::filesystem::file_size(exe, ec)};
+	const auto time {std::filesystem::last_write_time(exe, ec)};
+	return exe.string() + '\n' + std::to_string(size) + '\n'
+		+ std::to_string(time.time_since_epoch().count());
+}
+
+
+/**
+ * Writes the diagnostics of an engine to a job in the requested format.
+ * @param diag Engine whose diagnostics are written.
+ * @param job Job the diagnostics belong to.
+ * @param opts Options given on the command line.
+ */
+static void renderDiagnostics(
+	const DiagnosticEngine& diag, Job& job, const Options& opts)
+{
+	if (opts._json) diag.RenderJSON(job._err);
+	else diag.Render(job._err);
+}
+
+
+bool parseCount(std::string_view arg, size_t& count)
+{
+	const std::from_chars_result res
+		{std::from_chars(arg.data(), arg.data() + arg.size(), count)};
+	return res.ec == std::errc() && res.ptr == arg.data() + arg.size();
+}
+
+
+int parseOptions(int argc, const char* const* argv, int first, Options& opts,
+	std::ostream& err)
+{
+	while (first < argc)
+	{
+		const std::string_view opt {argv[first]};
+		if (opt == "-j"sv && first + 1 < argc)
+		{
+			const std::string_view arg {argv[first + 1]};
+			if (!parseCount(arg, opts._workers) || opts._workers == 0)
+			{
+				err << "Invalid number of jobs: "sv << arg << '\n';
+				return -1;
+			}
+			first += 2;
+		}
+		else if (opt.starts_with("-ferror-limit="sv))
+		{
+			const std::string_view arg {opt.substr(opt.find('=') + 1)};
+			if (!parseCount(arg, opts._errorLimit))
+			{
+				err << "Invalid error limit: "sv << arg << '\n';
+				return -1;
+			}
+			++ first;
+		}
+		else if (opt.starts_with("-fdiagnostics-format="sv))
+		{
+			const std::string_view arg {opt.substr(opt.find('=') + 1)};
+			if (arg != "text"sv && arg != "json"sv)
+			{
+				err << "Invalid diagnostics format: "sv << arg << '\n';
+				return -1;
+			}
+			opts._json = arg == "json"sv;
+			++ first;
+		}
+		else if (opt == "-fstream"sv)
+		{
+			opts._stream = true;
+			++ first;
+		}
+		else if (opt.starts_with("--lexer="sv))
+		{
+			const std::string_view arg {opt.substr(opt.find('=') + 1)};
+			if (arg != "carburetta"sv && arg != "direct"sv)
+			{
+				err << "Unknown lexer: "sv << arg << '\n';
+				return -1;
+			}
+			opts._lexer = arg == "direct"sv
+				? LexerKind::Direct : LexerKind::Carburetta;
+			++ first;
+		}
+		else if (opt.starts_with("-fcache-dir="sv))
+		{
+			opts._cacheDir = opt.substr(opt.find('=') + 1);
+			++ first;
+		}
+		else if (opt.starts_with("-fcache-size="sv))
+		{
+			const std::string_view arg {opt.substr(opt.find('=') + 1)};
+			if (!parseCount(arg, opts._cacheSize) || opts._cacheSize == 0)
+			{
+				err << "Invalid cache size: "sv << arg << '\n';
+				return -1;
+			}
+			++ first;
+		}
+		else if (opt == "-fcache-stats"sv)
+		{
+			opts._cacheStats = true;
+			++ first;
+		}
+		else break;
+	}
+	return first;
+}
+
+
+std::string usage(std::string_view argv0)
+{
+	return "Correct usage: "s + std::string(argv0)
+		+ " [-j <jobs>] [-ferror-limit=<n>]"
+		" [-fdiagnostics-format=<text|json>] [-fstream]"
+		" [--lexer=<carburetta|direct>]"
+		" [-fcache-dir=<dir>] [-fcache-size=<MiB>] [-fcache-stats]"
+		" <source file path>...\n";
+}
+
+
+std::string describeOptions(const Options& opts)
+{
+	return "-ferror-limit="s + std::to_string(opts._errorLimit)
+		+ (opts._json ? "\njson" : "\ntext")
+		+ (opts._stream ? "\nstream" : "")
+		+ (opts._lexer == LexerKind::Direct ? "\ndirect" : "");
+}
+
+
+bool openCache(Options& opts, const char* argv0,
+	std::unique_ptr<CompileCache>& cache, std::ostream& err)
+{
+	if (opts._cacheDir.empty()) return true;
+	try
+	{
+		cache = std::make_unique<CompileCache>(
+			opts._cacheDir, static_cast<uint64_t>(opts._cacheSize) << 20);
+	}
+	catch (std::filesystem::filesystem_error& e)
+	{
+		err << e.what() << '\n';
+		return false;
+	}
+	opts._cache = cache.get();
+	opts._config = identifyBuild(argv0) + '\n' + describeOptions(opts);
+	return true;
+}
+
+
+void reportCacheStats(const CompileCache& cache, std::ostream& os)
+{
+	const CompileCache::Stats stats {cache.GetStats()};
+	os
+		<< "Cache: "sv << stats._hits << " hits, "sv << stats._misses
+		<< " misses, "sv << stats._stores << " stores, "sv
+		<< stats._evictions << " evictions\n"sv;
+}
+
+
+void compileFile(carb_stack& stack, Job& job, uint32_t id, size_t workers,
+	const Options& opts)
+{
+	std::unique_ptr<TU> tu;
+	try
+	{
+		tu = job._src != nullptr
+			? std::make_unique<TU>(*job._src, job._path, id)
+			: std::make_unique<TU>(job._path, id);
+	}
+	catch (std::runtime_error& e)
+	{
+		DiagnosticEngine diag;
+		diag.Error(DiagID::Internal, {e.what()});
+		renderDiagnostics(diag, job, opts);
+		return;
+	}
+
+	std::ostream& out {job._sink != nullptr ? *job._sink : job._out};
+	std::string key;
+	if (opts._cache != nullptr)
+	{
+		key = CompileCache::Key(opts._config, job._path,
+			std::string_view(tu->GetBuf(), tu->GetSize()));
+		CompileCache::Entry entry;
+		if (opts._cache->Find(key, entry))
+		{
+			out << entry._out;
+			job._err << entry._err;
+			job._status = entry._status;
+			return;
+		}
+	}
+
+	// Output is also recorded when it is to be cached.
+	std::ostringstream record;
+	auto print = [&out, &record, &opts](SyntaxTreeNode* node)
+	{
+		if (opts._cache == nullptr) node->Print(out, "  "sv);
+		else
+		{
+			const size_t start {record.view().size()};
+			node->Print(record, "  "sv);
+			out << record.view().substr(start);
+		}
+	};
+
+	CompilerContext ctx {opts._errorLimit, opts._lexer};
+	bool success;
+	try
+	{
+		if (opts._stream) success = ctx.Stream(stack, *tu, print);
+		else
+		{
+			success = ctx.Parse(stack, *tu) && ctx.Check(*tu, workers);
+			for (SyntaxTreeNode* node : ctx.GetAST()) print(node);
+		}
+	}
+	catch (std::exception& e)
+	{
+		// The compilation could not complete, so its result is not cached.
+		ctx.GetDiagnosticEngine().Error(DiagID::Internal, {e.what()});
+		job._status = EXIT_FAILURE;
+		renderDiagnostics(ctx.GetDiagnosticEngine(), job, opts);
+		return;
+	}
+	job._status = success ? EXIT_SUCCESS : EXIT_FAILURE;
+	renderDiagnostics(ctx.GetDiagnosticEngine(), job, opts);
+	if (opts._cache != nullptr)
+	{
+		opts._cache->Store(key, CompileCache::Entry {
+			std::move(record).str(), job._err.str(), job._status});
+	}
+}
+
+
+int streamAll(std::vector<Job>& jobs, const Options& opts)
+{
+	int exit_code {EXIT_SUCCESS};
+	carb_stack stack;
+	carb_stack_init(&stack);
+	for (size_t i {0}; i < jobs.size(); ++ i)
+	{
+		jobs[i]._sink = &std::cout;
+		compileFile(stack, jobs[i], static_cast<uint32_t>(i), 1, opts);
+		std::cerr << jobs[i]._err.view();
+		if (jobs[i]._status != EXIT_SUCCESS) exit_code = EXIT_FAILURE;
+	}
+	carb_stack_cleanup(&stack);
+	return exit_code;
+}
+
+
+void compileAll(std::vector<Job>& jobs, const Options& opts)
+{
+	const size_t workers {opts._workers};
+	const size_t file_workers {std::max<size_t>(workers / jobs.size(), 1)};
+	std::atomic<size_t> next {0};
+	auto work = [&jobs, &next, file_workers, &opts]()
+	{
+		carb_stack stack;
+		carb_stack_init(&stack);
+		for (size_t i {next ++}; i < jobs.size(); i = next ++)
+		{
+			compileFile(stack, jobs[i], static_cast<uint32_t>(i),
+				file_workers, opts);
+		}
+		carb_stack_cleanup(&stack);
+	};
+
+	std::vector<std::thread> pool;
+	for (size_t i {1}; i < std::min(workers, jobs.size()); ++ i)
+	{
+		// Run with the threads started so far if no more can be.
+		try { pool.emplace_back(work); }
+		catch (std::system_error&) { break; }
+	}
+	work();
+	for (std::thread& thread : pool) thread.join();
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "cache.hpp"
+#include "diagnostics.hpp"
+#include "parser/lexer.hpp"
+#include "parser/parser.h"
+
+#include <cstdlib>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Output and result of compiling one source file. Workers write only to their
+// own job, so output can be collated in input order once they finish.
+struct Job
+{
+	const char* _path;				// Path to the source file.
+	// Source of the file if already read; null to read it from _path.
+	const std::string* _src {nullptr};
+	std::ostream* _sink {nullptr};	// Receives output as it is produced.
+	std::ostringstream _out;		// Standard output, unless _sink is set.
+	std::ostringstream _err;		// Diagnostics of the compilation.
+	int _status {EXIT_FAILURE};		// Exit status of the compilation.
+};
+
+
+// Options given on the command line.
+struct Options
+{
+	size_t _workers {1};		// Maximum number of worker threads.
+	size_t _errorLimit {0};		// Errors reported per file; 0 if unlimited.
+	bool _json {false};			// Indicates diagnostics are JSON Lines.
+	bool _stream {false};		// Indicates globals are checked as parsed.
+	// Scanner sources are split into tokens with.
+	LexerKind _lexer {LexerKind::Carburetta};
+	std::string _cacheDir;		// Directory of the cache; empty if none.
+	size_t _cacheSize {1024};	// Bound on the cache's size, in MiB.
+	bool _cacheStats {false};	// Indicates the cache's use is reported.
+	// Cache of compilation results; null if disabled.
+	CompileCache* _cache {nullptr};
+	// Compiler build and options affecting the output, for cache keys.
+	std::string _config;
+};
+
+
+/**
+ * Parses a decimal count given as an option's argument.
+ * @param arg Text of the argument.
+ * @param count Destination of the count.
+ * @return true if the whole argument is a count; false otherwise.
+ */
+bool parseCount(std::string_view arg, size_t& count);
+
+/**
+ * Parses the options of a command line: any of "-j <jobs>" limiting the
+ * number of worker threads, "-ferror-limit=<n>" stopping the compilation of a
+ * file after n errors (0 for no limit), "-fdiagnostics-format=<text|json>"
+ * selecting how diagnostics are written, "-fstream" checking and printing
+ * each global as soon as it is parsed, one file at a time,
+ * "--lexer=<carburetta|direct>" selecting the generated scanner (the default)
+ * or the hand-written lexer, "-fcache-dir=<dir>" reusing the results of
+ * earlier compilations stored in a directory, "-fcache-size=<MiB>" bounding
+ * the size of the stored results and "-fcache-stats" reporting the use of the
+ * cache once done.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ * @param first Index of the first option.
+ * @param opts Destination of the options.
+ * @param err Stream an invalid option is reported to.
+ * @return Index of the first argument after the options, or -1 if an option
+ * is invalid.
+ */
+int parseOptions(int argc, const char* const* argv, int first, Options& opts,
+	std::ostream& err);
+
+/**
+ * @param argv0 Path the compiler was invoked by.
+ * @return Usage message, listing the options parseOptions() accepts.
+ */
+std::string usage(std::string_view argv0);
+
+/**
+ * @param opts Options given on the command line.
+ * @return Description of the options that affect the output of a
+ * compilation.
+ */
+std::string describeOptions(const Options& opts);
+
+/**
+ * Opens the cache the options name, if any, and refers the options to it.
+ * @param opts Options given on the command line.
+ * @param argv0 Path the compiler was invoked by.
+ * @param cache Destination of the cache; left null if none is named.
+ * @param err Stream a failure to open the cache is reported to.
+ * @return true unless the cache could not be opened.
+ */
+bool openCache(Options& opts, const char* argv0,
+	std::unique_ptr<CompileCache>& cache, std::ostream& err);
+
+/**
+ * Reports the use of a cache.
+ * @param cache The cache.
+ * @param os Stream to write to.
+ */
+void reportCacheStats(const CompileCache& cache, std::ostream& os);
+
+/**
+ * Compiles one source file, writing all output to the job.
+ * @param stack Parser stack to use. It is reset by the parse.
+ * @param job Job describing the source file.
+ * @param id ID recorded in the locations of tokens from the source file.
+ * @param workers Maximum number of threads to check the source file with.
+ * @param opts Options given on the command line.
+ */
+void compileFile(carb_stack& stack, Job& job, uint32_t id, size_t workers,
+	const Options& opts);
+
+/**
+ * Compiles every job in order on this thread, writing the output of each to
+ * the standard output as it is produced and its diagnostics once it is done.
+ * @param jobs Jobs to be compiled.
+ * @param opts Options given on the command line.
+ * @return EXIT_SUCCESS if every job compiled; EXIT_FAILURE otherwise.
+ */
+int streamAll(std::vector<Job>& jobs, const Options& opts);
+
+/**
+ * Compiles every job on a pool of worker threads. Each worker owns a parser
+ * stack and claims the next unclaimed job until none remain. Threads left
+ * over when there are fewer jobs than workers help check each file.
+ * @param jobs Jobs to be compiled. Must not be empty.
+ * @param opts Options given on the command line.
+ */
+void compileAll(std::vector<Job>& jobs, const Options& opts);
@@ -0,0 +1,360 @@
+#include "json.hpp"
+
+#include <charconv>
+#include <cmath>
+
+using namespace std::string_view_literals;
+
+
+const JSONValue* JSONValue::Get(std::string_view key) const
+{
+	if (_kind != Kind::Object) return nullptr;
+	for (size_t i {0}; i < _keys.size(); ++ i)
+		if (_keys[i] == key) return &_items[i];
+	return nullptr;
+}
+
+
+JSONValue& JSONValue::Add(std::string key, JSONValue value)
+{
+	_kind = Kind::Object;
+	_keys.push_back(std::move(key));
+	return _items.emplace_back(std::move(value));
+}
+
+
+JSONValue& JSONValue::Append(JSONValue value)
+{
+	_kind = Kind::Array;
+	return _items.emplace_back(std::move(value));
+}
+
+
+int64_t JSONValue::GetInt() const
+{
+	return _kind == Kind::Number ? static_cast<int64_t>(_number) : 0;
+}
+
+
+JSONValue JSONValue::Bool(bool value)
+{
+	JSONValue json;
+	json._kind = Kind::Bool;
+	json._bool = value;
+	return json;
+}
+
+
+JSONValue JSONValue::Number(double value)
+{
+	JSONValue json;
+	json._kind = Kind::Number;
+	json._number = value;
+	return json;
+}
+
+
+JSONValue JSONValue::String(std::string value)
+{
+	JSONValue json;
+	json._kind = Kind::String;
+	json._string = std::move(value);
+	return json;
+}
+
+
+// Reads a JSON text by recursive descent.
+struct JSONReader
+{
+	static const int _maxDepth {256};	// Deepest nesting accepted.
+	std::string_view _text;				// The JSON text.
+	size_t _pos {0};					// Offset of the next character.
+	int _depth {0};						// Nesting depth of the next value.
+
+	// Passes over any whitespace.
+	void SkipSpace()
+	{
+		while (_pos < _text.size() && (_text[_pos] == ' '
+			|| _text[_pos] == '\t' || _text[_pos] == '\n'
+			|| _text[_pos] == '\r'))
+		{
+			++ _pos;
+		}
+	}
+
+	/**
+	 * Passes over a character if it is next, after any whitespace.
+	 * @param c The character.
+	 * @return true if the character was passed over; false otherwise.
+	 */
+	bool Accept(char c)
+	{
+		SkipSpace();
+		if (_pos >= _text.size() || _text[_pos] != c) return false;
+		++ _pos;
+		return true;
+	}
+
+	/**
+	 * Passes over a keyword if it is next.
+	 * @param word The keyword.
+	 * @return true if the keyword was passed over; false otherwise.
+	 */
+	bool AcceptWord(std::string_view word)
+	{
+		if (_text.substr(_pos, word.size()) != word) return false;
+		_pos += word.size();
+		return true;
+	}
+
+	/**
+	 * Reads four hexadecimal digits.
+	 * @param code Destination of the value of the digits.
+	 * @return true if four digits were read; false otherwise.
+	 */
+	bool ReadHex(uint32_t& code)
+	{
+		if (_pos + 4 > _text.size()) return false;
+		const char* first {_text.data() + _pos};
+		const std::from_chars_result res
+			{std::from_chars(first, first + 4, code, 16)};
+		if (res.ptr != first + 4) return false;
+		_pos += 4;
+		return true;
+	}
+
+	/**
+	 * Appends a code point to a string as UTF-8.
+	 * @param str The string.
+	 * @param code The code point.
+	 */
+	static void AppendUTF8(std::string& str, uint32_t code)
+	{
+		if (code < 0x80) str += static_cast<char>(code);
+		else if (code < 0x800)
+		{
+			str += static_cast<char>(0xC0 | (code >> 6));
+			str += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			str += static_cast<char>(0xE0 | (code >> 12));
+			str += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			str += static_cast<char>(0xF0 | (code >> 18));
+			str += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+			str += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+
+	/**
+	 * Reads a string, whose opening quote has been passed over.
+	 * @param str Destination of the string's value.
+	 * @return true if a well-formed string was read; false otherwise.
+	 */
+	bool ReadString(std::string& str)
+	{
+		while (_pos < _text.size())
+		{
+			const char c {_text[_pos ++]};
+			if (c == '"') return true;
+			if (static_cast<unsigned char>(c) < 0x20) return false;
+			if (c != '\\')
+			{
+				str += c;
+				continue;
+			}
+			if (_pos >= _text.size()) return false;
+			switch (_text[_pos ++])
+			{
+				case '"':	str += '"'; break;
+				case '\\':	str += '\\'; break;
+				case '/':	str += '/'; break;
+				case 'b':	str += '\b'; break;
+				case 'f':	str += '\f'; break;
+				case 'n':	str += '\n'; break;
+				case 'r':	str += '\r'; break;
+				case 't':	str += '\t'; break;
+				case 'u':
+				{
+					uint32_t code;
+					if (!ReadHex(code)) return false;
+					// Combine a surrogate pair into one code point.
+					uint32_t low;
+					if (code >= 0xD800 && code < 0xDC00
+						&& AcceptWord("\\u"sv) && ReadHex(low))
+					{
+						if (low < 0xDC00 || low >= 0xE000) return false;
+						code = 0x10000 + ((code - 0xD800) << 10)
+							+ (low - 0xDC00);
+					}
+					AppendUTF8(str, code);
+					break;
+				}
+				default:
+					return false;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Reads a number.
+	 * @param value Destination of the number's value.
+	 * @return true if a well-formed number was read; false otherwise.
+	 */
+	bool ReadNumber(double& value)
+	{
+		const char* first {_text.data() + _pos};
+		const char* last {_text.data() + _text.size()};
+		const std::from_chars_result res {std::from_chars(first, last, value)};
+		if (res.ec != std::errc() || res.ptr == first) return false;
+		_pos += static_cast<size_t>(res.ptr - first);
+		return true;
+	}
+
+	/**
+	 * Reads a value.
+	 * @param value Destination of the value.
+	 * @return true if a well-formed value was read; false otherwise.
+	 */
+	bool ReadValue(JSONValue& value)
+	{
+		SkipSpace();
+		if (_pos >= _text.size()) return false;
+		switch (_text[_pos])
+		{
+			case '{':
+			case '[':
+			{
+				const bool object {_text[_pos ++] == '{'};
+				const char close {object ? '}' : ']'};
+				value._kind = object
+					? JSONValue::Kind::Object : JSONValue::Kind::Array;
+				if (++ _depth > _maxDepth) return false;
+				if (Accept(close))
+				{
+					-- _depth;
+					return true;
+				}
+				do
+				{
+					if (object)
+					{
+						std::string& key {value._keys.emplace_back()};
+						if (!Accept('"') || !ReadString(key) || !Accept(':'))
+							return false;
+					}
+					if (!ReadValue(value._items.emplace_back())) return false;
+				}
+				while (Accept(','));
+				-- _depth;
+				return Accept(close);
+			}
+			case '"':
+				++ _pos;
+				value._kind = JSONValue::Kind::String;
+				return ReadString(value._string);
+			case 't':
+			case 'f':
+				value._kind = JSONValue::Kind::Bool;
+				value._bool = _text[_pos] == 't';
+				return AcceptWord(value._bool ? "true"sv : "false"sv);
+			case 'n':
+				value._kind = JSONValue::Kind::Null;
+				return AcceptWord("null"sv);
+			default:
+				// from_chars accepts no leading '+', as JSON requires.
+				value._kind = JSONValue::Kind::Number;
+				return ReadNumber(value._number);
+		}
+	}
+};
+
+
+bool parseJSON(std::string_view text, JSONValue& value)
+{
+	JSONReader reader {text};
+	value = JSONValue {};
+	if (!reader.ReadValue(value)) return false;
+	reader.SkipSpace();
+	return reader._pos == text.size();
+}
+
+
+void writeJSON(std::ostream& os, const JSONValue& value)
+{
+	switch (value._kind)
+	{
+		case JSONValue::Kind::Null:
+			os << "null"sv;
+			break;
+		case JSONValue::Kind::Bool:
+			os << (value._bool ? "true"sv : "false"sv);
+			break;
+		case JSONValue::Kind::Number:
+		{
+			char buf[32];
+			const double num {value._number};
+			const bool integral {std::trunc(num) == num
+				&& std::fabs(num) < 9.007199254740992e15};
+			const std::to_chars_result res {integral
+				? std::to_chars(buf, buf + sizeof(buf),
+					static_cast<int64_t>(num))
+				: std::to_chars(buf, buf + sizeof(buf), num)};
+			if (!std::isfinite(num)) os << "null"sv;
+			else os << std::string_view(buf, res.ptr - buf);
+			break;
+		}
+		case JSONValue::Kind::String:
+			writeJSONString(os, value._string);
+			break;
+		case JSONValue::Kind::Array:
+		case JSONValue::Kind::Object:
+		{
+			const bool object {value._kind == JSONValue::Kind::Object};
+			os << (object ? '{' : '[');
+			for (size_t i {0}; i < value._items.size(); ++ i)
+			{
+				if (i != 0) os << ',';
+				if (object)
+				{
+					writeJSONString(os, value._keys[i]);
+					os << ':';
+				}
+				writeJSON(os, value._items[i]);
+			}
+			os << (object ? '}' : ']');
+			break;
+		}
+	}
+}
+
+
+void writeJSONString(std::ostream& os, std::string_view str)
+{
+	static const char hex[] {"0123456789abcdef"};
+	os << '"';
+	for (char c : str)
+	{
+		switch (c)
+		{
+			case '"':	os << "\\\""sv; break;
+			case '\\':	os << "\\\\"sv; break;
+			case '\n':	os << "\\n"sv; break;
+			case '\r':	os << "\\r"sv; break;
+			case '\t':	os << "\\t"sv; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+				{
+					os << "\\u00"sv << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+				}
+				else os << c;
+		}
+	}
+	os << '"';
+}
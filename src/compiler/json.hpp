@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// A JSON value, as read from or written to a JSON text. Only the members for
+// the value's kind are used. Objects keep their members in order.
+struct JSONValue
+{
+	// Kinds of JSON values.
+	enum class Kind : uint8_t
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Kind _kind {Kind::Null};		// Kind of the value.
+	bool _bool {false};				// Value of a Boolean.
+	double _number {0};				// Value of a number.
+	std::string _string;			// Value of a string.
+	std::vector<JSONValue> _items;	// Elements of an array or object.
+	std::vector<std::string> _keys;	// Keys of an object, matching _items.
+
+	/**
+	 * @param key Key of a member.
+	 * @return The value of the first member of this object with the key, or
+	 * nullptr if this is not an object or has no such member.
+	 */
+	const JSONValue* Get(std::string_view key) const;
+
+	/**
+	 * Appends a member to this object, making this an object if it is null.
+	 * @param key Key of the member.
+	 * @param value Value of the member.
+	 * @return The member's value as stored in this object.
+	 */
+	JSONValue& Add(std::string key, JSONValue value);
+
+	/**
+	 * Appends an element to this array, making this an array if it is null.
+	 * @param value The element.
+	 * @return The element as stored in this array.
+	 */
+	JSONValue& Append(JSONValue value);
+
+	/**
+	 * @return The value of this number as an integer, or 0 if this is not a
+	 * number.
+	 */
+	int64_t GetInt() const;
+
+	/**
+	 * @return Value of a Boolean.
+	 */
+	static JSONValue Bool(bool value);
+
+	/**
+	 * @return Value of a number.
+	 */
+	static JSONValue Number(double value);
+
+	/**
+	 * @return Value of a string.
+	 */
+	static JSONValue String(std::string value);
+};
+
+
+/**
+ * Parses a complete JSON text.
+ * @param text The JSON text.
+ * @param value Destination of the parsed value.
+ * @return true if the text is a single well-formed JSON value, optionally
+ * surrounded by whitespace; false otherwise.
+ */
+bool parseJSON(std::string_view text, JSONValue& value);
+
+
+/**
+ * Writes a value as compact JSON text. Integral numbers are written without a
+ * fraction.
+ * @param os Stream to write to.
+ * @param value Value to be written.
+ */
+void writeJSON(std::ostream& os, const JSONValue& value);
+
+
+/**
+ * Writes a string as a quoted JSON string, escaping it as needed.
+ * @param os Stream to write to.
+ * @param str String to be written.
+ */
+void writeJSONString(std::ostream& os, std::string_view str);
@@ -1,145 +1,27 @@
-#include "parse.h"
+#include "driver.hpp"
+#include "server.hpp"
 #include "syntaxTree/base.hpp"
 #include "syntaxTree/common.hpp"
+#include "syntaxTree/globals.hpp"
 
+#include <algorithm>
 #include <cstdlib>
-#include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 using namespace std::string_view_literals;
 
 
-void printErrorLine(char* src, int src_len, carb_stack* stack)
-{
-	size_t line_start {carb_offset(stack) - carb_column(stack) + 1};
-	std::cerr << '\t';
-	for (size_t i {line_start}; src[i] != '\n' && i < src_len; ++ i)
-		std::cerr << src[i];
-	std::cerr << '\n' << '\t';
-	for (int i {0}; i < carb_column(stack) - 1; ++ i) std::cerr << ' ';
-	for (int i {0}; i < carb_len(stack); ++ i) std::cerr << '^';
-	std::cerr << '\n';
-}
-
-
-bool runParser(char* src, int src_len,
-	carb_stack* stack, std::vector<SyntaxTreeNode*>& node_list)
-{
-	bool failed {false};
-	int err_code {-1};
-
-	while (err_code != 0)
-	{
-		err_code = carb_scan(stack, node_list);
-		switch (err_code)
-		{
-			case _CARB_FINISH:
-				break;
-			case _CARB_LEXICAL_ERROR:
-				failed = true;
-				std::cerr
-					<< '(' << carb_line(stack) << ", "sv << carb_column(stack)
-					<< "): Unexpected character: "sv;
-				std::cerr.write(carb_text(stack), 1);
-				std::cerr << "\n"sv;
-				printErrorLine(src, src_len, stack);
-				break;
-			case _CARB_SYNTAX_ERROR:
-				failed = true;
-				std::cerr
-					<< '(' << carb_line(stack) << ", "sv << carb_column(stack)
-					<< "): Unexpected token: "sv;
-				std::cerr.write(carb_text(stack), carb_len(stack));
-				std::cerr << "\n"sv;
-				printErrorLine(src, src_len, stack);
-				break;
-			case _CARB_NO_MEMORY:
-				failed = true;
-				std::cerr << "Ran out of memory while parsing.\n"sv;
-				break;
-			case _CARB_OVERFLOW:
-				failed = true;
-				std::cerr << "An overflow error occurred while parsing.\n"sv;
-				break;
-			default:
-				failed = true;
-				std::cerr << "An unspecified error occurred while parsing.\n"sv;
-		}
-
-		if (failed) {
-			if (carb_stack_can_recover(stack)) err_code = -1;
-			else break;
-		}
-	}
-
-	return failed;
-}
-
-
-int readNodes(char* src_path, std::vector<SyntaxTreeNode*>& destTU)
-{
-	std::ifstream src_file;
-	src_file.open(src_path, std::ios_base::in);
-	if (!src_file)
-	{
-		std::cerr
-			<< "Unable to open source file: "sv
-			<< src_path << '\n';
-		return EXIT_FAILURE;
-	}
-
-	src_file.seekg(0, std::ios_base::end);
-	const int tu_size = src_file.tellg();
-	src_file.seekg(0, std::ios_base::beg);
-	char* tu_buffer {reinterpret_cast<char*>(malloc(tu_size))};
-	src_file.read(tu_buffer, tu_size);
-	src_file.close();
-
-	carb_stack stack;
-	carb_stack_init(&stack);
-	carb_set_input(&stack, tu_buffer, tu_size, 1);
-	const bool failed = runParser(tu_buffer, tu_size, &stack, destTU);
-	carb_stack_cleanup(&stack);
-	delete tu_buffer;
-	return (failed) ? EXIT_FAILURE : EXIT_SUCCESS;
-}
-
-
-/**
- * @brief Validates the provided translation unit's AST. 
- * 
- * @param tu AST to be validated.
- * @param dat Validation data initialized with the TUBuffer associated with the
- * passed AST.
- * @return true if the validation was successful; false otherwise.
- */
-bool validate(std::vector<SyntaxTreeNode*>& tu, ValidateData& dat)
-{
-	bool success = true;
-	ScopeStack ss;
-	ss.Enter();
-
-	for (SyntaxTreeNode* node : tu) node->Scope(ss, dat._src) && success;
-	if (!success) return false;
-	else if (ss.Lookup("main"sv) == nullptr)
-	{
-		std::cerr << "The function 'main' is undefined.\n"sv;
-		return false;
-	}
-
-	for (SyntaxTreeNode* node : tu) node->Validate(dat) && success;
-	return success;
-}
-
-
 /**
  * @brief Generates assembly output from the provided translation unit's AST.
  * 
  * @param tu AST to be generated.
  */
-void generate(std::vector<SyntaxTreeNode*>& tu)
+void generate(AST& tu)
 {	
 	GenData dat;
 	// Output stream for global and static variable initialization assembly.
@@ -148,8 +30,7 @@ void generate(std::vector<SyntaxTreeNode*>& tu)
 	std::stringstream primary;
 	for (SyntaxTreeNode* node : tu)
 	{
-		if (dynamic_cast<VariableDef*>(node) != nullptr)
-		node->Generate(dat, staticInit);
+		if (isa<VariableDef>(node)) node->Generate(dat, staticInit);
 		else node->Generate(dat, primary);
 	}
 
@@ -164,18 +45,66 @@ void generate(std::vector<SyntaxTreeNode*>& tu)
 }
 
 
+/**
+ * Compiles each source file named on the command line. Files are parsed and
+ * checked in parallel, and their output and diagnostics are written in the
+ * order the files were named.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments: the options parseOptions() accepts
+ * followed by one or more source file paths. Alternatively, the first may be
+ * "--server=<socket>", serving compilations on a Unix socket with
+ * runServer(), or "--client=<socket>", forwarding the remaining arguments to
+ * such a server with runClient(), and compiling here should none be reached.
+ * @return EXIT_SUCCESS if every file compiled; EXIT_FAILURE otherwise.
+ */
 int main(int argc, char** argv)
 {
-	if (argc == 1)
+	int first {1};
+	const std::string_view mode {argc > 1 ? argv[1] : ""};
+	if (mode.starts_with("--server="sv))
+		return runServer(argv[1] + "--server="sv.size(), argv[0]);
+	if (mode.starts_with("--client="sv))
+	{
+		const char* socket_path {argv[1] + "--client="sv.size()};
+		int status;
+		if (runClient(socket_path, argc - 2, argv + 2, status)) return status;
+		if (argc == 3 && argv[2] == "--shutdown"sv)
+		{
+			std::cerr << "No compile server at "sv << socket_path << '\n';
+			return EXIT_FAILURE;
+		}
+		first = 2;
+	}
+
+	Options opts;
+	opts._workers = std::max(std::thread::hardware_concurrency(), 1u);
+	first = parseOptions(argc, argv, first, opts, std::cerr);
+	if (first == -1) return EXIT_FAILURE;
+	if (first >= argc)
 	{
-		std::cerr
-			<< "Missing source path. Correct usage: "sv
-			<< argv[0] << " <source file path>\n"sv;
+		std::cerr << "Missing source path. "sv << usage(argv[0]);
 		return EXIT_FAILURE;
 	}
 
-	std::vector<SyntaxTreeNode*> tu;
-	const int exit_code {readNodes(argv[argc - 1], tu)};
-	for (SyntaxTreeNode* node : tu) node->Print(std::cout, "  "sv);
+	std::unique_ptr<CompileCache> cache;
+	if (!openCache(opts, argv[0], cache, std::cerr)) return EXIT_FAILURE;
+
+	std::vector<Job> jobs (static_cast<size_t>(argc - first));
+	for (size_t i {0}; i < jobs.size(); ++ i) jobs[i]._path = argv[first + i];
+	int exit_code {EXIT_SUCCESS};
+	if (opts._stream) exit_code = streamAll(jobs, opts);
+	else
+	{
+		compileAll(jobs, opts);
+		for (Job& job : jobs)
+		{
+			std::cout << job._out.view();
+			std::cerr << job._err.view();
+			if (job._status != EXIT_SUCCESS) exit_code = EXIT_FAILURE;
+		}
+	}
+
+	if (cache != nullptr && opts._cacheStats)
+		reportCacheStats(*cache, std::cerr);
 	return exit_code;
 }
@@ -0,0 +1,119 @@
+#include "names.hpp"
+
+#include <cstring>
+
+
+Name::Name()
+{}
+
+
+Name::Name(const NameEntry* entry)
+	: _entry{entry}
+{}
+
+
+std::string_view Name::View() const
+{
+	return _entry != nullptr ? _entry->_str : std::string_view();
+}
+
+
+uint32_t Name::GetID() const
+{
+	return _entry->_id;
+}
+
+
+bool Name::IsNull() const
+{
+	return _entry == nullptr;
+}
+
+
+size_t Name::Hash() const
+{
+	return std::hash<const NameEntry*>()(_entry);
+}
+
+
+bool operator==(Name lhs, Name rhs)
+{
+	return lhs._entry == rhs._entry;
+}
+
+
+bool operator!=(Name lhs, Name rhs)
+{
+	return lhs._entry != rhs._entry;
+}
+
+
+std::ostream& operator<<(std::ostream& os, Name name)
+{
+	return os << name.View();
+}
+
+
+NameTable::NameTable()
+{}
+
+
+std::string_view NameTable::Store(std::string_view str)
+{
+	if (str.empty()) return std::string_view();
+
+	char* dest;
+	if (str.size() > _blockSize / 4)
+	{
+		// Large spellings get a block of their own. The partially used block
+		// stays last so its remaining space is still handed out.
+		std::unique_ptr<char[]> block {std::make_unique<char[]>(str.size())};
+		dest = block.get();
+		_blocks.insert(_blocks.empty() ? _blocks.end() : _blocks.end() - 1,
+			std::move(block));
+	}
+	else
+	{
+		if (_blockSize - _blockUsed < str.size())
+		{
+			_blocks.push_back(std::make_unique<char[]>(_blockSize));
+			_blockUsed = 0;
+		}
+		dest = _blocks.back().get() + _blockUsed;
+		_blockUsed += str.size();
+	}
+
+	std::memcpy(dest, str.data(), str.size());
+	return std::string_view(dest, str.size());
+}
+
+
+Name NameTable::Intern(std::string_view str)
+{
+	const auto found {_lookup.find(str)};
+	if (found != _lookup.end()) return Name(found->second);
+
+	const uint32_t id {static_cast<uint32_t>(_entries.size())};
+	const NameEntry* entry {&_entries.emplace_back(NameEntry{Store(str), id})};
+	_lookup.emplace(entry->_str, entry);
+	return Name(entry);
+}
+
+
+Name NameTable::Find(std::string_view str) const
+{
+	const auto found {_lookup.find(str)};
+	return found != _lookup.end() ? Name(found->second) : Name();
+}
+
+
+Name NameTable::Get(uint32_t id) const
+{
+	return Name(&_entries[id]);
+}
+
+
+size_t NameTable::size() const
+{
+	return _entries.size();
+}
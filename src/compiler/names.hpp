@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// Storage for a single spelling interned by a NameTable.
+struct NameEntry
+{
+	std::string_view _str;	// The spelling, stored in the table's arena.
+	uint32_t _id;			// Dense index of the spelling within its table.
+};
+
+
+// Handle to a spelling interned by a NameTable. Handles from the same table
+// are equal exactly when their spellings are, so comparing and hashing them
+// never touches the characters.
+class Name
+{
+	friend class NameTable;
+
+	const NameEntry* _entry {nullptr};	// Interned spelling; null if unset.
+
+	/**
+	 * Construct a handle to an interned spelling.
+	 * @param entry Table entry holding the spelling.
+	 */
+	Name(const NameEntry* entry);
+
+public:
+	// Default constructor. Creates a null handle.
+	Name();
+
+	/**
+	 * @return View of the spelling. Empty for a null handle.
+	 */
+	std::string_view View() const;
+
+	/**
+	 * @return Index of the spelling within its table.
+	 */
+	uint32_t GetID() const;
+
+	/**
+	 * @return true if this handle does not refer to a spelling; false
+	 * otherwise.
+	 */
+	bool IsNull() const;
+
+	/**
+	 * @return A hash of the handle, consistent with operator==.
+	 */
+	size_t Hash() const;
+
+	// Equality operator overload.
+	friend bool operator==(Name lhs, Name rhs);
+
+	// Inequality operator overload.
+	friend bool operator!=(Name lhs, Name rhs);
+};
+
+
+/**
+ * Writes the spelling referred to by a name.
+ * @param os Stream to write to.
+ * @param name Name to be written.
+ * @return The stream written to.
+ */
+std::ostream& operator<<(std::ostream& os, Name name);
+
+
+// Enables Name as a key of unordered containers.
+template <>
+struct std::hash<Name>
+{
+	size_t operator()(Name name) const { return name.Hash(); }
+};
+
+
+// Interns strings so each distinct spelling is stored once. The characters
+// are kept in an arena owned by the table and stay valid until it is
+// destroyed.
+class NameTable
+{
+	static const size_t _blockSize {16384};		// Default arena block size.
+	std::vector<std::unique_ptr<char[]>> _blocks;	// Arena blocks.
+	size_t _blockUsed {_blockSize};		// Bytes used in the last block.
+	std::deque<NameEntry> _entries;		// Entries in order of interning.
+	// Maps each spelling to its entry.
+	std::unordered_map<std::string_view, const NameEntry*> _lookup;
+
+	/**
+	 * Copies a spelling into the arena.
+	 * @param str Spelling to be copied.
+	 * @return View of the copy.
+	 */
+	std::string_view Store(std::string_view str);
+
+public:
+	// Default constructor.
+	NameTable();
+
+	NameTable(const NameTable&) = delete;
+	NameTable& operator=(const NameTable&) = delete;
+
+	/**
+	 * Returns the handle of a spelling, interning it if necessary.
+	 * @param str Spelling to be interned.
+	 * @return Handle to the interned spelling.
+	 */
+	Name Intern(std::string_view str);
+
+	/**
+	 * Returns the handle of a spelling without interning it.
+	 * @param str Spelling to be found.
+	 * @return Handle to the interned spelling; a null handle if the spelling
+	 * was never interned.
+	 */
+	Name Find(std::string_view str) const;
+
+	/**
+	 * @param id Index of an interned spelling.
+	 * @return Handle to the spelling with the given index.
+	 */
+	Name Get(uint32_t id) const;
+
+	/**
+	 * @return Number of distinct spellings interned.
+	 */
+	size_t size() const;
+};
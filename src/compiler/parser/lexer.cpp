@@ -0,0 +1,379 @@
+#include "lexer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define LANG_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 code is compiled for any x86 target and only run on processors that
+// have it.
+#if defined(LANG_HAVE_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define LANG_HAVE_AVX2
+#define LANG_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+
+using namespace std::string_view_literals;
+
+
+// Classes of bytes that runs are made of, as bits of a byte's class mask.
+static const uint8_t classWhite {1};	// Space, tab, newline or return.
+static const uint8_t classDigit {2};	// Decimal digit.
+static const uint8_t classIdBody {4};	// Letter, digit or underscore.
+static const uint8_t classIdStart {8};	// Letter or underscore.
+
+// Class mask of every byte value.
+static constexpr std::array<uint8_t, 256> byteClasses {[]()
+{
+	std::array<uint8_t, 256> classes {};
+	for (char c : " \t\n\r"sv) classes[static_cast<uint8_t>(c)] = classWhite;
+	for (int c {'0'}; c <= '9'; ++ c) classes[c] = classDigit | classIdBody;
+	for (int c {'a'}; c <= 'z'; ++ c)
+	{
+		classes[c] = classIdBody | classIdStart;
+		classes[c - 'a' + 'A'] = classIdBody | classIdStart;
+	}
+	classes['_'] = classIdBody | classIdStart;
+	return classes;
+}()};
+
+
+// Keyword and the kind of token it is.
+struct Keyword
+{
+	std::string_view _text;	// Text of the keyword; empty if none.
+	TokenKind _kind;		// Kind of the keyword's token.
+};
+
+/**
+ * Perfect hash of the keywords: no two share a slot. The shortest keyword has
+ * two bytes, so both may be read.
+ * @param text Identifier at least two bytes long.
+ * @return Slot of the identifier in the keyword table.
+ */
+static constexpr size_t keywordSlot(std::string_view text)
+{
+	return (static_cast<uint8_t>(text[0]) + static_cast<uint8_t>(text[1])
+		+ text.size()) & 15;
+}
+
+// Keywords, each in the slot keywordSlot() gives it.
+static constexpr Keyword keywords[16] {
+	{""sv, TokenKind::Id},			{"if"sv, TokenKind::If},
+	{""sv, TokenKind::Id},			{"match"sv, TokenKind::Match},
+	{"while"sv, TokenKind::While},	{"else"sv, TokenKind::Else},
+	{""sv, TokenKind::Id},			{""sv, TokenKind::Id},
+	{"for"sv, TokenKind::For},		{"break"sv, TokenKind::Break},
+	{"true"sv, TokenKind::Boolean},	{""sv, TokenKind::Id},
+	{"false"sv, TokenKind::Boolean},	{"return"sv, TokenKind::Return},
+	{""sv, TokenKind::Id},			{"loop"sv, TokenKind::Loop}};
+
+static_assert([]()
+{
+	for (size_t i {0}; i < 16; ++ i)
+	{
+		const std::string_view text {keywords[i]._text};
+		if (!text.empty() && keywordSlot(text) != i) return false;
+	}
+	return true;
+}(), "Keywords must be placed in their hash slots.");
+
+// Lengths of the shortest and longest keywords.
+static const size_t keywordMin {2};
+static const size_t keywordMax {6};
+
+
+#ifdef LANG_HAVE_SSE2
+/**
+ * @tparam Class Class of bytes, one of classWhite, classDigit or classIdBody.
+ * @param block 16 bytes of source.
+ * @return Mask with bit i set if byte i of the block is not of the class.
+ */
+template <uint8_t Class>
+static uint32_t outsideClass(__m128i block)
+{
+	// Bytes from 0x80 up compare as negative, so fall outside every range.
+	auto in_range = [](__m128i v, char lo, char hi)
+	{
+		return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+			_mm_cmpgt_epi8(_mm_set1_epi8(hi + 1), v));
+	};
+
+	__m128i in;
+	if constexpr (Class == classWhite)
+	{
+		in = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+				_mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+			_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\n')),
+				_mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+	}
+	else
+	{
+		in = in_range(block, '0', '9');
+		if constexpr (Class == classIdBody)
+		{
+			// Setting bit 5 folds upper case letters onto lower case ones.
+			const __m128i folded {_mm_or_si128(block, _mm_set1_epi8(0x20))};
+			in = _mm_or_si128(_mm_or_si128(in, in_range(folded, 'a', 'z')),
+				_mm_cmpeq_epi8(block, _mm_set1_epi8('_')));
+		}
+	}
+	return ~static_cast<uint32_t>(_mm_movemask_epi8(in)) & 0xFFFF;
+}
+#endif
+
+
+#ifdef LANG_HAVE_AVX2
+/**
+ * @param v 32 bytes.
+ * @param lo Least byte of the range.
+ * @param hi Greatest byte of the range.
+ * @return Mask with byte i set if byte i of v is in the range.
+ */
+LANG_TARGET_AVX2 static __m256i inRange(__m256i v, char lo, char hi)
+{
+	return _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8(lo - 1)),
+		_mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), v));
+}
+
+
+/**
+ * @tparam Class Class of bytes, one of classWhite, classDigit or classIdBody.
+ * @param block 32 bytes of source.
+ * @return Mask with bit i set if byte i of the block is not of the class.
+ */
+template <uint8_t Class>
+LANG_TARGET_AVX2 static uint32_t outsideClass(__m256i block)
+{
+	__m256i in;
+	if constexpr (Class == classWhite)
+	{
+		in = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+				_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n')),
+				_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+	}
+	else
+	{
+		in = inRange(block, '0', '9');
+		if constexpr (Class == classIdBody)
+		{
+			const __m256i folded {
+				_mm256_or_si256(block, _mm256_set1_epi8(0x20))};
+			in = _mm256_or_si256(
+				_mm256_or_si256(in, inRange(folded, 'a', 'z')),
+				_mm256_cmpeq_epi8(block, _mm256_set1_epi8('_')));
+		}
+	}
+	return ~static_cast<uint32_t>(_mm256_movemask_epi8(in));
+}
+
+
+#endif
+
+
+/**
+ * @tparam Class Class of bytes, one of classWhite, classDigit or classIdBody.
+ * @param buf First byte of the source.
+ * @param pos Offset the run starts at.
+ * @param size Size of the source in bytes.
+ * @param vector Indicates the run is measured 16 bytes at a time.
+ * @return Offset of the first byte from pos on that is not of the class.
+ */
+template <uint8_t Class>
+static size_t spanNarrow(
+	const char* buf, size_t pos, size_t size, bool vector)
+{
+	if (vector)
+	{
+#ifdef LANG_HAVE_SSE2
+		for (; pos + 16 <= size; pos += 16)
+		{
+			const uint32_t outside {outsideClass<Class>(_mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(buf + pos)))};
+			if (outside != 0) return pos + std::countr_zero(outside);
+		}
+#endif
+	}
+	while (pos < size && (byteClasses[static_cast<uint8_t>(buf[pos])] & Class))
+		++ pos;
+	return pos;
+}
+
+
+#ifdef LANG_HAVE_AVX2
+/**
+ * @tparam Class Class of bytes, one of classWhite, classDigit or classIdBody.
+ * @param buf First byte of the source.
+ * @param pos Offset the run starts at.
+ * @param size Size of the source in bytes.
+ * @return Offset of the first byte from pos on that is not of the class,
+ * measured 32 bytes at a time, then 16 and one at a time for the last bytes.
+ */
+template <uint8_t Class>
+LANG_TARGET_AVX2 static size_t spanWide(
+	const char* buf, size_t pos, size_t size)
+{
+	for (; pos + 32 <= size; pos += 32)
+	{
+		const uint32_t outside {outsideClass<Class>(_mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(buf + pos)))};
+		if (outside != 0) return pos + std::countr_zero(outside);
+	}
+	return spanNarrow<Class>(buf, pos, size, true);
+}
+#endif
+
+
+/**
+ * @tparam Class Class of bytes, one of classWhite, classDigit or classIdBody.
+ * @param buf First byte of the source.
+ * @param pos Offset the run starts at.
+ * @param size Size of the source in bytes.
+ * @param width Width of the blocks the run is measured in, supported by the
+ * processor.
+ * @return Offset of the first byte from pos on that is not of the class.
+ */
+template <uint8_t Class>
+static size_t spanClass(
+	const char* buf, size_t pos, size_t size, VectorWidth width)
+{
+#ifdef LANG_HAVE_AVX2
+	if (width == VectorWidth::AVX2) return spanWide<Class>(buf, pos, size);
+#endif
+	return spanNarrow<Class>(buf, pos, size, width != VectorWidth::None);
+}
+
+
+VectorWidth Lexer::Widest()
+{
+#ifdef LANG_HAVE_AVX2
+	static const bool avx2 {__builtin_cpu_supports("avx2") != 0};
+	if (avx2) return VectorWidth::AVX2;
+#endif
+#ifdef LANG_HAVE_SSE2
+	return VectorWidth::SSE2;
+#else
+	return VectorWidth::None;
+#endif
+}
+
+
+Lexer::Lexer(std::string_view src, VectorWidth width)
+	: _buf {src.data()}, _size {src.size()}, _width {std::min(width, Widest())}
+{}
+
+
+bool Lexer::Next(Token& token)
+{
+	if (_pos >= _size) return false;
+
+	const size_t start {_pos};
+	const char c {_buf[start]};
+	const char next {start + 1 < _size ? _buf[start + 1] : '\0'};
+	size_t end {start + 1};
+	// Kind of a token of one byte, or of two if the second is as given.
+	auto pair = [&](TokenKind single, char second, TokenKind twice)
+	{
+		if (next != second) return single;
+		++ end;
+		return twice;
+	};
+
+	TokenKind kind {TokenKind::Error};
+	switch (c)
+	{
+		case ' ': case '\t': case '\n': case '\r':
+			kind = TokenKind::White;
+			end = spanClass<classWhite>(_buf, end, _size, _width);
+			break;
+		case ';': kind = TokenKind::Semicol; break;
+		case ',': kind = TokenKind::Comma; break;
+		case '*': kind = TokenKind::Asterisk; break;
+		case '/': kind = TokenKind::Slash; break;
+		case '%': kind = TokenKind::Percent; break;
+		case '^': kind = TokenKind::Xor; break;
+		case '~': kind = TokenKind::Comp; break;
+		case '(': kind = TokenKind::LParen; break;
+		case ')': kind = TokenKind::RParen; break;
+		case '{': kind = TokenKind::LBrace; break;
+		case '}': kind = TokenKind::RBrace; break;
+		case '=': kind = pair(TokenKind::Assign, '=', TokenKind::Eq); break;
+		case '!': kind = pair(TokenKind::Deny, '=', TokenKind::Ne); break;
+		case '+': kind = pair(TokenKind::Plus, '+', TokenKind::Inc); break;
+		case '&': kind = pair(TokenKind::And, '&', TokenKind::LAnd); break;
+		case '|': kind = pair(TokenKind::Or, '|', TokenKind::LOr); break;
+		case '-':
+			kind = next == '>' ? pair(TokenKind::Minus, '>', TokenKind::RArrow)
+				: pair(TokenKind::Minus, '-', TokenKind::Dec);
+			break;
+		case '>':
+			kind = next == '=' ? pair(TokenKind::Gt, '=', TokenKind::Ge)
+				: pair(TokenKind::Gt, '>', TokenKind::Shr);
+			break;
+		case '<':
+			kind = next == '=' ? pair(TokenKind::Lt, '=', TokenKind::Le)
+				: next == '-' ? pair(TokenKind::Lt, '-', TokenKind::LArrow)
+				: pair(TokenKind::Lt, '<', TokenKind::Shl);
+			break;
+		case '"':
+		{
+			// The string extends to the last quote on its line, as the
+			// pattern's "." matches anything but a newline.
+			const void* newline {
+				std::memchr(_buf + end, '\n', _size - end)};
+			size_t quote {newline != nullptr
+				? static_cast<size_t>(static_cast<const char*>(newline) - _buf)
+				: _size};
+			while (quote > end && _buf[quote - 1] != '"') -- quote;
+			if (quote > end)
+			{
+				kind = TokenKind::String;
+				end = quote;
+			}
+			break;
+		}
+		default:
+		{
+			const uint8_t cls {byteClasses[static_cast<uint8_t>(c)]};
+			if (cls & classDigit)
+			{
+				kind = TokenKind::Integer;
+				end = spanClass<classDigit>(_buf, end, _size, _width);
+			}
+			else if (cls & classIdStart)
+			{
+				kind = TokenKind::Id;
+				end = spanClass<classIdBody>(_buf, end, _size, _width);
+				const std::string_view text {_buf + start, end - start};
+				if (text.size() >= keywordMin && text.size() <= keywordMax)
+				{
+					const Keyword& keyword {keywords[keywordSlot(text)]};
+					if (keyword._text == text) kind = keyword._kind;
+				}
+			}
+			break;
+		}
+	}
+
+	token = Token {static_cast<uint32_t>(start),
+		static_cast<uint32_t>(end - start), kind};
+	_pos = end;
+	return true;
+}
+
+
+void Lexer::ScanAll(std::vector<Token>& tokens)
+{
+	Token token;
+	while (Next(token))
+		if (token._kind != TokenKind::White) tokens.push_back(token);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "../utilities.hpp"
+
+
+/*
+ * Kinds of tokens. Each but Error and White is matched by the pattern of a
+ * terminal in scanner.cbrt, which names its kind. LEVELS is never produced:
+ * INTEGER matches the same text and precedes it.
+ */
+enum class TokenKind : uint8_t
+{
+	Error,		// Byte no pattern matches.
+	White,		// Whitespace, discarded by the parser.
+	Assign, Semicol, Comma, Plus, Minus, Asterisk, Slash, Percent, Inc, Dec,
+	And, Or, Xor, Comp, Shr, Shl, LAnd, LOr, Deny, Eq, Ne, Gt, Lt, Ge, Le,
+	LParen, RParen, LBrace, RBrace, LArrow, RArrow,
+	If, Else, Match, For, Loop, While, Boolean, Break, Return,
+	Integer, Levels, Id, String
+};
+
+
+// Scanners a source can be split into tokens with.
+enum class LexerKind : uint8_t
+{
+	Carburetta,		// Scanner generated from scanner.cbrt.
+	Direct			// The hand-written Lexer.
+};
+
+
+// Token of a source: its kind and where its text lies.
+struct Token
+{
+	uint32_t _off;		// Offset of the token's first byte.
+	uint32_t _len;		// Length of the token in bytes.
+	TokenKind _kind;	// Kind of the token.
+};
+
+
+// Widths of the blocks runs of bytes are measured in, narrowest first.
+enum class VectorWidth : uint8_t
+{
+	None,		// One byte at a time.
+	SSE2,		// 16 bytes at a time.
+	AVX2		// 32 bytes at a time.
+};
+
+
+/*
+ * Hand-written scanner producing the same tokens as the Carburetta scanner of
+ * scanner.cbrt. Runs of whitespace, identifier bodies and digits are measured
+ * 16 or 32 bytes at a time with SSE2 or AVX2, as the processor running the
+ * lexer allows, and keywords are told from identifiers with a perfect hash.
+ */
+class Lexer
+{
+	const char* _buf;		// First byte of the source.
+	size_t _size;			// Size of the source in bytes.
+	size_t _pos {0};		// Offset of the next token.
+	VectorWidth _width;		// Width of the blocks runs are measured in.
+
+public:
+	/**
+	 * @return Widest blocks the target and the processor running the lexer
+	 * can measure runs in.
+	 */
+	static VectorWidth Widest();
+
+	/**
+	 * @param src Source to scan. Must outlive the lexer, and be smaller than
+	 * 4 GiB.
+	 * @param width Widest blocks to measure runs in, narrowed to Widest().
+	 */
+	explicit Lexer(std::string_view src, VectorWidth width = VectorWidth::AVX2);
+
+	/**
+	 * Scans the next token, whitespace included. A byte that begins no token
+	 * is returned alone, as an Error token.
+	 * @param token Destination of the token.
+	 * @return false if the source is exhausted; true otherwise.
+	 */
+	bool Next(Token& token);
+
+	/**
+	 * Scans the rest of the source, discarding whitespace.
+	 * @param tokens Tokens appended to, Error tokens included.
+	 */
+	void ScanAll(std::vector<Token>& tokens);
+};
+
+
+// Binary token files, holding the tokens of a source so they can be read
+// back rather than scanned again. A file is a header naming the size and a
+// hash of the source it was scanned from and the number of tokens, followed
+// by a record of two 32-bit words per token: its offset, and its length with
+// its kind in the top byte. Words are in the writer's byte order, which the
+// header's magic number identifies.
+namespace TokenFile
+{
+	/**
+	 * Writes tokens as a binary token file.
+	 * @param src Source the tokens were scanned from.
+	 * @param tokens Tokens of the source, whitespace discarded.
+	 * @param os Stream to write to, opened in binary mode.
+	 * @throws std::runtime_error If a token is 16 MiB or longer.
+	 */
+	void write(std::string_view src, const std::vector<Token>& tokens,
+		std::ostream& os);
+
+	/**
+	 * Reads the tokens held by a binary token file. Every token is checked
+	 * to lie within the source, after the one before it, so a malformed file
+	 * is rejected rather than trusted.
+	 * @param file TU holding the binary token file.
+	 * @param src Source the tokens are expected to have been scanned from.
+	 * @param tokens Tokens appended to.
+	 * @throws std::runtime_error If the file is not a well-formed binary
+	 * token file written on a platform of the same byte order, or was written
+	 * for another source.
+	 */
+	void load(const TU& file, std::string_view src, std::vector<Token>& tokens);
+}
@@ -1,31 +1,214 @@
 #include "parserTools.hpp"
 
+#include "../syntaxTree/common.hpp"
+#include "../syntaxTree/globals.hpp"
 
-bool Parser::getAST(carb_stack& stack, TU& tu, AST& ast)
+#include <algorithm>
+#include <string>
+#include <utility>
+
+
+// Bytes of the source fed to the Carburetta scanner at a time.
+static const size_t scanChunk {16384};
+// Tokens fed to the grammar at a time.
+static const size_t parseChunk {4096};
+
+
+/**
+ * @param stack Parser stack positioned at an erroneous token.
+ * @param tu Translation unit being parsed.
+ * @param tokens Tokens being parsed.
+ * @return The erroneous token; an empty one at the end of the source if the
+ * parser expected more tokens.
+ */
+static Token getToken(
+	carb_stack& stack, const TU& tu, const TokenWindow& tokens)
+{
+	const size_t i {carb_offset(&stack)};
+	if (tokens.Holds(i)) return tokens[i];
+	return Token {static_cast<uint32_t>(tu.GetSize()), 0, TokenKind::Error};
+}
+
+
+/**
+ * @param tu Translation unit a global was parsed from.
+ * @param global Top-level node parsed from the translation unit.
+ * @param shift Distance the global is yet to be moved by in the AST.
+ * @return Offset of the global's first token.
+ */
+static uint32_t getGlobalStart(
+	const TU& tu, const SyntaxTreeNode* global, int64_t shift)
+{
+	uint32_t off {static_cast<uint32_t>(
+		cast<const Declaration>(global)->_name->_off + shift)};
+	if (isa<Function>(global)) return off;
+
+	// A variable definition begins with the name of its type.
+	const char* buf {tu.GetBuf()};
+	auto is_space = [](char c)
+		{ return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+	auto is_id = [](char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+			|| (c >= '0' && c <= '9') || c == '_';
+	};
+	while (off > 0 && is_space(buf[off - 1])) -- off;
+	while (off > 0 && is_id(buf[off - 1])) -- off;
+	return off;
+}
+
+
+Parser::Scanner::Scanner(const TU& tu, LexerKind lexer)
+	: _tu {tu}, _kind {lexer},
+	_lexer {std::string_view(tu.GetBuf(), tu.GetSize())}
+{
+	scan_stack_init(&_stack);
+}
+
+
+Parser::Scanner::~Scanner()
+{
+	scan_stack_cleanup(&_stack);
+}
+
+
+void Parser::Scanner::Feed()
+{
+	const size_t size {std::min(scanChunk, _tu.GetSize() - _fed)};
+	scan_set_input(&_stack, _tu.GetBuf() + _fed, size,
+		_fed + size == _tu.GetSize() ? _tu.IsFinal() : 0);
+	_fed += size;
+	_matched.clear();
+	_next = 0;
+	while (true)
+	{
+		const int result {scan_scan(&_stack, _matched)};
+		switch (result)
+		{
+			case _SCAN_FEED_ME:
+				// A source that is not final ends here, unparsed onwards.
+				_done = size == 0;
+				return;
+			case _SCAN_FINISH:
+			case _SCAN_END_OF_INPUT:
+				_done = true;
+				return;
+			case _SCAN_LEXICAL_ERROR:
+				_matched.push_back(Token {
+					static_cast<uint32_t>(scan_offset(&_stack)),
+					static_cast<uint32_t>(scan_len(&_stack)),
+					TokenKind::Error});
+				continue;
+			case _SCAN_NO_MEMORY:
+				throw std::runtime_error(OOM);
+			default:
+				throw std::runtime_error(FIE);
+		}
+	}
+}
+
+
+size_t Parser::Scanner::Read(Token* tokens, size_t max)
+{
+	size_t count {0};
+	if (_kind == LexerKind::Direct)
+	{
+		Token token;
+		while (count < max && _lexer.Next(token))
+			if (token._kind != TokenKind::White) tokens[count ++] = token;
+		return count;
+	}
+
+	while (count < max)
+	{
+		if (_next == _matched.size())
+		{
+			if (_done) break;
+			Feed();
+			continue;
+		}
+		const size_t n {std::min(max - count, _matched.size() - _next)};
+		std::copy_n(_matched.begin() + _next, n, tokens + count);
+		_next += n;
+		count += n;
+	}
+	return count;
+}
+
+
+void Parser::scan(const TU& tu, LexerKind lexer, std::vector<Token>& tokens)
+{
+	if (lexer == LexerKind::Direct)
+	{
+		Lexer {std::string_view(tu.GetBuf(), tu.GetSize())}.ScanAll(tokens);
+		return;
+	}
+	Scanner scanner {tu, lexer};
+	while (true)
+	{
+		const size_t size {tokens.size()};
+		tokens.resize(size + parseChunk);
+		const size_t count {scanner.Read(tokens.data() + size, parseChunk)};
+		tokens.resize(size + count);
+		if (count < parseChunk) break;
+	}
+}
+
+
+bool Parser::parseTokens(carb_stack& stack, TU& tu, const TokenReader& read,
+	AST& ast, DiagnosticEngine& diag)
 {
+	// Feeds the grammar the next chunk of tokens, and tells whether there
+	// were any. The last token of the chunk before stays in the window, as
+	// the grammar's scanner may not yet have run its action.
+	TokenWindow window;
+	std::string codes;
+	auto feed = [&]()
+	{
+		if (!window._tokens.empty())
+		{
+			window._first += window._tokens.size() - 1;
+			window._tokens.erase(
+				window._tokens.begin(), window._tokens.end() - 1);
+		}
+		const size_t kept {window._tokens.size()};
+		window._tokens.resize(kept + parseChunk);
+		const size_t count {read(window._tokens.data() + kept, parseChunk)};
+		window._tokens.resize(kept + count);
+		codes.resize(count);
+		for (size_t i {0}; i < count; ++ i)
+			codes[i] = tokenCode(window._tokens[kept + i]._kind);
+		carb_set_input(&stack, codes.data(), count,
+			count == 0 ? tu.IsFinal() : 0);
+		return count != 0;
+	};
+
 	bool success {true};
+	bool more {feed()};
 	while (true)
 	{
-		switch (carb_scan(&stack, ast))
+		const int result {carb_scan(&stack, tu, window, ast)};
+		switch (result)
 		{
+			case _CARB_FEED_ME:
+				if (!more) break;
+				more = feed();
+				continue;
 			case _CARB_FINISH:
 			case _CARB_END_OF_INPUT:
 				break;
-			case _CARB_FEED_ME:
-				tu.ReadNext();
-				carb_set_input(&stack, tu.GetBuf(), tu.GetSize(), tu.IsFinal());
-				continue;
 			case _CARB_LEXICAL_ERROR:
-				std::cerr << "Unexpected token: "sv
-					<< carb_text(&stack) << '\n';
-				success = false;
-				continue;
 			case _CARB_SYNTAX_ERROR:
-				std::cerr << "Syntax error on ("sv << carb_line(&stack)
-					<< ", "sv << carb_column(&stack) << "): "sv
-					<< carb_text(&stack) << '\n';
+			{
+				const Token token {getToken(stack, tu, window)};
+				diag.Error(result == _CARB_LEXICAL_ERROR
+					? DiagID::UnexpectedToken : DiagID::SyntaxError,
+					SourceLocation {tu.GetID(), token._off, token._len},
+					{tu.GetText(token._off, token._len)});
 				success = false;
+				if (diag.ShouldAbort()) break;
 				continue;
+			}
 			case _CARB_NO_MEMORY:
 				throw std::runtime_error(OOM);
 				break;
@@ -38,3 +221,108 @@ bool Parser::getAST(carb_stack& stack, TU& tu, AST& ast)
 
 	return success;
 }
+
+
+bool Parser::parseTokens(carb_stack& stack, TU& tu,
+	const std::vector<Token>& tokens, AST& ast, DiagnosticEngine& diag)
+{
+	size_t next {0};
+	auto read = [&tokens, &next](Token* out, size_t max)
+	{
+		const size_t count {std::min(max, tokens.size() - next)};
+		std::copy_n(tokens.begin() + next, count, out);
+		next += count;
+		return count;
+	};
+	return parseTokens(stack, tu, read, ast, diag);
+}
+
+
+bool Parser::getAST(carb_stack& stack, TU& tu, AST& ast, DiagnosticEngine& diag,
+	LexerKind lexer)
+{
+	Scanner scanner {tu, lexer};
+	auto read = [&scanner](Token* tokens, size_t max)
+		{ return scanner.Read(tokens, max); };
+	return parseTokens(stack, tu, read, ast, diag);
+}
+
+
+bool Parser::reparse(carb_stack& stack, const TU& old_tu, TU& tu, AST& ast,
+	const std::vector<TextEdit>& edits, DiagnosticEngine& diag)
+{
+	const std::vector<SyntaxTreeNode*> old {std::move(ast._globals)};
+	const std::vector<int64_t> old_shifts {std::move(ast._shifts)};
+	ast._globals.clear();
+	ast._shifts.clear();
+	if (old.empty()) return getAST(stack, tu, ast, diag);
+
+	// Global i owns the text from bounds[i] up to bounds[i + 1].
+	std::vector<uint32_t> bounds (old.size() + 1);
+	for (size_t i {1}; i < old.size(); ++ i)
+		bounds[i] = getGlobalStart(old_tu, old[i], old_shifts[i]);
+	bounds[old.size()] = static_cast<uint32_t>(old_tu.GetSize());
+
+	// Consumes the edits ending before global i's text, which moves it, and
+	// tells whether the next edit touches that text.
+	size_t next {0};
+	int64_t delta {0};
+	auto is_damaged = [&](size_t i)
+	{
+		for (; next < edits.size(); ++ next)
+		{
+			const TextEdit& edit {edits[next]};
+			if (edit._off + edit._len >= bounds[i]) break;
+			delta += static_cast<int64_t>(edit._text.size()) - edit._len;
+		}
+		return next < edits.size() && edits[next]._off <= bounds[i + 1];
+	};
+
+	// Reparsed globals are parsed located in their region, which they are
+	// then moved to the start of, as kept globals are moved, on access.
+	std::vector<SyntaxTreeNode*> globals;
+	std::vector<int64_t> shifts;
+	globals.reserve(old.size());
+	shifts.reserve(old.size());
+	uint32_t base {0};
+	ast._consumer = [&globals, &shifts, &base](SyntaxTreeNode* node)
+	{
+		globals.push_back(node);
+		shifts.push_back(base);
+	};
+
+	bool success {true};
+	for (size_t i {0}; i < old.size() && success; )
+	{
+		if (!is_damaged(i))
+		{
+			globals.push_back(old[i]);
+			shifts.push_back(old_shifts[i] + delta);
+			++ i;
+			continue;
+		}
+
+		// Reparse the run of damaged globals as a source of its own.
+		size_t end {i + 1};
+		base = static_cast<uint32_t>(bounds[i] + delta);
+		while (end < old.size() && is_damaged(end)) ++ end;
+		const size_t len {end < old.size()
+			? static_cast<size_t>(bounds[end] + delta - base)
+			: tu.GetSize() - base};
+		TU region {tu.GetText(base, len), tu.GetPath(), tu.GetID()};
+		DiagnosticEngine region_diag {&region};
+		success = getAST(stack, region, ast, region_diag);
+		i = end;
+	}
+	ast._consumer = nullptr;
+
+	if (!success)
+	{
+		ast._globals.clear();
+		ast._shifts.clear();
+		return getAST(stack, tu, ast, diag);
+	}
+	ast._globals = std::move(globals);
+	ast._shifts = std::move(shifts);
+	return true;
+}
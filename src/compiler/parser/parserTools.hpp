@@ -1,10 +1,15 @@
 #pragma once
 
+#include "lexer.hpp"
 #include "parser.h"
+#include "scanner.h"
+#include "../diagnostics.hpp"
 
+#include <functional>
 #include <stdexcept>
 #include <iostream>
 #include <string_view>
+#include <vector>
 
 
 // Tools for interacting with the parser.
@@ -17,14 +22,137 @@ namespace Parser
 	// Fatal internal parser error message constant.
 	const char* const FIE {"Fatal interal error."};
 
+	/*
+	 * Splits the source of a translation unit into tokens on demand, with
+	 * either scanner, so that only a bounded number of them are held at a
+	 * time. Bytes that begin no token become Error tokens, reported when the
+	 * tokens are parsed.
+	 */
+	class Scanner
+	{
+		const TU& _tu;					// Translation unit scanned.
+		LexerKind _kind;				// Scanner splitting the source.
+		Lexer _lexer;					// Hand-written lexer, if chosen.
+		scan_stack _stack;				// Carburetta scanner, if chosen.
+		size_t _fed {0};				// Bytes fed to the Carburetta scanner.
+		std::vector<Token> _matched;	// Tokens it matched, not yet read.
+		size_t _next {0};				// Index of the next one to read.
+		bool _done {false};				// Indicates it reached the end.
+
+		/**
+		 * Feeds the Carburetta scanner the next chunk of the source, replacing
+		 * the tokens it matched before with those it matches in the chunk.
+		 * @throws std::runtime_error If the scanner fails unrecoverably.
+		 */
+		void Feed();
+
+	public:
+		/**
+		 * @param tu Translation unit to scan. Must outlive the scanner.
+		 * @param lexer Scanner to split the source with.
+		 */
+		Scanner(const TU& tu, LexerKind lexer);
+
+		~Scanner();
+
+		Scanner(const Scanner&) = delete;
+		Scanner& operator=(const Scanner&) = delete;
+
+		/**
+		 * Scans the next tokens of the source, discarding whitespace.
+		 * @param tokens Destination of the tokens.
+		 * @param max Number of tokens the destination holds.
+		 * @return Number of tokens scanned; fewer than max only once the
+		 * source is exhausted.
+		 * @throws std::runtime_error If the scanner fails unrecoverably.
+		 */
+		size_t Read(Token* tokens, size_t max);
+	};
+
+	/*
+	 * Source of the tokens the grammar is fed: writes up to the given number
+	 * of the next tokens, whitespace discarded, and returns how many it wrote;
+	 * 0 once the tokens are exhausted.
+	 */
+	using TokenReader = std::function<size_t(Token* tokens, size_t max)>;
+
+	/**
+	 * Splits the whole source of a translation unit into tokens.
+	 * @param tu Translation unit to scan.
+	 * @param lexer Scanner to split the source with.
+	 * @param tokens Tokens appended to, whitespace discarded.
+	 * @throws std::runtime_error If the scanner fails unrecoverably.
+	 */
+	void scan(const TU& tu, LexerKind lexer, std::vector<Token>& tokens);
+
+	/**
+	 * Parses the tokens of a translation unit into an AST, reading them a
+	 * bounded chunk at a time, whichever scanner produced them or wherever
+	 * they were read from. Each global is added to the AST, or handed to its
+	 * consumer, once its last token is parsed.
+	 * @param stack Parser stack to use.
+	 * @param tu Translation unit the tokens were scanned from.
+	 * @param read Source of the tokens, in order, whitespace discarded.
+	 * @param ast Destination AST to store the parser results in.
+	 * @param diag Engine lexical and syntactic errors are reported to.
+	 * Parsing stops once its error limit is reached.
+	 * @return true if parsing succeeded without issue; false if a lexical or
+	 * syntactic error occurred.
+	 */
+	bool parseTokens(carb_stack& stack, TU& tu, const TokenReader& read,
+		AST& ast, DiagnosticEngine& diag);
+
+	/**
+	 * Parses tokens held in memory, such as those of a binary token file.
+	 * @param stack Parser stack to use.
+	 * @param tu Translation unit the tokens were scanned from.
+	 * @param tokens Tokens of the source, in order, whitespace discarded.
+	 * @param ast Destination AST to store the parser results in.
+	 * @param diag Engine lexical and syntactic errors are reported to.
+	 * Parsing stops once its error limit is reached.
+	 * @return true if parsing succeeded without issue; false if a lexical or
+	 * syntactic error occurred.
+	 */
+	bool parseTokens(carb_stack& stack, TU& tu,
+		const std::vector<Token>& tokens, AST& ast, DiagnosticEngine& diag);
+
 	/**
 	 * Parses and returns the AST expressed by the provided translation unit
-	 * source.
+	 * source, scanning it as the grammar needs its tokens.
 	 * @param stack Parser stack to use.
 	 * @param tu Translation unit to read from.
 	 * @param ast Destination AST to store the parser results in.
+	 * @param diag Engine lexical and syntactic errors are reported to.
+	 * Parsing stops once its error limit is reached.
+	 * @param lexer Scanner to split the source with.
+	 * @return true if parsing succeeded without issue; false if a lexical or
+	 * syntactic error occurred.
+	 */
+	bool getAST(carb_stack& stack, TU& tu, AST& ast, DiagnosticEngine& diag,
+		LexerKind lexer = LexerKind::Carburetta);
+
+	/**
+	 * Updates an AST after its source is edited, reparsing only the globals
+	 * whose text is touched by an edit. A global's text extends to the start
+	 * of the next global, so an edit in the space between two globals damages
+	 * the first and an edit at the start of a global damages both. Untouched
+	 * globals are kept and moved to where the edits put them. Their nodes
+	 * are not visited: the distance is recorded in the AST, which moves them
+	 * when they are next accessed, as it moves reparsed globals from the
+	 * region of text they were parsed from. Replaced globals remain in the
+	 * AST's arena until the AST is destroyed. If a damaged region fails to
+	 * parse, the whole source is reparsed so that errors are reported as a
+	 * full parse would report them.
+	 * @param stack Parser stack to use.
+	 * @param old_tu Translation unit the AST was parsed from, without error.
+	 * @param tu Translation unit holding the edited source.
+	 * @param ast AST parsed from old_tu, updated to the AST of tu. Its
+	 * consumer must not be set.
+	 * @param edits Edits turning the source of old_tu into that of tu.
+	 * @param diag Engine lexical and syntactic errors are reported to.
 	 * @return true if parsing succeeded without issue; false if a lexical or
 	 * syntactic error occurred.
 	 */
-	bool getAST(carb_stack& stack, TU& tu, AST& ast);
+	bool reparse(carb_stack& stack, const TU& old_tu, TU& tu, AST& ast,
+		const std::vector<TextEdit>& edits, DiagnosticEngine& diag);
 }
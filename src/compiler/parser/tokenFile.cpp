@@ -0,0 +1,133 @@
+#include "lexer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+
+// Identifies a binary token file and the byte order of its words.
+static const uint32_t fileMagic {0x4B4F544C};	// "LTOK" in little endian.
+// Version of the binary token format.
+static const uint32_t fileVersion {1};
+// Bits of a record's second word holding the token's length.
+static const uint32_t lengthBits {24};
+
+
+// Header of a binary token file.
+struct TokenHeader
+{
+	uint32_t _magic;		// fileMagic.
+	uint32_t _version;		// fileVersion.
+	uint32_t _srcSize;		// Size of the source in bytes.
+	uint32_t _count;		// Number of token records.
+	uint64_t _srcHash;		// hashSource() of the source.
+};
+
+
+// Token record as stored in a binary token file.
+struct TokenRecord
+{
+	uint32_t _off;			// Offset of the token's first byte.
+	uint32_t _lenKind;		// Length, with the kind in the top byte.
+};
+
+static_assert(sizeof(TokenHeader) == 24 && sizeof(TokenRecord) == 8,
+	"Binary token records must not be padded.");
+
+
+/**
+ * @param src A source.
+ * @return 64-bit FNV-1a hash of the source, telling the source a file was
+ * written for from an edited one.
+ */
+static uint64_t hashSource(std::string_view src)
+{
+	uint64_t hash {0xCBF29CE484222325};
+	for (char c : src)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001B3;
+	}
+	return hash;
+}
+
+
+/**
+ * Reports a malformed binary token file.
+ * @param file TU holding the file.
+ * @param what Description of the problem.
+ */
+[[noreturn]] static void fail(const TU& file, const char* what)
+{
+	std::string msg {"Malformed binary token file ("};
+	msg.append(what);
+	msg.append("): ");
+	msg.append(file.GetPath());
+	throw std::runtime_error(msg);
+}
+
+
+void TokenFile::write(std::string_view src, const std::vector<Token>& tokens,
+	std::ostream& os)
+{
+	std::vector<TokenRecord> records;
+	records.reserve(tokens.size());
+	for (const Token& token : tokens)
+	{
+		if (token._len >> lengthBits != 0)
+			throw std::runtime_error("Token too long for a binary token file.");
+		records.push_back(TokenRecord {token._off, token._len
+			| static_cast<uint32_t>(token._kind) << lengthBits});
+	}
+
+	const TokenHeader header {fileMagic, fileVersion,
+		static_cast<uint32_t>(src.size()),
+		static_cast<uint32_t>(records.size()), hashSource(src)};
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	os.write(reinterpret_cast<const char*>(records.data()),
+		static_cast<std::streamsize>(records.size() * sizeof(TokenRecord)));
+}
+
+
+void TokenFile::load(const TU& file, std::string_view src,
+	std::vector<Token>& tokens)
+{
+	// The header is copied out, so its hash need not be aligned.
+	TokenHeader header;
+	if (file.GetSize() < sizeof(header)) fail(file, "truncated");
+	std::memcpy(&header, file.GetBuf(), sizeof(header));
+	if (header._magic != fileMagic) fail(file, "not a binary token file");
+	if (header._version != fileVersion) fail(file, "unsupported version");
+	if (file.GetSize() - sizeof(header)
+		!= size_t {header._count} * sizeof(TokenRecord))
+	{
+		fail(file, "wrong token count");
+	}
+	if (header._srcSize != src.size() || header._srcHash != hashSource(src))
+	{
+		std::string msg {"Binary token file written for another source: "};
+		msg.append(file.GetPath());
+		throw std::runtime_error(msg);
+	}
+
+	const TokenRecord* records {reinterpret_cast<const TokenRecord*>(
+		file.GetBuf() + sizeof(header))};
+	const uint32_t max_kind {static_cast<uint32_t>(TokenKind::String)};
+	uint64_t end {0};
+	tokens.reserve(tokens.size() + header._count);
+	for (uint32_t i {0}; i < header._count; ++ i)
+	{
+		const TokenRecord& rec {records[i]};
+		const uint32_t len {rec._lenKind & ((1u << lengthBits) - 1)};
+		const uint32_t kind {rec._lenKind >> lengthBits};
+		if (kind > max_kind || kind == static_cast<uint32_t>(TokenKind::White))
+			fail(file, "unknown token kind");
+		if (len == 0 || rec._off < end
+			|| uint64_t {rec._off} + len > src.size())
+		{
+			fail(file, "token out of range");
+		}
+		end = uint64_t {rec._off} + len;
+		tokens.push_back(Token {rec._off, len, static_cast<TokenKind>(kind)});
+	}
+}
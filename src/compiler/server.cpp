@@ -0,0 +1,539 @@
+#include "server.hpp"
+
+#include "driver.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+#ifdef __linux__
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std::string_view_literals;
+
+
+#ifdef __linux__
+
+// Events after which a watched file may no longer hold the source last read.
+static const uint32_t watchEvents
+	{IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF};
+// Bound on the length of a string in a message, against damaged messages.
+static const uint32_t maxString {1u << 30};
+// Seconds a connection may stall before the server gives up on it.
+static const int timeoutSeconds {30};
+// Requests after which a file no longer watched and not named is forgotten.
+static const uint64_t idleRequests {64};
+// Bound on the number of files kept, beyond which the least recently named
+// are forgotten.
+static const size_t maxFiles {4096};
+
+
+/**
+ * Writes the whole of a buffer to a socket.
+ * @param fd The socket.
+ * @param data The buffer.
+ * @param size Size of the buffer.
+ * @return true if the buffer was written; false otherwise.
+ */
+static bool writeAll(int fd, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t n {send(fd, data, size, MSG_NOSIGNAL)};
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+
+/**
+ * Fills a buffer from a socket.
+ * @param fd The socket.
+ * @param data The buffer.
+ * @param size Size of the buffer.
+ * @return true if the buffer was filled; false otherwise.
+ */
+static bool readAll(int fd, char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const ssize_t n {recv(fd, data, size, 0)};
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+		data += n;
+		size -= static_cast<size_t>(n);
+	}
+	return true;
+}
+
+
+/**
+ * Sends a message: a count of strings, then the length and bytes of each.
+ * @param fd Socket to write to.
+ * @param strs Strings of the message.
+ * @return true if the message was sent; false otherwise.
+ */
+static bool sendStrings(int fd, const std::vector<std::string>& strs)
+{
+	std::string msg;
+	auto put = [&msg](uint32_t n)
+		{ msg.append(reinterpret_cast<const char*>(&n), sizeof(n)); };
+	put(static_cast<uint32_t>(strs.size()));
+	for (const std::string& str : strs)
+	{
+		put(static_cast<uint32_t>(str.size()));
+		msg += str;
+	}
+	return writeAll(fd, msg.data(), msg.size());
+}
+
+
+/**
+ * Receives a message sent by sendStrings().
+ * @param fd Socket to read from.
+ * @param strs Destination of the strings of the message.
+ * @return true if a whole message was received; false otherwise.
+ */
+static bool receiveStrings(int fd, std::vector<std::string>& strs)
+{
+	uint32_t count;
+	if (!readAll(fd, reinterpret_cast<char*>(&count), sizeof(count))
+		|| count > maxString / sizeof(count))
+	{
+		return false;
+	}
+	strs.resize(count);
+	for (std::string& str : strs)
+	{
+		uint32_t size;
+		if (!readAll(fd, reinterpret_cast<char*>(&size), sizeof(size))
+			|| size > maxString)
+		{
+			return false;
+		}
+		str.resize(size);
+		if (!readAll(fd, str.data(), size)) return false;
+	}
+	return true;
+}
+
+
+/**
+ * Creates a stream socket and fills in the address of a Unix socket.
+ * @param path Path of the Unix socket.
+ * @param addr Destination of the address.
+ * @return The socket, or -1 if the path is too long or none was created.
+ */
+static int openSocket(const char* path, sockaddr_un& addr)
+{
+	addr = sockaddr_un {};
+	addr.sun_family = AF_UNIX;
+	if (std::strlen(path) >= sizeof(addr.sun_path)) return -1;
+	std::strcpy(addr.sun_path, path);
+	return socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+}
+
+
+/**
+ * Reads a whole file.
+ * @param path Path of the file.
+ * @param text Destination of the file's content.
+ * @return true if the file was read; false otherwise.
+ */
+static bool readFile(const std::string& path, std::string& text)
+{
+	std::ifstream in {path, std::ios::binary};
+	if (!in) return false;
+	text.assign(std::istreambuf_iterator<char> {in},
+		std::istreambuf_iterator<char> {});
+	return !in.bad();
+}
+
+
+// Output of compiling a file, kept while the file is watched.
+struct WarmFile
+{
+	std::string _src;			// Source compiled.
+	std::string _config;		// Options and path compiled with, if any.
+	std::string _out;			// Standard output of the compilation.
+	std::string _err;			// Rendered diagnostics.
+	int _status {EXIT_FAILURE};	// Exit status of the compilation.
+	int _watch {-1};			// Watch on the file; -1 if it may differ.
+	uint64_t _used {0};			// Number of the request last naming the file.
+};
+
+
+// Answers the requests of clients, keeping what it compiles for later ones.
+class CompileServer
+{
+	const char* _argv0;			// Path the compiler was invoked by.
+	int _inotify;				// Watches the files compiled.
+	bool _stop {false};			// Indicates a client asked the server to stop.
+	uint64_t _requests {0};		// Number of compilation requests served.
+	// Files compiled, by absolute path.
+	std::unordered_map<std::string, WarmFile> _files;
+	// Absolute paths of the files of each watch. Paths naming the same file
+	// share a watch.
+	std::unordered_map<int, std::vector<std::string>> _watched;
+
+	// Reads pending events of the watched files, forgetting their watches.
+	void ReadEvents();
+
+	/**
+	 * Forgets files no longer watched that were not named by recent
+	 * requests, then the least recently named files beyond maxFiles,
+	 * removing their watches.
+	 */
+	void Forget();
+
+	/**
+	 * Compiles the files a command line names, reusing what it can.
+	 * @param request The working directory, then the arguments.
+	 * @return The reply: the exit status, output and diagnostics.
+	 */
+	std::vector<std::string> Serve(const std::vector<std::string>& request);
+
+public:
+	/**
+	 * Construct a server.
+	 * @param argv0 Path the compiler was invoked by.
+	 */
+	CompileServer(const char* argv0);
+
+	~CompileServer();
+
+	CompileServer(const CompileServer&) = delete;
+	CompileServer& operator=(const CompileServer&) = delete;
+
+	/**
+	 * Serves requests until a client asks the server to stop.
+	 * @param socket_path Path of the socket to listen on.
+	 * @return Program exit status code.
+	 */
+	int Run(const char* socket_path);
+};
+
+
+void CompileServer::ReadEvents()
+{
+	alignas(inotify_event) char buf[4096];
+	for (;;)
+	{
+		const ssize_t n {read(_inotify, buf, sizeof(buf))};
+		if (n <= 0) break;
+		for (const char* p {buf}; p < buf + n;)
+		{
+			const inotify_event* event
+				{reinterpret_cast<const inotify_event*>(p)};
+			p += sizeof(inotify_event) + event->len;
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				// Events were lost, so any watched file may have changed.
+				for (const auto& [wd, paths] : _watched)
+					inotify_rm_watch(_inotify, wd);
+				for (auto& [path, file] : _files) file._watch = -1;
+				_watched.clear();
+				continue;
+			}
+			const auto it {_watched.find(event->wd)};
+			if (it == _watched.end()) continue;
+			for (const std::string& path : it->second)
+				_files[path]._watch = -1;
+			// The file is watched anew when next compiled, which also follows
+			// editors that save by replacing the file.
+			inotify_rm_watch(_inotify, event->wd);
+			_watched.erase(it);
+		}
+	}
+}
+
+
+void CompileServer::Forget()
+{
+	std::vector<std::unordered_map<std::string, WarmFile>::iterator> kept;
+	for (auto it {_files.begin()}; it != _files.end();)
+	{
+		if (it->second._watch == -1
+			&& _requests - it->second._used >= idleRequests)
+		{
+			it = _files.erase(it);
+		}
+		else kept.push_back(it ++);
+	}
+	if (kept.size() <= maxFiles) return;
+
+	const auto last {kept.end() - static_cast<ptrdiff_t>(maxFiles)};
+	std::nth_element(kept.begin(), last, kept.end(),
+		[](const auto& a, const auto& b)
+		{ return a->second._used < b->second._used; });
+	for (auto it {kept.begin()}; it != last; ++ it)
+	{
+		const int watch {(*it)->second._watch};
+		const auto paths {_watched.find(watch)};
+		if (paths != _watched.end())
+		{
+			std::erase(paths->second, (*it)->first);
+			if (paths->second.empty())
+			{
+				inotify_rm_watch(_inotify, watch);
+				_watched.erase(paths);
+			}
+		}
+		_files.erase(*it);
+	}
+}
+
+
+std::vector<std::string> CompileServer::Serve(
+	const std::vector<std::string>& request)
+{
+	std::ostringstream err;
+	auto fail = [&err]() -> std::vector<std::string>
+		{ return {std::to_string(EXIT_FAILURE), std::string {}, err.str()}; };
+	if (request.size() == 2 && request[1] == "--shutdown"sv)
+	{
+		_stop = true;
+		return {std::to_string(EXIT_SUCCESS), std::string {}, std::string {}};
+	}
+	if (chdir(request[0].c_str()) != 0)
+	{
+		err << "Cannot enter the working directory: "sv << request[0] << '\n';
+		return fail();
+	}
+	ReadEvents();
+	++ _requests;
+
+	std::vector<const char*> argv {_argv0};
+	for (size_t i {1}; i < request.size(); ++ i)
+		argv.push_back(request[i].c_str());
+	const int argc {static_cast<int>(argv.size())};
+	Options opts;
+	opts._workers = std::max(std::thread::hardware_concurrency(), 1u);
+	const int first {parseOptions(argc, argv.data(), 1, opts, err)};
+	if (first == -1) return fail();
+	if (first >= argc)
+	{
+		err << "Missing source path. "sv << usage(_argv0);
+		return fail();
+	}
+	std::unique_ptr<CompileCache> cache;
+	if (!openCache(opts, _argv0, cache, err)) return fail();
+	const std::string config {describeOptions(opts)};
+
+	// Each file is answered by what the server kept or by a job compiling it,
+	// shared by every mention of the file.
+	const size_t count {static_cast<size_t>(argc - first)};
+	std::vector<WarmFile*> kept (count, nullptr);
+	std::vector<size_t> slots (count);
+	std::vector<Job> jobs;
+	std::unordered_map<WarmFile*, size_t> pending;
+	for (size_t i {0}; i < count; ++ i)
+	{
+		const char* path {argv[first + static_cast<int>(i)]};
+		std::error_code ec;
+		const std::string abs
+			{std::filesystem::absolute(path, ec).lexically_normal().string()};
+		WarmFile& file {_files[abs]};
+		file._used = _requests;
+		const std::string file_config {config + '\n' + path};
+		const auto it {pending.find(&file)};
+		if (it != pending.end())
+		{
+			slots[i] = it->second;
+			continue;
+		}
+		if (file._watch != -1 && file._config == file_config)
+		{
+			kept[i] = &file;
+			continue;
+		}
+
+		// Watch the file before reading it, so no later change goes unseen.
+		if (file._watch == -1)
+		{
+			file._watch = inotify_add_watch(_inotify, abs.c_str(), watchEvents);
+			if (file._watch != -1) _watched[file._watch].push_back(abs);
+		}
+		std::string src;
+		const bool read {readFile(abs, src)};
+		if (read && file._config == file_config && src == file._src)
+		{
+			kept[i] = &file;
+			continue;
+		}
+
+		slots[i] = jobs.size();
+		Job& job {jobs.emplace_back()};
+		job._path = path;
+		file._config.clear();
+		if (read)
+		{
+			file._src = std::move(src);
+			job._src = &file._src;
+			pending.emplace(&file, slots[i]);
+		}
+	}
+	if (!jobs.empty()) compileAll(jobs, opts);
+
+	for (const auto& [file, slot] : pending)
+	{
+		file->_config = config + '\n' + jobs[slot]._path;
+		file->_out = jobs[slot]._out.str();
+		file->_err = jobs[slot]._err.str();
+		file->_status = jobs[slot]._status;
+	}
+	int status {EXIT_SUCCESS};
+	std::string out;
+	for (size_t i {0}; i < count; ++ i)
+	{
+		const WarmFile* file {kept[i]};
+		if (file == nullptr)
+		{
+			const Job& job {jobs[slots[i]]};
+			out += job._out.view();
+			err << job._err.view();
+			if (job._status != EXIT_SUCCESS) status = EXIT_FAILURE;
+			continue;
+		}
+		out += file->_out;
+		err << file->_err;
+		if (file->_status != EXIT_SUCCESS) status = EXIT_FAILURE;
+	}
+	if (cache != nullptr && opts._cacheStats) reportCacheStats(*cache, err);
+	Forget();
+	return {std::to_string(status), std::move(out), err.str()};
+}
+
+
+CompileServer::CompileServer(const char* argv0)
+	: _argv0 {argv0}, _inotify {inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+{
+}
+
+
+CompileServer::~CompileServer()
+{
+	if (_inotify != -1) close(_inotify);
+}
+
+
+int CompileServer::Run(const char* socket_path)
+{
+	if (_inotify == -1)
+	{
+		std::cerr << "Cannot watch files: "sv << std::strerror(errno) << '\n';
+		return EXIT_FAILURE;
+	}
+	sockaddr_un addr;
+	const int listener {openSocket(socket_path, addr)};
+	unlink(socket_path);
+	if (listener == -1
+		|| bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+		|| listen(listener, SOMAXCONN))
+	{
+		std::cerr << "Cannot listen on "sv << socket_path << ": "sv
+			<< std::strerror(errno) << '\n';
+		if (listener != -1) close(listener);
+		return EXIT_FAILURE;
+	}
+
+	const timeval timeout {timeoutSeconds, 0};
+	while (!_stop)
+	{
+		pollfd fds[2] {{listener, POLLIN, 0}, {_inotify, POLLIN, 0}};
+		if (poll(fds, 2, -1) < 0)
+		{
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (fds[1].revents & POLLIN) ReadEvents();
+		if (!(fds[0].revents & POLLIN)) continue;
+
+		const int client {accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)};
+		if (client == -1) continue;
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		std::vector<std::string> request;
+		if (receiveStrings(client, request) && !request.empty())
+			sendStrings(client, Serve(request));
+		close(client);
+	}
+	close(listener);
+	unlink(socket_path);
+	return EXIT_SUCCESS;
+}
+
+
+int runServer(const char* socket_path, const char* argv0)
+{
+	// Requests change the working directory, so the socket is named fully.
+	std::error_code ec;
+	const std::string path
+		{std::filesystem::absolute(socket_path, ec).string()};
+	CompileServer server {argv0};
+	return server.Run(path.c_str());
+}
+
+
+bool runClient(
+	const char* socket_path, int argc, const char* const* argv, int& status)
+{
+	sockaddr_un addr;
+	const int fd {openSocket(socket_path, addr)};
+	if (fd == -1) return false;
+	if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	std::error_code ec;
+	std::vector<std::string> msg {std::filesystem::current_path(ec).string()};
+	msg.insert(msg.end(), argv, argv + argc);
+	const bool replied {sendStrings(fd, msg) && receiveStrings(fd, msg)
+		&& msg.size() == 3};
+	close(fd);
+	if (!replied) return false;
+
+	std::cout << msg[1];
+	std::cerr << msg[2];
+	status = EXIT_FAILURE;
+	std::from_chars(msg[0].data(), msg[0].data() + msg[0].size(), status);
+	return true;
+}
+
+#else
+
+int runServer(const char*, const char*)
+{
+	std::cerr << "The compile server is not supported on this platform.\n"sv;
+	return EXIT_FAILURE;
+}
+
+
+bool runClient(const char*, int, const char* const*, int&)
+{
+	return false;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+
+
+/**
+ * Serves compilations on a Unix socket until a client asks it to stop. The
+ * server keeps the output, diagnostics and source of the files it compiles
+ * and watches them for changes, so a request naming an unchanged file is
+ * answered without reading it again, and one naming a file that was written
+ * without its content changing, without compiling it again. Files changed and
+ * not named again for a while are forgotten, as are the least recently named
+ * once too many are kept. Requests are served one at a time, compiling the
+ * files that need it in parallel.
+ * @param socket_path Path of the socket to listen on, replaced if it exists.
+ * @param argv0 Path the compiler was invoked by.
+ * @return Program exit status code.
+ */
+int runServer(const char* socket_path, const char* argv0);
+
+/**
+ * Forwards a command line and the working directory to a server started by
+ * runServer(), and writes the output and diagnostics it replies with to the
+ * standard output and error.
+ * @param socket_path Path of the socket the server listens on.
+ * @param argc Number of arguments to forward.
+ * @param argv Arguments to forward: options and source paths, as the
+ * compiler takes them, or "--shutdown" alone to stop the server.
+ * @param status Destination of the exit status of the compilation.
+ * @return true if a server replied; false if none could be reached.
+ */
+bool runClient(
+	const char* socket_path, int argc, const char* const* argv, int& status);
@@ -1,14 +1,26 @@
 #include "base.hpp"
 
-#include <iostream>
+#include "common.hpp"
+#include "globals.hpp"
+#include "traverse.hpp"
+
+#include <iterator>
+#include <ostream>
 #include <numeric>
+#include <type_traits>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
 
-ValidateData::ValidateData(TU* src)
-	: _src{src}
+ScopeData::ScopeData(TU* src, DiagnosticEngine& diag)
+	: _src{src}, _diag{diag}
+{}
+
+
+ValidateData::ValidateData(
+	TU* src, TypeTable* types, DiagnosticEngine& diag)
+	: _src{src}, _types{types}, _diag{diag}
 {}
 
 
@@ -58,172 +70,596 @@ void Location::ReinterpretStack(BytesT stack_args_size)
 }
 
 
-SymbolTable::SymbolTable()
+SyntaxTreeNode::SyntaxTreeNode(NodeKind kind)
+	: _kind{kind}
+{}
+
+
+SyntaxTreeNode::~SyntaxTreeNode()
 {}
 
 
-void SymbolTable::Enter()
+size_t SyntaxTreeNode::GetChildCount() const
 {
-	_stackMap.push_front(std::map<std::string_view, Declaration*>());
+	return 0;
 }
 
 
-void SymbolTable::Exit()
+SyntaxTreeNode* SyntaxTreeNode::GetChild(size_t i) const
 {
-	_stackMap.front().clear();
-	_stackMap.pop_front();
+	return nullptr;
 }
 
 
-Declaration* SymbolTable::Define(std::string_view name, Declaration* node)
+// Traversal hooks a node class overrides, as bits of a mask.
+enum HookMask : uint8_t
 {
-	std::map<std::string_view, Declaration*>& front {_stackMap.front()};
-	if (front.count(name) == 0) return front[name];
-	front.insert(std::pair(name, node));
-	return nullptr;
+	scopeEnterHook = 1 << 0,
+	scopeLeaveHook = 1 << 1,
+	validateEnterHook = 1 << 2,
+	validateBeforeChildHook = 1 << 3,
+	validateAfterChildHook = 1 << 4,
+	validateLeaveHook = 1 << 5
+};
+
+
+/**
+ * @param hook A hook, as named through a node class.
+ * @return true if the class inherits the hook from SyntaxTreeNode; false if
+ * it or a base other than SyntaxTreeNode overrides it.
+ */
+template <typename Ret, typename Class, typename... Args>
+static constexpr bool isDefault(Ret (Class::*hook)(Args...))
+{
+	return std::is_same_v<Class, SyntaxTreeNode>;
 }
 
 
-Declaration* SymbolTable::Lookup(std::string_view name)
+/**
+ * @return Mask of the traversal hooks the node class overrides.
+ */
+template <typename T>
+static constexpr uint8_t overriddenHooks()
 {
-	for (std::map<std::string_view, Declaration*> scope : _stackMap)
-		if (scope.count(name)) return scope[name];
-	return nullptr;
+	return (isDefault(&T::ScopeEnter) ? 0 : scopeEnterHook)
+		| (isDefault(&T::ScopeLeave) ? 0 : scopeLeaveHook)
+		| (isDefault(&T::ValidateEnter) ? 0 : validateEnterHook)
+		| (isDefault(&T::ValidateBeforeChild) ? 0 : validateBeforeChildHook)
+		| (isDefault(&T::ValidateAfterChild) ? 0 : validateAfterChildHook)
+		| (isDefault(&T::ValidateLeave) ? 0 : validateLeaveHook);
 }
 
 
-SyntaxTreeNode::~SyntaxTreeNode()
-{}
+// Hooks overridden by each node class, indexed by NodeKind. The passes call
+// only these; the defaults do nothing, so most calls are skipped without a
+// virtual dispatch.
+static constexpr uint8_t hooksByKind[] {
+	overriddenHooks<Identifier>(),
+	overriddenHooks<Parameter>(),
+	overriddenHooks<Function>(),
+	overriddenHooks<VariableDef>(),
+	overriddenHooks<IfStmt>(),
+	overriddenHooks<BreakStmt>(),
+	overriddenHooks<ReturnStmt>(),
+	overriddenHooks<LoopExpr>(),
+	overriddenHooks<CompoundStmt>(),
+	overriddenHooks<BinaryExpr>(),
+	overriddenHooks<UnaryExpr>(),
+	overriddenHooks<Invocation>(),
+	overriddenHooks<AssignmentExpr>(),
+	overriddenHooks<Variable>(),
+	overriddenHooks<IntLiteral>(),
+	overriddenHooks<BoolLiteral>(),
+	overriddenHooks<StrLiteral>()
+};
+static_assert(std::size(hooksByKind)
+	== static_cast<size_t>(NodeKind::StrLiteral) + 1);
+
+
+/**
+ * @param node The node.
+ * @param hook The hook.
+ * @return true if the node's class overrides the hook.
+ */
+static bool overrides(const SyntaxTreeNode* node, HookMask hook)
+{
+	return hooksByKind[static_cast<size_t>(node->_kind)] & hook;
+}
+
+
+/**
+ * Calls a node's ScopeEnter() unless the node's class inherits the default.
+ * @param node The node.
+ * @param symbols Symbol table to be used.
+ * @param dat Scope resolution data of the AST.
+ * @return The hook's result; true by default.
+ */
+static bool scopeEnter(
+	SyntaxTreeNode* node, SymbolTable& symbols, ScopeData& dat)
+{
+	return !overrides(node, scopeEnterHook) || node->ScopeEnter(symbols, dat);
+}
+
+
+/**
+ * Calls a node's ScopeLeave() unless the node's class inherits the default.
+ * @param node The node.
+ * @param symbols Symbol table to be used.
+ * @param dat Scope resolution data of the AST.
+ * @return The hook's result; true by default.
+ */
+static bool scopeLeave(
+	SyntaxTreeNode* node, SymbolTable& symbols, ScopeData& dat)
+{
+	return !overrides(node, scopeLeaveHook) || node->ScopeLeave(symbols, dat);
+}
+
+
+/**
+ * Calls a node's ValidateEnter() unless the node's class inherits the
+ * default.
+ * @param node The node.
+ * @param dat Validation data of the AST.
+ * @return The hook's result; true by default.
+ */
+static bool validateEnter(SyntaxTreeNode* node, ValidateData& dat)
+{
+	return !overrides(node, validateEnterHook) || node->ValidateEnter(dat);
+}
+
+
+/**
+ * Calls a node's ValidateBeforeChild() unless the node's class inherits the
+ * default.
+ * @param node The node.
+ * @param dat Validation data of the AST.
+ * @param i Index of the child slot.
+ * @param success Success of the node's validation so far.
+ * @return The hook's result; true by default.
+ */
+static bool validateBeforeChild(
+	SyntaxTreeNode* node, ValidateData& dat, size_t i, bool& success)
+{
+	return !overrides(node, validateBeforeChildHook)
+		|| node->ValidateBeforeChild(dat, i, success);
+}
+
+
+/**
+ * Calls a node's ValidateAfterChild() unless the node's class inherits the
+ * default.
+ * @param node The node.
+ * @param dat Validation data of the AST.
+ * @param i Index of the child slot.
+ * @param success Success of the node's validation so far.
+ */
+static void validateAfterChild(
+	SyntaxTreeNode* node, ValidateData& dat, size_t i, bool& success)
+{
+	if (overrides(node, validateAfterChildHook))
+		node->ValidateAfterChild(dat, i, success);
+}
+
+
+/**
+ * Calls a node's ValidateLeave() unless the node's class inherits the
+ * default.
+ * @param node The node.
+ * @param dat Validation data of the AST.
+ * @param success Success of the node's validation so far.
+ */
+static void validateLeave(
+	SyntaxTreeNode* node, ValidateData& dat, bool& success)
+{
+	if (overrides(node, validateLeaveHook))
+		node->ValidateLeave(dat, success);
+}
+
+
+// Visitor performing scope resolution.
+struct ScopeVisitor
+{
+	SymbolTable& _symbols;	// Symbol table to be used.
+	ScopeData& _dat;		// Scope resolution data of the AST.
+	bool _success {true};	// Indicates no errors were discovered.
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		_success = scopeEnter(node, _symbols, _dat) && _success;
+		return true;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i) { return true; }
+	void After(SyntaxTreeNode* node, size_t i) {}
+
+	void Leave(SyntaxTreeNode* node)
+	{
+		_success = scopeLeave(node, _symbols, _dat) && _success;
+	}
+};
+
+
+bool SyntaxTreeNode::Scope(SymbolTable& symbols, ScopeData& dat)
+{
+	ScopeVisitor visitor {symbols, dat};
+	traverse(this, visitor);
+	return visitor._success;
+}
+
+
+bool SyntaxTreeNode::ScopeChildren(SymbolTable& symbols, ScopeData& dat)
+{
+	ScopeVisitor visitor {symbols, dat};
+	traverse(this, visitor, true);
+	return visitor._success;
+}
+
+
+bool SyntaxTreeNode::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
+{
+	// Take no action and assume success by default.
+	return true;
+}
 
 
-bool SyntaxTreeNode::Scope(SymbolTable& symbols, TU& tu)
+bool SyntaxTreeNode::ScopeLeave(SymbolTable& symbols, ScopeData& dat)
 {
 	// Take no action and assume success by default.
 	return true;
 }
 
 
+// Visitor performing validation.
+struct ValidateVisitor
+{
+	// Validation state of a node whose children are being visited.
+	struct Frame
+	{
+		bool _entered;	// Indicates the node passed ValidateEnter().
+		bool _success;	// Indicates no errors were discovered so far.
+	};
+
+	ValidateData& _dat;			// Validation data of the AST.
+	std::vector<Frame> _path;	// State of each node being visited.
+	bool _last {true};			// Success of the node last left.
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		const bool entered {validateEnter(node, _dat)};
+		_path.push_back(Frame {entered, entered});
+		return entered;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i)
+	{
+		return validateBeforeChild(node, _dat, i, _path.back()._success);
+	}
+
+	void After(SyntaxTreeNode* node, size_t i)
+	{
+		bool& success {_path.back()._success};
+		success = _last && success;
+		validateAfterChild(node, _dat, i, success);
+	}
+
+	void Leave(SyntaxTreeNode* node)
+	{
+		Frame& top {_path.back()};
+		if (top._entered) validateLeave(node, _dat, top._success);
+		_last = top._success;
+		_path.pop_back();
+	}
+};
+
+
 bool SyntaxTreeNode::Validate(ValidateData& dat)
+{
+	ValidateVisitor visitor {dat};
+	traverse(this, visitor);
+	return visitor._last;
+}
+
+
+bool SyntaxTreeNode::ValidateEnter(ValidateData& dat)
 {
 	// Take no action and assume success by default.
 	return true;
 }
 
 
+bool SyntaxTreeNode::ValidateBeforeChild(
+	ValidateData& dat, size_t i, bool& success)
+{
+	// Validate every child by default.
+	return true;
+}
+
+
+void SyntaxTreeNode::ValidateAfterChild(
+	ValidateData& dat, size_t i, bool& success)
+{
+	// Take no action by default.
+}
+
+
+void SyntaxTreeNode::ValidateLeave(ValidateData& dat, bool& success)
+{
+	// Take no action by default.
+}
+
+
+// Visitor performing scope resolution and validation in one traversal. Nodes
+// that validation passes over, and every node once resolution fails, are
+// only resolved, as separate passes would resolve them.
+struct CheckVisitor
+{
+	// Check state of a node whose children are being visited.
+	struct Frame
+	{
+		bool _validated;	// Indicates the node is being validated.
+		bool _entered;		// Indicates the node passed ValidateEnter().
+		bool _success;		// Indicates no errors were discovered so far.
+	};
+
+	ValidateData& _dat;			// Validation data of the AST.
+	std::vector<Frame> _path;	// State of each node being visited.
+	bool _validateNext {true};	// Indicates the next node is to be validated.
+	bool _lastValidated {true};	// Indicates the node last left was validated.
+	bool _last {true};			// Success of the node last left.
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		bool validated {_validateNext && _dat._resolved};
+		if (!scopeEnter(node, *_dat._symbols, *_dat._scope))
+			_dat._resolved = validated = false;
+		const bool entered {validated && validateEnter(node, _dat)};
+		_path.push_back(Frame {validated, entered, entered});
+		return true;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i)
+	{
+		Frame& top {_path.back()};
+		_validateNext = top._entered && _dat._resolved
+			&& validateBeforeChild(node, _dat, i, top._success);
+		return true;
+	}
+
+	void After(SyntaxTreeNode* node, size_t i)
+	{
+		bool& success {_path.back()._success};
+		if (!_lastValidated || !_dat._resolved) return;
+		success = _last && success;
+		validateAfterChild(node, _dat, i, success);
+	}
+
+	void Leave(SyntaxTreeNode* node)
+	{
+		Frame& top {_path.back()};
+		if (top._entered && _dat._resolved)
+			validateLeave(node, _dat, top._success);
+		if (!scopeLeave(node, *_dat._symbols, *_dat._scope))
+			_dat._resolved = false;
+		_lastValidated = top._validated;
+		_last = top._success;
+		_path.pop_back();
+	}
+};
+
+
+bool SyntaxTreeNode::Check(ValidateData& dat)
+{
+	CheckVisitor visitor {dat};
+	traverse(this, visitor);
+	return visitor._last && dat._resolved;
+}
+
+
 void SyntaxTreeNode::Generate(GenData& dat, std::ostream& os)
 {
 	// Take no action by default.
 }
 
 
+// Visitor printing the AST.
+struct PrintVisitor
+{
+	std::ostream& _os;			// The output stream to print to.
+	std::string_view _indent;	// Unit of indentation.
+	std::vector<int> _depths;	// Depth of each node being visited.
+	int _next;					// Depth of the next node.
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		node->PrintEnter(_os, _indent, _next);
+		_depths.push_back(_next);
+		return true;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i)
+	{
+		_next = node->PrintBeforeChild(_os, _indent, _depths.back(), i);
+		return true;
+	}
+
+	void After(SyntaxTreeNode* node, size_t i) {}
+
+	void Leave(SyntaxTreeNode* node)
+	{
+		_depths.pop_back();
+	}
+};
+
+
+void SyntaxTreeNode::Print(std::ostream& os, std::string_view indent, int depth)
+{
+	PrintVisitor visitor {os, indent, {}, depth};
+	traverse(this, visitor);
+}
+
+
+int SyntaxTreeNode::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	// Print children unlabelled, one level deeper, by default.
+	return depth + 1;
+}
+
+
 void SyntaxTreeNode::PrintIndent(
 	std::ostream& os, std::string_view indent, int depth)
 {
+	if (indent.empty()) return;
 	for (int i {0}; i < depth; ++ i) os << indent;
 }
 
 
-void SyntaxTreeNode::PrintMaybe(
+void SyntaxTreeNode::PrintIfEmpty(
 	SyntaxTreeNode* node, std::ostream& os, std::string_view indent, int depth)
 {
-	if (node != nullptr) node->Print(os, indent, depth);
+	if (node != nullptr) return;
+	PrintIndent(os, indent, depth);
+	os << "nullptr\n"sv;
+}
+
+
+// Visitor moving the locations of the AST.
+struct ShiftVisitor
+{
+	int64_t _delta;	// Distance to move the locations by.
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		node->ShiftEnter(_delta);
+		return true;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i) { return true; }
+	void After(SyntaxTreeNode* node, size_t i) {}
+	void Leave(SyntaxTreeNode* node) {}
+};
+
+
+void SyntaxTreeNode::Shift(int64_t delta)
+{
+	ShiftVisitor visitor {delta};
+	traverse(this, visitor);
+}
+
+
+void SyntaxTreeNode::ShiftEnter(int64_t delta)
+{
+	_off = static_cast<uint32_t>(_off + delta);
+}
+
+
+void AST::emplace_back(SyntaxTreeNode* node)
+{
+	if (_consumer) _consumer(node);
 	else
 	{
-		PrintIndent(os, indent, depth);
-		os << "nullptr\n"sv;
+		_globals.emplace_back(node);
+		_shifts.push_back(0);
 	}
 }
 
 
-Identifier::Identifier(std::string& id)
-	: _id{id}
-{}
+size_t AST::size() const
+{
+	return _globals.size();
+}
 
 
-void Identifier::Print(std::ostream& os, std::string_view indent, int depth)
+uint32_t AST::GetOffset(size_t i) const
 {
-	os << "ID = "sv << _id;
+	return static_cast<uint32_t>(_globals[i]->_off + _shifts[i]);
 }
 
 
-Declaration::Declaration(Identifier* name)
-	: _name{name}
-{}
+void AST::Settle(size_t i)
+{
+	if (_shifts[i] == 0) return;
+	_globals[i]->Shift(_shifts[i]);
+	_shifts[i] = 0;
+}
 
 
-const std::unique_ptr<Type> Type::_void		(new Type("void",	0));
-const std::unique_ptr<Type> Type::_int		(new Type("int",	4));
-const std::unique_ptr<Type> Type::_bool		(new Type("bool",	1));
-const std::unique_ptr<Type> Type::_string	(new Type("string",	8));
+SyntaxTreeNode* AST::operator[](size_t i)
+{
+	Settle(i);
+	return _globals[i];
+}
 
 
-const std::map<std::string_view, Type*> Type::_namedFundamentals
+std::vector<SyntaxTreeNode*>::const_iterator AST::begin()
 {
-	{"void"sv,		Type::_void.get()	},
-	{"int"sv,		Type::_int.get()	},
-	{"bool"sv,		Type::_bool.get()	},
-	{"string"sv,	Type::_string.get()	}
-};
+	for (size_t i {0}; i < _globals.size(); ++ i) Settle(i);
+	return _globals.begin();
+}
 
 
-const std::set<const Type*> Type::_fundamentals
+std::vector<SyntaxTreeNode*>::const_iterator AST::end() const
 {
-	{Type::_void.get()},
-	{Type::_int.get()},
-	{Type::_bool.get()},
-	{Type::_string.get()}
-};
+	return _globals.end();
+}
 
 
-Type::Type()
+Identifier::Identifier(Name id)
+	: SyntaxTreeNode{NodeKind::Identifier}, _id{id}
 {}
 
 
-Type::Type(std::string type_name, BytesT size)
-	: _name{type_name}, _size{size}
+void Identifier::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
+{
+	os << "ID = "sv << _id;
+}
+
+
+Type::Type(Kind kind, uint32_t id, std::string_view type_name, BytesT size)
+	: _kind{kind}, _id{id}, _size{size}, _name{type_name}
 {}
 
 
-Type* Type::Create(std::string type_name)
+std::string_view Type::NameOf(const Type* type)
 {
-	if (_namedFundamentals.count(type_name))
-		return _namedFundamentals.at(type_name);
-	else return new Type(type_name);
+	return type ? type->_name : "void"sv;
 }
 
+
 const bool Type::IsVoid() const
 {
-	return this == _void.get();
+	return _kind == Kind::Void;
 }
 
 
 const bool Type::IsInt() const
 {
-	return this == _int.get();
+	return _kind == Kind::Int;
 }
 
 
 const bool Type::IsBool() const
 {
-	return this == _bool.get();
+	return _kind == Kind::Bool;
 }
 
 
 const bool Type::IsString() const
 {
-	return this == _string.get();
+	return _kind == Kind::String;
 }
 
 
 const bool Type::IsIntegral() const
 {
-	return this == _int.get() || this == _bool.get();
+	return _kind == Kind::Int || _kind == Kind::Bool;
 }
 
 
 const bool Type::IsPointer() const
 {
-	return this == _string.get();
+	return _kind == Kind::String;
 }
 
 
@@ -233,25 +669,74 @@ const BytesT Type::GetSize() const
 }
 
 
-bool operator==(const Type& lhs, const Type& rhs)
+uint32_t Type::GetID() const
 {
-	if (Type::_fundamentals.count(&lhs)) return &lhs == &rhs;
-	else return lhs._defType == rhs._defType;
+	return _id;
 }
 
 
-bool operator!=(const Type& lhs, const Type& rhs)
+void
+Type::GenerateAccess(GenData& dat, Location loc, bool load, std::ostream& os)
+{}
+
+
+TypeTable::TypeTable(NameTable& names)
 {
-	return !(lhs == rhs);
+	_void	= Add(Type::Kind::Void,		names.Intern("void"sv),		0);
+	_int	= Add(Type::Kind::Int,		names.Intern("int"sv),		4);
+	_bool	= Add(Type::Kind::Bool,		names.Intern("bool"sv),		1);
+	_string	= Add(Type::Kind::String,	names.Intern("string"sv),	8);
 }
 
 
-void
-Type::GenerateAccess(GenData& dat, Location loc, bool load, std::ostream& os)
-{}
+Type* TypeTable::Add(Type::Kind kind, Name name, BytesT size)
+{
+	const uint32_t id {static_cast<uint32_t>(_types.size())};
+	Type* type {&_types.emplace_back(kind, id, name.View(), size)};
+	_named.emplace(name, type);
+	return type;
+}
+
+
+Type* TypeTable::Get(Name name)
+{
+	auto it {_named.find(name)};
+	if (it != _named.end()) return it->second;
+	return Add(Type::Kind::Named, name, 0);
+}
+
+
+Type* TypeTable::operator[](uint32_t id)
+{
+	return &_types[id];
+}
+
+
+Type* TypeTable::Void() const
+{
+	return _void;
+}
+
+
+Type* TypeTable::Int() const
+{
+	return _int;
+}
+
+
+Type* TypeTable::Bool() const
+{
+	return _bool;
+}
+
+
+Type* TypeTable::String() const
+{
+	return _string;
+}
 
 
-void Type::Print(std::ostream& os, std::string_view indent, int depth)
+size_t TypeTable::size() const
 {
-	os << "Type = "sv << _name;
+	return _types.size();
 }
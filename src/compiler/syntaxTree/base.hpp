@@ -1,12 +1,19 @@
 #pragma once
 
+#include "../arena.hpp"
+#include "../diagnostics.hpp"
+#include "../names.hpp"
 #include "../utilities.hpp"
 
+#include <cassert>
+#include <deque>
+#include <functional>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <list>
 #include <map>
+#include <unordered_map>
 #include <ostream>
 #include <queue>
 #include <set>
@@ -24,7 +31,28 @@ using RegT = uint8_t;
 
 // Forward declarations.
 struct Breakable;
+struct Declaration;
 struct Function;
+struct SyntaxTreeNode;
+class TypeTable;
+template <typename Decl> struct BasicSymbolTable;
+
+// Stores the data necessary to perform scope resolution.
+struct ScopeData
+{
+	// TU for the source file expressing this AST.
+	TU* _src;
+	// Engine diagnostics are reported to.
+	DiagnosticEngine& _diag;
+
+	/**
+	 * Construct a new structure to store scope resolution data.
+	 * @param src A translation unit source file buffer.
+	 * @param diag Engine diagnostics are reported to.
+	 */
+	ScopeData(TU* src, DiagnosticEngine& diag);
+};
+
 
 // Stores the data necessary to perform validation.
 struct ValidateData
@@ -35,12 +63,25 @@ struct ValidateData
 	std::vector<Breakable*> _bs;
 	// Function definition currently being validated.
 	Function* _curFunc {nullptr};
+	// Types of the AST being validated.
+	TypeTable* _types;
+	// Engine diagnostics are reported to.
+	DiagnosticEngine& _diag;
+	// Symbol table and scope resolution data of a fused check, which resolves
+	// each node as it is validated.
+	BasicSymbolTable<Declaration>* _symbols {nullptr};
+	ScopeData* _scope {nullptr};
+	// Cleared once scope resolution fails in a fused check. Validation is then
+	// abandoned and the remaining nodes are only resolved.
+	bool _resolved {true};
 
 	/**
 	 * Construct a new structure to store validation data.
 	 * @param src A translation unit source file buffer.
+	 * @param types Type table of the AST being validated.
+	 * @param diag Engine diagnostics are reported to.
 	 */
-	ValidateData(TU* src);
+	ValidateData(TU* src, TypeTable* types, DiagnosticEngine& diag);
 };
 
 
@@ -130,35 +171,174 @@ public:
 };
 
 
-// Forward declaration:
-struct Declaration;
-
-
-// Stores program symbols in a scoped hierarchy.
-struct SymbolTable
+// Stores program symbols in a scoped hierarchy. All scopes share a single
+// open-addressing hash table that holds the innermost binding of each name.
+// Bindings that a scope shadows are recorded in an undo log and restored when
+// the scope exits, so entering and exiting a scope costs time proportional to
+// the number of symbols it defines, and lookups are independent of depth.
+// Symbols are bound to pointers to Decl, the node type of the AST being
+// resolved.
+//
+// A table may be nested in a read-only outer table, such as the globals of a
+// program, and see only the outer symbols defined before a given point. This
+// lets the bodies of functions be resolved concurrently, each in its own
+// table, without seeing globals declared after the function.
+template <typename Decl>
+struct BasicSymbolTable
 {
 protected:
-	// A stack of scopes that map identifiers to AST declarations.
-	std::forward_list<std::map<std::string_view, Declaration*>> _stackMap;
+	// A slot of the hash table.
+	struct Slot
+	{
+		Name _name;				// Key; null if the slot is free.
+		Decl* _decl {nullptr};	// Innermost binding; may be null.
+		uint32_t _depth {0};	// Scope depth of the binding.
+		uint32_t _seq {0};		// Sequence number of the binding.
+	};
+
+	// A binding replaced by a definition, to be restored on scope exit.
+	struct Shadowed
+	{
+		Name _name;			// The redefined name.
+		Decl* _decl;		// Binding prior to the definition.
+		uint32_t _depth;	// Scope depth of the prior binding.
+		uint32_t _seq;		// Sequence number of the prior binding.
+	};
+
+	std::vector<Slot> _slots;		// Hash table. Size is a power of two.
+	size_t _used {0};				// Number of keyed slots.
+	int _shift {64};				// Shift mapping a hash to a slot index.
+	std::vector<Shadowed> _undo;	// Log of replaced bindings.
+	std::vector<size_t> _scopes;	// Start of each open scope's undo entries.
+	uint32_t _defined {0};			// Number of definitions made.
+	const BasicSymbolTable* _outer {nullptr};	// Enclosing table, if any.
+	uint32_t _outerLimit {0};		// Outer definitions that are visible.
+
+	/**
+	 * Finds the slot keyed by a name, or the free slot it would occupy.
+	 * @param name Name to search for. Must not be null.
+	 * @return Index of the slot.
+	 */
+	size_t Probe(Name name) const
+	{
+		// Fibonacci hashing spreads the pointer-derived hashes over the table.
+		const size_t mask {_slots.size() - 1};
+		size_t i {static_cast<size_t>(
+			(name.Hash() * 0x9E3779B97F4A7C15ull) >> _shift)};
+		while (!_slots[i]._name.IsNull() && _slots[i]._name != name)
+			i = (i + 1) & mask;
+		return i;
+	}
+
+	// Doubles the capacity of the hash table.
+	void Grow()
+	{
+		std::vector<Slot> old {std::move(_slots)};
+		_slots = std::vector<Slot>(old.size() * 2);
+		-- _shift;
+		for (const Slot& slot : old)
+			if (!slot._name.IsNull()) _slots[Probe(slot._name)] = slot;
+	}
 
 public:
 	/** Default constructor. */
-	SymbolTable();
+	BasicSymbolTable()
+		: _slots(64), _shift{64 - 6}
+	{}
+
+	/**
+	 * Construct a table nested in an outer table. Symbols not defined in this
+	 * table are looked up in the outer one, which must not change while this
+	 * table is in use.
+	 * @param outer Enclosing table.
+	 * @param outer_limit Number of the outer table's definitions that are
+	 * visible, as returned by its GetDefinitionCount().
+	 */
+	BasicSymbolTable(const BasicSymbolTable* outer, uint32_t outer_limit)
+		: _slots(64), _shift{64 - 6}, _outer{outer}, _outerLimit{outer_limit}
+	{}
 
 	/** Mark the beginning of a new scope. */
-	void Enter();
+	void Enter()
+	{
+		_scopes.push_back(_undo.size());
+	}
 
 	/**  Mark the end of a new scope. */
-	void Exit();
+	void Exit()
+	{
+		const size_t start {_scopes.back()};
+		_scopes.pop_back();
+		while (_undo.size() > start)
+		{
+			const Shadowed& prev {_undo.back()};
+			Slot& slot {_slots[Probe(prev._name)]};
+			slot._decl = prev._decl;
+			slot._depth = prev._depth;
+			slot._seq = prev._seq;
+			_undo.pop_back();
+		}
+	}
+
+	/**
+	 * @return Number of scopes currently open.
+	 */
+	size_t GetDepth() const
+	{
+		return _scopes.size();
+	}
+
+	/**
+	 * @return Number of definitions made in this table so far.
+	 */
+	uint32_t GetDefinitionCount() const
+	{
+		return _defined;
+	}
 
 	/**
 	 * Attempts to define a new symbol in the current scope.
 	 * @param name The symbol's identifier (name).
 	 * @param node The AST node referred to by the symbol.
-	 * @return AST node that defines the symbol. If no such symbol is defined,
-	 * nullptr is returned.
+	 * @return AST node that already defines the symbol in the current scope.
+	 * If no such symbol is defined, nullptr is returned and the symbol is
+	 * defined.
 	 */
-	Declaration* Define(std::string_view name, Declaration* node);
+	Decl* Define(Name name, Decl* node)
+	{
+		const uint32_t depth {static_cast<uint32_t>(_scopes.size())};
+		size_t i {Probe(name)};
+		if (_slots[i]._name.IsNull())
+		{
+			// Keep the load factor at or below one half.
+			if ((_used + 1) * 2 > _slots.size())
+			{
+				Grow();
+				i = Probe(name);
+			}
+			_slots[i]._name = name;
+			++ _used;
+		}
+
+		Slot& slot {_slots[i]};
+		if (slot._decl != nullptr && slot._depth == depth) return slot._decl;
+		_undo.push_back(Shadowed {name, slot._decl, slot._depth, slot._seq});
+		slot._decl = node;
+		slot._depth = depth;
+		slot._seq = _defined ++;
+		return nullptr;
+	}
+
+	/**
+	 * Replaces the innermost binding of a symbol, keeping its scope and its
+	 * place in the order of definitions.
+	 * @param name The symbol's identifier (name). Must be bound.
+	 * @param node The AST node to be referred to by the symbol.
+	 */
+	void Rebind(Name name, Decl* node)
+	{
+		_slots[Probe(name)]._decl = node;
+	}
 
 	/**
 	 * Returns a pointer to the AST node referred to by the specfied symbol,
@@ -166,40 +346,200 @@ public:
 	 * symbol is returned over others (in preservation of shadowing).
 	 * @param name The symbol's identifier (name).
 	 * @return AST node that defines the symbol. If no such symbol is defined,
-	 * nullptr is returned. A returned pointer indicates a name collision.
+	 * nullptr is returned.
+	 */
+	Decl* Lookup(Name name) const
+	{
+		if (name.IsNull()) return nullptr;
+		const Slot& slot {_slots[Probe(name)]};
+		if (slot._decl != nullptr || _outer == nullptr) return slot._decl;
+		return _outer->LookupDefinedBefore(name, _outerLimit);
+	}
+
+	/**
+	 * Looks up a symbol as Lookup() does, but ignores bindings made by the
+	 * limit-th or later definition in this table.
+	 * @param name The symbol's identifier (name).
+	 * @param limit Number of definitions that are visible.
+	 * @return AST node that defines the symbol. If no such symbol is visible,
+	 * nullptr is returned.
 	 */
-	Declaration* Lookup(std::string_view name);
+	Decl* LookupDefinedBefore(Name name, uint32_t limit) const
+	{
+		if (name.IsNull()) return nullptr;
+		const Slot& slot {_slots[Probe(name)]};
+		return slot._seq < limit ? slot._decl : nullptr;
+	}
 };
 
 
+// Symbol table resolving the declarations of a pointer-linked AST.
+using SymbolTable = BasicSymbolTable<Declaration>;
+
+
 // Storess the data necessary to generate code and provides some utilities.
 struct GenData
-{};
+{
+	// Global variables to allocate and the label IDs of their definitions.
+	std::vector<std::pair<const Type*, IDT>> _globalVars;
+};
 
 
-// Base class for nodes of the AST.
+// Identifies the concrete class of an AST node. Kinds are ordered so that the
+// subclasses of each abstract node class form a contiguous range.
+enum class NodeKind : uint8_t
+{
+	Identifier,
+	Parameter,		// Statements and declarations begin here.
+	Function,
+	VariableDef,
+	IfStmt,
+	BreakStmt,
+	ReturnStmt,
+	LoopExpr,		// Expressions and breakables begin here.
+	CompoundStmt,
+	BinaryExpr,
+	UnaryExpr,
+	Invocation,
+	AssignmentExpr,
+	Variable,		// Literals begin here.
+	IntLiteral,
+	BoolLiteral,
+	StrLiteral
+};
+
+
+// Base class for nodes of the AST. Node classes form a single-inheritance
+// hierarchy, so every node starts with the same fixed header: the vtable
+// pointer, the source location, the node's kind, and its flags.
 struct SyntaxTreeNode
-	: public virtual TokenInfo
+	: public SourceLocation
 {
-	// Necessary to enable polymorphic deletion of derived AST nodes.
+	const NodeKind _kind;		// Concrete class of the node.
+	bool _hasReturn {false};	// Indicates whether all control paths return.
+	bool _hasCall {false};		// This node calls a function.
+
+	/**
+	 * Construct a new node.
+	 * @param kind Concrete class of the node.
+	 */
+	SyntaxTreeNode(NodeKind kind);
+
+	// Nodes live in an AST's arena, so this is never invoked by the AST.
 	virtual ~SyntaxTreeNode();
 
+	/**
+	 * @return Number of child slots of this node. Slots of optional children
+	 * may be empty. Children are listed in the order they are visited.
+	 */
+	virtual size_t GetChildCount() const;
+
+	/**
+	 * @param i Index of a child slot, less than GetChildCount().
+	 * @return The child in the slot, or nullptr if the slot is empty.
+	 */
+	virtual SyntaxTreeNode* GetChild(size_t i) const;
+
 	/**
 	 * Performs scope resolution by populating references to declarations.
+	 * Visits the subtree without recursion, calling ScopeEnter() and
+	 * ScopeLeave() around the children of each node.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool Scope(SymbolTable& symbols, ScopeData& dat);
+
+	/**
+	 * Performs scope resolution of the children of this node, but not of the
+	 * node itself.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool ScopeChildren(SymbolTable& symbols, ScopeData& dat);
+
+	/**
+	 * Performs the scope resolution of this node that precedes resolution of
+	 * its children, such as looking up a symbol or opening a scope.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	virtual bool ScopeEnter(SymbolTable& symbols, ScopeData& dat);
+
+	/**
+	 * Performs the scope resolution of this node that follows resolution of
+	 * its children, such as defining a variable or closing a scope.
 	 * @param symbols Symbol table to be used.
-	 * @param tu Translation unit corresponding to this node.
+	 * @param dat Scope resolution data of the AST.
 	 * @return true if scope resolution is successful; false otherwise.
 	 */
-	virtual bool Scope(SymbolTable& symbols, TU& tu);
+	virtual bool ScopeLeave(SymbolTable& symbols, ScopeData& dat);
 
 	/**
 	 * Traverses the AST structure and validates the semantics of the
-	 * represented program.
+	 * represented program. Visits the subtree without recursion, calling the
+	 * validation hooks of each node.
 	 * @param dat An instance of ValidateData to store the state of the
 	 * validation.
 	 * @return true if the validation discovered no errors; false otherwise.
 	 */
-	virtual bool Validate(ValidateData& dat);
+	bool Validate(ValidateData& dat);
+
+	/**
+	 * Performs the validation of this node that precedes validation of its
+	 * children.
+	 * @param dat Validation data of the AST.
+	 * @return false if validation failed, in which case neither the children
+	 * nor the rest of this node are validated; true otherwise.
+	 */
+	virtual bool ValidateEnter(ValidateData& dat);
+
+	/**
+	 * Performs the validation of this node that precedes validation of a
+	 * child. Called for empty child slots as well.
+	 * @param dat Validation data of the AST.
+	 * @param i Index of the child slot.
+	 * @param success Success of this node's validation so far. May be
+	 * cleared.
+	 * @return true if the child is to be validated; false otherwise.
+	 */
+	virtual bool
+		ValidateBeforeChild(ValidateData& dat, size_t i, bool& success);
+
+	/**
+	 * Performs the validation of this node that follows validation of a
+	 * child.
+	 * @param dat Validation data of the AST.
+	 * @param i Index of the child slot.
+	 * @param success Success of this node's validation so far, including the
+	 * child's. May be cleared.
+	 */
+	virtual void
+		ValidateAfterChild(ValidateData& dat, size_t i, bool& success);
+
+	/**
+	 * Performs the validation of this node that follows validation of its
+	 * children.
+	 * @param dat Validation data of the AST.
+	 * @param success Success of this node's validation so far, including its
+	 * children's. May be cleared.
+	 */
+	virtual void ValidateLeave(ValidateData& dat, bool& success);
+
+	/**
+	 * Performs scope resolution and validation in a single traversal: each
+	 * node is resolved on the way down and validated on the way up. Produces
+	 * the diagnostics of Scope() and Validate() in the order separate passes
+	 * would, provided validation diagnostics are written to a separate stream
+	 * and discarded if resolution fails.
+	 * @param dat Validation data with the symbol table and scope resolution
+	 * data of the check set.
+	 * @return true if resolution and validation discovered no errors; false
+	 * otherwise.
+	 */
+	bool Check(ValidateData& dat);
 
 	/**
 	 * Generates the output assembly described by the AST.
@@ -209,13 +549,35 @@ struct SyntaxTreeNode
 	virtual void Generate(GenData& dat, std::ostream& os);
 
 	/**
-	 * Prints a textual representation of this AST node to the specified stream.
+	 * Prints a textual representation of this AST node to the specified
+	 * stream. Visits the subtree without recursion, calling PrintEnter() and
+	 * PrintBeforeChild() for each node.
 	 * @param os The output stream to print to.
 	 * @param indent A view of the unit of indentation to be used.
 	 * @param depth The depth of the node in the tree. Need not be set.
 	 */
+	void Print(std::ostream& os, std::string_view indent, int depth = 0);
+
+	/**
+	 * Prints the representation of this node that precedes its children.
+	 * @param os The output stream to print to.
+	 * @param indent A view of the unit of indentation to be used.
+	 * @param depth The depth of the node in the tree.
+	 */
 	virtual void
-		Print(std::ostream& os, std::string_view indent, int depth = 0) = 0;
+		PrintEnter(std::ostream& os, std::string_view indent, int depth) = 0;
+
+	/**
+	 * Prints what precedes a child, such as its label, or stands in for an
+	 * empty child slot.
+	 * @param os The output stream to print to.
+	 * @param indent A view of the unit of indentation to be used.
+	 * @param depth The depth of this node in the tree.
+	 * @param i Index of the child slot.
+	 * @return The depth the child is printed at.
+	 */
+	virtual int PrintBeforeChild(
+		std::ostream& os, std::string_view indent, int depth, size_t i);
 
 	/**
 	 * Prints the indentation for Print().
@@ -228,96 +590,68 @@ struct SyntaxTreeNode
 		PrintIndent(std::ostream& os, std::string_view indent, int depth);
 
 	/**
-	 * Calls Print() on the referenced node. If the node is nullptr,
-	 * "nullptr\n" is printed instead.
-	 * @param node A node to attempt to print.
+	 * Prints "nullptr\n" in place of an empty child slot.
+	 * @param node The child in the slot, which need not be empty.
 	 * @param os The output stream to print to.
 	 * @param indent A view of the unit of indentation to be used.
-	 * @param depth The depth of the node in the tree (the number of levels of
-	 * indentation).
+	 * @param depth The depth the child is printed at.
 	 */
-	static void PrintMaybe(SyntaxTreeNode* node, std::ostream& os
+	static void PrintIfEmpty(SyntaxTreeNode* node, std::ostream& os
 		, std::string_view indent, int depth);
-};
-
-
-// Stores the AST of a complete program.
-using AST = std::vector<std::unique_ptr<SyntaxTreeNode>>;
-
-
-struct Identifier
-	: public SyntaxTreeNode
-{
-	std::string _id; // Name associated with this node.
 
 	/**
-	 * Construct a new identifier.
-	 * @param id Name to be associated with this node.
+	 * Moves every location in this subtree by the same distance, as when text
+	 * is inserted or removed before it. Visits the subtree without recursion,
+	 * calling ShiftEnter() for each node.
+	 * @param delta Distance to move the locations by, in characters.
 	 */
-	Identifier(std::string& id);
-
-	// Prints inline in the format "ID = <type_name>".
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
-
-	// TokenInfo refers to the ID itself, assigned by the parser.
-};
-
-
-// Represents any node which defines a symbol.
-struct Declaration
-	: public virtual SyntaxTreeNode
-{
-	std::unique_ptr<Identifier> _name; // Declared identifier.
+	void Shift(int64_t delta);
 
 	/**
-	 * Construct a new declaration.
-	 * @param name Identifier associated with the declaration.
+	 * Moves the locations held by this node, but not those of its children.
+	 * Nodes referring to others that are not their children, such as
+	 * identifiers, move those as well.
+	 * @param delta Distance to move the locations by, in characters.
 	 */
-	Declaration(Identifier* name);
+	virtual void ShiftEnter(int64_t delta);
 };
 
 
-// Represents a type in the program.
+// Represents a type in the program. Types are owned by a TypeTable, which holds
+// exactly one instance of each distinct type, so two types are the same type
+// exactly when they are the same object.
 struct Type
-	: public SyntaxTreeNode
 {
+	// Distinguishes the fundamental types from user-defined ones.
+	enum class Kind : uint8_t { Void, Int, Bool, String, Named };
+
 protected:
-	static const std::unique_ptr<Type> _void;	// Void singleton.
-	static const std::unique_ptr<Type> _int;	// Integer singleton.
-	static const std::unique_ptr<Type> _bool;	// Boolean singleton.
-	static const std::unique_ptr<Type> _string;	// String singleton.
-
-	// Maps the names of fundamental types to their singletons.
-	static const std::map<std::string_view, Type*> _namedFundamentals;
-	// Set of fundamental types.
-	static const std::set<const Type*> _fundamentals;
-	// Type's instance size in bytes.
-	BytesT _size {0};
+	Kind _kind;			// Which fundamental type this is, if any.
+	uint32_t _id;		// Dense index of the type within its table.
+	BytesT _size {0};	// Type's instance size in bytes.
 
-	// Default constructor.
-	Type();
+public:
+	std::string_view _name;				// The type's name.
+	SyntaxTreeNode*	_defType {nullptr};	// The defined type, if applicable.
 
 	/**
-	 * Construct a new type.
+	 * Construct a new type. Only TypeTable should construct types.
+	 * @param kind Which fundamental type this is, if any.
+	 * @param id Dense index of the type within its table.
 	 * @param type_name Type's symbolic name.
 	 * @param size Type's instance size in bytes.
 	 */
-	Type(std::string type_name, BytesT size = 0);
+	Type(Kind kind, uint32_t id, std::string_view type_name, BytesT size = 0);
 
-
-public:
-	// TODO: Reevaluate whether the name should be stored as an Identifier node.
-	std::string _name;					// The type's name.
-	SyntaxTreeNode*	_defType {nullptr};	// The defined type, if applicable.
+	Type(const Type&) = delete;
+	Type& operator=(const Type&) = delete;
 
 	/**
-	 * Returns a pointer to a new instance of Type with. AST nodes which
-	 * define the type must take ownership of the pointer.
-	 * @param type_name The type to be represented.
-	 * @return Type* A pointer to the new Type instance.
+	 * @param type Type to be named, or nullptr if not yet known.
+	 * @return The type's name, or "void" for nullptr.
 	 */
-	static Type* Create(std::string type_name);
-	
+	static std::string_view NameOf(const Type* type);
+
 	/**
 	 * @return true if this is the fundamental type void; false otherwise.
 	 */
@@ -353,11 +687,10 @@ public:
 	 */
 	const BytesT GetSize() const;
 
-	// Equality operator overload.
-	friend bool operator==(const Type& lhs, const Type& rhs);
-
-	// Inequality operator overload.
-	friend bool operator!=(const Type& lhs, const Type& rhs);
+	/**
+	 * @return Dense index of the type within its table.
+	 */
+	uint32_t GetID() const;
 
 	/**
 	 * Generates the output assembly necessary to load or store data to
@@ -372,7 +705,217 @@ public:
 	 */
 	void
 	GenerateAccess(GenData& dat, Location loc, bool load, std::ostream& os);
+};
+
+
+// Interns the types of a compilation. Each distinct type is created once, on
+// first use, and every later request for it returns the same instance, so
+// annotating an expression with a type never allocates.
+class TypeTable
+{
+	std::deque<Type> _types;				// Storage with stable addresses.
+	std::unordered_map<Name, Type*> _named;	// Maps names to their types.
+	Type* _void;							// The fundamental types.
+	Type* _int;
+	Type* _bool;
+	Type* _string;
+
+	/**
+	 * Creates and registers a new type.
+	 * @param kind Which fundamental type this is, if any.
+	 * @param name The type's name.
+	 * @param size The type's instance size in bytes.
+	 * @return The new type.
+	 */
+	Type* Add(Type::Kind kind, Name name, BytesT size);
+
+public:
+	/**
+	 * Construct a table holding the fundamental types.
+	 * @param names Table used to intern the fundamental types' names. Must
+	 * outlive the type table.
+	 */
+	TypeTable(NameTable& names);
+
+	TypeTable(const TypeTable&) = delete;
+	TypeTable& operator=(const TypeTable&) = delete;
+
+	/**
+	 * Returns the type with the given name, creating it if necessary.
+	 * @param name The type's name, interned in the table given at construction.
+	 * @return The unique instance of the type.
+	 */
+	Type* Get(Name name);
+
+	/**
+	 * @param id Index of a type in this table, as returned by Type::GetID().
+	 * @return The type with the given index.
+	 */
+	Type* operator[](uint32_t id);
 
-	// Prints inline in the format "Type = <type_name>".
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	/**
+	 * @return The fundamental type void.
+	 */
+	Type* Void() const;
+
+	/**
+	 * @return The fundamental type int.
+	 */
+	Type* Int() const;
+
+	/**
+	 * @return The fundamental type bool.
+	 */
+	Type* Bool() const;
+
+	/**
+	 * @return The fundamental type string.
+	 */
+	Type* String() const;
+
+	/**
+	 * @return Number of distinct types in the table.
+	 */
+	size_t size() const;
 };
+
+
+// Stores the AST of a complete program. Every node is allocated in the AST's
+// arena, in parse order, and all of them are released together with it.
+struct AST
+{
+	// Spellings of the identifiers and literals referred to by the AST.
+	NameTable _names;
+	// Types referred to by the AST. Must follow _names, which it refers to.
+	TypeTable _types {_names};
+	// Storage of every node in the AST.
+	Arena _arena;
+	// Top-level nodes of the AST in source order.
+	std::vector<SyntaxTreeNode*> _globals;
+	// Distance each top-level node's subtree is yet to be moved by, in the
+	// order of _globals. Parser::reparse() moves a global by adding to it,
+	// and the subtree is shifted when the global is next accessed, so that
+	// globals no one looks at are not visited.
+	std::vector<int64_t> _shifts;
+	// If set, receives each top-level node as it is appended, in place of
+	// _globals, so it can be processed while the rest is still parsed.
+	std::function<void(SyntaxTreeNode*)> _consumer;
+
+	/**
+	 * Constructs a node in the AST's arena.
+	 * @param args Arguments forwarded to the node's constructor.
+	 * @return Pointer to the new node.
+	 */
+	template <typename T, typename... Args>
+	T* Create(Args&&... args)
+	{
+		return _arena.Create<T>(std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Copies a list of child nodes into the AST's arena.
+	 * @param items Nodes to be listed.
+	 * @return List referring to the copy.
+	 */
+	template <typename T>
+	ArenaList<T> CreateList(const std::vector<T*>& items)
+	{
+		return _arena.CreateList(items);
+	}
+
+	/**
+	 * Appends a top-level node, or hands it to the consumer if one is set.
+	 * @param node Node to be appended. Must be allocated in this AST's arena.
+	 */
+	void emplace_back(SyntaxTreeNode* node);
+
+	/**
+	 * @return Number of top-level nodes.
+	 */
+	size_t size() const;
+
+	/**
+	 * @param i Index of a top-level node.
+	 * @return Offset of the top-level node at the specified index, as it
+	 * will be once moved, without moving its subtree.
+	 */
+	uint32_t GetOffset(size_t i) const;
+
+	/**
+	 * Moves the subtree of a top-level node by the distance it is yet to be
+	 * moved by, if any. Not to be called concurrently for the same node.
+	 * @param i Index of a top-level node.
+	 */
+	void Settle(size_t i);
+
+	/**
+	 * @param i Index of a top-level node.
+	 * @return The top-level node at the specified index, moved to where it
+	 * is in the source.
+	 */
+	SyntaxTreeNode* operator[](size_t i);
+
+	// Iterators over the top-level nodes, all of which begin() moves to
+	// where they are in the source.
+	std::vector<SyntaxTreeNode*>::const_iterator begin();
+	std::vector<SyntaxTreeNode*>::const_iterator end() const;
+};
+
+
+struct Identifier
+	: public SyntaxTreeNode
+{
+	Name _id; // Name associated with this node.
+
+	/**
+	 * Construct a new identifier.
+	 * @param id Name to be associated with this node.
+	 */
+	Identifier(Name id);
+
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::Identifier; }
+
+	// Prints inline in the format "ID = <type_name>".
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+
+	// SourceLocation refers to the ID itself, assigned by the parser.
+};
+
+
+/**
+ * Tests the concrete class of a node without consulting RTTI. Each node class
+ * T provides T::ClassOf(), which accepts the kinds of its concrete classes.
+ * @param node Node to be tested. Must not be nullptr.
+ * @return true if node is an instance of T; false otherwise.
+ */
+template <typename T>
+bool isa(const SyntaxTreeNode* node)
+{
+	return T::ClassOf(node->_kind);
+}
+
+
+/**
+ * Downcasts a node known to be an instance of To without consulting RTTI.
+ * @param node Node to be cast. Must be an instance of To.
+ * @return node as a To.
+ */
+template <typename To, typename From>
+To* cast(From* node)
+{
+	assert(isa<To>(node));
+	return static_cast<To*>(node);
+}
+
+
+/**
+ * Downcasts a node if it is an instance of To, without consulting RTTI.
+ * @param node Node to be cast. May be nullptr.
+ * @return node as a To, or nullptr if node is nullptr or not a To.
+ */
+template <typename To, typename From>
+To* dyn_cast(From* node)
+{
+	return node != nullptr && isa<To>(node) ? cast<To>(node) : nullptr;
+}
@@ -15,17 +15,25 @@ using namespace std::string_view_literals;
 struct Statement;	// Forward declaration.
 
 // Stores a list of statements.
-using StmtList = std::vector<std::unique_ptr<Statement>>;
+using StmtList = ArenaList<Statement>;
 
 // Base class to represent statements.
 struct Statement
-	: public virtual SyntaxTreeNode
+	: public SyntaxTreeNode
 {
-	bool _hasReturn {false};	// Indicates whether all control paths return.
-	bool _hasCall {false};		// This expression calls a function.
+	static bool ClassOf(NodeKind kind)
+	{
+		return kind >= NodeKind::Parameter && kind <= NodeKind::StrLiteral;
+	}
+
+	/**
+	 * Construct a new statement.
+	 * @param kind Concrete class of the statement.
+	 */
+	Statement(NodeKind kind);
 
 	/**
-	 * Determines whether the passed list of statements contains a
+	 * Determines whether the passed list of validated statements contains a
 	 * return statement in a valid place (at the end of all control paths).
 	 * @param stmts The list of statements to consider.
 	 * @param dat An instance of ValidateData to store the state of the
@@ -36,10 +44,53 @@ struct Statement
 	 * parameter.
 	 * @return true if the statements return in a valid way; false otherwise.
 	 */
-	static bool ValidateAndGetReturn(
+	static bool CheckReturn(
 		StmtList& stmts, ValidateData& dat, bool& success, bool* has_call);
 
-	// TokenInfo should refer to the entire statement in extending classes.
+	// SourceLocation should refer to the entire statement in extending classes.
+};
+
+
+// Represents any node which defines a symbol. Parameters and functions are
+// declarations, and hence statements, only so that the hierarchy stays single.
+struct Declaration
+	: public Statement
+{
+	static bool ClassOf(NodeKind kind)
+	{
+		return kind >= NodeKind::Parameter && kind <= NodeKind::VariableDef;
+	}
+
+	Identifier* _name;	// Declared identifier.
+	Type* _type;		// Declared type; the return type of a function.
+
+	/**
+	 * Construct a new declaration.
+	 * @param kind Concrete class of the declaration.
+	 * @param name Identifier associated with the declaration.
+	 * @param type Declared type; the return type of a function.
+	 */
+	Declaration(NodeKind kind, Identifier* name, Type* type);
+
+	/**
+	 * Defines the declared symbol in the current scope, reporting a collision
+	 * with any symbol already defined there.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if the symbol was defined; false on a collision.
+	 */
+	bool Define(SymbolTable& symbols, ScopeData& dat);
+
+	/**
+	 * Copies the parts of this declaration that later code may refer to: its
+	 * name, its type and a function's parameters, but not an initializer or
+	 * a body. Lets the rest of the declaration's subtree be released.
+	 * @param arena Arena the copy is placed in.
+	 * @return The copy, located where this declaration is.
+	 */
+	Declaration* CopySignature(Arena& arena) const;
+
+	void ShiftEnter(int64_t delta) override;
 };
 
 
@@ -47,22 +98,41 @@ struct Statement
 struct Expression
 	: public Statement
 {
-	Type* _type {Type::Create("void")};	// This expression's type.
+	static bool ClassOf(NodeKind kind)
+	{
+		return kind >= NodeKind::LoopExpr && kind <= NodeKind::StrLiteral;
+	}
+
+	// This expression's type, assigned during validation.
+	Type* _type {nullptr};
+
+	/**
+	 * Construct a new expression.
+	 * @param kind Concrete class of the expression.
+	 */
+	Expression(NodeKind kind);
 };
 
 
 // Abstract representation of expressions that can be broken.
 struct Breakable
 	: public Expression
-{};
+{
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::LoopExpr; }
+
+	/**
+	 * Construct a new breakable expression.
+	 * @param kind Concrete class of the expression.
+	 */
+	Breakable(NodeKind kind);
+};
 
 
 // Represents a variable definition (including initialization).
 struct VariableDef
-	: public virtual Statement, public Declaration
+	: public Declaration
 {
-	Type* _type;						// Variable's type.
-	std::unique_ptr<Expression> _init;	// Variable's initializer.
+	Expression* _init;	// Variable's initializer.
 
 	/**
 	 * Construct a new variable definition.
@@ -72,12 +142,17 @@ struct VariableDef
 	 */
 	VariableDef(Type* type, Identifier* name, Expression* init);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::VariableDef; }
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ScopeLeave(SymbolTable& symbols, ScopeData& dat) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
 
-	// TokenInfo refers to the equal symbol.
+	// SourceLocation refers to the equal symbol.
 };
 
 
@@ -85,9 +160,9 @@ struct VariableDef
 struct IfStmt
 	: public Statement
 {
-	std::unique_ptr<Expression> _cond;	// A conditional expression.
-	std::unique_ptr<Statement> _body;	// Statement executed on true.
-	std::unique_ptr<Statement> _alt;	// The else case. Optional.
+	Expression* _cond;	// A conditional expression.
+	Statement* _body;	// Statement executed on true.
+	Statement* _alt;	// The else case. Optional.
 
 	/**
 	 * Construct a new if statement.
@@ -97,12 +172,18 @@ struct IfStmt
 	 */
 	IfStmt(Expression* cond, Statement* body, Statement* alt);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::IfStmt; }
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 	
-	// TokenInfo refers to the if keyword.
+	// SourceLocation refers to the if keyword.
 };
 
 
@@ -113,9 +194,9 @@ struct IntLiteral;	// Forward declaration.
 struct BreakStmt
 	: public Statement
 {
-	Breakable* _target {nullptr};		// Targetted breakable expression.
-	std::unique_ptr<Expression> _expr;	// Yield expression. Optional.
-	std::unique_ptr<IntLiteral> _count;	// Break count literal. Optional.
+	Breakable* _target {nullptr};	// Targetted breakable expression.
+	Expression* _expr;				// Yield expression. Optional.
+	IntLiteral* _count;				// Break count literal. Optional.
 
 	/**
 	 * Construct a new break statement.
@@ -123,20 +204,28 @@ struct BreakStmt
 N	 */
 	BreakStmt(Expression* expr, IntLiteral* count);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::BreakStmt; }
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ValidateEnter(ValidateData& dat) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void ShiftEnter(int64_t delta) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the break keyword.
+	// SourceLocation refers to the break keyword.
 };
 
 
 struct ReturnStmt
 	: public Statement
 {
-	Function* _target;					// The enclosing function.
-	std::unique_ptr<Expression> _expr;	// An optional return expression.
+	Function* _target;	// The enclosing function.
+	Expression* _expr;	// An optional return expression.
 
 	/**
 	 * Construct a new return statement.
@@ -144,12 +233,19 @@ struct ReturnStmt
 	 */
 	ReturnStmt(Expression* expr);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::ReturnStmt; }
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ValidateEnter(ValidateData& dat) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the return keyword.
+	// SourceLocation refers to the return keyword.
 };
 
 
@@ -157,24 +253,36 @@ struct ReturnStmt
 struct CompoundStmt
 	: public Expression
 {
-	StmtList _stmts;					// Node's children statements.
-	std::unique_ptr<Expression> _expr;	// An evaluation expression. Optional.
+	StmtList _stmts;	// Node's children statements.
+	Expression* _expr;	// An evaluation expression. Optional.
 	
 	/**
 	 * Construct a new compound statement.
-	 * @param stmts Node's children statements. Assumed to be in reverse order
-	 * after being parsed bottom-up.
+	 * @param stmts Node's children statements, in source order.
 	 * @param expr An optional return expression, declared as the last statement
 	 * without a semicolon.
 	 */
 	CompoundStmt(StmtList stmts, Expression* expr);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind)
+	{
+		return kind == NodeKind::CompoundStmt;
+	}
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ScopeEnter(SymbolTable& symbols, ScopeData& dat) override;
+	bool ScopeLeave(SymbolTable& symbols, ScopeData& dat) override;
+	bool ValidateBeforeChild(
+		ValidateData& dat, size_t i, bool& success) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the inclusive span between curly braces.
+	// SourceLocation refers to the inclusive span between curly braces.
 };
 
 
@@ -207,9 +315,9 @@ struct BinaryExpr
 		Mod
 	};
 
-	std::unique_ptr<Expression> _argl;	// Expression's left operand.
-	std::unique_ptr<Expression> _argr;	// Expression's right operand.
-	Ops _op;							// Operator being applied.
+	Expression* _argl;	// Expression's left operand.
+	Expression* _argr;	// Expression's right operand.
+	Ops _op;			// Operator being applied.
 
 	/**
 	 * Construct a new binary expression.
@@ -219,19 +327,26 @@ struct BinaryExpr
 	 */
 	BinaryExpr(Expression* argl, Expression* argr, Ops op);
 
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::BinaryExpr; }
+
 	/**
 	 * Returns a view to a textual representation of the operator.
 	 * @param op Operator to be named.
 	 * @return std::string_view View to the operator's name.
 	 */
-	std::string_view GetOpText(Ops op); // TODO: Extract superclass to own this.
+	// TODO: Extract superclass to own this.
+	static std::string_view GetOpText(Ops op);
 	
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the operator symbol.
+	// SourceLocation refers to the operator symbol.
 };
 
 
@@ -252,8 +367,8 @@ struct UnaryExpr
 		Comp
 	};
 
-	std::unique_ptr<Expression> _arg;	// Expression's operand.
-	Ops _op;							// Operator being applied.
+	Expression* _arg;	// Expression's operand.
+	Ops _op;			// Operator being applied.
 
 	/**
 	 * Construct a new unary expression.
@@ -262,19 +377,25 @@ struct UnaryExpr
 	 */
 	UnaryExpr(Expression* arg, Ops op);
 
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::UnaryExpr; }
+
 	/**
 	 * Returns a view to a textual representation of the operator.
 	 * @param op Operator to be named.
 	 * @return std::string_view View to the operator's name.
 	 */
-	std::string_view GetOpText(Ops op);
+	static std::string_view GetOpText(Ops op);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the operator symbol.
+	// SourceLocation refers to the operator symbol.
 };
 
 
@@ -283,26 +404,37 @@ struct Invocation
 	: public Expression
 {
 	// Stores the arguments passed to a function.
-	using ArgList = std::vector<std::unique_ptr<Expression>>;
+	using ArgList = ArenaList<Expression>;
 
-	std::unique_ptr<Identifier> _name;	// Callee function's identifier.
-	Function* _def;						// Node defining the callee function.
-	ArgList _args;						// Arguments specified by the call.
+	Identifier* _name;	// Callee function's identifier.
+	Function* _def;		// Node defining the callee function.
+	ArgList _args;		// Arguments specified by the call.
 
 	/**
 	 * Construct a new invocation.
 	 * @param name Name of the function being called.
-	 * @param args Arguments specified by the function call. Assumed to be in
-	 * reverse order after being parsed.
+	 * @param args Arguments specified by the function call, in source order.
 	 */
-	Invocation(Identifier* name, ArgList& args);
-
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	Invocation(Identifier* name, ArgList args);
+
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::Invocation; }
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ScopeEnter(SymbolTable& symbols, ScopeData& dat) override;
+	bool ValidateEnter(ValidateData& dat) override;
+	bool ValidateBeforeChild(
+		ValidateData& dat, size_t i, bool& success) override;
+	void ValidateAfterChild(
+		ValidateData& dat, size_t i, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void ShiftEnter(int64_t delta) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the span of the ID to the closing parentheses.
+	// SourceLocation refers to the span of the ID to the closing parentheses.
 };
 
 
@@ -312,9 +444,9 @@ struct Invocation
 struct AssignmentExpr
 	: public Expression
 {
-	std::unique_ptr<Identifier> _name;	// Variable's identifier.
-	VariableDef* _def;					// AST node declaring the variable.
-	std::unique_ptr<Expression> _expr;	// Expression being assigned.
+	Identifier* _name;	// Variable's identifier.
+	VariableDef* _def;	// AST node declaring the variable.
+	Expression* _expr;	// Expression being assigned.
 
 	/**
 	 * Construct a new assignment expression.
@@ -323,12 +455,23 @@ struct AssignmentExpr
 	 */
 	AssignmentExpr(Identifier* name, Expression* expr);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind)
+	{
+		return kind == NodeKind::AssignmentExpr;
+	}
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ScopeEnter(SymbolTable& symbols, ScopeData& dat) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void ShiftEnter(int64_t delta) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the equal symbol.
+	// SourceLocation refers to the equal symbol.
 };
 
 
@@ -336,10 +479,10 @@ struct AssignmentExpr
 struct LoopExpr
 	: public Breakable
 {
-	std::unique_ptr<Expression> _init;	// Runs before the loop. Optional.
-	std::unique_ptr<Expression> _cond;	// Tested before iterations. Optional.
-	std::unique_ptr<Expression> _inc;	// Runs after the condition. Optional.
-	std::unique_ptr<Statement> _body;	// Executed each iteration.
+	Expression* _init;	// Runs before the loop. Optional.
+	Expression* _cond;	// Tested before iterations. Optional.
+	Expression* _inc;	// Runs after the condition. Optional.
+	Statement* _body;	// Executed each iteration.
 
 	/**
 	 * Construct a new LoopExpr object.
@@ -350,12 +493,19 @@ struct LoopExpr
 	 */
 	LoopExpr(Expression* init, Expression* cond, Expression* inc, Statement* body);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::LoopExpr; }
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ValidateEnter(ValidateData& dat) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
+	int PrintBeforeChild(std::ostream& os, std::string_view indent, int depth,
+		size_t i) override;
 
-	// TokenInfo refers to the loop keyword (for, loop, or while).
+	// SourceLocation refers to the loop keyword (for, loop, or while).
 };
 
 
@@ -366,18 +516,27 @@ struct Literal
 	: public Expression
 {
 	std::string_view _literalName;	// The name of the literal's node.
-	std::string _rawValue;			// The raw value obtained from the source.
+	Name _rawValue;					// The raw value obtained from the source.
 
 	/**
 	 * Construct a new literal object.
+	 * @param kind Concrete class of the literal.
 	 * @param literal_name Specifies the type of literal represented.
 	 * @param raw_value Value described by the literal sans type descriptors.
 	 */
-	Literal(std::string_view literal_name, std::string& raw_value);
+	Literal(NodeKind kind, std::string_view literal_name, Name raw_value);
 
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	static bool ClassOf(NodeKind kind)
+	{
+		return kind >= NodeKind::Variable && kind <= NodeKind::StrLiteral;
+	}
+
+	// Literals assign their own type, so every literal class validates.
+	bool ValidateEnter(ValidateData& dat) override = 0;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
 
-	// TokenInfo should refer to the entire literal.
+	// SourceLocation should refer to the entire literal.
 };
 
 
@@ -391,12 +550,15 @@ struct Variable
 	 * Construct a new variable.
 	 * @param name Variable's identifier.
 	 */
-	Variable(std::string& name);
+	Variable(Name name);
+
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::Variable; }
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
+	bool ScopeEnter(SymbolTable& symbols, ScopeData& dat) override;
+	bool ValidateEnter(ValidateData& dat) override;
 	void Generate(GenData& dat, std::ostream& os) override;
 
-	// TokenInfo refers to the identifier itself.
+	// SourceLocation refers to the identifier itself.
 };
 
 
@@ -410,12 +572,14 @@ struct IntLiteral
 	 * Construct a new integer literal.
 	 * @param raw_val Literal's integer value.
 	 */
-	IntLiteral(std::string& value);
+	IntLiteral(Name value);
 
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::IntLiteral; }
+
+	bool ValidateEnter(ValidateData& dat) override;
 	void Generate(GenData& dat, std::ostream& os) override;
 
-	// TokenInfo refers to the value itself.
+	// SourceLocation refers to the value itself.
 };
 
 
@@ -429,12 +593,14 @@ struct BoolLiteral
 	 * Construct a new Boolean literal.
 	 * @param value Literal's Boolean value.
 	 */
-	BoolLiteral(std::string& value);
+	BoolLiteral(Name value);
+
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::BoolLiteral; }
 
-	bool Validate(ValidateData& dat) override;
+	bool ValidateEnter(ValidateData& dat) override;
 	void Generate(GenData& dat, std::ostream& os) override;
 
-	// TokenInfo refers to the value itself.
+	// SourceLocation refers to the value itself.
 };
 
 
@@ -442,16 +608,18 @@ struct BoolLiteral
 struct StrLiteral
 	: public Literal
 {
-	std::string _value;	// Concrete literal value.
+	std::string_view _value;	// Concrete literal value.
 
 	/**
 	 * Construct a new string literal.
 	 * @param value Literal's Boolean value.
 	 */
-	StrLiteral(std::string& value);
+	StrLiteral(Name value);
+
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::StrLiteral; }
 
-	bool Validate(ValidateData& dat) override;
+	bool ValidateEnter(ValidateData& dat) override;
 	void Generate(GenData& dat, std::ostream& os) override;
 
-	// TokenInfo refers to the value itself.
+	// SourceLocation refers to the value itself.
 };
@@ -1,47 +1,50 @@
 #include "common.hpp"
 
-#include <iostream>
+#include <ostream>
 
 using namespace std::string_view_literals;
 
 
 AssignmentExpr::AssignmentExpr(Identifier* name, Expression* expr)
-	: _name{name}, _expr{expr}
+	: Expression{NodeKind::AssignmentExpr}, _name{name}, _expr{expr}
 {}
 
 
-bool AssignmentExpr::Scope(SymbolTable& symbols, TU& tu)
+size_t AssignmentExpr::GetChildCount() const
 {
-	bool success {true};
-	_def = dynamic_cast<VariableDef*>(symbols.Lookup(_name->_id));
+	return 1;
+}
+
+
+SyntaxTreeNode* AssignmentExpr::GetChild(size_t i) const
+{
+	return _expr;
+}
+
+
+bool AssignmentExpr::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
+{
+	_def = dyn_cast<VariableDef>(symbols.Lookup(_name->_id));
 	if (_def == nullptr)
 	{
-		std::cerr << '(' << _name->_row << ", "sv << _name->_col
-			<< "): Unkown variable: "sv << _name->_id << '\n';
-		tu.HighlightError(std::cerr, *_name);
-		success = false;
+		dat._diag.Error(DiagID::UnknownVariable, *_name, {_name->_id.View()});
+		return false;
 	}
-	
-	return _expr->Scope(symbols, tu) && success;
+	return true;
 }
 
 
-bool AssignmentExpr::Validate(ValidateData& dat)
+void AssignmentExpr::ValidateLeave(ValidateData& dat, bool& success)
 {
-	bool success {_expr->Validate(dat)};
-
 	_type = _def->_type;
-	if (*_type != *_expr->_type)
+	if (_type != _expr->_type)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Expected assignment expression of type "sv << _type->_name
-			<< ", found: "sv << _expr->_type->_name << '\n';
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::AssignmentType, *this,
+			{_type->_name, _expr->_type->_name});
 		success = false;
 	}
 	
 	_hasCall = _expr->_hasCall;
-	return success;
 }
 
 
@@ -49,44 +52,72 @@ void AssignmentExpr::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void AssignmentExpr::Print(std::ostream& os, std::string_view indent, int depth)
+void AssignmentExpr::ShiftEnter(int64_t delta)
+{
+	SyntaxTreeNode::ShiftEnter(delta);
+	_name->ShiftEnter(delta);
+}
+
+
+void AssignmentExpr::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "AssignmentExpression(ID) = "sv << _name->_id << "):\n"sv;
-	PrintIndent(os, indent, ++ depth);
+}
+
+
+int AssignmentExpr::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	PrintIndent(os, indent, depth + 1);
 	os << "Expression =\n"sv;
-	PrintMaybe(_expr.get(), os, indent, ++ depth);
+	PrintIfEmpty(_expr, os, indent, depth + 2);
+	return depth + 2;
 }
 
 
 LoopExpr::LoopExpr(
 	Expression* init, Expression* cond, Expression* inc, Statement* body)
-	: _init{init}, _cond{cond}, _inc{inc}, _body{body}
+	: Breakable{NodeKind::LoopExpr}
+		, _init{init}, _cond{cond}, _inc{inc}, _body{body}
 {}
 
 
-bool LoopExpr::Scope(SymbolTable& symbols, TU& tu)
+size_t LoopExpr::GetChildCount() const
 {
-	bool success {_init != nullptr ? _init->Scope(symbols, tu) : true};
-	success = (_cond != nullptr ? _init->Scope(symbols, tu) : true) && success;
-	success = (_inc != nullptr ? _init->Scope(symbols, tu) : true) && success;
-	return (_body != nullptr ? _init->Scope(symbols, tu) : true) && success;
+	return 4;
 }
 
 
-bool LoopExpr::Validate(ValidateData& dat)
+SyntaxTreeNode* LoopExpr::GetChild(size_t i) const
 {
+	switch (i)
+	{
+		case 0:		return _init;
+		case 1:		return _cond;
+		case 2:		return _inc;
+		default:	return _body;
+	}
+}
+
+
+bool LoopExpr::ValidateEnter(ValidateData& dat)
+{
+	// Void until a break statement in the body supplies a value.
+	_type = dat._types->Void();
 	dat._bs.push_back(this);
-	bool success {true};
-	if (_init != nullptr) success = _init->Validate(dat) && success;
-	if (_cond != nullptr) success = _cond->Validate(dat) && success;
-	if (_inc != nullptr) success = _inc->Validate(dat) && success;
-	success = _body->Validate(dat) && success;
+	return true;
+}
+
+
+void LoopExpr::ValidateLeave(ValidateData& dat, bool& success)
+{
 	dat._bs.pop_back();
+	for (Expression* expr : {_init, _cond, _inc})
+		if (expr != nullptr) _hasCall = _hasCall || expr->_hasCall;
 	_hasReturn = _body->_hasReturn;
-	_hasCall = _init->_hasCall || _cond->_hasCall
-		|| _body->_hasCall || _inc->_hasCall;
-	return success;
+	_hasCall = _hasCall || _body->_hasCall;
 }
 
 
@@ -94,23 +125,23 @@ void LoopExpr::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void LoopExpr::Print(std::ostream& os, std::string_view indent, int depth)
+void LoopExpr::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
-	os << "LoopExpression("sv;
-	_type->Print(os, indent, depth);
-	os << "):\n";
-	++ depth;
-	PrintIndent(os, indent, depth);
-	os << "Initialize =\n"sv;
-	_init->Print(os, indent, depth + 1);
-	PrintIndent(os, indent, depth);
-	os << "Condition =\n"sv;
-	_cond->Print(os, indent, depth + 1);
-	PrintIndent(os, indent, depth);
-	os << "Increment =\n"sv;
-	_inc->Print(os, indent, depth + 1);
-	PrintIndent(os, indent, depth);
-	os << "Body =\n"sv;
-	_body->Print(os, indent, depth + 1);
+	os << "LoopExpression(Type = "sv << Type::NameOf(_type) << "):\n"sv;
+}
+
+
+int LoopExpr::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	static const std::string_view labels[] {
+		"Initialize =\n"sv, "Condition =\n"sv,
+		"Increment =\n"sv, "Body =\n"sv
+	};
+	PrintIndent(os, indent, depth + 1);
+	os << labels[i];
+	PrintIfEmpty(GetChild(i), os, indent, depth + 2);
+	return depth + 2;
 }
@@ -0,0 +1,1149 @@
+#include "flat.hpp"
+
+#include "common.hpp"
+#include "globals.hpp"
+#include "traverse.hpp"
+
+#include <charconv>
+#include <ostream>
+#include <string>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+
+FlatAST::FlatAST(AST& ast)
+	: _names{&ast._names}, _types{&ast._types}
+{
+	for (SyntaxTreeNode* node : ast) _globals.push_back(Flatten(node));
+}
+
+
+FlatAST::Ref FlatAST::MakeRef(Array array, uint32_t index)
+{
+	assert(index < (1u << 30) - 1);
+	return (static_cast<uint32_t>(array) << 30) | index;
+}
+
+
+FlatAST::Array FlatAST::ArrayOf(Ref ref)
+{
+	return static_cast<Array>(ref >> 30);
+}
+
+
+uint32_t FlatAST::IndexOf(Ref ref)
+{
+	return ref & ((1u << 30) - 1);
+}
+
+
+FlatAST::Node& FlatAST::Get(Ref ref)
+{
+	switch (ArrayOf(ref))
+	{
+		case Array::Decl:	return _decls[IndexOf(ref)];
+		case Array::Stmt:	return _stmts[IndexOf(ref)];
+		default:			return _exprs[IndexOf(ref)];
+	}
+}
+
+
+const FlatAST::Node& FlatAST::Get(Ref ref) const
+{
+	return const_cast<FlatAST*>(this)->Get(ref);
+}
+
+
+size_t FlatAST::size() const
+{
+	return _globals.size();
+}
+
+
+FlatAST::Ref FlatAST::operator[](size_t i) const
+{
+	return _globals[i];
+}
+
+
+size_t FlatAST::GetBytesUsed() const
+{
+	return (_decls.size() + _stmts.size() + _exprs.size()) * sizeof(Node)
+		+ _exprTypes.size() * sizeof(uint32_t)
+		+ _idents.size() * sizeof(Ident)
+		+ (_lists.size() + _globals.size()) * sizeof(Ref);
+}
+
+
+FlatAST::Ref FlatAST::Add(const Node& node)
+{
+	std::vector<Node>* array {&_exprs};
+	Array tag {Array::Expr};
+	if (Declaration::ClassOf(node._kind))
+	{
+		array = &_decls;
+		tag = Array::Decl;
+	}
+	else if (!Expression::ClassOf(node._kind))
+	{
+		array = &_stmts;
+		tag = Array::Stmt;
+	}
+	else _exprTypes.push_back(None);
+
+	array->push_back(node);
+	return MakeRef(tag, static_cast<uint32_t>(array->size() - 1));
+}
+
+
+uint32_t FlatAST::FlattenIdent(Identifier* id)
+{
+	_idents.push_back(Ident {*id, id->_id.GetID()});
+	return static_cast<uint32_t>(_idents.size() - 1);
+}
+
+
+
+uint32_t FlatAST::AddList(const Ref* refs, size_t count)
+{
+	const uint32_t list {static_cast<uint32_t>(_lists.size())};
+	_lists.push_back(static_cast<Ref>(count));
+	_lists.insert(_lists.end(), refs, refs + count);
+	return list;
+}
+
+
+// Visitor copying a pointer-linked AST. A node is copied when it is left, by
+// which time its children have been.
+struct FlatAST::FlattenVisitor
+{
+	FlatAST& _flat;			// AST the copies are appended to.
+	std::vector<Ref> _done;	// Copies of the children visited so far.
+
+	bool Enter(SyntaxTreeNode* node) { return true; }
+
+	bool Before(SyntaxTreeNode* node, size_t i)
+	{
+		// Empty slots are passed over, so their copies are recorded here.
+		if (node->GetChild(i) == nullptr) _done.push_back(None);
+		return true;
+	}
+
+	void After(SyntaxTreeNode* node, size_t i) {}
+
+	void Leave(SyntaxTreeNode* node)
+	{
+		const size_t count {node->GetChildCount()};
+		const size_t first {_done.size() - count};
+		const Ref ref {_flat.Copy(node, _done.data() + first)};
+		_done.resize(first);
+		_done.push_back(ref);
+	}
+};
+
+
+FlatAST::Ref FlatAST::Flatten(SyntaxTreeNode* node)
+{
+	if (node == nullptr) return None;
+	FlattenVisitor visitor {*this, {}};
+	traverse(node, visitor);
+	return visitor._done.back();
+}
+
+
+FlatAST::Ref FlatAST::Copy(SyntaxTreeNode* node, const Ref* children)
+{
+	Node rec {*node, node->_kind, node->_hasReturn, node->_hasCall};
+	uint32_t* ops {rec._ops};
+	switch (node->_kind)
+	{
+	case NodeKind::Parameter:
+	{
+		Parameter* param {cast<Parameter>(node)};
+		ops[0] = FlattenIdent(param->_name);
+		ops[1] = param->_type->GetID();
+		break;
+	}
+	case NodeKind::Function:
+	{
+		// Parameters are not children, and have no children of their own.
+		Function* fn {cast<Function>(node)};
+		std::vector<Ref> params;
+		params.reserve(fn->_params.size());
+		for (Parameter* param : fn->_params)
+			params.push_back(Copy(param, nullptr));
+		ops[0] = FlattenIdent(fn->_name);
+		ops[1] = fn->_type->GetID();
+		ops[2] = AddList(params.data(), params.size());
+		ops[3] = AddList(children, fn->_body.size());
+		break;
+	}
+	case NodeKind::VariableDef:
+	{
+		VariableDef* var {cast<VariableDef>(node)};
+		ops[0] = FlattenIdent(var->_name);
+		ops[1] = var->_type->GetID();
+		ops[2] = children[0];
+		break;
+	}
+	case NodeKind::BreakStmt:
+	{
+		// The count is not a child, and has no children of its own.
+		BreakStmt* stmt {cast<BreakStmt>(node)};
+		ops[0] = children[0];
+		if (stmt->_count != nullptr) ops[1] = Copy(stmt->_count, nullptr);
+		break;
+	}
+	case NodeKind::IfStmt:
+	case NodeKind::LoopExpr:
+		for (size_t i {0}; i < node->GetChildCount(); ++ i)
+			ops[i] = children[i];
+		break;
+	case NodeKind::ReturnStmt:
+		ops[0] = children[0];
+		break;
+	case NodeKind::CompoundStmt:
+	{
+		const size_t stmts_len {cast<CompoundStmt>(node)->_stmts.size()};
+		ops[0] = AddList(children, stmts_len);
+		ops[1] = children[stmts_len];
+		break;
+	}
+	case NodeKind::BinaryExpr:
+		ops[0] = children[0];
+		ops[1] = children[1];
+		ops[2] = static_cast<uint32_t>(cast<BinaryExpr>(node)->_op);
+		break;
+	case NodeKind::UnaryExpr:
+		ops[0] = children[0];
+		ops[1] = static_cast<uint32_t>(cast<UnaryExpr>(node)->_op);
+		break;
+	case NodeKind::Invocation:
+	{
+		Invocation* expr {cast<Invocation>(node)};
+		ops[0] = FlattenIdent(expr->_name);
+		ops[1] = AddList(children, expr->_args.size());
+		break;
+	}
+	case NodeKind::AssignmentExpr:
+		ops[0] = FlattenIdent(cast<AssignmentExpr>(node)->_name);
+		ops[1] = children[0];
+		break;
+	case NodeKind::Variable:
+	case NodeKind::StrLiteral:
+		ops[0] = cast<Literal>(node)->_rawValue.GetID();
+		break;
+	case NodeKind::IntLiteral:
+		ops[0] = cast<IntLiteral>(node)->_rawValue.GetID();
+		ops[1] = static_cast<uint32_t>(cast<IntLiteral>(node)->_value);
+		break;
+	case NodeKind::BoolLiteral:
+		ops[0] = cast<BoolLiteral>(node)->_rawValue.GetID();
+		ops[1] = cast<BoolLiteral>(node)->_value;
+		break;
+	case NodeKind::Identifier:
+		// Identifiers are only reached through their owners.
+		assert(false);
+		return None;
+	}
+
+	return Add(rec);
+}
+
+
+uint32_t FlatAST::ListSize(uint32_t list) const
+{
+	return _lists[list];
+}
+
+
+const FlatAST::Ref* FlatAST::ListBegin(uint32_t list) const
+{
+	return &_lists[list + 1];
+}
+
+
+uint32_t FlatAST::ChildCount(Ref ref) const
+{
+	const Node& node {Get(ref)};
+	switch (node._kind)
+	{
+		case NodeKind::Function:		return ListSize(node._ops[3]);
+		case NodeKind::IfStmt:			return 3;
+		case NodeKind::LoopExpr:		return 4;
+		case NodeKind::CompoundStmt:	return ListSize(node._ops[0]) + 1;
+		case NodeKind::BinaryExpr:		return 2;
+		case NodeKind::Invocation:		return ListSize(node._ops[1]);
+		case NodeKind::VariableDef:
+		case NodeKind::BreakStmt:
+		case NodeKind::ReturnStmt:
+		case NodeKind::UnaryExpr:
+		case NodeKind::AssignmentExpr:	return 1;
+		default:						return 0;
+	}
+}
+
+
+FlatAST::Ref FlatAST::Child(Ref ref, uint32_t i) const
+{
+	const uint32_t* ops {Get(ref)._ops};
+	switch (Get(ref)._kind)
+	{
+		case NodeKind::Function:		return ListBegin(ops[3])[i];
+		case NodeKind::VariableDef:		return ops[2];
+		case NodeKind::AssignmentExpr:	return ops[1];
+		case NodeKind::Invocation:		return ListBegin(ops[1])[i];
+		case NodeKind::CompoundStmt:
+			return i < ListSize(ops[0]) ? ListBegin(ops[0])[i] : ops[1];
+		// The remaining kinds hold their children in their first operands.
+		default:						return ops[i];
+	}
+}
+
+
+template <typename Visitor>
+void FlatAST::Traverse(Ref root, Visitor& visitor) const
+{
+	// A node whose children are being visited.
+	struct Frame
+	{
+		Ref _ref;			// The node.
+		uint32_t _next;		// Slot of the next child to be visited.
+		uint32_t _count;	// Number of child slots.
+	};
+
+	std::vector<Frame> path;
+	Ref next {root};
+	for (;;)
+	{
+		if (next != None && visitor.Enter(next))
+		{
+			path.push_back(Frame {next, 0, ChildCount(next)});
+			next = None;
+		}
+		else if (next == None && path.back()._next < path.back()._count)
+		{
+			Frame& top {path.back()};
+			const uint32_t i {top._next ++};
+			if (visitor.Before(top._ref, i)) next = Child(top._ref, i);
+			continue;
+		}
+		else
+		{
+			// Leave the node entered without children, or the innermost one.
+			Ref ref {next};
+			if (ref == None)
+			{
+				ref = path.back()._ref;
+				path.pop_back();
+			}
+			next = None;
+			visitor.Leave(ref);
+			if (path.empty()) return;
+			visitor.After(path.back()._ref, path.back()._next - 1);
+		}
+	}
+}
+
+
+Type* FlatAST::TypeOf(Ref ref) const
+{
+	const uint32_t id {_exprTypes[IndexOf(ref)]};
+	return id == None ? nullptr : (*_types)[id];
+}
+
+
+void FlatAST::SetType(Ref ref, const Type* type)
+{
+	_exprTypes[IndexOf(ref)] = type->GetID();
+}
+
+
+Name FlatAST::NameOf(uint32_t ident) const
+{
+	return _names->Get(_idents[ident]._name);
+}
+
+
+bool FlatAST::Define(
+	Ref ref, BasicSymbolTable<Node>& symbols, ScopeData& dat)
+{
+	Node& node {Get(ref)};
+	const Ident& name {_idents[node._ops[0]]};
+	Node* pre {symbols.Define(NameOf(node._ops[0]), &node)};
+	if (pre != nullptr)
+	{
+		const Ident& pre_name {_idents[pre->_ops[0]]};
+		dat._diag.Error(DiagID::SymbolCollision, name._loc,
+			{NameOf(node._ops[0]).View()});
+		dat._diag.Note(DiagID::CollisionPrevious, pre_name._loc,
+			{std::to_string(dat._src->Locate(pre_name._loc)._row)});
+		return false;
+	}
+	return true;
+}
+
+
+// Visitor performing scope resolution, as ScopeVisitor does.
+struct FlatAST::ScopeVisitor
+{
+	FlatAST& _flat;						// AST being resolved.
+	BasicSymbolTable<Node>& _symbols;	// Symbol table to be used.
+	ScopeData& _dat;					// Scope resolution data of the AST.
+	bool _success {true};				// Indicates no errors were discovered.
+
+	bool Enter(Ref ref)
+	{
+		_success = _flat.ScopeEnter(ref, _symbols, _dat) && _success;
+		return true;
+	}
+
+	bool Before(Ref ref, uint32_t i) { return true; }
+	void After(Ref ref, uint32_t i) {}
+
+	void Leave(Ref ref)
+	{
+		_success = _flat.ScopeLeave(ref, _symbols, _dat) && _success;
+	}
+};
+
+
+bool FlatAST::Scope(TU& tu, DiagnosticEngine& diag)
+{
+	ScopeData dat {&tu, diag};
+	BasicSymbolTable<Node> symbols;
+	symbols.Enter();
+	ScopeVisitor visitor {*this, symbols, dat};
+	for (Ref ref : _globals) Traverse(ref, visitor);
+	return visitor._success;
+}
+
+
+bool FlatAST::ScopeEnter(
+	Ref ref, BasicSymbolTable<Node>& symbols, ScopeData& dat)
+{
+	Node& node {Get(ref)};
+	uint32_t* ops {node._ops};
+	// Converts a bound declaration back to a reference.
+	auto decl_ref = [this](Node* decl)
+	{
+		return MakeRef(
+			Array::Decl, static_cast<uint32_t>(decl - _decls.data()));
+	};
+
+	switch (node._kind)
+	{
+	case NodeKind::Parameter:
+		return Define(ref, symbols, dat);
+	case NodeKind::Function:
+	{
+		bool success {Define(ref, symbols, dat)};
+		symbols.Enter();
+		const Ref* params {ListBegin(ops[2])};
+		for (uint32_t i {0}; i < ListSize(ops[2]); ++ i)
+			success = Define(params[i], symbols, dat) && success;
+		return success;
+	}
+	case NodeKind::CompoundStmt:
+		symbols.Enter();
+		return true;
+	case NodeKind::Invocation:
+	{
+		const Ident& name {_idents[ops[0]]};
+		Node* def {symbols.Lookup(NameOf(ops[0]))};
+		if (def == nullptr || def->_kind != NodeKind::Function)
+		{
+			dat._diag.ErrorAt(DiagID::UnknownFunction, node._loc, name._loc,
+				{NameOf(ops[0]).View()});
+			return false;
+		}
+		ops[2] = decl_ref(def);
+		return true;
+	}
+	case NodeKind::AssignmentExpr:
+	{
+		const Ident& name {_idents[ops[0]]};
+		Node* def {symbols.Lookup(NameOf(ops[0]))};
+		if (def == nullptr || def->_kind != NodeKind::VariableDef)
+		{
+			dat._diag.Error(DiagID::UnknownVariable, name._loc,
+				{NameOf(ops[0]).View()});
+			return false;
+		}
+		ops[2] = decl_ref(def);
+		return true;
+	}
+	case NodeKind::Variable:
+	{
+		const Name name {_names->Get(ops[0])};
+		Node* def {symbols.Lookup(name)};
+		if (def == nullptr)
+		{
+			dat._diag.Error(DiagID::UnknownSymbol, node._loc, {name.View()});
+			return false;
+		}
+		else if (def->_kind == NodeKind::Function)
+		{
+			dat._diag.Error(
+				DiagID::MisusedFunction, node._loc, {name.View()});
+			return false;
+		}
+		ops[1] = decl_ref(def);
+		return true;
+	}
+	default:
+		return true;
+	}
+}
+
+
+bool FlatAST::ScopeLeave(
+	Ref ref, BasicSymbolTable<Node>& symbols, ScopeData& dat)
+{
+	switch (Get(ref)._kind)
+	{
+	case NodeKind::Function:
+	case NodeKind::CompoundStmt:
+		symbols.Exit();
+		return true;
+	case NodeKind::VariableDef:
+		// The variable is not in scope within its own initializer.
+		return Define(ref, symbols, dat);
+	default:
+		return true;
+	}
+}
+
+
+// Visitor performing validation, as ValidateVisitor does.
+struct FlatAST::ValidateVisitor
+{
+	// Validation state of a node whose children are being visited.
+	struct Frame
+	{
+		bool _entered;	// Indicates the node passed ValidateEnter().
+		bool _success;	// Indicates no errors were discovered so far.
+	};
+
+	FlatAST& _flat;				// AST being validated.
+	ValidateState& _dat;		// State of the validation.
+	std::vector<Frame> _path;	// State of each node being visited.
+	bool _last {true};			// Success of the node last left.
+
+	bool Enter(Ref ref)
+	{
+		const bool entered {_flat.ValidateEnter(ref, _dat)};
+		_path.push_back(Frame {entered, entered});
+		return entered;
+	}
+
+	bool Before(Ref ref, uint32_t i)
+	{
+		return _flat.ValidateBeforeChild(ref, _dat, i, _path.back()._success);
+	}
+
+	void After(Ref ref, uint32_t i)
+	{
+		bool& success {_path.back()._success};
+		success = _last && success;
+		_flat.ValidateAfterChild(ref, _dat, i, success);
+	}
+
+	void Leave(Ref ref)
+	{
+		Frame& top {_path.back()};
+		if (top._entered) _flat.ValidateLeave(ref, _dat, top._success);
+		_last = top._success;
+		_path.pop_back();
+	}
+};
+
+
+bool FlatAST::Validate(TU& tu, DiagnosticEngine& diag)
+{
+	ValidateState dat {&tu, diag};
+	bool success {true};
+	for (Ref ref : _globals)
+	{
+		ValidateVisitor visitor {*this, dat};
+		Traverse(ref, visitor);
+		success = visitor._last && success;
+	}
+	return success;
+}
+
+
+bool FlatAST::CheckReturn(
+	uint32_t list, ValidateState& dat, bool& success, bool* has_call)
+{
+	const uint32_t stmts_len {ListSize(list)};
+	const Ref* stmts {ListBegin(list)};
+	uint32_t returns_at {stmts_len};
+	bool makes_call {false};
+	for (uint32_t i {0}; i < stmts_len; ++ i)
+	{
+		const Node& cur {Get(stmts[i])};
+		makes_call = makes_call || cur._hasCall;
+		if (cur._hasReturn && returns_at == stmts_len) returns_at = i;
+	}
+	if (has_call != nullptr) *has_call = makes_call;
+
+	if (returns_at == stmts_len) return false;
+	if (returns_at != stmts_len - 1)
+	{
+		const SourceLocation& next {Get(stmts[returns_at + 1])._loc};
+		dat._diag.Error(DiagID::UnreachableCode, next);
+		success = false;
+	}
+	return true;
+}
+
+
+bool FlatAST::ValidateEnter(Ref ref, ValidateState& dat)
+{
+	Node& node {Get(ref)};
+	uint32_t* ops {node._ops};
+
+	switch (node._kind)
+	{
+	case NodeKind::Function:
+		dat._curFunc = ref;
+		return true;
+	case NodeKind::BreakStmt:
+	{
+		if (ops[1] != None && !ValidateEnter(ops[1], dat)) return false;
+		const size_t count {ops[1] == None ? 1 : Get(ops[1])._ops[1]};
+		if (count == 0 || dat._bs.size() < count)
+		{
+			dat._diag.Error(DiagID::BreakDepth, node._loc,
+				{std::to_string(count)});
+			return false;
+		}
+		ops[2] = dat._bs[dat._bs.size() - count];
+		return true;
+	}
+	case NodeKind::ReturnStmt:
+	{
+		if (dat._curFunc == None)
+		{
+			dat._diag.Error(DiagID::ReturnOutsideFunction, node._loc);
+			return false;
+		}
+		ops[1] = dat._curFunc;
+
+		const Type* expected {(*_types)[Get(dat._curFunc)._ops[1]]};
+		if (ops[0] == None && !expected->IsVoid())
+		{
+			dat._diag.Error(DiagID::MissingReturnValue, node._loc,
+				{expected->_name});
+			return false;
+		}
+		return true;
+	}
+	case NodeKind::LoopExpr:
+		// Void until a break statement in the body supplies a value.
+		SetType(ref, _types->Void());
+		dat._bs.push_back(ref);
+		return true;
+	case NodeKind::Invocation:
+	{
+		const Node& def {Get(ops[2])};
+		SetType(ref, (*_types)[def._ops[1]]);
+		const uint32_t expected_args {ListSize(def._ops[2])};
+		const uint32_t given_args {ListSize(ops[1])};
+		if (given_args != expected_args)
+		{
+			dat._diag.Error(DiagID::ArgumentCount, node._loc,
+				{NameOf(ops[0]).View(), std::to_string(expected_args),
+				std::to_string(given_args)});
+			return false;
+		}
+		return true;
+	}
+	case NodeKind::Variable:
+		SetType(ref, (*_types)[Get(ops[1])._ops[1]]);
+		return true;
+	case NodeKind::IntLiteral:
+	{
+		SetType(ref, _types->Int());
+		const std::string_view raw {_names->Get(ops[0]).View()};
+		int32_t value {0};
+		const std::from_chars_result res
+			{std::from_chars(raw.data(), raw.data() + raw.size(), value)};
+		ops[1] = static_cast<uint32_t>(value);
+		if (res.ec == std::errc::result_out_of_range)
+		{
+			dat._diag.Error(DiagID::IntOutOfRange, node._loc, {raw});
+			return false;
+		}
+		return true;
+	}
+	case NodeKind::BoolLiteral:
+		SetType(ref, _types->Bool());
+		ops[1] = _names->Get(ops[0]).View() == "true"sv;
+		return true;
+	case NodeKind::StrLiteral:
+		SetType(ref, _types->String());
+		return true;
+	default:
+		return true;
+	}
+}
+
+
+bool FlatAST::ValidateBeforeChild(
+	Ref ref, ValidateState& dat, uint32_t i, bool& success)
+{
+	Node& node {Get(ref)};
+	switch (node._kind)
+	{
+	case NodeKind::CompoundStmt:
+		if (i == ListSize(node._ops[0]))
+		{
+			node._hasReturn
+				= CheckReturn(node._ops[0], dat, success, &node._hasCall);
+			SetType(ref, _types->Void());
+		}
+		return true;
+	case NodeKind::Invocation:
+		// Arguments after the first invalid one are not validated.
+		return success;
+	default:
+		return true;
+	}
+}
+
+
+void FlatAST::ValidateAfterChild(
+	Ref ref, ValidateState& dat, uint32_t i, bool& success)
+{
+	Node& node {Get(ref)};
+	if (node._kind != NodeKind::Invocation) return;
+
+	const uint32_t* ops {node._ops};
+	const Ref arg {ListBegin(ops[1])[i]};
+	const Ref param {ListBegin(Get(ops[2])._ops[2])[i]};
+	const Type* expected_type {(*_types)[Get(param)._ops[1]]};
+	const Type* given_type {TypeOf(arg)};
+	if (given_type != expected_type)
+	{
+		dat._diag.Error(DiagID::ArgumentType, node._loc,
+			{expected_type->_name, std::to_string(i + 1),
+			NameOf(ops[0]).View(), Type::NameOf(given_type)});
+		success = false;
+	}
+	node._hasCall = node._hasCall || Get(arg)._hasCall;
+}
+
+
+/**
+ * Reports the error associated with incorrectly typed operand expressions
+ * for binary operators, as BinaryExpr does.
+ * @param diag Engine the error is reported to.
+ * @param op The location of the operator in question.
+ * @param found The type of the incorrectly typed operand expression.
+ * @param is_left true if the operand is the left operand; false otherwise.
+ * @param expected The name of the expected type.
+ */
+static void ExpectedBinaryType(DiagnosticEngine& diag,
+	const SourceLocation& op, const Type* found, bool is_left,
+	std::string_view expected)
+{
+	diag.Error(DiagID::OperandType, op,
+		{is_left ? "left"sv : "right"sv, expected, found->_name});
+}
+
+
+void FlatAST::ValidateLeave(Ref ref, ValidateState& dat, bool& success)
+{
+	Node& node {Get(ref)};
+	uint32_t* ops {node._ops};
+
+	switch (node._kind)
+	{
+	case NodeKind::Function:
+	{
+		const bool returns
+			{CheckReturn(ops[3], dat, success, &node._hasCall)};
+		dat._curFunc = None;
+
+		if (!(*_types)[ops[1]]->IsVoid() && !returns)
+		{
+			dat._diag.Error(DiagID::MissingReturn, node._loc,
+				{NameOf(ops[0]).View()});
+			success = false;
+		}
+		break;
+	}
+	case NodeKind::VariableDef:
+	{
+		const Type* type {(*_types)[ops[1]]};
+		if (type->IsVoid())
+		{
+			dat._diag.Error(DiagID::VoidVariable, node._loc,
+				{NameOf(ops[0]).View()});
+			success = false;
+		}
+		else if (TypeOf(ops[2]) != type)
+		{
+			dat._diag.Error(DiagID::InitializerType, node._loc,
+				{type->_name, TypeOf(ops[2])->_name});
+			success = false;
+		}
+		break;
+	}
+	case NodeKind::IfStmt:
+		if (ops[2] != None)
+			node._hasReturn = Get(ops[1])._hasReturn && Get(ops[2])._hasReturn;
+		else node._hasReturn = Get(ops[1])._hasReturn;
+
+		if (!TypeOf(ops[0])->IsBool())
+		{
+			dat._diag.Error(DiagID::ConditionType, node._loc,
+				{TypeOf(ops[0])->_name});
+			success = false;
+		}
+		break;
+	case NodeKind::BreakStmt:
+	{
+		const Type* existing {TypeOf(ops[2])};
+		if (ops[0] != None)
+		{
+			if (existing->IsVoid()) SetType(ops[2], TypeOf(ops[0]));
+			else if (existing != TypeOf(ops[0]))
+			{
+				dat._diag.Error(DiagID::BreakType, node._loc,
+					{existing->_name, TypeOf(ops[0])->_name});
+				success = false;
+			}
+		}
+		else if (!existing->IsVoid())
+		{
+			dat._diag.Error(DiagID::MissingBreakValue, node._loc);
+			success = false;
+		}
+		break;
+	}
+	case NodeKind::ReturnStmt:
+	{
+		if (ops[0] == None) break;
+
+		const Type* expected {(*_types)[Get(ops[1])._ops[1]]};
+		if (expected->IsVoid())
+		{
+			dat._diag.Error(DiagID::UnexpectedReturnValue, node._loc);
+			success = false;
+		}
+		else if (TypeOf(ops[0]) != expected)
+		{
+			dat._diag.Error(DiagID::ReturnType, node._loc,
+				{expected->_name, TypeOf(ops[0])->_name});
+			success = false;
+		}
+		break;
+	}
+	case NodeKind::LoopExpr:
+		dat._bs.pop_back();
+		for (uint32_t i {0}; i < 3; ++ i)
+		{
+			if (ops[i] != None)
+				node._hasCall = node._hasCall || Get(ops[i])._hasCall;
+		}
+		node._hasReturn = Get(ops[3])._hasReturn;
+		node._hasCall = node._hasCall || Get(ops[3])._hasCall;
+		break;
+	case NodeKind::CompoundStmt:
+		if (ops[1] == None) break;
+
+		SetType(ref, TypeOf(ops[1]));
+		node._hasCall = node._hasCall || Get(ops[1])._hasCall;
+		if (node._hasReturn)
+		{
+			const SourceLocation& expr {Get(ops[1])._loc};
+			dat._diag.ErrorAt(DiagID::UnevaluatedExpression, expr, node._loc);
+			success = false;
+		}
+		break;
+	case NodeKind::BinaryExpr:
+	{
+		using Ops = BinaryExpr::Ops;
+		const Type* argl {TypeOf(ops[0])};
+		const Type* argr {TypeOf(ops[1])};
+		switch (static_cast<Ops>(ops[2]))
+		{
+			// Operands must both be Booleans.
+			case Ops::LAND:	case Ops::LOR:
+				if (!argl->IsBool())
+				{
+					ExpectedBinaryType(
+						dat._diag, node._loc, argl, true, "bool"sv);
+					success = false;
+				}
+				if (!argr->IsBool())
+				{
+					ExpectedBinaryType(
+						dat._diag, node._loc, argr, false, "bool"sv);
+					success = false;
+				}
+				SetType(ref, argl);
+				break;
+
+			// Operands must be the same type.
+			case Ops::Eq:		case Ops::NE:		case Ops::GT:
+			case Ops::LT:		case Ops::LE:		case Ops::GE:
+				if (argl != argr)
+				{
+					dat._diag.Error(DiagID::MismatchedOperands, node._loc,
+						{argl->_name, argr->_name});
+					success = false;
+				}
+				SetType(ref, _types->Bool());
+				break;
+
+			// Operands must both be integers.
+			default:
+				if (!argl->IsInt())
+				{
+					ExpectedBinaryType(
+						dat._diag, node._loc, argl, true, "int"sv);
+					success = false;
+				}
+				if (!argr->IsInt())
+				{
+					ExpectedBinaryType(
+						dat._diag, node._loc, argr, false, "int"sv);
+					success = false;
+				}
+				SetType(ref, argl);
+				break;
+		}
+		node._hasCall = Get(ops[0])._hasCall || Get(ops[1])._hasCall;
+		break;
+	}
+	case NodeKind::UnaryExpr:
+	{
+		const Type* arg {TypeOf(ops[0])};
+		if (!arg->IsInt())
+		{
+			dat._diag.Error(
+				DiagID::UnaryOperandType, node._loc, {arg->_name});
+			success = false;
+		}
+		SetType(ref, arg);
+		node._hasCall = Get(ops[0])._hasCall;
+		break;
+	}
+	case NodeKind::AssignmentExpr:
+	{
+		const Type* type {(*_types)[Get(ops[2])._ops[1]]};
+		SetType(ref, type);
+		if (type != TypeOf(ops[1]))
+		{
+			dat._diag.Error(DiagID::AssignmentType, node._loc,
+				{type->_name, TypeOf(ops[1])->_name});
+			success = false;
+		}
+		node._hasCall = Get(ops[1])._hasCall;
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+
+// Visitor printing the AST, as PrintVisitor does.
+struct FlatAST::PrintVisitor
+{
+	const FlatAST& _flat;		// AST being printed.
+	std::ostream& _os;			// The output stream to print to.
+	std::string_view _indent;	// Unit of indentation.
+	std::vector<int> _depths;	// Depth of each node being visited.
+	int _next;					// Depth of the next node.
+
+	bool Enter(Ref ref)
+	{
+		_flat.PrintEnter(ref, _os, _indent, _next);
+		_depths.push_back(_next);
+		return true;
+	}
+
+	bool Before(Ref ref, uint32_t i)
+	{
+		_next = _flat.PrintBeforeChild(ref, _os, _indent, _depths.back(), i);
+		return true;
+	}
+
+	void After(Ref ref, uint32_t i) {}
+
+	void Leave(Ref ref)
+	{
+		_depths.pop_back();
+	}
+};
+
+
+void FlatAST::Print(std::ostream& os, std::string_view indent) const
+{
+	for (Ref ref : _globals)
+	{
+		PrintVisitor visitor {*this, os, indent, {}, 0};
+		Traverse(ref, visitor);
+	}
+}
+
+
+void FlatAST::PrintEnter(
+	Ref ref, std::ostream& os, std::string_view indent, int depth) const
+{
+	SyntaxTreeNode::PrintIndent(os, indent, depth);
+	const Node& node {Get(ref)};
+	const uint32_t* ops {node._ops};
+	switch (node._kind)
+	{
+	case NodeKind::Parameter:
+		os << "Parameter(ID = "sv << NameOf(ops[0])
+			<< ", Type = "sv << (*_types)[ops[1]]->_name << ")\n"sv;
+		break;
+	case NodeKind::Function:
+	{
+		os << "Function(ID = "sv << NameOf(ops[0])
+			<< ", Type = "sv << (*_types)[ops[1]]->_name << "):\n"sv;
+		const Ref* params {ListBegin(ops[2])};
+		for (uint32_t i {0}; i < ListSize(ops[2]); ++ i)
+		{
+			const Node& param {Get(params[i])};
+			SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+			os << "Parameters["sv << i << "](ID = "sv
+				<< NameOf(param._ops[0]) << ", Type = "sv
+				<< (*_types)[param._ops[1]]->_name << ")\n"sv;
+		}
+		break;
+	}
+	case NodeKind::VariableDef:
+		os << "VariableInitialization(ID = "sv << NameOf(ops[0])
+			<< ", Type = "sv << (*_types)[ops[1]]->_name << "):\n"sv;
+		break;
+	case NodeKind::IfStmt:
+		os << "IfExpression:\n"sv;
+		break;
+	case NodeKind::BreakStmt:
+		os << "BreakStatement(Levels = "sv
+			<< (ops[1] == None ? 0 : static_cast<int32_t>(Get(ops[1])._ops[1]))
+			<< "):\n"sv;
+		break;
+	case NodeKind::ReturnStmt:
+		os << "ReturnStatement:\n"sv;
+		break;
+	case NodeKind::LoopExpr:
+		os << "LoopExpression(Type = "sv << Type::NameOf(TypeOf(ref))
+			<< "):\n"sv;
+		break;
+	case NodeKind::CompoundStmt:
+		os << "CompoundStatement:\n"sv;
+		break;
+	case NodeKind::BinaryExpr:
+		os << "BinaryExpression(Op = "sv
+			<< BinaryExpr::GetOpText(static_cast<BinaryExpr::Ops>(ops[2]))
+			<< ", Type = "sv << Type::NameOf(TypeOf(ref)) << "):\n"sv;
+		break;
+	case NodeKind::UnaryExpr:
+		os << "UnaryExpr(Op = "sv
+			<< UnaryExpr::GetOpText(static_cast<UnaryExpr::Ops>(ops[1]))
+			<< ", Type = "sv << Type::NameOf(TypeOf(ref)) << "):\n"sv;
+		break;
+	case NodeKind::Invocation:
+		os << "InvokeExpression(Function = "sv << NameOf(ops[0])
+			<< ", Type = "sv << Type::NameOf(TypeOf(ref)) << "):\n"sv;
+		break;
+	case NodeKind::AssignmentExpr:
+		os << "AssignmentExpression(ID) = "sv << NameOf(ops[0]) << "):\n"sv;
+		break;
+	case NodeKind::Variable:
+		os << "Variable = "sv << _names->Get(ops[0]) << '\n';
+		break;
+	case NodeKind::IntLiteral:
+		os << "IntLiteral = "sv << _names->Get(ops[0]) << '\n';
+		break;
+	case NodeKind::BoolLiteral:
+		os << "BoolLiteral = "sv << _names->Get(ops[0]) << '\n';
+		break;
+	case NodeKind::StrLiteral:
+		os << "StrLiteral = "sv << _names->Get(ops[0]) << '\n';
+		break;
+	case NodeKind::Identifier:
+		break;
+	}
+}
+
+
+/**
+ * Prints an omitted child as SyntaxTreeNode::PrintIfEmpty() does.
+ * @param ref Reference to the child.
+ * @param os The output stream to print to.
+ * @param indent A view of the unit of indentation to be used.
+ * @param depth The depth of the child in the tree.
+ */
+static void PrintIfNone(FlatAST::Ref ref, std::ostream& os,
+	std::string_view indent, int depth)
+{
+	if (ref == FlatAST::None)
+		SyntaxTreeNode::PrintIfEmpty(nullptr, os, indent, depth);
+}
+
+
+int FlatAST::PrintBeforeChild(Ref ref, std::ostream& os,
+	std::string_view indent, int depth, uint32_t i) const
+{
+	static constexpr std::string_view if_labels[]
+		{"Condition =\n"sv, "Body =\n"sv, "Else =\n"sv};
+	static constexpr std::string_view loop_labels[] {
+		"Initialize =\n"sv, "Condition =\n"sv,
+		"Increment =\n"sv, "Body =\n"sv
+	};
+
+	const Node& node {Get(ref)};
+	switch (node._kind)
+	{
+	case NodeKind::IfStmt:
+	case NodeKind::LoopExpr:
+		SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+		os << (node._kind == NodeKind::IfStmt ? if_labels : loop_labels)[i];
+		PrintIfNone(Child(ref, i), os, indent, depth + 2);
+		return depth + 2;
+	case NodeKind::BreakStmt:
+	case NodeKind::ReturnStmt:
+		PrintIfNone(Child(ref, i), os, indent, depth + 1);
+		return depth + 1;
+	case NodeKind::CompoundStmt:
+		if (i == ListSize(node._ops[0]))
+		{
+			PrintIfNone(Child(ref, i), os, indent, depth + 1);
+			return depth + 1;
+		}
+		SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+		os << "Statement["sv << i << "] ->\n"sv;
+		return depth + 2;
+	case NodeKind::BinaryExpr:
+		SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+		os << (i == 0 ? "Left Operand =\n"sv : "Right Operand =\n"sv);
+		return depth + 2;
+	case NodeKind::UnaryExpr:
+		SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+		os << "Operand =\n"sv;
+		return depth + 2;
+	case NodeKind::Invocation:
+		SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+		os << "Arg["sv << i << "] =\n"sv;
+		return depth + 2;
+	case NodeKind::AssignmentExpr:
+		SyntaxTreeNode::PrintIndent(os, indent, depth + 1);
+		os << "Expression =\n"sv;
+		PrintIfNone(Child(ref, i), os, indent, depth + 2);
+		return depth + 2;
+	default:
+		// Print children unlabelled, one level deeper.
+		return depth + 1;
+	}
+}
@@ -0,0 +1,394 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+
+// Stores an AST as typed contiguous arrays of fixed-size records linked by
+// 32-bit references instead of pointers. Declarations, statements and
+// expressions each have their own array, child lists are contiguous runs of
+// references in a shared pool, and spellings and types are referred to by their
+// dense IDs. The representation holds no pointers into itself, so it can be
+// moved or written out as is, and passes scan a node's children linearly.
+//
+// A flat AST is built from a pointer-linked AST, which must outlive it as it
+// owns the name and type tables. Scope(), Validate() and Print() behave as
+// their counterparts on the pointer-linked nodes do, and report the same
+// diagnostics.
+//
+// Write() stores the records, with the spellings and type names they refer
+// to, in a binary AST file, and Load() rebuilds a pointer-linked AST from one.
+// The file is a header of 32-bit counts followed by sections of 32-bit words:
+// the end offset of each spelling in the spelling bytes, the spelling bytes
+// (padded to a word), the spelling ID of each type's name, the declaration,
+// statement and expression records, the identifier records, the child lists
+// and the top-level references. Words are in the writer's byte order, which
+// the header's magic number identifies.
+class FlatAST
+{
+public:
+	// Refers to a node. The top two bits select the array holding the node and
+	// the remaining bits index that array.
+	using Ref = uint32_t;
+
+	// Arrays that hold nodes.
+	enum class Array : uint32_t { Decl, Stmt, Expr };
+
+	// Refers to no node, as for an omitted optional child.
+	static constexpr Ref None {UINT32_MAX};
+
+	// Fixed-size record of a node. The meaning of each operand depends on the
+	// node's kind, where "ident" indexes _idents, "list" indexes _lists, and
+	// "name" and "type" are IDs in the AST's name and type tables:
+	//   Parameter:      ident, type
+	//   Function:       ident, type, parameter list, body list
+	//   VariableDef:    ident, type, initializer
+	//   IfStmt:         condition, body, else
+	//   BreakStmt:      expression, count, targetted loop
+	//   ReturnStmt:     expression, enclosing function
+	//   LoopExpr:       initializer, condition, increment, body
+	//   CompoundStmt:   statement list, expression
+	//   BinaryExpr:     left operand, right operand, operator
+	//   UnaryExpr:      operand, operator
+	//   Invocation:     ident, argument list, invoked function
+	//   AssignmentExpr: ident, expression, assigned variable
+	//   Variable:       name, declaration
+	//   IntLiteral:     name, value
+	//   BoolLiteral:    name, value
+	//   StrLiteral:     name
+	// References to other nodes are filled in by Scope() and Validate().
+	struct Node
+	{
+		SourceLocation _loc;		// As the node's SourceLocation.
+		NodeKind _kind;				// Concrete class of the node.
+		bool _hasReturn {false};	// All control paths return.
+		bool _hasCall {false};		// This node calls a function.
+		uint32_t _ops[4] {None, None, None, None};	// Operands.
+	};
+
+	// Record of an identifier.
+	struct Ident
+	{
+		SourceLocation _loc;	// Location of the identifier.
+		uint32_t _name;			// ID of the identifier's spelling.
+	};
+
+protected:
+	NameTable* _names;				// Spellings of the source AST.
+	TypeTable* _types;				// Types of the source AST.
+	std::vector<Node> _decls;		// Parameters, functions and variables.
+	std::vector<Node> _stmts;		// Statements that are not expressions.
+	std::vector<Node> _exprs;		// Expressions.
+	std::vector<uint32_t> _exprTypes;	// Type ID of each expression.
+	std::vector<Ident> _idents;		// Identifiers.
+	// Child lists, each stored as its length followed by its elements.
+	std::vector<Ref> _lists;
+	std::vector<Ref> _globals;		// Top-level nodes in source order.
+
+	// State of a Validate() pass.
+	struct ValidateState
+	{
+		TU* _src;					// Source of the AST.
+		DiagnosticEngine& _diag;	// Engine diagnostics are reported to.
+		std::vector<Ref> _bs;		// Enclosing breakable expressions.
+		Ref _curFunc {None};		// Function being validated.
+	};
+
+	// Visitors performing the passes, defined with them.
+	struct FlattenVisitor;
+	struct ScopeVisitor;
+	struct ValidateVisitor;
+	struct PrintVisitor;
+
+	/**
+	 * Appends a node to the array appropriate to its kind.
+	 * @param node Node to be stored.
+	 * @return Reference to the stored node.
+	 */
+	Ref Add(const Node& node);
+
+	/**
+	 * Appends a copy of a pointer-linked subtree, without recursion.
+	 * @param node Root of the subtree. May be nullptr.
+	 * @return Reference to the copy, or None if node is nullptr.
+	 */
+	Ref Flatten(SyntaxTreeNode* node);
+
+	/**
+	 * Appends a copy of a pointer-linked node whose children are copied.
+	 * @param node Node to be copied.
+	 * @param children References to the copies of the node's children, one
+	 * per child slot as GetChild() numbers them, None for an empty slot.
+	 * @return Reference to the copy.
+	 */
+	Ref Copy(SyntaxTreeNode* node, const Ref* children);
+
+	/**
+	 * Appends an identifier.
+	 * @param id Identifier to be copied.
+	 * @return Index of the copy in _idents.
+	 */
+	uint32_t FlattenIdent(Identifier* id);
+
+	/**
+	 * Appends a list of references.
+	 * @param refs First element of the list.
+	 * @param count Number of elements in the list.
+	 * @return Index of the list in _lists.
+	 */
+	uint32_t AddList(const Ref* refs, size_t count);
+
+	/**
+	 * @param list Index of a list in _lists.
+	 * @return Number of elements in the list.
+	 */
+	uint32_t ListSize(uint32_t list) const;
+
+	/**
+	 * @param list Index of a list in _lists.
+	 * @return Pointer to the first element of the list.
+	 */
+	const Ref* ListBegin(uint32_t list) const;
+
+	/**
+	 * @param ref Reference to a node. Must not be None.
+	 * @return Number of child slots of the node, as its pointer-linked
+	 * counterpart's GetChildCount() returns.
+	 */
+	uint32_t ChildCount(Ref ref) const;
+
+	/**
+	 * @param ref Reference to a node. Must not be None.
+	 * @param i Index of the child slot.
+	 * @return The child in the slot, or None if the slot is empty.
+	 */
+	Ref Child(Ref ref, uint32_t i) const;
+
+	/**
+	 * Visits a subtree depth first, as traverse() visits a pointer-linked
+	 * subtree: the path from the root is kept on an explicit stack, and the
+	 * visitor's Enter(), Before(), After() and Leave() are given references.
+	 * @param root Root of the subtree. Must not be None.
+	 * @param visitor Visitor called for each node.
+	 */
+	template <typename Visitor>
+	void Traverse(Ref root, Visitor& visitor) const;
+
+	/**
+	 * @param ref Reference to an expression.
+	 * @return The expression's type, or nullptr if it has not been validated.
+	 */
+	Type* TypeOf(Ref ref) const;
+
+	/**
+	 * Sets the type of an expression.
+	 * @param ref Reference to an expression.
+	 * @param type Type to be assigned.
+	 */
+	void SetType(Ref ref, const Type* type);
+
+	/**
+	 * @param ident Index of an identifier.
+	 * @return The identifier's spelling.
+	 */
+	Name NameOf(uint32_t ident) const;
+
+	/**
+	 * Defines the symbol of a declaration in the current scope, as
+	 * Declaration::Define() does.
+	 * @param ref Reference to the declaration.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if the symbol was defined; false on a collision.
+	 */
+	bool Define(Ref ref, BasicSymbolTable<Node>& symbols, ScopeData& dat);
+
+	/**
+	 * Resolves a node before its children, as ScopeEnter() does.
+	 * @param ref Reference to the node.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool ScopeEnter(Ref ref, BasicSymbolTable<Node>& symbols, ScopeData& dat);
+
+	/**
+	 * Resolves a node after its children, as ScopeLeave() does.
+	 * @param ref Reference to the node.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool ScopeLeave(Ref ref, BasicSymbolTable<Node>& symbols, ScopeData& dat);
+
+	/**
+	 * Checks how a list of validated statements returns, as
+	 * Statement::CheckReturn does.
+	 * @param list Index of the list.
+	 * @param dat State of the validation.
+	 * @param success Updated with the success of the validation.
+	 * @param has_call Set if the statements call a function. May be nullptr.
+	 * @return true if the statements return in a valid way; false otherwise.
+	 */
+	bool CheckReturn(
+		uint32_t list, ValidateState& dat, bool& success, bool* has_call);
+
+	/**
+	 * Validates a node before its children, as ValidateEnter() does.
+	 * @param ref Reference to the node.
+	 * @param dat State of the validation.
+	 * @return false to pass over the node's children and fail it; true
+	 * otherwise.
+	 */
+	bool ValidateEnter(Ref ref, ValidateState& dat);
+
+	/**
+	 * Decides whether a child is validated, as ValidateBeforeChild() does.
+	 * @param ref Reference to the node.
+	 * @param dat State of the validation.
+	 * @param i Index of the child slot.
+	 * @param success Success of the node's validation so far.
+	 * @return true if the child is to be validated; false otherwise.
+	 */
+	bool ValidateBeforeChild(
+		Ref ref, ValidateState& dat, uint32_t i, bool& success);
+
+	/**
+	 * Validates a node after one of its children, as ValidateAfterChild()
+	 * does.
+	 * @param ref Reference to the node.
+	 * @param dat State of the validation.
+	 * @param i Index of the child slot.
+	 * @param success Success of the node's validation so far.
+	 */
+	void ValidateAfterChild(
+		Ref ref, ValidateState& dat, uint32_t i, bool& success);
+
+	/**
+	 * Validates a node after its children, as ValidateLeave() does.
+	 * @param ref Reference to the node.
+	 * @param dat State of the validation.
+	 * @param success Success of the node's validation so far.
+	 */
+	void ValidateLeave(Ref ref, ValidateState& dat, bool& success);
+
+	/**
+	 * Prints a node before its children, as PrintEnter() does.
+	 * @param ref Reference to the node.
+	 * @param os The output stream to print to.
+	 * @param indent A view of the unit of indentation to be used.
+	 * @param depth The depth of the node in the tree.
+	 */
+	void PrintEnter(
+		Ref ref, std::ostream& os, std::string_view indent, int depth) const;
+
+	/**
+	 * Prints what precedes a child, as PrintBeforeChild() does.
+	 * @param ref Reference to the node.
+	 * @param os The output stream to print to.
+	 * @param indent A view of the unit of indentation to be used.
+	 * @param depth The depth of the node in the tree.
+	 * @param i Index of the child slot.
+	 * @return The depth the child is printed at.
+	 */
+	int PrintBeforeChild(Ref ref, std::ostream& os, std::string_view indent,
+		int depth, uint32_t i) const;
+
+public:
+	/**
+	 * Construct a flat copy of an AST.
+	 * @param ast AST to be copied. Must outlive the copy.
+	 */
+	FlatAST(AST& ast);
+
+	/**
+	 * @param array Array holding a node.
+	 * @param index Index of the node in the array.
+	 * @return Reference to the node.
+	 */
+	static Ref MakeRef(Array array, uint32_t index);
+
+	/**
+	 * @param ref Reference to a node. Must not be None.
+	 * @return Array holding the node.
+	 */
+	static Array ArrayOf(Ref ref);
+
+	/**
+	 * @param ref Reference to a node. Must not be None.
+	 * @return Index of the node within its array.
+	 */
+	static uint32_t IndexOf(Ref ref);
+
+	/**
+	 * @param ref Reference to a node. Must not be None.
+	 * @return The node.
+	 */
+	Node& Get(Ref ref);
+	const Node& Get(Ref ref) const;
+
+	/**
+	 * @return Number of top-level nodes.
+	 */
+	size_t size() const;
+
+	/**
+	 * @param i Index of a top-level node.
+	 * @return Reference to the node.
+	 */
+	Ref operator[](size_t i) const;
+
+	/**
+	 * @return Bytes occupied by the node records, identifiers and lists.
+	 */
+	size_t GetBytesUsed() const;
+
+	/**
+	 * Performs scope resolution over the whole AST, binding variables,
+	 * assignments and invocations to their declarations.
+	 * @param tu Translation unit corresponding to the AST.
+	 * @param diag Engine diagnostics are reported to.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool Scope(TU& tu, DiagnosticEngine& diag);
+
+	/**
+	 * Validates the semantics of every top-level node. Scope() must have
+	 * succeeded first.
+	 * @param tu Translation unit corresponding to the AST.
+	 * @param diag Engine diagnostics are reported to.
+	 * @return true if the validation discovered no errors; false otherwise.
+	 */
+	bool Validate(TU& tu, DiagnosticEngine& diag);
+
+	/**
+	 * Writes the AST as a binary AST file. References filled in by Scope()
+	 * and Validate() are written as they are, and ignored by Load().
+	 * @param os Stream to write to, opened in binary mode.
+	 */
+	void Write(std::ostream& os) const;
+
+	/**
+	 * Rebuilds the pointer-linked AST held by a binary AST file. The records
+	 * are read where they lie in the file's buffer, which is mapped into
+	 * memory where the platform allows it, rather than parsed. Every
+	 * reference is checked, so a malformed file is rejected rather than
+	 * trusted.
+	 * @param file TU holding the binary AST file.
+	 * @param ast AST the top-level nodes are appended to. The file's
+	 * spellings and types are interned in its tables.
+	 * @throws std::runtime_error If the file is not a well-formed binary AST
+	 * file written on a platform of the same byte order.
+	 */
+	static void Load(const TU& file, AST& ast);
+
+	/**
+	 * Prints every top-level node as the pointer-linked AST would.
+	 * @param os The output stream to print to.
+	 * @param indent A view of the unit of indentation to be used.
+	 */
+	void Print(std::ostream& os, std::string_view indent) const;
+};
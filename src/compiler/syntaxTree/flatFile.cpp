@@ -0,0 +1,556 @@
+#include "flat.hpp"
+
+#include "common.hpp"
+#include "globals.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// Identifies a binary AST file and the byte order of its words.
+static const uint32_t fileMagic {0x5453414C};	// "LAST" in little endian.
+// Version of the binary AST format.
+static const uint32_t fileVersion {1};
+
+
+// Header of a binary AST file.
+struct FileHeader
+{
+	uint32_t _magic;		// fileMagic.
+	uint32_t _version;		// fileVersion.
+	uint32_t _names;		// Number of spellings.
+	uint32_t _nameBytes;	// Total length of the spellings.
+	uint32_t _types;		// Number of types.
+	uint32_t _decls;		// Number of declaration records.
+	uint32_t _stmts;		// Number of statement records.
+	uint32_t _exprs;		// Number of expression records.
+	uint32_t _idents;		// Number of identifier records.
+	uint32_t _lists;		// Words in the child lists.
+	uint32_t _globals;		// Number of top-level references.
+	uint32_t _reserved;		// Zero.
+};
+
+
+// Node record as stored in a binary AST file, free of padding.
+struct FileNode
+{
+	uint32_t _file;			// Location of the node.
+	uint32_t _off;
+	uint32_t _len;
+	uint8_t _kind;			// Concrete class of the node.
+	uint8_t _hasReturn;		// All control paths return.
+	uint8_t _hasCall;		// This node calls a function.
+	uint8_t _reserved;		// Zero.
+	uint32_t _ops[4];		// Operands, as in FlatAST::Node.
+};
+
+
+// Identifier record as stored in a binary AST file.
+struct FileIdent
+{
+	uint32_t _file;			// Location of the identifier.
+	uint32_t _off;
+	uint32_t _len;
+	uint32_t _name;			// ID of the identifier's spelling.
+};
+
+static_assert(sizeof(FileNode) == 32 && sizeof(FileIdent) == 16,
+	"Binary AST records must not be padded.");
+
+
+/**
+ * Writes an array of words or records.
+ * @param os Stream to write to.
+ * @param items The array.
+ */
+template <typename T>
+static void writeArray(std::ostream& os, const std::vector<T>& items)
+{
+	os.write(reinterpret_cast<const char*>(items.data()),
+		static_cast<std::streamsize>(items.size() * sizeof(T)));
+}
+
+
+void FlatAST::Write(std::ostream& os) const
+{
+	std::vector<uint32_t> ends;
+	std::string chars;
+	for (size_t i {0}; i < _names->size(); ++ i)
+	{
+		chars += _names->Get(static_cast<uint32_t>(i)).View();
+		ends.push_back(static_cast<uint32_t>(chars.size()));
+	}
+	const uint32_t name_bytes {static_cast<uint32_t>(chars.size())};
+	chars.resize((chars.size() + 3) & ~size_t {3}, '\0');
+
+	std::vector<uint32_t> type_names;
+	for (size_t i {0}; i < _types->size(); ++ i)
+	{
+		const Type* type {(*_types)[static_cast<uint32_t>(i)]};
+		type_names.push_back(_names->Find(type->_name).GetID());
+	}
+
+	const FileHeader header {fileMagic, fileVersion,
+		static_cast<uint32_t>(ends.size()), name_bytes,
+		static_cast<uint32_t>(type_names.size()),
+		static_cast<uint32_t>(_decls.size()),
+		static_cast<uint32_t>(_stmts.size()),
+		static_cast<uint32_t>(_exprs.size()),
+		static_cast<uint32_t>(_idents.size()),
+		static_cast<uint32_t>(_lists.size()),
+		static_cast<uint32_t>(_globals.size()), 0};
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	writeArray(os, ends);
+	os.write(chars.data(), static_cast<std::streamsize>(chars.size()));
+	writeArray(os, type_names);
+
+	for (const std::vector<Node>* array : {&_decls, &_stmts, &_exprs})
+	{
+		std::vector<FileNode> records;
+		records.reserve(array->size());
+		for (const Node& node : *array)
+		{
+			FileNode& rec {records.emplace_back(FileNode {node._loc._file,
+				node._loc._off, node._loc._len,
+				static_cast<uint8_t>(node._kind), node._hasReturn,
+				node._hasCall, 0, {}})};
+			std::copy(node._ops, node._ops + 4, rec._ops);
+		}
+		writeArray(os, records);
+	}
+
+	std::vector<FileIdent> idents;
+	idents.reserve(_idents.size());
+	for (const Ident& ident : _idents)
+	{
+		idents.push_back(FileIdent {ident._loc._file, ident._loc._off,
+			ident._loc._len, ident._name});
+	}
+	writeArray(os, idents);
+	writeArray(os, _lists);
+	writeArray(os, _globals);
+}
+
+
+// Rebuilds the pointer-linked nodes of a binary AST file from the records
+// where they lie in the file's buffer, checking every reference.
+struct FileLoader
+{
+	using Ref = FlatAST::Ref;
+	static constexpr Ref None {FlatAST::None};
+
+	const TU& _file;						// The binary AST file.
+	AST& _ast;								// AST the nodes are created in.
+	size_t _pos {0};						// Offset of the next section.
+	std::vector<Name> _names {};			// Spellings, by ID in the file.
+	std::vector<Type*> _types {};			// Types, by ID in the file.
+	const FileNode* _records[3] {};			// Node records of each array.
+	uint32_t _counts[3] {};					// Number of records in each array.
+	const FileIdent* _idents {nullptr};		// Identifier records.
+	uint32_t _identCount {0};				// Number of identifier records.
+	const uint32_t* _lists {nullptr};		// Child lists.
+	uint32_t _listCount {0};				// Words in the child lists.
+	// Node built from each record, if any.
+	std::vector<SyntaxTreeNode*> _built[3] {};
+	// State of each record: 0 if unvisited, 1 if its children are being
+	// built, 2 if built.
+	std::vector<uint8_t> _state[3] {};
+
+	/**
+	 * Rejects the file.
+	 * @param what Description of the flaw found.
+	 */
+	[[noreturn]] void Fail(const char* what) const
+	{
+		std::string msg {"Malformed binary AST file ("};
+		msg.append(what);
+		msg.append("): ");
+		msg.append(_file.GetPath());
+		throw std::runtime_error(msg);
+	}
+
+	/**
+	 * Takes the next section of the file.
+	 * @param count Number of items in the section.
+	 * @return Pointer to the first item, in the file's buffer.
+	 */
+	template <typename T>
+	const T* Take(size_t count)
+	{
+		static_assert(alignof(T) <= 4);
+		// Sections are padded to a word, which also keeps records aligned.
+		const size_t bytes {(count * sizeof(T) + 3) & ~size_t {3}};
+		if (_file.GetSize() - _pos < bytes) Fail("truncated");
+		const T* items
+			{reinterpret_cast<const T*>(_file.GetBuf() + _pos)};
+		_pos += bytes;
+		return items;
+	}
+
+	/**
+	 * @param ref Reference to a record.
+	 * @return The record.
+	 */
+	const FileNode& Record(Ref ref) const
+	{
+		const uint32_t array {static_cast<uint32_t>(FlatAST::ArrayOf(ref))};
+		if (array > 2 || FlatAST::IndexOf(ref) >= _counts[array])
+			Fail("node out of range");
+		return _records[array][FlatAST::IndexOf(ref)];
+	}
+
+	/**
+	 * @param ref Reference to a record.
+	 * @return State of the record.
+	 */
+	uint8_t& State(Ref ref)
+	{
+		return _state[static_cast<uint32_t>(FlatAST::ArrayOf(ref))]
+			[FlatAST::IndexOf(ref)];
+	}
+
+	/**
+	 * @param list Index of a child list.
+	 * @param size Destination of the number of elements in the list.
+	 * @return Pointer to the first element of the list.
+	 */
+	const Ref* List(uint32_t list, uint32_t& size) const
+	{
+		if (list >= _listCount || _lists[list] > _listCount - list - 1)
+			Fail("list out of range");
+		size = _lists[list];
+		return _lists + list + 1;
+	}
+
+	/**
+	 * Lists the children of a record that are records themselves.
+	 * @param rec The record.
+	 * @param refs Destination of the children's references.
+	 */
+	void Children(const FileNode& rec, std::vector<Ref>& refs) const
+	{
+		refs.clear();
+		const uint32_t* ops {rec._ops};
+		auto add_list = [this, &refs](uint32_t list)
+		{
+			uint32_t size;
+			const Ref* items {List(list, size)};
+			refs.insert(refs.end(), items, items + size);
+		};
+		switch (static_cast<NodeKind>(rec._kind))
+		{
+			case NodeKind::Function:
+				add_list(ops[2]);
+				add_list(ops[3]);
+				break;
+			case NodeKind::VariableDef:
+				refs.push_back(ops[2]);
+				break;
+			case NodeKind::IfStmt:
+				refs.insert(refs.end(), ops, ops + 3);
+				break;
+			case NodeKind::LoopExpr:
+				refs.insert(refs.end(), ops, ops + 4);
+				break;
+			case NodeKind::BreakStmt:
+			case NodeKind::BinaryExpr:
+				refs.insert(refs.end(), ops, ops + 2);
+				break;
+			case NodeKind::ReturnStmt:
+			case NodeKind::UnaryExpr:
+				refs.push_back(ops[0]);
+				break;
+			case NodeKind::CompoundStmt:
+				add_list(ops[0]);
+				refs.push_back(ops[1]);
+				break;
+			case NodeKind::Invocation:
+				add_list(ops[1]);
+				break;
+			case NodeKind::AssignmentExpr:
+				refs.push_back(ops[1]);
+				break;
+			default:
+				break;
+		}
+	}
+
+	/**
+	 * @param ref Reference to a built record, or None.
+	 * @param optional Indicates the child may be omitted.
+	 * @return The node built from the record, or nullptr for an omitted
+	 * child.
+	 */
+	template <typename T>
+	T* Child(Ref ref, bool optional = false)
+	{
+		if (ref == None)
+		{
+			if (!optional) Fail("missing child");
+			return nullptr;
+		}
+		SyntaxTreeNode* node {_built[static_cast<uint32_t>(
+			FlatAST::ArrayOf(ref))][FlatAST::IndexOf(ref)]};
+		// Functions are only top-level, parameters only in a function's list.
+		if (!isa<T>(node) || isa<Function>(node)
+			|| (isa<Parameter>(node) && !std::is_same_v<T, Parameter>))
+		{
+			Fail("child of the wrong kind");
+		}
+		return cast<T>(node);
+	}
+
+	/**
+	 * @param list Index of a child list of built records.
+	 * @return The list, in the AST's arena.
+	 */
+	template <typename T>
+	ArenaList<T> ChildList(uint32_t list)
+	{
+		uint32_t size;
+		const Ref* items {List(list, size)};
+		std::vector<T*> nodes;
+		nodes.reserve(size);
+		for (uint32_t i {0}; i < size; ++ i)
+			nodes.push_back(Child<T>(items[i]));
+		return _ast.CreateList(nodes);
+	}
+
+	/**
+	 * @param index Index of an identifier record.
+	 * @return New identifier built from the record.
+	 */
+	Identifier* MakeIdent(uint32_t index)
+	{
+		if (index >= _identCount) Fail("identifier out of range");
+		const FileIdent& rec {_idents[index]};
+		Identifier* ident {_ast.Create<Identifier>(GetName(rec._name))};
+		ident->SetSymbolInfo(SourceLocation {rec._file, rec._off, rec._len});
+		return ident;
+	}
+
+	/**
+	 * @param id ID of a spelling in the file.
+	 * @return The spelling, as interned in the AST.
+	 */
+	Name GetName(uint32_t id) const
+	{
+		if (id >= _names.size()) Fail("spelling out of range");
+		return _names[id];
+	}
+
+	/**
+	 * @param id ID of a type in the file.
+	 * @return The type, as interned in the AST.
+	 */
+	Type* GetType(uint32_t id) const
+	{
+		if (id >= _types.size()) Fail("type out of range");
+		return _types[id];
+	}
+
+	/**
+	 * Builds the node of a record whose children are built.
+	 * @param rec The record.
+	 * @return The node.
+	 */
+	SyntaxTreeNode* Build(const FileNode& rec)
+	{
+		const uint32_t* ops {rec._ops};
+		SyntaxTreeNode* node {nullptr};
+		switch (static_cast<NodeKind>(rec._kind))
+		{
+			case NodeKind::Parameter:
+				node = _ast.Create<Parameter>(
+					GetType(ops[1]), MakeIdent(ops[0]));
+				break;
+			case NodeKind::Function:
+				node = _ast.Create<Function>(MakeIdent(ops[0]),
+					ChildList<Parameter>(ops[2]), GetType(ops[1]),
+					ChildList<Statement>(ops[3]));
+				break;
+			case NodeKind::VariableDef:
+				node = _ast.Create<VariableDef>(GetType(ops[1]),
+					MakeIdent(ops[0]), Child<Expression>(ops[2]));
+				break;
+			case NodeKind::IfStmt:
+				node = _ast.Create<IfStmt>(Child<Expression>(ops[0]),
+					Child<Statement>(ops[1]), Child<Statement>(ops[2], true));
+				break;
+			case NodeKind::BreakStmt:
+				node = _ast.Create<BreakStmt>(Child<Expression>(ops[0], true),
+					Child<IntLiteral>(ops[1], true));
+				break;
+			case NodeKind::ReturnStmt:
+				node = _ast.Create<ReturnStmt>(Child<Expression>(ops[0], true));
+				break;
+			case NodeKind::LoopExpr:
+				node = _ast.Create<LoopExpr>(Child<Expression>(ops[0], true),
+					Child<Expression>(ops[1], true),
+					Child<Expression>(ops[2], true), Child<Statement>(ops[3]));
+				break;
+			case NodeKind::CompoundStmt:
+				node = _ast.Create<CompoundStmt>(ChildList<Statement>(ops[0]),
+					Child<Expression>(ops[1], true));
+				break;
+			case NodeKind::BinaryExpr:
+				if (ops[2] > static_cast<uint32_t>(BinaryExpr::Ops::Mod))
+					Fail("unknown operator");
+				node = _ast.Create<BinaryExpr>(Child<Expression>(ops[0]),
+					Child<Expression>(ops[1]),
+					static_cast<BinaryExpr::Ops>(ops[2]));
+				break;
+			case NodeKind::UnaryExpr:
+				if (ops[1] > static_cast<uint32_t>(UnaryExpr::Ops::Comp))
+					Fail("unknown operator");
+				node = _ast.Create<UnaryExpr>(Child<Expression>(ops[0]),
+					static_cast<UnaryExpr::Ops>(ops[1]));
+				break;
+			case NodeKind::Invocation:
+				node = _ast.Create<Invocation>(MakeIdent(ops[0]),
+					ChildList<Expression>(ops[1]));
+				break;
+			case NodeKind::AssignmentExpr:
+				node = _ast.Create<AssignmentExpr>(MakeIdent(ops[0]),
+					Child<Expression>(ops[1]));
+				break;
+			case NodeKind::Variable:
+				node = _ast.Create<Variable>(GetName(ops[0]));
+				break;
+			case NodeKind::IntLiteral:
+			{
+				IntLiteral* lit {_ast.Create<IntLiteral>(GetName(ops[0]))};
+				lit->_value = static_cast<int32_t>(ops[1]);
+				node = lit;
+				break;
+			}
+			case NodeKind::BoolLiteral:
+			{
+				BoolLiteral* lit {_ast.Create<BoolLiteral>(GetName(ops[0]))};
+				lit->_value = ops[1] != 0;
+				node = lit;
+				break;
+			}
+			case NodeKind::StrLiteral:
+				node = _ast.Create<StrLiteral>(GetName(ops[0]));
+				break;
+			case NodeKind::Identifier:
+				Fail("identifier record");
+		}
+		node->SetSymbolInfo(SourceLocation {rec._file, rec._off, rec._len});
+		node->_hasReturn = rec._hasReturn != 0;
+		node->_hasCall = rec._hasCall != 0;
+		return node;
+	}
+
+	/**
+	 * Builds the subtree of a top-level record without recursion, building
+	 * each record once its children are.
+	 * @param root Reference to the record.
+	 * @return The subtree's root.
+	 */
+	SyntaxTreeNode* BuildTree(Ref root)
+	{
+		std::vector<std::pair<Ref, bool>> stack {{root, false}};
+		std::vector<Ref> children;
+		while (!stack.empty())
+		{
+			const auto [ref, ready] = stack.back();
+			const FileNode& rec {Record(ref)};
+			if (ready)
+			{
+				stack.pop_back();
+				_built[static_cast<uint32_t>(FlatAST::ArrayOf(ref))]
+					[FlatAST::IndexOf(ref)] = Build(rec);
+				State(ref) = 2;
+				continue;
+			}
+
+			// A record reached twice is shared or part of a cycle.
+			if (State(ref) != 0) Fail("node referred to twice");
+			State(ref) = 1;
+			stack.back().second = true;
+			Children(rec, children);
+			for (Ref child : children)
+				if (child != None) stack.emplace_back(child, false);
+		}
+		return _built[static_cast<uint32_t>(FlatAST::ArrayOf(root))]
+			[FlatAST::IndexOf(root)];
+	}
+
+	/**
+	 * Checks that each record is of a kind its array holds.
+	 * @param array Index of the array.
+	 */
+	void CheckKinds(uint32_t array) const
+	{
+		for (uint32_t i {0}; i < _counts[array]; ++ i)
+		{
+			const uint8_t kind {_records[array][i]._kind};
+			if (kind > static_cast<uint8_t>(NodeKind::StrLiteral))
+				Fail("unknown node kind");
+			const NodeKind node_kind {static_cast<NodeKind>(kind)};
+			const FlatAST::Array expected {Declaration::ClassOf(node_kind)
+				? FlatAST::Array::Decl : Expression::ClassOf(node_kind)
+				? FlatAST::Array::Expr : FlatAST::Array::Stmt};
+			if (static_cast<uint32_t>(expected) != array)
+				Fail("node in the wrong array");
+		}
+	}
+};
+
+
+void FlatAST::Load(const TU& file, AST& ast)
+{
+	FileLoader in {file, ast};
+	const FileHeader& header {*in.Take<FileHeader>(1)};
+	if (header._magic != fileMagic) in.Fail("not a binary AST");
+	if (header._version != fileVersion) in.Fail("unsupported version");
+
+	// Intern the spellings and types in the AST's tables.
+	const uint32_t* ends {in.Take<uint32_t>(header._names)};
+	const char* chars {in.Take<char>(header._nameBytes)};
+	uint32_t start {0};
+	for (uint32_t i {0}; i < header._names; ++ i)
+	{
+		if (ends[i] < start || ends[i] > header._nameBytes)
+			in.Fail("spelling out of range");
+		in._names.push_back(ast._names.Intern(
+			std::string_view(chars + start, ends[i] - start)));
+		start = ends[i];
+	}
+	const uint32_t* type_names {in.Take<uint32_t>(header._types)};
+	for (uint32_t i {0}; i < header._types; ++ i)
+		in._types.push_back(ast._types.Get(in.GetName(type_names[i])));
+
+	const uint32_t counts[3] {header._decls, header._stmts, header._exprs};
+	for (uint32_t array {0}; array < 3; ++ array)
+	{
+		in._counts[array] = counts[array];
+		in._records[array] = in.Take<FileNode>(counts[array]);
+		in._built[array].resize(counts[array]);
+		in._state[array].resize(counts[array]);
+		in.CheckKinds(array);
+	}
+	in._identCount = header._idents;
+	in._idents = in.Take<FileIdent>(header._idents);
+	in._listCount = header._lists;
+	in._lists = in.Take<uint32_t>(header._lists);
+	const uint32_t* globals {in.Take<uint32_t>(header._globals)};
+	if (in._pos != file.GetSize()) in.Fail("trailing data");
+
+	// Globals are appended once all are built, so a rejected file adds none.
+	std::vector<SyntaxTreeNode*> nodes;
+	for (uint32_t i {0}; i < header._globals; ++ i)
+	{
+		SyntaxTreeNode* node {in.BuildTree(globals[i])};
+		if (!isa<Function>(node) && !isa<VariableDef>(node))
+			in.Fail("top-level node of the wrong kind");
+		nodes.push_back(node);
+	}
+	for (SyntaxTreeNode* node : nodes) ast.emplace_back(node);
+}
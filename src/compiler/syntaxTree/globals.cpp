@@ -2,35 +2,25 @@
 
 #include "../utilities.hpp"
 
-#include <algorithm>
-#include <iostream>
+#include <ostream>
+#include <utility>
 
 using namespace std::string_view_literals;
 
 
 Parameter::Parameter(Type* type, Identifier* name)
-	: Declaration{name}, _type{type}
+	: Declaration{NodeKind::Parameter, name, type}
 {}
 
 
-bool Parameter::Scope(SymbolTable& symbols, TU& tu)
+bool Parameter::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
 {
-	Declaration* pre {symbols.Define(_name->_id, this)};
-	if (pre != nullptr)
-	{
-		std::cerr << '(' << _name->_row << ", "sv << _name->_col
-			<< "): Symbol collision: "sv << _name->_id
-			<< "\n# The following on line "sv << _name->_row << ":\n"sv;
-		tu.HighlightError(std::cerr, *_name);
-		std::cerr << "# Redefines on line "sv << pre->_name->_row << ":\n"sv;
-		tu.HighlightError(std::cerr, *pre->_name);
-		return false;
-	}
-	return true;
+	return Define(symbols, dat);
 }
 
 
-void Parameter::Print(std::ostream& os, std::string_view indent, int depth)
+void Parameter::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "Parameter(ID = "sv << _name->_id
@@ -40,46 +30,73 @@ void Parameter::Print(std::ostream& os, std::string_view indent, int depth)
 
 Function::Function(
 	Identifier* name, ParamList params, Type* type, StmtList body)
-	: Declaration{name}, _params{std::move(params)}
-		, _type{type}, _body{std::move(body)}
+	: Declaration{NodeKind::Function, name, type}
+		, _params{std::move(params)}, _body{std::move(body)}
+{}
+
+
+size_t Function::GetChildCount() const
 {
-	std::reverse(_params.begin(), _params.end());
-	std::reverse(_body.begin(), _body.end());
+	return _body.size();
 }
 
 
-bool Function::Scope(SymbolTable& symbols, TU& tu)
+SyntaxTreeNode* Function::GetChild(size_t i) const
+{
+	return _body[i];
+}
+
+
+bool Function::ScopeBody(SymbolTable& symbols, ScopeData& dat)
+{
+	bool success {ScopeParams(symbols, dat)};
+	success = ScopeChildren(symbols, dat) && success;
+	return ScopeLeave(symbols, dat) && success;
+}
+
+
+bool Function::ScopeParams(SymbolTable& symbols, ScopeData& dat)
 {
-	symbols.Enter();
 	bool success {true};
+	symbols.Enter();
 	for (size_t i {0}; i < _params.size(); ++ i)
-		success = _params[i]->Scope(symbols, tu) && success;
-	for (size_t i {0}; i < _body.size(); ++ i)
-		success = _body[i]->Scope(symbols, tu) && success;
-	symbols.Exit();
+		success = _params[i]->ScopeEnter(symbols, dat) && success;
 	return success;
 }
 
 
-bool Function::Validate(ValidateData& dat)
+bool Function::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
+{
+	const bool success {Define(symbols, dat)};
+	return ScopeParams(symbols, dat) && success;
+}
+
+
+bool Function::ScopeLeave(SymbolTable& symbols, ScopeData& dat)
+{
+	symbols.Exit();
+	return true;
+}
+
+
+bool Function::ValidateEnter(ValidateData& dat)
 {
-	bool success {true};
 	dat._curFunc = this;
-	const bool returns {Statement::ValidateAndGetReturn(
+	return true;
+}
+
+
+void Function::ValidateLeave(ValidateData& dat, bool& success)
+{
+	const bool returns {Statement::CheckReturn(
 		_body, dat, success, &_hasCall)};
 	dat._curFunc = nullptr;
 
 	if (!_type->IsVoid() && !returns)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Non-void function does not return in all control paths: \n"sv
-			<< _name->_id << '\n';
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::MissingReturn, *this, {_name->_id.View()});
 		success = false;
 	}
-
-	dat._curFunc = nullptr;
-	return success;
 }
 
 
@@ -87,7 +104,15 @@ void Function::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void Function::Print(std::ostream& os, std::string_view indent, int depth)
+void Function::ShiftEnter(int64_t delta)
+{
+	Declaration::ShiftEnter(delta);
+	for (Parameter* param : _params) param->ShiftEnter(delta);
+}
+
+
+void Function::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "Function(ID = "sv << _name->_id
@@ -99,6 +124,4 @@ void Function::Print(std::ostream& os, std::string_view indent, int depth)
 		os << "Parameters["sv << i << "](ID = "sv << _params[i]->_name->_id
 			<< ", Type = "sv << _params[i]->_type->_name << ")\n"sv;
 	}
-	for (size_t i {0}; i < _body.size(); ++ i)
-		_body[i]->Print(os, indent, depth);
 }
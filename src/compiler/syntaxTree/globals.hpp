@@ -13,8 +13,6 @@
 struct Parameter
 	: public Declaration
 {
-	Type* _type {nullptr}; // Parameter's type.
-
 	/**
 	 * Construct a new Parameter object.
 	 * @param type Name of the parameter's type.
@@ -22,10 +20,13 @@ struct Parameter
 	 */
 	Parameter(Type* type, Identifier* name);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::Parameter; }
+
+	bool ScopeEnter(SymbolTable& symbols, ScopeData& dat) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
 
-	// TokenInfo refers to the span of the parameter's type and name.
+	// SourceLocation refers to the span of the parameter's type and name.
 };
 
 
@@ -34,28 +35,49 @@ struct Function
 	: public Declaration
 {
 	// Stores the parameters expressed in the function definition.
-	using ParamList = std::vector<std::unique_ptr<Parameter>>;
+	using ParamList = ArenaList<Parameter>;
 
-	Type* _type {nullptr};	// Function's return type.
 	ParamList _params;		// Function's parameters.
 	StmtList _body;			// Function's body statements.
-	bool _hasCall;			// Function's body contains a function call.
 
 	/**
 	 * Construct a new function.
 	 * @param name Function's name.
-	 * @param params Function's parameters. Assumed to be in reverse order after
-	 * being parsed bottom-up.
+	 * @param params Function's parameters, in source order.
 	 * @param type Function's return type.
-	 * @param body Function's body. Assumed to be in reverse order after being
-	 * parsed bottom-up.
+	 * @param body Function's body statements, in source order.
 	 */
 	Function(Identifier* name, ParamList params, Type* type, StmtList body);
 
-	bool Scope(SymbolTable& symbols, TU& tu) override;
-	bool Validate(ValidateData& dat) override;
+	static bool ClassOf(NodeKind kind) { return kind == NodeKind::Function; }
+
+	/**
+	 * Performs scope resolution of the parameters and body in a new scope,
+	 * without defining the function itself.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool ScopeBody(SymbolTable& symbols, ScopeData& dat);
+
+	/**
+	 * Opens the scope of the body and defines the parameters in it.
+	 * @param symbols Symbol table to be used.
+	 * @param dat Scope resolution data of the AST.
+	 * @return true if scope resolution is successful; false otherwise.
+	 */
+	bool ScopeParams(SymbolTable& symbols, ScopeData& dat);
+
+	size_t GetChildCount() const override;
+	SyntaxTreeNode* GetChild(size_t i) const override;
+	bool ScopeEnter(SymbolTable& symbols, ScopeData& dat) override;
+	bool ScopeLeave(SymbolTable& symbols, ScopeData& dat) override;
+	bool ValidateEnter(ValidateData& dat) override;
+	void ValidateLeave(ValidateData& dat, bool& success) override;
 	void Generate(GenData& dat, std::ostream& os) override;
-	void Print(std::ostream& os, std::string_view indent, int depth) override;
+	void ShiftEnter(int64_t delta) override;
+	void PrintEnter(
+		std::ostream& os, std::string_view indent, int depth) override;
 
-	// TokenInfo refers to the span from the name to return type.
+	// SourceLocation refers to the span from the name to return type.
 };
@@ -2,17 +2,18 @@
 
 #include "globals.hpp"
 
-#include <iostream>
+#include <charconv>
+#include <ostream>
 
 using namespace std::string_view_literals;
 
 
-Literal::Literal(std::string_view literal_name, std::string& raw_value)
-	: _literalName{literal_name}, _rawValue{raw_value}
+Literal::Literal(NodeKind kind, std::string_view literal_name, Name raw_value)
+	: Expression{kind}, _literalName{literal_name}, _rawValue{raw_value}
 {}
 
 
-void Literal::Print(
+void Literal::PrintEnter(
 	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
@@ -20,50 +21,53 @@ void Literal::Print(
 }
 
 
-Variable::Variable(std::string& name)
-	: Literal{"Variable"sv, name}
+Variable::Variable(Name name)
+	: Literal{NodeKind::Variable, "Variable"sv, name}
 {}
 
 
-bool Variable::Scope(SymbolTable& symbols, TU& tu)
+bool Variable::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
 {
 	_def = symbols.Lookup(_rawValue);
 	if (_def == nullptr)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Unkown symbol: " << _rawValue << '\n';
-		tu.HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::UnknownSymbol, *this, {_rawValue.View()});
 		return false;
 	}
-	else if (dynamic_cast<Function*>(_def) != nullptr)
+	else if (isa<Function>(_def))
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Misuse of function identifier: " << _rawValue << '\n';
-		tu.HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::MisusedFunction, *this, {_rawValue.View()});
 		return false;
 	}
 	return true;
 }
 
 
+bool Variable::ValidateEnter(ValidateData& dat)
+{
+	_type = _def->_type;
+	return true;
+}
+
+
 void Variable::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-IntLiteral::IntLiteral(std::string& value)
-	: Literal{"IntLiteral"sv, value}
+IntLiteral::IntLiteral(Name value)
+	: Literal{NodeKind::IntLiteral, "IntLiteral"sv, value}
 {}
 
 
-bool IntLiteral::Validate(ValidateData& dat)
+bool IntLiteral::ValidateEnter(ValidateData& dat)
 {
-	try { _value = std::stoi(_rawValue); }
-	catch ([[maybe_unused]] const std::out_of_range& e)
+	_type = dat._types->Int();
+	const std::string_view raw {_rawValue.View()};
+	const std::from_chars_result res
+		{std::from_chars(raw.data(), raw.data() + raw.size(), _value)};
+	if (res.ec == std::errc::result_out_of_range)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Ingeger literal is out of range of u32: "sv
-			<< _rawValue << '\n';
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::IntOutOfRange, *this, {raw});
 		return false;
 	}
 	return true;
@@ -74,14 +78,15 @@ void IntLiteral::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-BoolLiteral::BoolLiteral(std::string& value)
-	: Literal{"BoolLiteral"sv, value}
+BoolLiteral::BoolLiteral(Name value)
+	: Literal{NodeKind::BoolLiteral, "BoolLiteral"sv, value}
 {}
 
 
-bool BoolLiteral::Validate(ValidateData& dat)
+bool BoolLiteral::ValidateEnter(ValidateData& dat)
 {
-	_value = (_rawValue == "true"sv) ? true : false;
+	_type = dat._types->Bool();
+	_value = (_rawValue.View() == "true"sv) ? true : false;
 	return true;
 }
 
@@ -90,14 +95,16 @@ void BoolLiteral::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-StrLiteral::StrLiteral(std::string& value)
-	: Literal{"StrLiteral"sv, value}
+StrLiteral::StrLiteral(Name value)
+	: Literal{NodeKind::StrLiteral, "StrLiteral"sv, value}
 {}
 
 
-bool StrLiteral::Validate(ValidateData& dat)
+bool StrLiteral::ValidateEnter(ValidateData& dat)
 {
-	_value = _rawValue.substr(1, _rawValue.length() - 2);
+	_type = dat._types->String();
+	const std::string_view raw {_rawValue.View()};
+	_value = raw.substr(1, raw.length() - 2);
 	return true;
 }
 
@@ -0,0 +1,129 @@
+#include "nodeIndex.hpp"
+
+#include "common.hpp"
+#include "globals.hpp"
+#include "traverse.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+
+// Span attributed to a node while an index is built.
+struct IndexEntry
+{
+	uint32_t _off;			// Offset of the first character of the span.
+	uint32_t _end;			// Offset after the last character of the span.
+	uint32_t _order;		// Position of the entry in traversal order.
+	SyntaxTreeNode* _node;	// Node the span is attributed to.
+};
+
+
+// Visitor listing the spans of the nodes of a subtree.
+struct IndexVisitor
+{
+	std::vector<IndexEntry> _entries;	// Spans listed so far.
+
+	/**
+	 * Lists a span unless it is empty.
+	 * @param loc The span.
+	 * @param node Node the span is attributed to.
+	 */
+	void Add(const SourceLocation& loc, SyntaxTreeNode* node)
+	{
+		if (loc._len == 0) return;
+		_entries.push_back(IndexEntry {loc._off, loc.GetEndOff(),
+			static_cast<uint32_t>(_entries.size()), node});
+	}
+
+	bool Enter(SyntaxTreeNode* node)
+	{
+		Add(*node, node);
+		if (Declaration* decl {dyn_cast<Declaration>(node)})
+			Add(*decl->_name, node);
+		if (Function* fn {dyn_cast<Function>(node)})
+		{
+			for (Parameter* param : fn->_params)
+			{
+				Add(*param, param);
+				Add(*param->_name, param);
+			}
+		}
+		else if (Invocation* call {dyn_cast<Invocation>(node)})
+			Add(*call->_name, node);
+		else if (AssignmentExpr* assign {dyn_cast<AssignmentExpr>(node)})
+			Add(*assign->_name, node);
+		else if (BreakStmt* brk {dyn_cast<BreakStmt>(node)})
+		{
+			if (brk->_count != nullptr) Add(*brk->_count, brk->_count);
+		}
+		return true;
+	}
+
+	bool Before(SyntaxTreeNode* node, size_t i) { return true; }
+	void After(SyntaxTreeNode* node, size_t i) {}
+	void Leave(SyntaxTreeNode* node) {}
+};
+
+
+NodeIndex::NodeIndex()
+{}
+
+
+NodeIndex::NodeIndex(SyntaxTreeNode* root)
+{
+	IndexVisitor visitor;
+	traverse(root, visitor);
+	std::vector<IndexEntry>& entries {visitor._entries};
+
+	// Enclosing spans precede those they enclose; of equal spans, the one
+	// listed last, the deeper node, is entered last and so is innermost.
+	std::sort(entries.begin(), entries.end(),
+		[](const IndexEntry& lhs, const IndexEntry& rhs)
+		{
+			return std::tie(lhs._off, rhs._end, lhs._order)
+				< std::tie(rhs._off, lhs._end, rhs._order);
+		});
+
+	// Sweep the spans in order, keeping the open ones on a stack whose top
+	// is innermost, and start a segment wherever the innermost one changes.
+	std::vector<const IndexEntry*> open;
+	auto begin = [this](uint32_t off, SyntaxTreeNode* node)
+	{
+		if (!_segments.empty() && _segments.back()._off == off)
+			_segments.back()._node = node;
+		else _segments.push_back(Segment {off, node});
+	};
+	auto close = [&open, &begin](uint32_t off)
+	{
+		while (!open.empty() && open.back()->_end <= off)
+		{
+			const uint32_t end {open.back()->_end};
+			while (!open.empty() && open.back()->_end <= end) open.pop_back();
+			begin(end, open.empty() ? nullptr : open.back()->_node);
+		}
+	};
+	for (const IndexEntry& entry : entries)
+	{
+		close(entry._off);
+		open.push_back(&entry);
+		begin(entry._off, entry._node);
+	}
+	close(UINT32_MAX);
+}
+
+
+SyntaxTreeNode* NodeIndex::Find(uint32_t off) const
+{
+	auto next = std::upper_bound(_segments.begin(), _segments.end(), off,
+		[](uint32_t value, const Segment& segment)
+		{
+			return value < segment._off;
+		});
+	return next == _segments.begin() ? nullptr : (next - 1)->_node;
+}
+
+
+uint32_t NodeIndex::GetStart() const
+{
+	return _segments.empty() ? UINT32_MAX : _segments.front()._off;
+}
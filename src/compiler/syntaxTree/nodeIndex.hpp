@@ -0,0 +1,50 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <cstdint>
+#include <vector>
+
+
+// Maps offsets in a source to the innermost node of a subtree located there.
+// The spans of the nodes, and of the identifiers they name, either nest or
+// are disjoint, so they divide the source into segments in each of which one
+// node is innermost. Segments are kept in order of offset, so finding the
+// node at an offset is a binary search rather than a walk of the subtree.
+class NodeIndex
+{
+	// Run of characters sharing the same innermost node.
+	struct Segment
+	{
+		uint32_t _off;			// Offset of the first character of the run.
+		SyntaxTreeNode* _node;	// Innermost node; nullptr if there is none.
+	};
+
+	std::vector<Segment> _segments;	// Segments in order of offset.
+
+public:
+	// Construct an empty index.
+	NodeIndex();
+
+	/**
+	 * Construct an index of the nodes in a subtree. The names of
+	 * declarations, invocations and assignments are attributed to the node
+	 * naming them, and the parameters of a function are indexed with it.
+	 * @param root Root of the subtree to be indexed.
+	 */
+	NodeIndex(SyntaxTreeNode* root);
+
+	/**
+	 * Finds the innermost node located at an offset.
+	 * @param off Offset of a character.
+	 * @return The innermost node spanning the character, or nullptr if no
+	 * node does.
+	 */
+	SyntaxTreeNode* Find(uint32_t off) const;
+
+	/**
+	 * @return Offset of the first character spanned by an indexed node, or
+	 * UINT32_MAX if the index is empty.
+	 */
+	uint32_t GetStart() const;
+};
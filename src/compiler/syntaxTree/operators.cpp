@@ -2,15 +2,15 @@
 
 #include "globals.hpp"
 
-#include <algorithm>
-#include <iostream>
+#include <ostream>
+#include <string>
 #include <utility>
 
 using namespace std::string_view_literals;
 
 
 BinaryExpr::BinaryExpr(Expression* argl, Expression* argr, Ops op)
-	: _argl{argl}, _argr{argr}, _op{op}
+	: Expression{NodeKind::BinaryExpr}, _argl{argl}, _argr{argr}, _op{op}
 {}
 
 
@@ -46,36 +46,35 @@ std::string_view BinaryExpr::GetOpText(Ops op)
  * @brief Prints the error message associated with incorrectly typed operand
  * expressions for binary operators.
  * 
- * @param src The buffer of the source file expressing this AST.
- * @param op The TokenInfo of the operator in question.
+ * @param dat Validation data of the AST.
+ * @param op The location of the operator in question.
  * @param expr The incorrectly typed operand expression.
  * @param is_left true if the passed operand is the left operand; false
  * otherwise.
  * @param expected The name of the expected type.
  */
-void ExpectedBinaryType(TU* src, TokenInfo& op, Expression* expr,
-	bool is_left, std::string_view expected)
+void ExpectedBinaryType(ValidateData& dat, SourceLocation& op,
+	Expression* expr, bool is_left, std::string_view expected)
 {
-	std::cerr << '(' << op._row << ", "sv << op._col << "): Expected "sv
-		<< (is_left ? "left"sv : "right"sv)
-		<< " operand of type "sv << expected << ", found: "sv
-		<< expr->_type->_name << '\n';
-	src->HighlightError(std::cerr, op);
+	dat._diag.Error(DiagID::OperandType, op,
+		{is_left ? "left"sv : "right"sv, expected, expr->_type->_name});
 }
 
 
-bool BinaryExpr::Scope(SymbolTable& symbols, TU& tu)
+size_t BinaryExpr::GetChildCount() const
 {
-	const bool success {_argl->Scope(symbols, tu)};
-	return _argr->Scope(symbols, tu) && success;
+	return 2;
 }
 
 
-bool BinaryExpr::Validate(ValidateData& dat)
+SyntaxTreeNode* BinaryExpr::GetChild(size_t i) const
 {
-	bool success {_argl->Validate(dat)};
-	success = _argr->Validate(dat) && success;
+	return i == 0 ? _argl : _argr;
+}
+
 
+void BinaryExpr::ValidateLeave(ValidateData& dat, bool& success)
+{
 	switch (_op)
 	{
 		// Operands must both be Booleans.
@@ -83,13 +82,13 @@ bool BinaryExpr::Validate(ValidateData& dat)
 			if (!_argl->_type->IsBool())
 			{
 				ExpectedBinaryType(
-					dat._src, *this, _argl.get(), true, "bool"sv);
+					dat, *this, _argl, true, "bool"sv);
 				success = false;
 			}
 			if (!_argr->_type->IsBool())
 			{
 				ExpectedBinaryType(
-					dat._src, *this, _argr.get(), false, "bool"sv);
+					dat, *this, _argr, false, "bool"sv);
 				success = false;
 			}
 			_type = _argl->_type;
@@ -100,13 +99,13 @@ bool BinaryExpr::Validate(ValidateData& dat)
 		case Ops::LShift:	case Ops::RShift:	case Ops::Mod:
 			if (!_argl->_type->IsInt())
 			{
-				ExpectedBinaryType(dat._src, *this, _argl.get(), true, "int"sv);
+				ExpectedBinaryType(dat, *this, _argl, true, "int"sv);
 				success = false;
 			}
 			if (!_argr->_type->IsInt())
 			{
 				ExpectedBinaryType(
-					dat._src, *this, _argr.get(), false, "bool"sv);
+					dat, *this, _argr, false, "int"sv);
 				success = false;
 			}
 			_type = _argl->_type;
@@ -117,13 +116,11 @@ bool BinaryExpr::Validate(ValidateData& dat)
 		case Ops::LT:		case Ops::LE:		case Ops::GE:
 			if (_argl->_type != _argr->_type)
 			{
-				std::cerr << '(' << _row << ", "sv << _col
-					<< "): Expected operands of matching types, found: "sv
-					<< _argl->_type->_name << " and "sv
-					<< _argr->_type->_name << '\n';
-			dat._src->HighlightError(std::cerr, *this);
+				dat._diag.Error(DiagID::MismatchedOperands, *this,
+					{_argl->_type->_name, _argr->_type->_name});
+				success = false;
 			}
-			_type = Type::Create("bool");
+			_type = dat._types->Bool();
 			break;
 
 		// Operands must be numbers.
@@ -131,13 +128,13 @@ bool BinaryExpr::Validate(ValidateData& dat)
 		case Ops::Mul:	case Ops::Div:
 			if (!_argl->_type->IsInt())
 			{
-				ExpectedBinaryType(dat._src, *this, _argl.get(), true, "int"sv);
+				ExpectedBinaryType(dat, *this, _argl, true, "int"sv);
 				success = false;
 			}
 			if (!_argr->_type->IsInt())
 			{
 				ExpectedBinaryType(
-					dat._src, *this, _argr.get(), false, "bool"sv);
+					dat, *this, _argr, false, "int"sv);
 				success = false;
 			}
 			_type = _argl->_type;
@@ -145,7 +142,6 @@ bool BinaryExpr::Validate(ValidateData& dat)
 	}
 
 	_hasCall = _argl->_hasCall || _argr->_hasCall;
-	return success;
 }
 
 
@@ -153,23 +149,26 @@ void BinaryExpr::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void BinaryExpr::Print(std::ostream& os, std::string_view indent, int depth)
+void BinaryExpr::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "BinaryExpression(Op = "sv << GetOpText(_op) << ", Type = "sv
-		<< _type->_name << "):\n"sv;
-	++ depth;
-	PrintIndent(os, indent, depth);
-	os << "Left Operand =\n"sv;
-	_argl->Print(os, indent, depth + 1);
-	PrintIndent(os, indent, depth);
-	os << "Right Operand =\n"sv;
-	_argr->Print(os, indent, depth + 1);
+		<< Type::NameOf(_type) << "):\n"sv;
+}
+
+
+int BinaryExpr::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	PrintIndent(os, indent, depth + 1);
+	os << (i == 0 ? "Left Operand =\n"sv : "Right Operand =\n"sv);
+	return depth + 2;
 }
 
 
 UnaryExpr::UnaryExpr(Expression* arg, Ops op)
-	: _arg{arg}, _op{op}
+	: Expression{NodeKind::UnaryExpr}, _arg{arg}, _op{op}
 {}
 
 
@@ -191,28 +190,29 @@ std::string_view UnaryExpr::GetOpText(Ops op)
 }
 
 
-bool UnaryExpr::Scope(SymbolTable& symbols, TU& tu)
+size_t UnaryExpr::GetChildCount() const
 {
-	return _arg->Scope(symbols, tu);
+	return 1;
 }
 
 
-bool UnaryExpr::Validate(ValidateData& dat)
+SyntaxTreeNode* UnaryExpr::GetChild(size_t i) const
 {
-	bool success {_arg->Validate(dat)};
+	return _arg;
+}
+
 
+void UnaryExpr::ValidateLeave(ValidateData& dat, bool& success)
+{
 	if (!_arg->_type->IsInt())
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Expected operand of type int, found: "sv
-			<< _arg->_type->_name << '\n';
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(
+			DiagID::UnaryOperandType, *this, {_arg->_type->_name});
 		success = false;
 	}
 
 	_type = _arg->_type;
 	_hasCall = _arg->_hasCall;
-	return success;
 }
 
 
@@ -222,95 +222,118 @@ void UnaryExpr::Generate(GenData& dat, std::ostream& os)
 }
 
 
-void UnaryExpr::Print(std::ostream& os, std::string_view indent, int depth)
+void UnaryExpr::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "UnaryExpr(Op = "sv << GetOpText(_op)
-		<< ", Type = "sv << _type->_name << "):\n"sv;
-	PrintIndent(os, indent, ++ depth);
+		<< ", Type = "sv << Type::NameOf(_type) << "):\n"sv;
+}
+
+
+int UnaryExpr::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	PrintIndent(os, indent, depth + 1);
 	os << "Operand =\n"sv;
-	_arg->Print(os, indent, ++ depth);
+	return depth + 2;
 }
 
 
-Invocation::Invocation(Identifier* name, ArgList& args)
-	: _name{name}, _args{std::move(args)}
+Invocation::Invocation(Identifier* name, ArgList args)
+	: Expression{NodeKind::Invocation}, _name{name}, _args{std::move(args)}
 {
-	std::reverse(_args.begin(), _args.end());
 	_hasCall = true;
 }
 
 
-bool Invocation::Scope(SymbolTable& symbols, TU& tu)
+size_t Invocation::GetChildCount() const
+{
+	return _args.size();
+}
+
+
+SyntaxTreeNode* Invocation::GetChild(size_t i) const
+{
+	return _args[i];
+}
+
+
+bool Invocation::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
 {
-	bool success {true};
-	_def = dynamic_cast<Function*>(symbols.Lookup(_name->_id));
+	_def = dyn_cast<Function>(symbols.Lookup(_name->_id));
 	if (_def == nullptr)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Unknown function: "sv << _name->_id << '\n';
-		tu.HighlightError(std::cerr, *_name);
-		success = false;
+		dat._diag.ErrorAt(
+			DiagID::UnknownFunction, *this, *_name, {_name->_id.View()});
+		return false;
 	}
-
-	for (size_t i {0}; i < _args.size(); ++ i)
-		success = _args[i]->Scope(symbols, tu) && success;	
-
-	return success;
+	return true;
 }
 
 
-bool Invocation::Validate(ValidateData& dat)
+bool Invocation::ValidateEnter(ValidateData& dat)
 {
 	_type = _def->_type;
 	const size_t expected_args {_def->_params.size()}; // Bigger than _evalIndex.
 	if (_args.size() != expected_args)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Incorrect number of arguments in call to "sv
-			<< _name->_id << ". Expected "sv << expected_args
-			<< ", found "sv << _args.size() << ".\n"sv;
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::ArgumentCount, *this, {_name->_id.View(),
+			std::to_string(expected_args), std::to_string(_args.size())});
 		return false;
 	}
+	return true;
+}
 
-	bool success {true};
-	for (size_t i {0}; i < expected_args; ++ i)
-	{
-		Expression* arg {_args[i].get()};
-		success = success && arg->Validate(dat);
-		Type* expected_type {_def->_params[i]->_type};
-		Type* given_type {arg->_type};
-		if (*given_type != *expected_type)
-		{
-			std::cerr << '(' << _row << ", "sv << _col
-				<< "): Expected "sv << expected_type->_name << " for argument"sv
-				<< i + 1 << " in call to "sv << _name->_id << ", found: "sv
-				<< given_type->_name << '\n';
-			dat._src->HighlightError(std::cerr, *this);
-			success = false;
-		}
-		_hasCall = _hasCall || arg->_hasCall;
-	}
 
+bool Invocation::ValidateBeforeChild(
+	ValidateData& dat, size_t i, bool& success)
+{
+	// Arguments after the first invalid one are not validated.
 	return success;
 }
 
 
+void Invocation::ValidateAfterChild(ValidateData& dat, size_t i, bool& success)
+{
+	Expression* arg {_args[i]};
+	Type* expected_type {_def->_params[i]->_type};
+	Type* given_type {arg->_type};
+	if (given_type != expected_type)
+	{
+		dat._diag.Error(DiagID::ArgumentType, *this,
+			{expected_type->_name, std::to_string(i + 1), _name->_id.View(),
+			Type::NameOf(given_type)});
+		success = false;
+	}
+	_hasCall = _hasCall || arg->_hasCall;
+}
+
+
 void Invocation::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void Invocation::Print(std::ostream& os, std::string_view indent, int depth)
+void Invocation::ShiftEnter(int64_t delta)
+{
+	SyntaxTreeNode::ShiftEnter(delta);
+	_name->ShiftEnter(delta);
+}
+
+
+void Invocation::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "InvokeExpression(Function = "sv << _name->_id
-		<< ", Type = "sv << _type->_name << "):\n"sv;
-	++ depth;
-	for (size_t i {0}; i < _args.size(); ++ i)
-	{
-		PrintIndent(os, indent, depth);
-		os << "Arg["sv << i << "] =\n"sv;
-		_args[i]->Print(os, indent, depth + 1);
-	}
+		<< ", Type = "sv << Type::NameOf(_type) << "):\n"sv;
+}
+
+
+int Invocation::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	PrintIndent(os, indent, depth + 1);
+	os << "Arg["sv << i << "] =\n"sv;
+	return depth + 2;
 }
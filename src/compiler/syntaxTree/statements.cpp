@@ -2,92 +2,158 @@
 
 #include "globals.hpp"
 
-#include <algorithm>
-#include <iostream>
+#include <ostream>
 #include <sstream>
+#include <string>
 #include <utility>
 
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
 
-bool Statement::ValidateAndGetReturn(
+Statement::Statement(NodeKind kind)
+	: SyntaxTreeNode{kind}
+{}
+
+
+Declaration::Declaration(NodeKind kind, Identifier* name, Type* type)
+	: Statement{kind}, _name{name}, _type{type}
+{}
+
+
+bool Declaration::Define(SymbolTable& symbols, ScopeData& dat)
+{
+	Declaration* pre {symbols.Define(_name->_id, this)};
+	if (pre != nullptr)
+	{
+		dat._diag.Error(DiagID::SymbolCollision, *_name, {_name->_id.View()});
+		dat._diag.Note(DiagID::CollisionPrevious, *pre->_name,
+			{std::to_string(dat._src->Locate(*pre->_name)._row)});
+		return false;
+	}
+	return true;
+}
+
+
+/**
+ * Copies an identifier into an arena.
+ * @param arena Arena the copy is placed in.
+ * @param id Identifier to be copied.
+ * @return The copy, located where the identifier is.
+ */
+static Identifier* copyIdentifier(Arena& arena, const Identifier& id)
+{
+	Identifier* copy {arena.Create<Identifier>(id._id)};
+	copy->SetSymbolInfo(id);
+	return copy;
+}
+
+
+Declaration* Declaration::CopySignature(Arena& arena) const
+{
+	Identifier* name {copyIdentifier(arena, *_name)};
+	Declaration* copy;
+	if (const Function* fn {dyn_cast<const Function>(this)})
+	{
+		std::vector<Parameter*> params;
+		for (const Parameter* param : fn->_params)
+		{
+			params.push_back(arena.Create<Parameter>(
+				param->_type, copyIdentifier(arena, *param->_name)));
+			params.back()->SetSymbolInfo(*param);
+		}
+		copy = arena.Create<Function>(
+			name, arena.CreateList(params), _type, StmtList {});
+	}
+	else if (isa<Parameter>(this))
+		copy = arena.Create<Parameter>(_type, name);
+	else copy = arena.Create<VariableDef>(_type, name, nullptr);
+	copy->SetSymbolInfo(*this);
+	return copy;
+}
+
+
+void Declaration::ShiftEnter(int64_t delta)
+{
+	SyntaxTreeNode::ShiftEnter(delta);
+	_name->ShiftEnter(delta);
+}
+
+
+Expression::Expression(NodeKind kind)
+	: Statement{kind}
+{}
+
+
+Breakable::Breakable(NodeKind kind)
+	: Expression{kind}
+{}
+
+
+bool Statement::CheckReturn(
 	StmtList &stmts, ValidateData& dat, bool& success, bool* has_call)
 {
 	const size_t stmts_len {stmts.size()};
-	if (stmts_len == 0) return false;
-
-	Statement* cur {nullptr};
-	Statement* last_ret {stmts[stmts_len - 1].get()};
+	size_t returns_at {stmts_len};
 	bool makes_call {false};
 	for (size_t i {0}; i < stmts_len; ++ i)
 	{
-		cur = stmts[i].get();
+		Statement* cur {stmts[i]};
 		makes_call = makes_call || cur->_hasCall;
-		success = cur->Validate(dat) && success;
-		if (cur->_hasReturn) last_ret = cur;
+		if (cur->_hasReturn && returns_at == stmts_len) returns_at = i;
 	}
+	if (has_call != nullptr) *has_call = makes_call;
 
-	if (last_ret == nullptr) return false;
-	if (cur != last_ret)
+	if (returns_at == stmts_len) return false;
+	if (returns_at != stmts_len - 1)
 	{
-		std::cerr << '(' << cur->_row << ", "sv << cur->_col
-			<< "): Unreachable code after a returning statement.\n"sv;
-		dat._src->HighlightError(std::cerr, *cur);
+		Statement* next {stmts[returns_at + 1]};
+		dat._diag.Error(DiagID::UnreachableCode, *next);
 		success = false;
-		return false;
 	}
-
-	if (has_call != nullptr) *has_call = makes_call;
 	return true;
 }
 
 
 VariableDef::VariableDef(Type* type, Identifier* name, Expression* init)
-	: Declaration{name}, _type{type}, _init{init}
+	: Declaration{NodeKind::VariableDef, name, type}, _init{init}
 {}
 
 
+size_t VariableDef::GetChildCount() const
+{
+	return 1;
+}
+
 
-bool VariableDef::Scope(SymbolTable& symbols, TU& tu)
+SyntaxTreeNode* VariableDef::GetChild(size_t i) const
 {
-	Declaration* pre {symbols.Define(_name->_id, this)};
-	if (pre != nullptr)
-	{
-		std::cerr << '(' << _name->_row << ", "sv << _name->_col
-			<< "): Symbol collision: "sv << _name->_id
-			<< "\n# The following on line "sv << _name->_row << ":\n"sv;
-		tu.HighlightError(std::cerr, *_name);
-		std::cerr << "# Redefines on line "sv << pre->_name->_row << ":\n"sv;
-		tu.HighlightError(std::cerr, *pre->_name);
-		return false;
-	}
-	return true;
+	return _init;
 }
 
 
-bool VariableDef::Validate(ValidateData& dat)
+bool VariableDef::ScopeLeave(SymbolTable& symbols, ScopeData& dat)
 {
-	bool success {_init->Validate(dat)};
+	// The variable is not in scope within its own initializer.
+	return Define(symbols, dat);
+}
 
+
+void VariableDef::ValidateLeave(ValidateData& dat, bool& success)
+{
 	if (_type->IsVoid())
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Variable cannot be type void: "sv << _name->_id << '\n';
-		dat._src->HighlightError(std::cerr, *this);
-		return false;
+		dat._diag.Error(DiagID::VoidVariable, *this, {_name->_id.View()});
+		success = false;
+		return;
 	}
 	
-	if (*_init->_type != *_type)
+	if (_init->_type != _type)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Expected initializer of type "sv << _type->_name
-			<< ", found: "sv << _init->_type->_name << '\n';
-		dat._src->HighlightError(std::cerr, *this);
-		return false;
+		dat._diag.Error(DiagID::InitializerType, *this,
+			{_type->_name, _init->_type->_name});
+		success = false;
 	}
-
-	return success;
 }
 
 
@@ -95,48 +161,47 @@ void VariableDef::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void VariableDef::Print(std::ostream& os, std::string_view indent, int depth)
+void VariableDef::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "VariableInitialization(ID = "sv << _name->_id << ", Type = "sv
 		<< _type->_name << "):\n"sv;
-	_init->Print(os, indent, ++ depth);
 }
 
 
 IfStmt::IfStmt(Expression* cond, Statement* body, Statement* alt)
-	: _cond{cond}, _body{body}, _alt{alt}
+	: Statement{NodeKind::IfStmt}, _cond{cond}, _body{body}, _alt{alt}
 {}
 
 
-bool IfStmt::Scope(SymbolTable& symbols, TU& tu)
+size_t IfStmt::GetChildCount() const
 {
-	const bool success {_cond->Scope(symbols, tu) && _body->Scope(symbols, tu)};
-	return (_cond != nullptr ? _cond->Scope(symbols, tu) : true) && success;
+	return 3;
 }
 
 
-bool IfStmt::Validate(ValidateData& dat)
+SyntaxTreeNode* IfStmt::GetChild(size_t i) const
 {
-	bool success {_cond->Validate(dat)};
-	success = _body->Validate(dat) && success;
-	if (_alt != nullptr)
+	switch (i)
 	{
-		success = _alt->Validate(dat) && success;
-		_hasReturn = _body->_hasReturn && _alt->_hasReturn;
+		case 0:		return _cond;
+		case 1:		return _body;
+		default:	return _alt;
 	}
+}
+
+
+void IfStmt::ValidateLeave(ValidateData& dat, bool& success)
+{
+	if (_alt != nullptr) _hasReturn = _body->_hasReturn && _alt->_hasReturn;
 	else _hasReturn = _body->_hasReturn;
 
 	if (!_cond->_type->IsBool())
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Expected if statement condition of type bool, found: "sv
-			<< _cond->_type->_name << '\n';
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::ConditionType, *this, {_cond->_type->_name});
 		success = false;
 	}
-
-	return success;
 }
 
 
@@ -144,71 +209,76 @@ void IfStmt::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void IfStmt::Print(std::ostream& os, std::string_view indent, int depth)
+void IfStmt::PrintEnter(std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "IfExpression:\n"sv;
-	++ depth;
-	PrintIndent(os, indent, depth);
-	os << "Condition =\n"sv;
-	_cond->Print(os, indent, depth + 1);
-	PrintIndent(os, indent, depth);
-	os << "Body =\n"sv;
-	_body->Print(os, indent, depth + 1);
-	PrintIndent(os, indent, depth);
-	os << "Else =\n"sv;
-	PrintMaybe(_alt.get(), os, indent, depth + 1);
+}
+
+
+int IfStmt::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	static constexpr std::string_view labels[]
+		{"Condition =\n"sv, "Body =\n"sv, "Else =\n"sv};
+	PrintIndent(os, indent, depth + 1);
+	os << labels[i];
+	PrintIfEmpty(GetChild(i), os, indent, depth + 2);
+	return depth + 2;
 }
 
 
 BreakStmt::BreakStmt(Expression* expr, IntLiteral* count)
-	: _expr{expr}, _count{count}
+	: Statement{NodeKind::BreakStmt}, _expr{expr}, _count{count}
 {}
 
 
-bool BreakStmt::Scope(SymbolTable& symbols, TU& tu)
+size_t BreakStmt::GetChildCount() const
+{
+	return 1;
+}
+
+
+SyntaxTreeNode* BreakStmt::GetChild(size_t i) const
 {
-	return _expr != nullptr ? _expr->Scope(symbols, tu) : true;
+	return _expr;
 }
 
 
-bool BreakStmt::Validate(ValidateData& dat)
+bool BreakStmt::ValidateEnter(ValidateData& dat)
 {
+	if (_count != nullptr && !_count->ValidateEnter(dat)) return false;
 	const size_t count
 		{static_cast<size_t>(_count == nullptr ? 1 : _count->_value)};
 
-	if (dat._bs.size() < count)
+	if (count == 0 || dat._bs.size() < count)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Break count exceeds breakable depth: "sv << count << '\n';
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::BreakDepth, *this, {std::to_string(count)});
 		return false;
 	}
-	_target = dat._bs[count - 1];
+	_target = dat._bs[dat._bs.size() - count];
+	return true;
+}
+
 
+void BreakStmt::ValidateLeave(ValidateData& dat, bool& success)
+{
 	const Type* existing {_target->_type};
 	if (_expr != nullptr)
 	{
-		bool success {_expr->Validate(dat)};
 		if (existing->IsVoid()) _target->_type = _expr->_type;
-		else if (*existing != *_expr->_type)
+		else if (existing != _expr->_type)
 		{
-			std::cerr << '(' << _row << ", "sv << _col
-				<< "): Expected break expression of type "sv << existing->_name
-				<< ", found: "sv << existing->_name << '\n';
-			dat._src->HighlightError(std::cerr, *this);
+			dat._diag.Error(DiagID::BreakType, *this,
+				{existing->_name, _expr->_type->_name});
 			success = false;
 		}
-		return success;
 	}
 	else if (!existing->IsVoid())
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Expected break expression, none provided.\n"sv;
-		dat._src->HighlightError(std::cerr, *this);
-		return false;
+		dat._diag.Error(DiagID::MissingBreakValue, *this);
+		success = false;
 	}
-	else return true;
 }
 
 
@@ -216,73 +286,85 @@ void BreakStmt::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void BreakStmt::Print(std::ostream& os, std::string_view indent, int depth)
+void BreakStmt::ShiftEnter(int64_t delta)
+{
+	SyntaxTreeNode::ShiftEnter(delta);
+	if (_count != nullptr) _count->ShiftEnter(delta);
+}
+
+
+void BreakStmt::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "BreakStatement(Levels = "sv
 		<< (_count == nullptr ? 0 : _count->_value) << "):\n"sv;
-	PrintMaybe(_expr.get(), os, indent, ++ depth);
+}
+
+
+int BreakStmt::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	PrintIfEmpty(_expr, os, indent, depth + 1);
+	return depth + 1;
 }
 
 
 ReturnStmt::ReturnStmt(Expression* expr)
-	: _expr{expr}
+	: Statement{NodeKind::ReturnStmt}, _expr{expr}
 {
 	_hasReturn = true;
 }
 
 
-bool ReturnStmt::Scope(SymbolTable& symbols, TU& tu)
+size_t ReturnStmt::GetChildCount() const
+{
+	return 1;
+}
+
+
+SyntaxTreeNode* ReturnStmt::GetChild(size_t i) const
 {
-	return _expr != nullptr ? _expr->Scope(symbols, tu) : true;
+	return _expr;
 }
 
 
-bool ReturnStmt::Validate(ValidateData& dat)
+bool ReturnStmt::ValidateEnter(ValidateData& dat)
 {	
 	if (dat._curFunc == nullptr)
 	{
-		std::cerr << '(' << _row << ", "sv << _col
-			<< "): Return statement occurs outside of a function body.\n"sv;
-		dat._src->HighlightError(std::cerr, *this);
+		dat._diag.Error(DiagID::ReturnOutsideFunction, *this);
 		return false;
 	}
 
 	_target = dat._curFunc;
 
 	const Type* expected {dat._curFunc->_type};
-	if (_expr == nullptr)
+	if (_expr == nullptr && !expected->IsVoid())
 	{
-		if (!expected->IsVoid())
-		{
-			std::cerr << '(' << _row << ", "sv << _col
-				<< "): Return from a function of type "sv
-				<< expected->_name << " is missing a return expression.\n"sv;
-			dat._src->HighlightError(std::cerr, *this);
-			return false;
-		}
+		dat._diag.Error(DiagID::MissingReturnValue, *this, {expected->_name});
+		return false;
 	}
-	else
+	return true;
+}
+
+
+void ReturnStmt::ValidateLeave(ValidateData& dat, bool& success)
+{
+	if (_expr == nullptr) return;
+
+	const Type* expected {_target->_type};
+	if (expected->IsVoid())
 	{
-		bool success {_expr->Validate(dat)};
-		if (expected->IsVoid())
-		{
-			std::cerr << '(' << _row << ", "sv << _col
-				<< "): Unexpected return expression in a void function.\n"sv;
-			dat._src->HighlightError(std::cerr, *this);
-			success = false;
-		}
-		else if (*_expr->_type != *expected)
-		{
-			std::cerr << '(' << _row << ", "sv << _col
-				<< "): Expected return expression of type "sv << expected->_name
-				<< ", found: "sv << expected->_name << '\n';
-			dat._src->HighlightError(std::cerr, *this);
-			success = false;
-		}
-		return success;
+		dat._diag.Error(DiagID::UnexpectedReturnValue, *this);
+		success = false;
+	}
+	else if (_expr->_type != expected)
+	{
+		dat._diag.Error(DiagID::ReturnType, *this,
+			{expected->_name, _expr->_type->_name});
+		success = false;
 	}
-	return true;
 }
 
 
@@ -290,51 +372,78 @@ void ReturnStmt::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void ReturnStmt::Print(std::ostream& os, std::string_view indent, int depth)
+void ReturnStmt::PrintEnter(
+	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "ReturnStatement:\n"sv;
-	PrintMaybe(_expr.get(), os, indent, ++ depth);
+}
+
+
+int ReturnStmt::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	PrintIfEmpty(_expr, os, indent, depth + 1);
+	return depth + 1;
 }
 
 
 CompoundStmt::CompoundStmt(StmtList stmts, Expression* expr)
-	: _stmts{std::move(stmts)}, _expr{expr}
+	: Expression{NodeKind::CompoundStmt}
+		, _stmts{std::move(stmts)}, _expr{expr}
+{}
+
+
+size_t CompoundStmt::GetChildCount() const
+{
+	// The trailing expression follows the statements.
+	return _stmts.size() + 1;
+}
+
+
+SyntaxTreeNode* CompoundStmt::GetChild(size_t i) const
 {
-	std::reverse(_stmts.begin(), _stmts.end());
+	return i < _stmts.size() ? _stmts[i] : _expr;
 }
 
 
-bool CompoundStmt::Scope(SymbolTable& symbols, TU& tu)
+bool CompoundStmt::ScopeEnter(SymbolTable& symbols, ScopeData& dat)
 {
 	symbols.Enter();
-	bool success {true};
-	for (size_t i {0}; i < _stmts.size(); ++ i)
-		success = _stmts[i]->Scope(symbols, tu) && success;
-	success = (_expr != nullptr ? _expr->Scope(symbols, tu) : true) && success;
+	return true;
+}
+
+
+bool CompoundStmt::ScopeLeave(SymbolTable& symbols, ScopeData& dat)
+{
 	symbols.Exit();
-	return success;
+	return true;
 }
 
 
-bool CompoundStmt::Validate(ValidateData& dat)
+bool CompoundStmt::ValidateBeforeChild(
+	ValidateData& dat, size_t i, bool& success)
 {
-	bool success {true};
-	if (_expr != nullptr)
+	if (i == _stmts.size())
 	{
-		_type = _expr->_type;
-		_hasCall = _expr->_hasCall;
-		if (_hasReturn)
-		{
-			std::cerr << '(' << _expr->_row << ", "sv << _expr->_col
-				<< "): Evaluation never occurs as it appears after a "sv 
-				<< "return statement."sv;
-			dat._src->HighlightError(std::cerr, *this);
-			success = false;
-		}
+		_hasReturn = CheckReturn(_stmts, dat, success, &_hasCall);
+		_type = dat._types->Void();
 	}
+	return true;
+}
+
 
-	return success;
+void CompoundStmt::ValidateLeave(ValidateData& dat, bool& success)
+{
+	if (_expr == nullptr) return;
+
+	_type = _expr->_type;
+	_hasCall = _hasCall || _expr->_hasCall;
+	if (_hasReturn)
+	{
+		dat._diag.ErrorAt(DiagID::UnevaluatedExpression, *_expr, *this);
+		success = false;
+	}
 }
 
 
@@ -342,17 +451,23 @@ void CompoundStmt::Generate(GenData& dat, std::ostream& os)
 {}
 
 
-void CompoundStmt::Print(
+void CompoundStmt::PrintEnter(
 	std::ostream& os, std::string_view indent, int depth)
 {
 	PrintIndent(os, indent, depth);
 	os << "CompoundStatement:\n"sv;
-	++ depth;
-	for (size_t i {0}; i < _stmts.size(); ++ i)
+}
+
+
+int CompoundStmt::PrintBeforeChild(
+	std::ostream& os, std::string_view indent, int depth, size_t i)
+{
+	if (i == _stmts.size())
 	{
-		PrintIndent(os, indent, depth);
-		os << "Statement["sv << i << "] ->\n"sv;
-		_stmts[i]->Print(os, indent, depth + 1);
+		PrintIfEmpty(_expr, os, indent, depth + 1);
+		return depth + 1;
 	}
-	PrintMaybe(_expr.get(), os, indent, depth);
+	PrintIndent(os, indent, depth + 1);
+	os << "Statement["sv << i << "] ->\n"sv;
+	return depth + 2;
 }
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <vector>
+
+
+/**
+ * Visits the subtree rooted at a node depth first. The path from the root to
+ * the current node is kept on an explicit stack rather than the native one,
+ * so the depth of the tree is bounded only by available memory. The visitor
+ * is called with the following members:
+ *
+ * bool Enter(SyntaxTreeNode* node): Called before the node's children. May
+ * return false to pass over all of them.
+ * bool Before(SyntaxTreeNode* node, size_t i): Called before child slot i of
+ * the node, including empty slots. May return false to pass over the child.
+ * Empty slots are passed over regardless.
+ * void After(SyntaxTreeNode* node, size_t i): Called after the child in slot
+ * i of the node was visited.
+ * void Leave(SyntaxTreeNode* node): Called after the node's children.
+ *
+ * @param root Root of the subtree to be visited. Must not be nullptr.
+ * @param visitor Visitor called for each node.
+ * @param children_only Indicates only the subtrees of the root's children
+ * are visited; Enter() and Leave() are then not called for the root itself.
+ */
+template <typename Visitor>
+void
+	traverse(SyntaxTreeNode* root, Visitor& visitor, bool children_only = false)
+{
+	// A node whose children are being visited.
+	struct Frame
+	{
+		SyntaxTreeNode* _node;	// The node.
+		size_t _next;			// Slot of the next child to be visited.
+		size_t _count;			// Number of child slots.
+	};
+
+	std::vector<Frame> path;
+	SyntaxTreeNode* next {root};
+	if (children_only)
+	{
+		path.push_back(Frame {root, 0, root->GetChildCount()});
+		next = nullptr;
+	}
+	for (;;)
+	{
+		if (next != nullptr && visitor.Enter(next))
+		{
+			path.push_back(Frame {next, 0, next->GetChildCount()});
+			next = nullptr;
+		}
+		else if (next == nullptr && path.back()._next < path.back()._count)
+		{
+			Frame& top {path.back()};
+			const size_t i {top._next ++};
+			if (visitor.Before(top._node, i)) next = top._node->GetChild(i);
+			continue;
+		}
+		else
+		{
+			// Leave the node entered without children, or the innermost one.
+			SyntaxTreeNode* node {next};
+			if (node == nullptr)
+			{
+				if (children_only && path.size() == 1) return;
+				node = path.back()._node;
+				path.pop_back();
+			}
+			next = nullptr;
+			visitor.Leave(node);
+			if (path.empty()) return;
+			visitor.After(path.back()._node, path.back()._next - 1);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "base.hpp"
+#include "common.hpp"
+#include "globals.hpp"
+
+#include <cstdlib>
+
+
+/**
+ * Calls a visitor with a node cast to its concrete class, selected by the
+ * node's kind rather than by a virtual call or RTTI. The visitor may overload
+ * its call operator for any mix of concrete and abstract node classes, such as
+ * a generic lambda or a struct with one overload per class of interest.
+ * @param node Node to be visited. Must not be nullptr.
+ * @param visitor Callable accepting a reference to every concrete node class.
+ * All of its overloads must return the same type.
+ * @return The visitor's result.
+ */
+template <typename Visitor>
+decltype(auto) visit(SyntaxTreeNode* node, Visitor&& visitor)
+{
+	switch (node->_kind)
+	{
+	case NodeKind::Identifier:
+		return visitor(*cast<Identifier>(node));
+	case NodeKind::Parameter:
+		return visitor(*cast<Parameter>(node));
+	case NodeKind::Function:
+		return visitor(*cast<Function>(node));
+	case NodeKind::VariableDef:
+		return visitor(*cast<VariableDef>(node));
+	case NodeKind::IfStmt:
+		return visitor(*cast<IfStmt>(node));
+	case NodeKind::BreakStmt:
+		return visitor(*cast<BreakStmt>(node));
+	case NodeKind::ReturnStmt:
+		return visitor(*cast<ReturnStmt>(node));
+	case NodeKind::LoopExpr:
+		return visitor(*cast<LoopExpr>(node));
+	case NodeKind::CompoundStmt:
+		return visitor(*cast<CompoundStmt>(node));
+	case NodeKind::BinaryExpr:
+		return visitor(*cast<BinaryExpr>(node));
+	case NodeKind::UnaryExpr:
+		return visitor(*cast<UnaryExpr>(node));
+	case NodeKind::Invocation:
+		return visitor(*cast<Invocation>(node));
+	case NodeKind::AssignmentExpr:
+		return visitor(*cast<AssignmentExpr>(node));
+	case NodeKind::Variable:
+		return visitor(*cast<Variable>(node));
+	case NodeKind::IntLiteral:
+		return visitor(*cast<IntLiteral>(node));
+	case NodeKind::BoolLiteral:
+		return visitor(*cast<BoolLiteral>(node));
+	case NodeKind::StrLiteral:
+		return visitor(*cast<StrLiteral>(node));
+	}
+	std::abort(); // Unreachable unless a node's kind is corrupt.
+}
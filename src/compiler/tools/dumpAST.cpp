@@ -1,10 +1,15 @@
+#include "../parser/lexer.hpp"
 #include "../parser/parser.h"
 #include "../parser/parserTools.hpp"
 #include "../syntaxTree/base.hpp"
+#include "../syntaxTree/flat.hpp"
 #include "../utilities.hpp"
 
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string_view>
+#include <vector>
 
 
 using namespace std::string_view_literals;
@@ -12,23 +17,87 @@ using namespace std::string_view_literals;
 
 /**
  * Outputs the AST of a source file to the standard output.
- * @param argc Number of command line arguments (expects 2).
- * @param argv Command line arguments. The second expected argument is the
- * source file to analyze.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments: any of the options
+ * "--format=<text|binary>" selecting whether the AST is printed or written
+ * as a binary AST file, "--input=<source|binary>" selecting whether the
+ * file analyzed is parsed or loaded as a binary AST file,
+ * "--lexer=<carburetta|direct>" selecting the generated scanner (the default)
+ * or the hand-written lexer, "--tokens=<path>" parsing the tokens of a binary
+ * token file written for the source rather than scanning it, and
+ * "--output=<path>" writing to a file rather than the standard output,
+ * followed by the path of the file to analyze. No binary AST file is written
+ * for a source that fails to parse.
  * @return Program exit status code.
  */
 int main(int argc, char** argv)
 {
-	if (argc == 1)
+	bool binary_out {false};
+	bool binary_in {false};
+	LexerKind lexer {LexerKind::Carburetta};
+	const char* tokens_path {nullptr};
+	const char* output_path {nullptr};
+	int first {1};
+	for (; first < argc; ++ first)
+	{
+		const std::string_view opt {argv[first]};
+		const std::string_view arg {opt.substr(opt.find('=') + 1)};
+		if (opt.starts_with("--format="sv))
+		{
+			if (arg != "text"sv && arg != "binary"sv)
+			{
+				std::cerr << "Invalid output format: "sv << arg << '\n';
+				return EXIT_FAILURE;
+			}
+			binary_out = arg == "binary"sv;
+		}
+		else if (opt.starts_with("--input="sv))
+		{
+			if (arg != "source"sv && arg != "binary"sv)
+			{
+				std::cerr << "Invalid input format: "sv << arg << '\n';
+				return EXIT_FAILURE;
+			}
+			binary_in = arg == "binary"sv;
+		}
+		else if (opt.starts_with("--lexer="sv))
+		{
+			if (arg != "carburetta"sv && arg != "direct"sv)
+			{
+				std::cerr << "Unknown lexer: "sv << arg << '\n';
+				return EXIT_FAILURE;
+			}
+			lexer = arg == "direct"sv
+				? LexerKind::Direct : LexerKind::Carburetta;
+		}
+		else if (opt.starts_with("--tokens="sv)) tokens_path = arg.data();
+		else if (opt.starts_with("--output="sv)) output_path = arg.data();
+		else break;
+	}
+
+	if (first >= argc)
 	{
 		std::cerr
-			<< "Missing source path. Correct usage: "sv
-			<< argv[0] << " <source file path>\n"sv;
+			<< "Missing source path. Correct usage: "sv << argv[0]
+			<< " [--format=<text|binary>] [--input=<source|binary>]"
+			" [--lexer=<carburetta|direct>] [--tokens=<token file path>]"
+			" [--output=<path>] <source file path>\n"sv;
+		return EXIT_FAILURE;
+	}
+	if (binary_in && tokens_path != nullptr)
+	{
+		std::cerr << "A binary AST file has no tokens to read.\n"sv;
 		return EXIT_FAILURE;
 	}
 
 	std::unique_ptr<TU> tu;
-	try { tu = std::make_unique<TU>(argv[1]); }
+	std::unique_ptr<TU> tokens_file;
+	try
+	{
+		tu = std::make_unique<TU>(argv[first]);
+		if (tokens_path != nullptr)
+			tokens_file = std::make_unique<TU>(tokens_path);
+	}
 	catch (std::runtime_error& e)
 	{
 		std::cerr << e.what() << '\n';
@@ -37,17 +106,57 @@ int main(int argc, char** argv)
 
 	carb_stack stack;
 	carb_stack_init(&stack);
-	carb_set_input(&stack, tu->_buf, tu->_size, tu->_end ? 1 : 0);
 	int status {EXIT_SUCCESS};
 	AST out;
 	
 	try
 	{
-		Parser::getAST(stack, *tu, out);
-		for (size_t i {0}; i < out.size(); ++ i)
-			out[i]->Print(std::cout, "	"sv);
+		if (binary_in) FlatAST::Load(*tu, out);
+		else
+		{
+			DiagnosticEngine diag {tu.get()};
+			bool parsed;
+			if (tokens_file != nullptr)
+			{
+				std::vector<Token> tokens;
+				TokenFile::load(*tokens_file,
+					std::string_view(tu->GetBuf(), tu->GetSize()), tokens);
+				parsed = Parser::parseTokens(stack, *tu, tokens, out, diag);
+			}
+			else parsed = Parser::getAST(stack, *tu, out, diag, lexer);
+			if (!parsed) status = EXIT_FAILURE;
+			diag.Render(std::cerr);
+		}
+
+		// A partial AST is printed, but never stored for later stages.
+		if (!binary_out || status == EXIT_SUCCESS)
+		{
+			// Opened in binary mode, so binary ASTs are written unaltered.
+			std::ofstream file;
+			if (output_path != nullptr)
+			{
+				file.open(output_path, std::ios::binary);
+				if (!file)
+					throw std::runtime_error("Cannot open the output file.");
+			}
+			else if (binary_out) setBinaryStdout();
+			std::ostream& os {file.is_open() ? file : std::cout};
+
+			if (binary_out) FlatAST {out}.Write(os);
+			else
+			{
+				for (size_t i {0}; i < out.size(); ++ i)
+					out[i]->Print(os, "	"sv);
+			}
+			os.flush();
+			if (!os) throw std::runtime_error("Failed to write the output.");
+		}
+	}
+	catch (std::runtime_error& e)
+	{
+		std::cerr << e.what() << '\n';
+		status = EXIT_FAILURE;
 	}
-	catch (std::runtime_error& e) { std::cerr << e.what() << '\n'; }
 
 	carb_stack_cleanup(&stack);
 	return status;
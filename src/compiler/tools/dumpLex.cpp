@@ -1,65 +1,187 @@
-#include "../parse.h"
+#include "../parser/lexer.hpp"
+#include "../parser/parserTools.hpp"
 #include "../utilities.hpp"
 
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
+
+
+using namespace std::string_view_literals;
+
+
+// Shortest time the throughput mode scans for, so short sources are timed
+// over many scans.
+static const std::chrono::milliseconds minBenchTime {500};
 
 
 /**
- * Outputs the lexemes of a source file to the standard output, one per line.
- * @param argc Number of command line arguments (expects 2).
- * @param argv Command line arguments. The second expected argument is the
- * source file to analyze.
+ * Outputs the lexemes of a source file, one per line, and reports the bytes
+ * that begin no token.
+ * @param tu Translation unit the tokens were scanned from.
+ * @param tokens Tokens of the source.
+ * @param os Stream to write to.
+ */
+static void printTokens(
+	const TU& tu, const std::vector<Token>& tokens, std::ostream& os)
+{
+	std::string out;
+	for (const Token& token : tokens)
+	{
+		const std::string_view text {tu.GetText(token._off, token._len)};
+		if (token._kind == TokenKind::Error)
+			std::cerr << "Unexpected token: "sv << text << '\n';
+		else
+		{
+			out.append(text);
+			out += '\n';
+		}
+	}
+	os.write(out.data(), static_cast<std::streamsize>(out.size()));
+}
+
+
+/**
+ * Outputs the lexemes of a source file.
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments: any of the options
+ * "--lexer=<carburetta|direct>" selecting the generated scanner (the
+ * default) or the hand-written lexer, "--tokens=<path>" reading the tokens
+ * from a binary token file written for the source rather than scanning it,
+ * "--format=<text|binary>" selecting whether the lexemes are printed one per
+ * line or written as a binary token file, "--output=<path>" writing to a file
+ * rather than the standard output, and "--throughput" scanning repeatedly
+ * and reporting the rate instead, followed by the path of the source file to
+ * analyze.
  * @return Program exit status code.
  */
 int main(int argc, char** argv)
 {
-	if (argc == 1)
+	bool direct {false};
+	const char* tokens_path {nullptr};
+	bool binary_out {false};
+	const char* output_path {nullptr};
+	bool throughput {false};
+	int first {1};
+	for (; first < argc; ++ first)
+	{
+		const std::string_view opt {argv[first]};
+		const std::string_view arg {opt.substr(opt.find('=') + 1)};
+		if (opt.starts_with("--lexer="sv))
+		{
+			if (arg != "carburetta"sv && arg != "direct"sv)
+			{
+				std::cerr << "Unknown lexer: "sv << arg << '\n';
+				return EXIT_FAILURE;
+			}
+			direct = arg == "direct"sv;
+		}
+		else if (opt.starts_with("--tokens="sv)) tokens_path = arg.data();
+		else if (opt.starts_with("--format="sv))
+		{
+			if (arg != "text"sv && arg != "binary"sv)
+			{
+				std::cerr << "Invalid output format: "sv << arg << '\n';
+				return EXIT_FAILURE;
+			}
+			binary_out = arg == "binary"sv;
+		}
+		else if (opt.starts_with("--output="sv)) output_path = arg.data();
+		else if (opt == "--throughput"sv) throughput = true;
+		else break;
+	}
+
+	if (first >= argc)
 	{
 		std::cerr
-			<< "Missing source path. Correct usage: "sv
-			<< argv[0] << " <source file path>\n"sv;
+			<< "Missing source path. Correct usage: "sv << argv[0]
+			<< " [--lexer=<carburetta|direct>] [--tokens=<token file path>]"
+			" [--format=<text|binary>] [--output=<path>] [--throughput]"
+			" <source file path>\n"sv;
 		return EXIT_FAILURE;
 	}
 
 	std::unique_ptr<TU> tu;
-	try { tu = std::make_unique<TU>(argv[1]); }
+	std::unique_ptr<TU> tokens_file;
+	try
+	{
+		tu = std::make_unique<TU>(argv[first]);
+		if (tokens_path != nullptr)
+			tokens_file = std::make_unique<TU>(tokens_path);
+	}
 	catch (std::runtime_error& e)
 	{
 		std::cerr << e.what() << '\n';
 		return EXIT_FAILURE;
 	}
 
-	carb_stack stack;
-	carb_stack_init(&stack);
-	carb_set_input(&stack, tu->_buf, tu->_size, 1);
+	const std::string_view src {tu->GetBuf(), tu->GetSize()};
+	std::vector<Token> tokens;
+	size_t runs {0};
+	const auto start {std::chrono::steady_clock::now()};
+	auto elapsed = [&start]()
+		{ return std::chrono::steady_clock::now() - start; };
+	try
+	{
+		do
+		{
+			tokens.clear();
+			if (tokens_file != nullptr)
+				TokenFile::load(*tokens_file, src, tokens);
+			else
+			{
+				Parser::scan(*tu,
+					direct ? LexerKind::Direct : LexerKind::Carburetta, tokens);
+			}
+			++ runs;
+		}
+		while (throughput && elapsed() < minBenchTime);
+	}
+	catch (std::runtime_error& e)
+	{
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
 
-	int status {EXIT_SUCCESS};
-	while (true)
+	const double seconds {std::chrono::duration<double>(elapsed()).count()
+		/ static_cast<double>(runs)};
+	try
 	{
-		switch (carb_lex(&stack))
+		// Opened in binary mode, so binary token files are written unaltered.
+		std::ofstream file;
+		if (output_path != nullptr)
 		{
-			case _CARB_MATCH:
-				if (stack.best_match_action_ > carbWhiteBound)
-					std::cout << carb_text(&stack) << '\n';
-				continue;
-			case _CARB_FEED_ME:
-				tu->ReadNext();
-				carb_set_input(&stack, tu->_buf, tu->_size, 1);
-				continue;
-			case _CARB_END_OF_INPUT:
-				break;
-			case _CARB_LEXICAL_ERROR:
-				std::cerr << "Unexpected token: "sv << carb_text(&stack) << '\n';
-				continue;
-			default:
-				std::cerr << "Encountered an unrecoverable error, aborting.\n"sv;
-				status = EXIT_FAILURE;
+			file.open(output_path, std::ios::binary);
+			if (!file) throw std::runtime_error("Cannot open the output file.");
 		}
-		break;
+		else if (binary_out && !throughput) setBinaryStdout();
+		std::ostream& os {file.is_open() ? file : std::cout};
+
+		if (throughput)
+		{
+			os
+				<< src.size() << " bytes, "sv << tokens.size()
+				<< " tokens in "sv << seconds * 1e3 << " ms per scan ("sv
+				<< runs << " scans): "sv
+				<< static_cast<double>(src.size()) / seconds / 1e6
+				<< " MB/s, "sv
+				<< static_cast<double>(tokens.size()) / seconds / 1e6
+				<< " M tokens/s\n"sv;
+		}
+		else if (binary_out) TokenFile::write(src, tokens, os);
+		else printTokens(*tu, tokens, os);
+		os.flush();
+		if (!os) throw std::runtime_error("Failed to write the output.");
+	}
+	catch (std::runtime_error& e)
+	{
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
 	}
-	
-	carb_stack_cleanup(&stack);
-	return status;
+
+	return EXIT_SUCCESS;
 }
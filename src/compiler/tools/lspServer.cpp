@@ -0,0 +1,398 @@
+#include "../document.hpp"
+#include "../json.hpp"
+#include "../parser/parser.h"
+#include "../syntaxTree/base.hpp"
+
+#include <charconv>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+
+// Documents open in the editor, keyed by URI.
+using DocumentMap = std::unordered_map<std::string, std::unique_ptr<Document>>;
+
+
+// Largest message content read; longer messages are skipped.
+static constexpr size_t maxMessageSize {64 << 20};
+
+
+/**
+ * Reads a message framed by a Content-Length header. A frame whose length is
+ * missing, malformed or over maxMessageSize is skipped, leaving the body
+ * empty.
+ * @param is Stream to read from.
+ * @param body Destination of the message's content.
+ * @return true if a frame was read; false at the end of the stream.
+ */
+static bool readMessage(std::istream& is, std::string& body)
+{
+	static const std::string_view length {"Content-Length:"sv};
+	size_t size {0};
+	bool valid {false};
+	std::string line;
+	while (std::getline(is, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty())
+		{
+			body.clear();
+			if (!valid) return true;
+			if (size > maxMessageSize)
+				return static_cast<bool>(is.ignore(size));
+			body.resize(size);
+			return static_cast<bool>(is.read(body.data(), size));
+		}
+
+		std::string_view header {line};
+		if (header.substr(0, length.size()) != length) continue;
+		header.remove_prefix(length.size());
+		while (!header.empty() && (header[0] == ' ' || header[0] == '\t'))
+			header.remove_prefix(1);
+		const char* last {header.data() + header.size()};
+		const std::from_chars_result res
+			{std::from_chars(header.data(), last, size)};
+		valid = res.ec == std::errc() && res.ptr == last;
+	}
+	return false;
+}
+
+
+/**
+ * Writes a message framed by a Content-Length header.
+ * @param os Stream to write to.
+ * @param msg The message.
+ */
+static void writeMessage(std::ostream& os, const JSONValue& msg)
+{
+	std::ostringstream body;
+	writeJSON(body, msg);
+	const std::string text {body.str()};
+	os << "Content-Length: "sv << text.size() << "\r\n\r\n"sv << text;
+	os.flush();
+}
+
+
+/**
+ * @param text UTF-8 text.
+ * @return Number of UTF-16 code units encoding the text.
+ */
+static size_t countUTF16(std::string_view text)
+{
+	size_t units {0};
+	for (char c : text)
+	{
+		const unsigned char byte {static_cast<unsigned char>(c)};
+		if ((byte & 0xC0) != 0x80) units += byte >= 0xF0 ? 2 : 1;
+	}
+	return units;
+}
+
+
+/**
+ * Converts an LSP position, whose character is counted in UTF-16 code units,
+ * to an offset in a source.
+ * @param tu The source.
+ * @param pos The position; may be nullptr.
+ * @return Offset of the character at the position, clamped to the source.
+ */
+static uint32_t toOffset(const TU& tu, const JSONValue* pos)
+{
+	if (pos == nullptr) return 0;
+	const JSONValue* line {pos->Get("line"sv)};
+	const JSONValue* character {pos->Get("character"sv)};
+	const int64_t row {line != nullptr ? line->GetInt() + 1 : 1};
+	if (row < 1) return 0;
+	if (static_cast<size_t>(row) > tu.GetLineCount())
+		return static_cast<uint32_t>(tu.GetSize());
+
+	const std::string_view text {tu.GetLine(static_cast<size_t>(row))};
+	const int64_t units {character != nullptr ? character->GetInt() : 0};
+	size_t i {0};
+	for (int64_t seen {0}; i < text.size() && seen < units;)
+	{
+		seen += countUTF16(text.substr(i, 1));
+		++ i;
+		while (i < text.size() && (text[i] & 0xC0) == 0x80) ++ i;
+	}
+	return static_cast<uint32_t>(text.data() - tu.GetBuf() + i);
+}
+
+
+/**
+ * Converts an offset in a source to an LSP position.
+ * @param tu The source.
+ * @param off The offset.
+ * @return The position.
+ */
+static JSONValue toPosition(const TU& tu, uint32_t off)
+{
+	const SourcePosition pos {tu.Locate(off)};
+	const std::string_view line {tu.GetLine(pos._row)};
+	JSONValue json;
+	json.Add("line"s, JSONValue::Number(pos._row - 1));
+	json.Add("character"s, JSONValue::Number(
+		countUTF16(line.substr(0, pos._col - 1))));
+	return json;
+}
+
+
+/**
+ * Converts a location in a source to an LSP range.
+ * @param tu The source.
+ * @param loc The location.
+ * @return The range.
+ */
+static JSONValue toRange(const TU& tu, const SourceLocation& loc)
+{
+	JSONValue json;
+	json.Add("start"s, toPosition(tu, loc._off));
+	json.Add("end"s, toPosition(tu, loc.GetEndOff()));
+	return json;
+}
+
+
+/**
+ * Sends the diagnostics of a document to the client. Notes become related
+ * information of the diagnostic they add detail to.
+ * @param os Stream to write to.
+ * @param uri URI of the document.
+ * @param doc The document.
+ */
+static void publishDiagnostics(
+	std::ostream& os, const std::string& uri, const Document& doc)
+{
+	const TU& tu {doc.GetTU()};
+	JSONValue diags;
+	diags._kind = JSONValue::Kind::Array;
+	for (const Diagnostic& diag : doc.GetDiagnosticEngine().GetDiagnostics())
+	{
+		const SourceLocation loc {diag._located ? diag._highlight
+			: SourceLocation {tu.GetID(), 0, 0}};
+		if (diag._severity == Severity::Note)
+		{
+			if (diags._items.empty()) continue;
+			JSONValue location;
+			location.Add("uri"s, JSONValue::String(uri));
+			location.Add("range"s, toRange(tu, loc));
+			JSONValue info;
+			info.Add("location"s, std::move(location));
+			info.Add("message"s, JSONValue::String(
+				DiagnosticEngine::GetMessage(diag)));
+			JSONValue& last {diags._items.back()};
+			// Related information is the last member once added.
+			if (last.Get("relatedInformation"sv) == nullptr)
+				last.Add("relatedInformation"s, JSONValue {});
+			last._items.back().Append(std::move(info));
+			continue;
+		}
+
+		JSONValue json;
+		json.Add("range"s, toRange(tu, loc));
+		json.Add("severity"s, JSONValue::Number(
+			diag._severity == Severity::Warning ? 2 : 1));
+		json.Add("code"s, JSONValue::String(
+			std::string(DiagnosticEngine::GetName(diag._id))));
+		json.Add("message"s, JSONValue::String(
+			DiagnosticEngine::GetMessage(diag)));
+		diags.Append(std::move(json));
+	}
+
+	JSONValue params;
+	params.Add("uri"s, JSONValue::String(uri));
+	params.Add("diagnostics"s, std::move(diags));
+	JSONValue msg;
+	msg.Add("jsonrpc"s, JSONValue::String("2.0"s));
+	msg.Add("method"s, JSONValue::String("textDocument/publishDiagnostics"s));
+	msg.Add("params"s, std::move(params));
+	writeMessage(os, msg);
+}
+
+
+/**
+ * @param params Parameters of a request or notification.
+ * @return URI of the text document the parameters name, or an empty string
+ * if they name none.
+ */
+static std::string getURI(const JSONValue* params)
+{
+	const JSONValue* doc {params->Get("textDocument"sv)};
+	const JSONValue* uri {doc != nullptr ? doc->Get("uri"sv) : nullptr};
+	return uri != nullptr ? uri->_string : std::string {};
+}
+
+
+/**
+ * Answers a hover or definition request.
+ * @param method Method of the request.
+ * @param params Parameters of the request.
+ * @param docs The open documents.
+ * @return Result of the request; null if there is nothing at the position.
+ */
+static JSONValue answer(
+	std::string_view method, const JSONValue* params, const DocumentMap& docs)
+{
+	const std::string uri {getURI(params)};
+	const auto it {docs.find(uri)};
+	if (it == docs.end()) return JSONValue {};
+	const Document& doc {*it->second};
+	const TU& tu {doc.GetTU()};
+	const uint32_t off {toOffset(tu, params->Get("position"sv))};
+
+	JSONValue result;
+	if (method == "textDocument/hover"sv)
+	{
+		std::string text;
+		SourceLocation loc;
+		if (!doc.Describe(off, text, loc)) return result;
+		JSONValue contents;
+		contents.Add("kind"s, JSONValue::String("plaintext"s));
+		contents.Add("value"s, JSONValue::String(std::move(text)));
+		result.Add("contents"s, std::move(contents));
+		result.Add("range"s, toRange(tu, loc));
+	}
+	else
+	{
+		const Declaration* decl {doc.FindDefinition(off)};
+		if (decl == nullptr) return result;
+		result.Add("uri"s, JSONValue::String(uri));
+		result.Add("range"s, toRange(tu, *decl->_name));
+	}
+	return result;
+}
+
+
+/**
+ * @return Result of the initialize request, describing what is served.
+ */
+static JSONValue initializeResult()
+{
+	JSONValue sync;
+	sync.Add("openClose"s, JSONValue::Bool(true));
+	sync.Add("change"s, JSONValue::Number(2));	// Incremental.
+	JSONValue capabilities;
+	capabilities.Add("textDocumentSync"s, std::move(sync));
+	capabilities.Add("hoverProvider"s, JSONValue::Bool(true));
+	capabilities.Add("definitionProvider"s, JSONValue::Bool(true));
+	JSONValue result;
+	result.Add("capabilities"s, std::move(capabilities));
+	return result;
+}
+
+
+/**
+ * Serves the Language Server Protocol over the standard input and output,
+ * providing diagnostics, hover and go-to-definition for the documents the
+ * client opens. Edits reparse and recheck only what they affect.
+ * @return Program exit status code: 0 if the client shut the server down
+ * before exiting; 1 otherwise.
+ */
+int main()
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	DocumentMap docs;
+	uint32_t next_id {0};
+	bool shutdown {false};
+	int status {EXIT_FAILURE};
+
+	const JSONValue none;
+	std::string body;
+	while (readMessage(std::cin, body))
+	{
+		JSONValue msg;
+		if (!parseJSON(body, msg)) continue;
+		const JSONValue* name {msg.Get("method"sv)};
+		const JSONValue* id {msg.Get("id"sv)};
+		const JSONValue* params {msg.Get("params"sv)};
+		if (params == nullptr) params = &none;
+		const std::string_view method
+			{name != nullptr ? name->_string : std::string_view {}};
+		if (method == "exit"sv)
+		{
+			status = shutdown ? EXIT_SUCCESS : EXIT_FAILURE;
+			break;
+		}
+
+		JSONValue result;
+		bool known {true};
+		try
+		{
+			if (method == "initialize"sv) result = initializeResult();
+			else if (method == "shutdown"sv) shutdown = true;
+			else if (method == "textDocument/didOpen"sv)
+			{
+				const std::string uri {getURI(params)};
+				const JSONValue* item {params->Get("textDocument"sv)};
+				const JSONValue* text
+					{item != nullptr ? item->Get("text"sv) : nullptr};
+				std::unique_ptr<Document>& doc {docs[uri]};
+				doc = std::make_unique<Document>(uri, next_id ++);
+				doc->Open(stack, text != nullptr ? text->_string : ""sv);
+				publishDiagnostics(std::cout, uri, *doc);
+			}
+			else if (method == "textDocument/didChange"sv)
+			{
+				const std::string uri {getURI(params)};
+				const JSONValue* changes {params->Get("contentChanges"sv)};
+				const auto it {docs.find(uri)};
+				if (it == docs.end() || changes == nullptr) continue;
+				Document& doc {*it->second};
+				// Each change is located in the text the previous ones left.
+				for (const JSONValue& change : changes->_items)
+				{
+					const JSONValue* text {change.Get("text"sv)};
+					const JSONValue* range {change.Get("range"sv)};
+					std::string str {text != nullptr ? text->_string : ""s};
+					if (range == nullptr)
+					{
+						doc.Open(stack, str);
+						continue;
+					}
+					const uint32_t start
+						{toOffset(doc.GetTU(), range->Get("start"sv))};
+					const uint32_t end
+						{toOffset(doc.GetTU(), range->Get("end"sv))};
+					doc.Edit(stack, {TextEdit {start,
+						end > start ? end - start : 0, std::move(str)}});
+				}
+				publishDiagnostics(std::cout, uri, doc);
+			}
+			else if (method == "textDocument/didClose"sv)
+				docs.erase(getURI(params));
+			else if (method == "textDocument/hover"sv
+				|| method == "textDocument/definition"sv)
+			{
+				result = answer(method, params, docs);
+			}
+			else known = false;
+		}
+		catch (std::exception& e) { std::cerr << e.what() << '\n'; }
+
+		// Notifications, which have no ID, are not answered.
+		if (id == nullptr) continue;
+		JSONValue reply;
+		reply.Add("jsonrpc"s, JSONValue::String("2.0"s));
+		reply.Add("id"s, *id);
+		if (known) reply.Add("result"s, std::move(result));
+		else
+		{
+			JSONValue error;
+			error.Add("code"s, JSONValue::Number(-32601));
+			error.Add("message"s, JSONValue::String("Method not found"s));
+			reply.Add("error"s, std::move(error));
+		}
+		writeMessage(std::cout, reply);
+	}
+
+	carb_stack_cleanup(&stack);
+	return status;
+}
@@ -1,53 +1,197 @@
 #include "utilities.hpp"
 
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <filesystem>
+#include <cstdio>
 #include <fstream>
+#include <iostream>
+#include <stdexcept>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define LANG_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
-void TokenInfo::SetSymbolInfo(TokenInfo info)
+#if defined(__unix__) || defined(__APPLE__)
+#define LANG_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+
+void SourceLocation::SetSymbolInfo(SourceLocation info)
 {
-	_row		= info._row;
-	_col		= info._col;
-	_off		= info._off;
-	_endOff		= info._endOff;
+	_file	= info._file;
+	_off	= info._off;
+	_len	= info._len;
 }
 
 
-void TokenInfo::SetMergedInfo(TokenInfo& i1, TokenInfo& i2)
+void SourceLocation::SetMergedInfo(SourceLocation& i1, SourceLocation& i2)
 {
-	TokenInfo& first {i1};
-	TokenInfo& second {i2};
-	if (i2._off < i1._off)
-	{
-		first = i2;
-		second = i1;
-	}
-	_row	= first._row;
-	_col	= first._col;
+	const SourceLocation& first {i2._off < i1._off ? i2 : i1};
+	const SourceLocation& second {i2._off < i1._off ? i1 : i2};
+	_file	= first._file;
 	_off	= first._off;
-	_endOff	= second._endOff;
+	_len	= second.GetEndOff() - first._off;
+}
+
+
+uint32_t SourceLocation::GetEndOff() const
+{
+	return _off + _len;
+}
+
+
+std::ostream& operator<<(std::ostream& os, SourcePosition pos)
+{
+	return os << '(' << pos._row << ", " << pos._col << ')';
 }
 
 
-TU::TU(const char* src_path)
+TU::TU(const char* src_path, uint32_t id)
+	: _id{id}, _path{src_path}
 {
-	_src.open(src_path, std::ios_base::in);
-	if (!_src)
+	std::ifstream src (src_path, std::ios_base::in | std::ios_base::binary);
+	if (!src)
 	{
 		std::string msg {"Failed to open source file: "};
 		msg.append(src_path);
 		throw std::runtime_error(msg);
 	}
 
-	_buf = std::make_unique<char[]>(_capacity);
-	ReadNext();
+	src.seekg(0, std::ios_base::end);
+	const std::streamoff end {src.tellg()};
+	src.seekg(0, std::ios_base::beg);
+	_size = end > 0 ? static_cast<size_t>(end) : 0;
+	if (_size > UINT32_MAX)
+	{
+		std::string msg {"Source file exceeds 4 GiB: "};
+		msg.append(src_path);
+		throw std::runtime_error(msg);
+	}
+
+#ifdef LANG_HAVE_MMAP
+	const int fd {_size > 0 ? open(src_path, O_RDONLY) : -1};
+	if (fd != -1)
+	{
+		void* map {mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0)};
+		if (map != MAP_FAILED)
+		{
+			madvise(map, _size, MADV_SEQUENTIAL);
+			_map = map;
+			_buf = static_cast<const char*>(map);
+		}
+		close(fd);
+	}
+#endif
+
+	if (_map == nullptr) ReadAll(src);
+	IndexLines();
 }
 
 
-char* TU::GetBuf() const
+TU::TU(std::string_view text, std::string_view src_path, uint32_t id)
+	: _size{text.size()}, _id{id}, _path{src_path}
 {
-	return _buf.get();
+	if (_size > UINT32_MAX)
+	{
+		std::string msg {"Source file exceeds 4 GiB: "};
+		msg.append(src_path);
+		throw std::runtime_error(msg);
+	}
+
+	_owned = std::make_unique<char[]>(_size + 1);
+	std::memcpy(_owned.get(), text.data(), _size);
+	_buf = _owned.get();
+	IndexLines();
+}
+
+
+TU::TU(const TU& src, const std::vector<TextEdit>& edits)
+	: TU(ApplyEdits(src, edits), src._path, src._id)
+{}
+
+
+TU::~TU()
+{
+#ifdef LANG_HAVE_MMAP
+	if (_map != nullptr) munmap(_map, _size);
+#endif
+}
+
+
+void TU::ReadAll(std::ifstream& src)
+{
+	_owned = std::make_unique<char[]>(_size + 1);
+	src.read(_owned.get(), static_cast<std::streamsize>(_size));
+	_size = static_cast<size_t>(src.gcount());
+	_buf = _owned.get();
+}
+
+
+std::string TU::ApplyEdits(const TU& src, const std::vector<TextEdit>& edits)
+{
+	std::string text;
+	size_t copied {0};
+	for (const TextEdit& edit : edits)
+	{
+		if (edit._off < copied || edit._off + size_t {edit._len} > src._size)
+			throw std::out_of_range("Invalid source edit.");
+		text.append(src._buf + copied, edit._off - copied);
+		text.append(edit._text);
+		copied = edit._off + size_t {edit._len};
+	}
+	text.append(src._buf + copied, src._size - copied);
+	return text;
+}
+
+
+void TU::IndexLines()
+{
+	_lineStarts.clear();
+	_lineStarts.push_back(0);
+	size_t i {0};
+
+#ifdef LANG_HAVE_SSE2
+	// Compare 16 bytes at a time and record the position of every set bit.
+	const __m128i newline {_mm_set1_epi8('\n')};
+	for (; i + 16 <= _size; i += 16)
+	{
+		const __m128i block {_mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(_buf + i))};
+		unsigned mask {static_cast<unsigned>(
+			_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)))};
+		while (mask != 0)
+		{
+			_lineStarts.push_back(i + std::countr_zero(mask) + 1);
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	while (i < _size)
+	{
+		const void* found {std::memchr(_buf + i, '\n', _size - i)};
+		if (found == nullptr) break;
+		i = static_cast<size_t>(static_cast<const char*>(found) - _buf) + 1;
+		_lineStarts.push_back(i);
+	}
+}
+
+
+const char* TU::GetBuf() const
+{
+	return _buf;
 }
 
 
@@ -57,45 +201,90 @@ size_t TU::GetSize() const
 }
 
 
+uint32_t TU::GetID() const
+{
+	return _id;
+}
+
+
+std::string_view TU::GetPath() const
+{
+	return _path;
+}
+
+
 bool TU::IsEnd() const
 {
-	return _end;
+	return true;
 }
 
 
 int TU::IsFinal() const
 {
-	return _end ? 1 : 0;
+	return 1;
 }
 
 
-void TU::ReadNext()
+bool TU::IsMapped() const
 {
-	_src.read(_buf.get(), _capacity);
-	_size = static_cast<size_t>(_src.gcount());
-	_end = _src.eof();
+	return _map != nullptr;
 }
 
 
-void TU::ReadFrom(size_t pos)
+std::string_view TU::GetText(size_t off, size_t len) const
 {
-	_src.seekg(pos);
-	ReadNext();
+	return std::string_view(_buf + off, len);
 }
 
 
-void TU::HighlightError(std::ostream& os, TokenInfo& info)
+size_t TU::GetLineCount() const
 {
-	const size_t line_start {info._off - info._col + 1ull};
-	ReadFrom(line_start);
-	os << '\t';
-	const size_t line_len {std::min(_size, (size_t) 256)};
-	for (size_t i {line_start}; _buf[i] != '\n' && i < line_len; ++ i)
-		os << _buf[i];
-	os << '\n' << '\t';
-	const size_t padding {static_cast<size_t>(info._col - 1)};
+	return _lineStarts.size();
+}
+
+
+SourcePosition TU::Locate(size_t off) const
+{
+	const auto next
+		{std::upper_bound(_lineStarts.begin(), _lineStarts.end(), off)};
+	const size_t row {static_cast<size_t>(next - _lineStarts.begin())};
+	return SourcePosition {row, off - _lineStarts[row - 1] + 1};
+}
+
+
+SourcePosition TU::Locate(const SourceLocation& loc) const
+{
+	return Locate(loc._off);
+}
+
+
+std::string_view TU::GetLine(size_t row) const
+{
+	const size_t start {_lineStarts[row - 1]};
+	size_t end {row < _lineStarts.size() ? _lineStarts[row] - 1 : _size};
+	if (end > start && _buf[end - 1] == '\r') -- end;
+	return std::string_view(_buf + start, end - start);
+}
+
+
+void TU::HighlightError(std::ostream& os, const SourceLocation& info) const
+{
+	const size_t max_len {256};
+	const SourcePosition pos {Locate(info._off)};
+	const std::string_view line {GetLine(pos._row).substr(0, max_len)};
+	os << '\t' << line << '\n' << '\t';
+	const size_t padding {std::min(pos._col - 1, line.size())};
 	for (size_t i {0}; i < padding; ++ i) os << ' ';
-	const size_t len {info._endOff - info._off};
-	for (size_t i {0}; i < std::min(len, 256 - padding - len); ++ i) os << '^';
+	const size_t len {std::min((size_t) info._len, max_len - padding)};
+	for (size_t i {0}; i < std::max(len, (size_t) 1); ++ i) os << '^';
 	os << '\n';
-};
+}
+
+
+void setBinaryStdout()
+{
+#ifdef _WIN32
+	std::cout.flush();
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+}
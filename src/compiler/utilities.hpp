@@ -1,96 +1,277 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
 #include <forward_list>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
+#include <system_error>
+#include <thread>
 #include <vector>
 
 
-// Stores the information necessary to locate a token in the TU buffer.
-struct TokenInfo
+// Compactly locates a token or a span of tokens in the source of a TU. Rows
+// and columns are only derived (from the TU's line index) when a diagnostic
+// needs them.
+struct SourceLocation
 {
-	int _row {1};		// Row at the start of the match.
-	int _col {1};		// Column at the start of the match.
-	size_t _off {0};	// Offset of the first character of the match.
-	size_t _endOff {0};	// Offset after the last character of the match.
+	uint32_t _file {0};	// ID of the TU containing the span.
+	uint32_t _off {0};	// Offset of the first character of the span.
+	uint32_t _len {0};	// Number of characters in the span.
 
 	/**
 	 * Convenience function to copy in the fields defined by this struct
-	 * from other instances of TokenInfo.
-	 * @param info An instance of TokenInfo whose values are to be copied to
-	 * this.
+	 * from other instances of SourceLocation.
+	 * @param info An instance of SourceLocation whose values are to be copied
+	 * to this.
 	 */
-	void SetSymbolInfo(TokenInfo info);
+	void SetSymbolInfo(SourceLocation info);
 
 	/**
 	 * Copies the fields defined by this struct from two other instance
 	 * such that the interval represented spans the intervals of both inputs.
-	 * @param i1 An instance of TokenInfo.
-	 * @param i2 An instance of TokenInfo.
+	 * @param i1 An instance of SourceLocation.
+	 * @param i2 An instance of SourceLocation.
 	 */
-	void SetMergedInfo(TokenInfo& i1, TokenInfo& i2);
+	void SetMergedInfo(SourceLocation& i1, SourceLocation& i2);
+
+	/**
+	 * @return Offset after the last character of the span.
+	 */
+	uint32_t GetEndOff() const;
+};
+
+
+// Human-readable position of a character in a TU's source.
+struct SourcePosition
+{
+	size_t _row {1};	// One-based line number.
+	size_t _col {1};	// One-based column number.
+};
+
+
+/**
+ * Writes a position in the format "(<row>, <column>)".
+ * @param os Stream to write to.
+ * @param pos Position to be written.
+ * @return The stream written to.
+ */
+std::ostream& operator<<(std::ostream& os, SourcePosition pos);
+
+
+// Replaces a span of a TU's source. Lists of edits are sorted by offset, do
+// not overlap, and are located in the source before any of them is applied.
+struct TextEdit
+{
+	uint32_t _off {0};	// Offset of the first character replaced.
+	uint32_t _len {0};	// Number of characters replaced.
+	std::string _text;	// Replacement text.
 };
 
 
-// Wraps a buffer to contain a TU's source.
+// Provides read-only access to the complete source of a TU. The file is
+// memory-mapped where the platform allows it and otherwise read into a single
+// buffer, so the scanner can be handed the whole source in one piece.
 class TU
 {
-	static const size_t _capacity {4096};	// Size of the buffer.
-	std::ifstream _src;						// Source file.
-	std::unique_ptr<char[]> _buf;			// TU's source buffer.
-	size_t _size;							// Bytes stored in the buffer.
-	bool _end {false}; // Indicates the EOF was reached in the last operation.
+	const char* _buf {nullptr};		// First byte of the TU's source.
+	size_t _size {0};				// Size of the source in bytes.
+	void* _map {nullptr};			// Mapping backing _buf, if mapped.
+	std::unique_ptr<char[]> _owned;	// Buffer backing _buf, if not mapped.
+	std::vector<size_t> _lineStarts;	// Offsets at which each line begins.
+	uint32_t _id {0};				// ID recorded in this TU's locations.
+	std::string _path;				// Path the source was read from.
+
+	/**
+	 * Reads the entire source file into _owned. Used when the file cannot be
+	 * memory-mapped.
+	 * @param src Source file, positioned at its beginning. Its size must
+	 * already be stored in _size.
+	 */
+	void ReadAll(std::ifstream& src);
+
+	// Populates _lineStarts from the source.
+	void IndexLines();
+
+	/**
+	 * Applies edits to the source of a TU.
+	 * @param src TU whose source is edited.
+	 * @param edits Edits to be applied, located in the source of src.
+	 * @return The edited source.
+	 * @throws std::out_of_range If an edit lies outside the source or the
+	 * edits are unsorted or overlap.
+	 */
+	static std::string ApplyEdits(
+		const TU& src, const std::vector<TextEdit>& edits);
 
 public:
 	/**
 	 * Construct a new TU object for the specified file.
 	 * @param src_path Path to the file to be represented by this object.
-	 * @throws std::runtime_error If the specified file could not be opened.
+	 * @param id ID recorded in the locations of tokens from this TU.
+	 * @throws std::runtime_error If the specified file could not be opened or
+	 * is too large to be addressed by a SourceLocation.
+	 */
+	TU(const char* src_path, uint32_t id = 0);
+
+	/**
+	 * Construct a new TU object holding a copy of the specified source.
+	 * @param text Source of the TU.
+	 * @param src_path Path reported as the source's origin.
+	 * @param id ID recorded in the locations of tokens from this TU.
+	 * @throws std::runtime_error If the source is too large to be addressed
+	 * by a SourceLocation.
+	 */
+	TU(std::string_view text, std::string_view src_path, uint32_t id = 0);
+
+	/**
+	 * Construct a new TU object holding an edited copy of another TU's
+	 * source, with the same path and ID.
+	 * @param src TU whose source is edited.
+	 * @param edits Edits to be applied, located in the source of src.
+	 * @throws std::out_of_range If an edit lies outside the source or the
+	 * edits are unsorted or overlap.
 	 */
-	TU(const char* src_path);
+	TU(const TU& src, const std::vector<TextEdit>& edits);
+
+	// Releases the mapping or buffer holding the source.
+	~TU();
+
+	TU(const TU&) = delete;
+	TU& operator=(const TU&) = delete;
 
 	/**
-	 * @return Pointer to the buffer.
+	 * @return Pointer to the first byte of the source.
 	 */
-	char* GetBuf() const;
+	const char* GetBuf() const;
 
 	/**
-	 * @return Number of bytes currently available in the buffer.
+	 * @return Size of the source in bytes.
 	 */
 	size_t GetSize() const;
 
 	/**
-	 * @return true if the end of the source was reached in the last operation;
-	 * false otherwise.
+	 * @return ID recorded in the locations of tokens from this TU.
+	 */
+	uint32_t GetID() const;
+
+	/**
+	 * @return Path the source was read from.
+	 */
+	std::string_view GetPath() const;
+
+	/**
+	 * @return true as the entire source is always available.
 	 */
 	bool IsEnd() const;
 
 	/**
-	 * @return 1 if the end of the source was reached in the last operation; 0
-	 * otherwise.
+	 * @return 1 as the entire source is always available.
 	 */
 	int IsFinal() const;
 
 	/**
-	 * Advances the buffer's position in the source file to the next available
-	 * data.
+	 * @return true if the source is backed by a memory mapping; false if it
+	 * was read into a buffer.
+	 */
+	bool IsMapped() const;
+
+	/**
+	 * Returns a view of the source without copying it. The view remains valid
+	 * for the lifetime of this object.
+	 * @param off Offset of the first character of the view.
+	 * @param len Number of characters in the view.
+	 * @return View of the requested characters.
+	 */
+	std::string_view GetText(size_t off, size_t len) const;
+
+	/**
+	 * @return Number of lines in the source.
+	 */
+	size_t GetLineCount() const;
+
+	/**
+	 * Converts an offset in the source to a row and column.
+	 * @param off Offset of a character in the source.
+	 * @return The row and column of the character.
+	 */
+	SourcePosition Locate(size_t off) const;
+
+	/**
+	 * Converts the start of a location in the source to a row and column.
+	 * @param loc Location in this TU's source.
+	 * @return The row and column of the location's first character.
 	 */
-	void ReadNext();
+	SourcePosition Locate(const SourceLocation& loc) const;
 
 	/**
-	 * Populates the buffer with the data a the specified offset in the source
-	 * file.
-	 * @param pos Offset to read from in the source file.
+	 * Returns a view of a line of the source, excluding its line terminator.
+	 * @param row One-based number of the line.
+	 * @return View of the line's characters.
 	 */
-	void ReadFrom(size_t pos);
+	std::string_view GetLine(size_t row) const;
 
 	/**
 	 * Outputs an error message that contains an erroneous line of code
 	 * and highlights which token causes the error.
 	 * @param os Stream to write the message to.
-	 * @param info Position information of the offending token.
+	 * @param info Location of the offending token.
 	 */
-	void HighlightError(std::ostream& os, TokenInfo& info);
+	void HighlightError(std::ostream& os, const SourceLocation& info) const;
 };
+
+
+/**
+ * Stops the standard output translating newlines on platforms that do, so
+ * binary data written to it arrives unaltered.
+ */
+void setBinaryStdout();
+
+
+/**
+ * Invokes a function once for every index in [0, count), distributing the
+ * indices over a pool of threads. The calling thread is one of the workers, so
+ * a single worker runs every index in order without starting a thread.
+ * @param count Number of indices.
+ * @param workers Maximum number of threads to use.
+ * @param fn Function taking an index. Invocations may run concurrently.
+ * @throws The first exception thrown by fn, once every thread has stopped.
+ * Once an invocation throws, no further indices are claimed.
+ */
+template <typename Fn>
+void parallelFor(size_t count, size_t workers, Fn&& fn)
+{
+	std::atomic<size_t> next {0};
+	std::exception_ptr error;
+	std::mutex error_lock;
+	auto work = [count, &next, &fn, &error, &error_lock]()
+	{
+		try
+		{
+			for (size_t i {next ++}; i < count; i = next ++) fn(i);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> guard {error_lock};
+			if (!error) error = std::current_exception();
+			next = count;
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (size_t i {1}; i < std::min(workers, count); ++ i)
+	{
+		// Run with the threads started so far if no more can be.
+		try { pool.emplace_back(work); }
+		catch (std::system_error&) { break; }
+	}
+	work();
+	for (std::thread& thread : pool) thread.join();
+	if (error) std::rethrow_exception(error);
+}
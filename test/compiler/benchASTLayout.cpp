@@ -0,0 +1,68 @@
+#include "syntaxTree/base.hpp"
+#include "syntaxTree/common.hpp"
+#include "syntaxTree/flat.hpp"
+#include "syntaxTree/globals.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+// Prints the size of a node class.
+#define PRINT_SIZE(T) std::printf("%-16s %4zu\n", #T, sizeof(T))
+
+
+/**
+ * Reports the size of every node class, then the arena memory used by the AST
+ * of a function one million lines long, each line of the form
+ * "int v<i> = v<i-1> + 1;", both as pointer-linked nodes and as a FlatAST.
+ * @return Program exit status code.
+ */
+int main()
+{
+	PRINT_SIZE(Identifier);
+	PRINT_SIZE(Parameter);
+	PRINT_SIZE(Function);
+	PRINT_SIZE(VariableDef);
+	PRINT_SIZE(IfStmt);
+	PRINT_SIZE(BreakStmt);
+	PRINT_SIZE(ReturnStmt);
+	PRINT_SIZE(LoopExpr);
+	PRINT_SIZE(CompoundStmt);
+	PRINT_SIZE(BinaryExpr);
+	PRINT_SIZE(UnaryExpr);
+	PRINT_SIZE(Invocation);
+	PRINT_SIZE(AssignmentExpr);
+	PRINT_SIZE(Variable);
+	PRINT_SIZE(IntLiteral);
+	PRINT_SIZE(BoolLiteral);
+	PRINT_SIZE(StrLiteral);
+
+	const size_t lines {1000000};
+	AST ast;
+	const Name one {ast._names.Intern("1")};
+	Name prev {ast._names.Intern("v")};
+	std::vector<Statement*> body;
+	for (size_t i {0}; i < lines; ++ i)
+	{
+		const Name name {ast._names.Intern("v" + std::to_string(i))};
+		Expression* expr {ast.Create<BinaryExpr>(ast.Create<Variable>(prev),
+			ast.Create<IntLiteral>(one), BinaryExpr::Ops::Add)};
+		body.push_back(ast.Create<VariableDef>(
+			ast._types.Int(), ast.Create<Identifier>(name), expr));
+		prev = name;
+	}
+	ast.emplace_back(ast.Create<Function>(
+		ast.Create<Identifier>(ast._names.Intern("main")),
+		Function::ParamList{}, ast._types.Int(), ast.CreateList(body)));
+
+	const size_t bytes {ast._arena.GetBytesUsed()};
+	std::printf("\n%zu lines: %zu AST bytes (%.1f per line)\n",
+		lines, bytes, static_cast<double>(bytes) / lines);
+
+	const FlatAST flat {ast};
+	const size_t flat_bytes {flat.GetBytesUsed()};
+	std::printf("%zu lines: %zu flat AST bytes (%.1f per line)\n",
+		lines, flat_bytes, static_cast<double>(flat_bytes) / lines);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "context.hpp"
+#include "parser/parser.h"
+#include "utilities.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+
+/**
+ * Writes a valid program of many functions, each a long chain of variable
+ * definitions with a loop calling the preceding function every 16 lines.
+ * @param path Path of the source file to write.
+ * @param functions Number of functions besides main.
+ * @param lines Number of variable definitions in each function.
+ */
+void writeProgram(const std::string& path, size_t functions, size_t lines)
+{
+	std::ofstream out (path);
+	for (size_t f {0}; f < functions; ++ f)
+	{
+		out << "f" << f << "(int a, int b) -> int\n{\n\tint v0 = a + b;\n";
+		for (size_t i {1}; i < lines; ++ i)
+		{
+			out << "\tint v" << i << " = v" << i - 1 << " * 3 - a;\n";
+			if (f == 0 || i % 16 != 0) continue;
+			const std::string k {"k" + std::to_string(i)};
+			out << "\tint " << k << " = 0;\n\tfor (" << k << " = 0; " << k
+				<< " < b; " << k << " = " << k << " + 1)\n\t{\n\t\tv" << i
+				<< " = f" << f - 1 << "(v" << i << ", " << k << ");\n\t};\n";
+		}
+		out << "\treturn v" << lines - 1 << ";\n}\n\n";
+	}
+	out << "main() -> int\n{\n\treturn f" << functions - 1 << "(1, 2);\n}\n";
+}
+
+
+/**
+ * Times a check of the whole program.
+ * @param ctx Context holding the parsed program.
+ * @param tu Translation unit the program was parsed from.
+ * @param fused Indicates the check is performed in a single traversal.
+ * @param ok Set to whether the check succeeded.
+ * @return Milliseconds taken by the check.
+ */
+double timeCheck(CompilerContext& ctx, TU& tu, bool fused, bool& ok)
+{
+	using Clock = std::chrono::steady_clock;
+	const Clock::time_point start {Clock::now()};
+	ok = fused ? ctx.CheckFused(tu) : ctx.Check(tu);
+	return std::chrono::duration<double, std::milli>(
+		Clock::now() - start).count();
+}
+
+
+/**
+ * Compares a serial check of a large program in separate scope resolution
+ * and validation passes against one in a single fused traversal, and
+ * confirms both report the same diagnostics.
+ * @return Program exit status code.
+ */
+int main()
+{
+	const size_t functions {2000};
+	const size_t lines {500};
+	const size_t reps {5};
+	const std::string path {(std::filesystem::temp_directory_path()
+		/ "bench_fused_check.lang").string()};
+	writeProgram(path, functions, lines);
+
+	carb_stack stack;
+	carb_stack_init(&stack);
+	TU tu (path.c_str());
+	CompilerContext separate, fused;
+	const bool parsed {separate.Parse(stack, tu) && fused.Parse(stack, tu)};
+	carb_stack_cleanup(&stack);
+	if (!parsed)
+	{
+		std::fprintf(stderr, "Parsing failed:\n%.*s",
+			static_cast<int>(separate.GetDiagnostics().size()),
+			separate.GetDiagnostics().data());
+		return EXIT_FAILURE;
+	}
+
+	// Checks are repeatable, so alternate them to share any warm-up.
+	double separate_ms {0}, fused_ms {0};
+	bool separate_ok {false}, fused_ok {false};
+	for (size_t r {0}; r < reps; ++ r)
+	{
+		separate_ms += timeCheck(separate, tu, false, separate_ok);
+		fused_ms += timeCheck(fused, tu, true, fused_ok);
+	}
+
+	std::printf("%zu functions of %zu lines\n", functions, lines);
+	std::printf("%-18s %10.2f ms\n", "Separate passes", separate_ms / reps);
+	std::printf("%-18s %10.2f ms\n", "Fused traversal", fused_ms / reps);
+	const bool agree {separate_ok == fused_ok
+		&& separate.GetDiagnostics() == fused.GetDiagnostics()};
+	std::printf("Diagnostics %s\n", agree ? "agree" : "DIFFER");
+	std::filesystem::remove(path);
+	return agree && separate_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,133 @@
+#include "syntaxTree/base.hpp"
+#include "syntaxTree/common.hpp"
+#include "syntaxTree/globals.hpp"
+#include "syntaxTree/visit.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/**
+ * Times a pass of a classifier over every node.
+ * @param nodes Nodes to be classified.
+ * @param classify Returns 1 for the nodes being counted; 0 otherwise.
+ * @param count Set to the number of nodes counted.
+ * @return Nanoseconds per node.
+ */
+template <typename Node, typename Classify>
+double timePass(
+	const std::vector<Node*>& nodes, Classify classify, size_t& count)
+{
+	using Clock = std::chrono::steady_clock;
+	const size_t reps {8};
+	count = 0;
+	Clock::time_point start {Clock::now()};
+	for (size_t r {0}; r < reps; ++ r)
+		for (Node* node : nodes) count += classify(node);
+	count /= reps;
+	return std::chrono::duration<double, std::nano>(
+		Clock::now() - start).count() / (nodes.size() * reps);
+}
+
+
+/**
+ * Compares dynamic_cast against kind-tag dispatch over a large AST for the
+ * casts made by scope resolution and code generation, and for a dispatch over
+ * every concrete class.
+ * @return Program exit status code.
+ */
+int main()
+{
+	const size_t node_count {1 << 20};
+
+	AST ast;
+	Type* type {ast._types.Int()};
+	std::vector<Declaration*> decls;
+	std::vector<SyntaxTreeNode*> nodes;
+	for (size_t i {0}; i < node_count; ++ i)
+	{
+		Name name {ast._names.Intern("n" + std::to_string(i))};
+		Identifier* id {ast.Create<Identifier>(name)};
+		Expression* lit {ast.Create<IntLiteral>(name)};
+		switch (i % 4)
+		{
+		case 0:
+			decls.push_back(ast.Create<VariableDef>(type, id, lit));
+			break;
+		case 1:
+			decls.push_back(ast.Create<Parameter>(type, id));
+			break;
+		case 2:
+			decls.push_back(ast.Create<Function>(
+				id, Function::ParamList{}, type, StmtList{}));
+			break;
+		default:
+			nodes.push_back(ast.Create<BinaryExpr>(
+				lit, lit, BinaryExpr::Ops::Add));
+			nodes.push_back(lit);
+			continue;
+		}
+		nodes.push_back(decls.back());
+	}
+
+	size_t expected {0}, found {0};
+	bool agree {true};
+	std::printf("%-34s %14s %14s\n", "", "dynamic_cast", "kind tag");
+
+	double rtti {timePass(decls, [](Declaration* decl)
+		{ return dynamic_cast<Function*>(decl) != nullptr; }, expected)};
+	double tag {timePass(decls, [](Declaration* decl)
+		{ return isa<Function>(decl); }, found)};
+	agree = agree && expected == found;
+	std::printf("%-34s %11.2f ns %11.2f ns\n",
+		"Declaration is Function", rtti, tag);
+
+	rtti = timePass(decls, [](Declaration* decl)
+		{ return dynamic_cast<VariableDef*>(decl) != nullptr; }, expected);
+	tag = timePass(decls, [](Declaration* decl)
+		{ return dyn_cast<VariableDef>(decl) != nullptr; }, found);
+	agree = agree && expected == found;
+	std::printf("%-34s %11.2f ns %11.2f ns\n",
+		"Declaration to VariableDef", rtti, tag);
+
+	rtti = timePass(nodes, [](SyntaxTreeNode* node)
+		{ return dynamic_cast<VariableDef*>(node) != nullptr; }, expected);
+	tag = timePass(nodes, [](SyntaxTreeNode* node)
+		{ return isa<VariableDef>(node); }, found);
+	agree = agree && expected == found;
+	std::printf("%-34s %11.2f ns %11.2f ns\n",
+		"SyntaxTreeNode is VariableDef", rtti, tag);
+
+	rtti = timePass(nodes, [](SyntaxTreeNode* node) -> size_t
+		{
+			if (dynamic_cast<VariableDef*>(node)) return 1;
+			if (dynamic_cast<Function*>(node)) return 2;
+			if (dynamic_cast<BinaryExpr*>(node)) return 3;
+			if (dynamic_cast<IntLiteral*>(node)) return 4;
+			return 0;
+		}, expected);
+	tag = timePass(nodes, [](SyntaxTreeNode* node) -> size_t
+		{
+			return visit(node, [](auto& n) -> size_t
+			{
+				using T = std::remove_reference_t<decltype(n)>;
+				if constexpr (std::is_same_v<T, VariableDef>) return 1;
+				else if constexpr (std::is_same_v<T, Function>) return 2;
+				else if constexpr (std::is_same_v<T, BinaryExpr>) return 3;
+				else if constexpr (std::is_same_v<T, IntLiteral>) return 4;
+				else return 0;
+			});
+		}, found);
+	agree = agree && expected == found;
+	std::printf("%-34s %11.2f ns %11.2f ns\n",
+		"Dispatch on concrete class", rtti, tag);
+
+	if (!agree)
+	{
+		std::fprintf(stderr, "Kind tags disagree with dynamic_cast.\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+#include "diagnostics.hpp"
+#include "parser/parser.h"
+#include "parser/parserTools.hpp"
+#include "syntaxTree/base.hpp"
+#include "utilities.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+
+/**
+ * Writes a valid program of many functions, each a chain of variable
+ * definitions calling the preceding function.
+ * @param functions Number of functions.
+ * @param lines Number of variable definitions in each function.
+ * @return Source of the program.
+ */
+std::string writeProgram(size_t functions, size_t lines)
+{
+	std::ostringstream out;
+	for (size_t f {0}; f < functions; ++ f)
+	{
+		out << "f" << f << "(int a) -> int\n{\n\tint v0 = a;\n";
+		for (size_t i {1}; i < lines; ++ i)
+		{
+			out << "\tint v" << i << " = f" << (f == 0 ? 0 : f - 1) << "(v"
+				<< i - 1 << ") * 3;\n";
+		}
+		out << "\treturn v" << lines - 1 << ";\n}\n\n";
+	}
+	return out.str();
+}
+
+
+/**
+ * @param ast An AST.
+ * @return Textual representation of the whole AST.
+ */
+std::string printAST(AST& ast)
+{
+	std::ostringstream out;
+	for (SyntaxTreeNode* node : ast) node->Print(out, "  "sv);
+	return out.str();
+}
+
+
+/**
+ * Compares reparsing a large program after a single-line edit near its start,
+ * middle and end against parsing it in full, and confirms both produce the
+ * same AST.
+ * @return Program exit status code.
+ */
+int main()
+{
+	using Clock = std::chrono::steady_clock;
+	const size_t functions {2500};
+	const size_t lines {16};
+	const size_t reps {10};
+	const std::string src {writeProgram(functions, lines)};
+
+	carb_stack stack;
+	carb_stack_init(&stack);
+	TU tu {src, "bench_reparse.lang"sv};
+	AST ast;
+	DiagnosticEngine diag {&tu};
+	const Clock::time_point start {Clock::now()};
+	bool ok {Parser::getAST(stack, tu, ast, diag)};
+	const double full_ms {std::chrono::duration<double, std::milli>(
+		Clock::now() - start).count()};
+	std::printf("%zu lines\n", tu.GetLineCount());
+	std::printf("%-18s %10.3f ms\n", "Full parse", full_ms);
+
+	// Each edit is undone by the next, so every rep starts from src.
+	for (const double where : {0.01, 0.5, 0.99})
+	{
+		const uint32_t off {static_cast<uint32_t>(
+			src.find(") * 3;"sv, static_cast<size_t>(src.size() * where)))};
+		const std::vector<TextEdit> edit {{off + 4, 1, "42"}};
+		const std::vector<TextEdit> undo {{off + 4, 2, "3"}};
+		double reparse_ms {0};
+		for (size_t r {0}; r < reps && ok; ++ r)
+		{
+			TU edited {tu, edit};
+			Clock::time_point begin {Clock::now()};
+			ok = Parser::reparse(stack, tu, edited, ast, edit, diag);
+			reparse_ms += std::chrono::duration<double, std::milli>(
+				Clock::now() - begin).count();
+
+			TU undone {edited, undo};
+			begin = Clock::now();
+			ok = ok && Parser::reparse(stack, edited, undone, ast, undo, diag);
+			reparse_ms += std::chrono::duration<double, std::milli>(
+				Clock::now() - begin).count();
+		}
+		std::printf("Reparse at %3.0f%%    %10.3f ms\n", where * 100,
+			reparse_ms / (2 * reps));
+	}
+
+	AST full;
+	ok = ok && Parser::getAST(stack, tu, full, diag);
+	carb_stack_cleanup(&stack);
+	diag.Render(std::cerr);
+	const bool agree {ok && printAST(ast) == printAST(full)};
+	std::printf("ASTs %s\n", agree ? "agree" : "DIFFER");
+	return agree ? EXIT_SUCCESS : EXIT_FAILURE;
+}
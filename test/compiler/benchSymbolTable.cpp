@@ -0,0 +1,87 @@
+#include "syntaxTree/base.hpp"
+#include "syntaxTree/globals.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/**
+ * Measures SymbolTable lookups of globals and innermost locals at increasing
+ * scope depths. Each scope defines a few locals, as nested compound
+ * statements do. Lookup cost should stay flat as the depth grows.
+ * @return Program exit status code.
+ */
+int main()
+{
+	using Clock = std::chrono::steady_clock;
+	const size_t global_count {64};
+	const size_t locals_per_scope {4};
+	const size_t lookups {4000000};
+	const size_t depths[] {1, 8, 64, 512, 4096, 32768};
+
+	AST ast;
+	Type* type {ast._types.Int()};
+	std::vector<Parameter*> globals;
+	for (size_t i {0}; i < global_count; ++ i)
+	{
+		Name name {ast._names.Intern("g" + std::to_string(i))};
+		globals.push_back(ast.Create<Parameter>(
+			type, ast.Create<Identifier>(name)));
+	}
+
+	std::printf("%8s %16s %16s %16s\n",
+		"depth", "global ns/op", "local ns/op", "exit ns/scope");
+	for (size_t depth : depths)
+	{
+		SymbolTable symbols;
+		symbols.Enter();
+		for (Parameter* param : globals)
+			symbols.Define(param->_name->_id, param);
+
+		std::vector<Name> locals;
+		for (size_t d {0}; d < depth; ++ d)
+		{
+			symbols.Enter();
+			locals.clear();
+			for (size_t k {0}; k < locals_per_scope; ++ k)
+			{
+				Name name {ast._names.Intern(
+					"l" + std::to_string(d) + "_" + std::to_string(k))};
+				symbols.Define(name,
+					ast.Create<Parameter>(type, ast.Create<Identifier>(name)));
+				locals.push_back(name);
+			}
+		}
+
+		size_t found {0};
+		Clock::time_point start {Clock::now()};
+		for (size_t i {0}; i < lookups; ++ i)
+			found += symbols.Lookup(globals[i % global_count]->_name->_id)
+				!= nullptr;
+		const double global_ns {std::chrono::duration<double, std::nano>(
+			Clock::now() - start).count() / lookups};
+
+		start = Clock::now();
+		for (size_t i {0}; i < lookups; ++ i)
+			found += symbols.Lookup(locals[i % locals_per_scope]) != nullptr;
+		const double local_ns {std::chrono::duration<double, std::nano>(
+			Clock::now() - start).count() / lookups};
+
+		start = Clock::now();
+		for (size_t d {0}; d < depth; ++ d) symbols.Exit();
+		const double exit_ns {std::chrono::duration<double, std::nano>(
+			Clock::now() - start).count() / depth};
+
+		if (found != lookups * 2)
+		{
+			std::fprintf(stderr, "Lookup failed at depth %zu.\n", depth);
+			return EXIT_FAILURE;
+		}
+		std::printf("%8zu %16.2f %16.2f %16.2f\n",
+			depth, global_ns, local_ns, exit_ns);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+#include "gtest/gtest.h"
+
+#include "cache.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+
+// Test fixture providing an empty cache directory.
+class CacheTest
+	: public testing::Test
+{
+protected:
+	const fs::path _dir {fs::path(testing::TempDir()) / "compile_cache"};
+
+	CacheTest()
+	{
+		fs::remove_all(_dir);
+	}
+
+	~CacheTest()
+	{
+		fs::remove_all(_dir);
+	}
+
+	/**
+	 * @param key Key of an entry.
+	 * @return Path of the entry's file.
+	 */
+	fs::path PathOf(std::string_view key) const
+	{
+		return _dir / std::string(key.substr(0, 2))
+			/ (std::string(key) + ".entry");
+	}
+
+	/**
+	 * Marks an entry as last used some time ago.
+	 * @param key Key of the entry.
+	 * @param hours Number of hours ago.
+	 */
+	void Age(std::string_view key, int hours) const
+	{
+		fs::last_write_time(PathOf(key),
+			fs::file_time_type::clock::now() - std::chrono::hours {hours});
+	}
+};
+
+
+// Keys depend on every input, and a stored result is found as it was stored.
+TEST_F(CacheTest, StoreAndFind)
+{
+	const std::string key {CompileCache::Key("v1"sv, "a.lang"sv, "x"sv)};
+	EXPECT_EQ(64, key.size());
+	EXPECT_EQ(key, CompileCache::Key("v1"sv, "a.lang"sv, "x"sv));
+	EXPECT_NE(key, CompileCache::Key("v2"sv, "a.lang"sv, "x"sv));
+	EXPECT_NE(key, CompileCache::Key("v1"sv, "b.lang"sv, "x"sv));
+	EXPECT_NE(key, CompileCache::Key("v1"sv, "a.lang"sv, "y"sv));
+	EXPECT_NE(key, CompileCache::Key("v1a"sv, ".lang"sv, "x"sv))
+		<< "Expected the inputs to be kept apart.";
+
+	CompileCache cache {_dir, 1 << 20};
+	CompileCache::Entry entry;
+	EXPECT_FALSE(cache.Find(key, entry));
+	cache.Store(key, CompileCache::Entry {"output\n", "error\n", 1});
+	ASSERT_TRUE(cache.Find(key, entry));
+	EXPECT_EQ("output\n", entry._out);
+	EXPECT_EQ("error\n", entry._err);
+	EXPECT_EQ(1, entry._status);
+
+	const CompileCache::Stats stats {cache.GetStats()};
+	EXPECT_EQ(1, stats._hits);
+	EXPECT_EQ(1, stats._misses);
+	EXPECT_EQ(1, stats._stores);
+	EXPECT_EQ(0, stats._evictions);
+}
+
+
+// Exceeding the size bound removes the least recently used entries, where
+// finding an entry counts as using it.
+TEST_F(CacheTest, Evict_LeastRecentlyUsed)
+{
+	const std::string out (100, 'o');
+	const uint64_t size {24 + out.size()};	// Entry header and output.
+	CompileCache cache {_dir, 3 * size + size / 2};
+	const std::string keys[] {"a", "b", "c", "d"};
+	for (int i {0}; i < 3; ++ i)
+	{
+		cache.Store(keys[i], CompileCache::Entry {out, "", 0});
+		Age(keys[i], 3 - i);
+	}
+
+	CompileCache::Entry entry;
+	ASSERT_TRUE(cache.Find("a"sv, entry));
+	cache.Store("d"sv, CompileCache::Entry {out, "", 0});
+	EXPECT_TRUE(fs::exists(PathOf("a"sv)));
+	EXPECT_FALSE(fs::exists(PathOf("b"sv)))
+		<< "Expected the least recently used entry to be evicted.";
+	EXPECT_TRUE(fs::exists(PathOf("c"sv)));
+	EXPECT_TRUE(fs::exists(PathOf("d"sv)));
+	EXPECT_EQ(1, cache.GetStats()._evictions);
+}
+
+
+// The size of the entries is estimated across caches over the directory, so
+// a store within the bound does not measure them, and one exceeding it evicts.
+TEST_F(CacheTest, Evict_EstimateShared)
+{
+	const std::string out (100, 'o');
+	const uint64_t size {24 + out.size()};	// Entry header and output.
+	{
+		CompileCache cache {_dir, 2 * size + size / 2};
+		cache.Store("a"sv, CompileCache::Entry {out, "", 0});
+		Age("a"sv, 2);
+	}
+
+	// An abandoned temporary file is only removed when the entries are
+	// measured.
+	const fs::path temp {_dir / "abandoned.tmp1.0"};
+	std::ofstream {temp} << "partial";
+	fs::last_write_time(temp,
+		fs::file_time_type::clock::now() - std::chrono::hours {2});
+
+	CompileCache cache {_dir, 2 * size + size / 2};
+	cache.Store("b"sv, CompileCache::Entry {out, "", 0});
+	EXPECT_TRUE(fs::exists(temp))
+		<< "Expected a store within the bound not to measure the entries.";
+	cache.Store("c"sv, CompileCache::Entry {out, "", 0});
+	EXPECT_FALSE(fs::exists(temp));
+	EXPECT_FALSE(fs::exists(PathOf("a"sv)))
+		<< "Expected the entry stored by another cache to count.";
+	EXPECT_TRUE(fs::exists(PathOf("b"sv)));
+	EXPECT_TRUE(fs::exists(PathOf("c"sv)));
+	EXPECT_EQ(1, cache.GetStats()._evictions);
+}
+
+
+// A damaged entry is a miss, and is removed.
+TEST_F(CacheTest, Find_DamagedEntry)
+{
+	CompileCache cache {_dir, 1 << 20};
+	cache.Store("k"sv, CompileCache::Entry {"output", "error", 0});
+	fs::resize_file(PathOf("k"sv), fs::file_size(PathOf("k"sv)) - 1);
+	CompileCache::Entry entry;
+	EXPECT_FALSE(cache.Find("k"sv, entry));
+	EXPECT_FALSE(fs::exists(PathOf("k"sv)));
+}
+
+
+// Caches sharing a directory, as concurrent compiler processes do, only ever
+// find complete entries while others replace and evict them.
+TEST_F(CacheTest, Concurrent_CompleteEntries)
+{
+	const size_t threads {8};
+	const size_t rounds {200};
+	// The bound holds about half the entries, so they are evicted often.
+	CompileCache first {_dir, 32 << 10};
+	CompileCache second {_dir, 32 << 10};
+	std::vector<std::thread> pool;
+	std::vector<size_t> bad (threads, 0);
+	for (size_t t {0}; t < threads; ++ t)
+	{
+		pool.emplace_back([&, t]()
+		{
+			CompileCache& cache {t % 2 == 0 ? first : second};
+			for (size_t i {0}; i < rounds; ++ i)
+			{
+				const std::string key {std::to_string((i * 7 + t) % 32)};
+				// An entry's contents are determined by its key.
+				const std::string out (1000 + key.size() * 512, key[0]);
+				CompileCache::Entry entry;
+				if (cache.Find(key, entry))
+				{
+					if (entry._out != out || entry._err != key) ++ bad[t];
+				}
+				else cache.Store(key, CompileCache::Entry {out, key, 0});
+			}
+		});
+	}
+	for (std::thread& thread : pool) thread.join();
+
+	for (size_t t {0}; t < threads; ++ t) EXPECT_EQ(0, bad[t]);
+	for (const fs::directory_entry& file
+		: fs::recursive_directory_iterator {_dir})
+	{
+		EXPECT_EQ(std::string::npos, file.path().string().find(".tmp"))
+			<< "Temporary file left behind: " << file.path();
+	}
+}
@@ -0,0 +1,797 @@
+#include "gtest/gtest.h"
+
+#include "context.hpp"
+#include "parser/parser.h"
+#include "parser/parserTools.hpp"
+#include "syntaxTree/base.hpp"
+#include "syntaxTree/flat.hpp"
+#include "utilities.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LANG_HAVE_RUSAGE
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std::string_view_literals;
+
+
+// Result of compiling one source file in its own context.
+struct Result
+{
+	bool _parsed {false};	// Indicates parsing succeeded.
+	bool _checked {false};	// Indicates checking succeeded.
+	std::string _diag;		// Diagnostics reported.
+	std::string _json;		// Diagnostics reported, as JSON Lines.
+	size_t _globals {0};	// Number of top-level nodes.
+};
+
+
+// Source files compiled by the tests, with errors of different passes. The
+// last has a type error preceding a scope error, which alone is reported.
+const char* const sources[] {
+	"@TESTDATADIR@/testContext/valid.lang",
+	"@TESTDATADIR@/testContext/type_errors.lang",
+	"@TESTDATADIR@/testContext/scope_errors.lang",
+	"@TESTDATADIR@/testContext/order_errors.lang",
+	"@TESTDATADIR@/testContext/mixed_errors.lang",
+};
+
+
+/**
+ * Compiles a source file in a fresh context.
+ * @param stack Parser stack to use.
+ * @param src_path Path to the source file.
+ * @param workers Maximum number of threads to check the source file with.
+ * @param fused Indicates the source file is checked in a single traversal.
+ * @param error_limit Number of errors after which the compilation stops; 0
+ * for no limit.
+ * @return Result of the compilation.
+ */
+Result compile(carb_stack& stack, const char* src_path, size_t workers = 1,
+	bool fused = false, size_t error_limit = 0)
+{
+	TU tu (src_path);
+	CompilerContext ctx {error_limit};
+	Result res;
+	res._parsed = ctx.Parse(stack, tu);
+	if (res._parsed)
+		res._checked = fused ? ctx.CheckFused(tu) : ctx.Check(tu, workers);
+	res._diag = ctx.GetDiagnostics();
+	std::ostringstream json;
+	ctx.GetDiagnosticEngine().RenderJSON(json);
+	res._json = json.str();
+	res._globals = ctx.GetAST().size();
+	return res;
+}
+
+
+#ifdef LANG_HAVE_RUSAGE
+/**
+ * @return Peak resident set size of the process so far, in bytes.
+ */
+size_t peakRSS()
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return static_cast<size_t>(usage.ru_maxrss);	// Already in bytes.
+#else
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+
+/**
+ * Runs a function in a child process, whose peak memory starts from what
+ * the process holds rather than what the tests before it once held.
+ * @param fn Function to run.
+ * @return Growth of the child's peak resident set size while running fn, in
+ * bytes; SIZE_MAX if the child failed.
+ */
+size_t childPeakGrowth(const std::function<void()>& fn)
+{
+	int fds[2];
+	if (pipe(fds) != 0) return SIZE_MAX;
+	const pid_t pid {fork()};
+	if (pid == 0)
+	{
+		close(fds[0]);
+		const size_t before {peakRSS()};
+		fn();
+		const size_t growth {peakRSS() - before};
+		const bool written {write(fds[1], &growth, sizeof(growth))
+			== static_cast<ssize_t>(sizeof(growth))};
+		_exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	close(fds[1]);
+	size_t growth {SIZE_MAX};
+	if (pid < 0 || read(fds[0], &growth, sizeof(growth))
+		!= static_cast<ssize_t>(sizeof(growth))) growth = SIZE_MAX;
+	close(fds[0]);
+	if (pid > 0) waitpid(pid, nullptr, 0);
+	return growth;
+}
+#endif
+
+
+// Result of resolving and validating one source file.
+struct Passes
+{
+	bool _success {false};	// Indicates both passes succeeded.
+	std::string _diag;		// Diagnostics reported.
+	std::string _printed;	// AST printed after the passes.
+};
+
+
+/**
+ * Parses a source file, then resolves and validates its globals in order,
+ * validating only once resolution succeeded, with the passes of either the
+ * pointer-linked nodes or a flat copy of the AST.
+ * @param stack Parser stack to use.
+ * @param tu Source file.
+ * @param flat Indicates the passes of a flat copy are run.
+ * @param indent Unit of indentation the AST is printed with.
+ * @return Result of the passes.
+ */
+Passes runPasses(
+	carb_stack& stack, TU& tu, bool flat, std::string_view indent = "  "sv)
+{
+	AST ast;
+	DiagnosticEngine diag {&tu};
+	Passes res;
+	std::ostringstream os;
+	if (!Parser::getAST(stack, tu, ast, diag))
+	{
+		res._diag = diag.ToString();
+		return res;
+	}
+	if (flat)
+	{
+		FlatAST copy {ast};
+		res._success = copy.Scope(tu, diag) && copy.Validate(tu, diag);
+		copy.Print(os, indent);
+	}
+	else
+	{
+		SymbolTable symbols;
+		symbols.Enter();
+		ScopeData scope {&tu, diag};
+		res._success = true;
+		for (SyntaxTreeNode* node : ast)
+			res._success = node->Scope(symbols, scope) && res._success;
+		if (res._success)
+		{
+			ValidateData dat {&tu, &ast._types, diag};
+			for (SyntaxTreeNode* node : ast)
+				res._success = node->Validate(dat) && res._success;
+		}
+		for (SyntaxTreeNode* node : ast) node->Print(os, indent);
+	}
+	res._diag = diag.ToString();
+	res._printed = os.str();
+	return res;
+}
+
+
+/**
+ * Runs the passes of the pointer-linked nodes over a source, expecting the
+ * passes of a flat AST to agree with them.
+ * @param text The source.
+ * @return Result of the passes of the nodes.
+ */
+Passes checkSource(std::string_view text)
+{
+	TU tu {text, "source.lang"sv};
+	carb_stack stack;
+	carb_stack_init(&stack);
+	const Passes nodes {runPasses(stack, tu, false)};
+	const Passes flat {runPasses(stack, tu, true)};
+	carb_stack_cleanup(&stack);
+	EXPECT_TRUE(nodes._success == flat._success && nodes._diag == flat._diag
+		&& nodes._printed == flat._printed)
+		<< "The flat passes disagree on:\n" << text;
+	return nodes;
+}
+
+
+// Each source file is diagnosed as expected by a single context.
+TEST(ContextTest, Check_Diagnostics)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	const Result valid {compile(stack, sources[0])};
+	const Result type_errors {compile(stack, sources[1])};
+	const Result scope_errors {compile(stack, sources[2])};
+	const Result order_errors {compile(stack, sources[3])};
+	const Result mixed_errors {compile(stack, sources[4])};
+	carb_stack_cleanup(&stack);
+
+	EXPECT_TRUE(valid._parsed && valid._checked)
+		<< "Unexpected errors in a valid program:\n" << valid._diag;
+	EXPECT_TRUE(valid._diag.empty())
+		<< "Unexpected diagnostics for a valid program.";
+	EXPECT_EQ(2, valid._globals)
+		<< "Incorrect number of top-level AST nodes.";
+
+	EXPECT_TRUE(type_errors._parsed && !type_errors._checked)
+		<< "Expected type errors to fail the check.";
+	EXPECT_NE(std::string::npos, type_errors._diag.find("initializer"))
+		<< "Expected an initializer type error.";
+
+	EXPECT_TRUE(scope_errors._parsed && !scope_errors._checked)
+		<< "Expected scope errors to fail the check.";
+	EXPECT_NE(std::string::npos, scope_errors._diag.find("Symbol collision"))
+		<< "Expected a symbol collision.";
+	EXPECT_NE(std::string::npos, scope_errors._diag.find("missing"))
+		<< "Expected an unknown symbol.";
+
+	EXPECT_TRUE(order_errors._parsed && !order_errors._checked)
+		<< "Expected a call to a later function to fail the check.";
+	EXPECT_NE(std::string::npos, order_errors._diag.find("Unknown function"))
+		<< "Expected an unknown function.";
+
+	EXPECT_TRUE(mixed_errors._parsed && !mixed_errors._checked)
+		<< "Expected a scope error to fail the check.";
+	EXPECT_NE(std::string::npos, mixed_errors._diag.find("unknown"))
+		<< "Expected an unknown symbol.";
+	EXPECT_EQ(std::string::npos, mixed_errors._diag.find("initializer"))
+		<< "Expected no type errors once scope resolution failed.";
+}
+
+
+// Checking functions concurrently reports exactly what a serial check does,
+// including for functions that refer to globals declared after them.
+TEST(ContextTest, Check_ParallelMatchesSerial)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	for (const char* src : sources)
+	{
+		const Result serial {compile(stack, src, 1)};
+		const Result parallel {compile(stack, src, 8)};
+		EXPECT_EQ(serial._checked, parallel._checked)
+			<< src << " checked differently in parallel.";
+		EXPECT_EQ(serial._diag, parallel._diag)
+			<< src << " reported differently in parallel.";
+	}
+	carb_stack_cleanup(&stack);
+}
+
+
+// Resolving and validating in a single traversal reports exactly what
+// separate passes do, for errors of either pass.
+TEST(ContextTest, CheckFused_MatchesSeparatePasses)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	for (const char* src : sources)
+	{
+		const Result separate {compile(stack, src)};
+		const Result fused {compile(stack, src, 1, true)};
+		EXPECT_EQ(separate._checked, fused._checked)
+			<< src << " checked differently in a single traversal.";
+		EXPECT_EQ(separate._diag, fused._diag)
+			<< src << " reported differently in a single traversal.";
+	}
+	carb_stack_cleanup(&stack);
+}
+
+
+// A reparsed AST is checked, in either way, and written as a binary AST file
+// located as a full parse of the edited source is, although its kept globals
+// are moved only once accessed.
+TEST(ContextTest, Check_ReparsedAST)
+{
+	const std::string src {
+		"int limit = 10;\n"
+		"first(int a) -> int\n{\n\treturn a;\n}\n\n"
+		"second() -> void\n{\n\tfirst(limit);\n}\n\n"
+		"third(bool b) -> bool\n{\n\treturn missing;\n}\n\n"
+		"third() -> void\n{\n}\n"};
+	const uint32_t off {static_cast<uint32_t>(src.find("limit);"sv))};
+	const std::vector<TextEdit> edits {{off, 5, "limit\n\t\t* 100"}};
+	carb_stack stack;
+	carb_stack_init(&stack);
+	for (bool fused : {false, true})
+	{
+		TU old_tu {src, "reparsed.lang"sv};
+		TU tu {old_tu, edits};
+		CompilerContext full;
+		ASSERT_TRUE(full.Parse(stack, tu)) << full.GetDiagnostics();
+		EXPECT_FALSE(fused ? full.CheckFused(tu) : full.Check(tu))
+			<< "Expected scope errors to fail the check.";
+
+		// Each context's AST is reparsed anew, so neither the check nor the
+		// writer finds its globals already moved.
+		CompilerContext ctx, written_ctx;
+		for (CompilerContext* reparsed : {&ctx, &written_ctx})
+		{
+			ASSERT_TRUE(reparsed->Parse(stack, old_tu))
+				<< reparsed->GetDiagnostics();
+			DiagnosticEngine diag {&tu};
+			ASSERT_TRUE(Parser::reparse(
+				stack, old_tu, tu, reparsed->GetAST(), edits, diag))
+				<< diag.ToString();
+		}
+		EXPECT_FALSE(fused ? ctx.CheckFused(tu) : ctx.Check(tu))
+			<< "Expected scope errors to fail the check.";
+		EXPECT_EQ(full.GetDiagnostics(), ctx.GetDiagnostics())
+			<< "The reparsed AST is diagnosed differently.";
+
+		std::ostringstream written;
+		FlatAST {written_ctx.GetAST()}.Write(written);
+		CompilerContext loaded;
+		TU file {written.str(), "reparsed.ast"sv};
+		FlatAST::Load(file, loaded.GetAST());
+		EXPECT_FALSE(fused ? loaded.CheckFused(tu) : loaded.Check(tu))
+			<< "Expected scope errors to fail the check.";
+		EXPECT_EQ(full.GetDiagnostics(), loaded.GetDiagnostics())
+			<< "The binary AST of the reparsed AST is diagnosed differently.";
+	}
+	carb_stack_cleanup(&stack);
+}
+
+
+// The passes of a flat AST report and print exactly what those of the
+// pointer-linked nodes do, for every test source.
+TEST(ContextTest, Flat_MatchesNodes)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	size_t files {0};
+	for (const std::filesystem::directory_entry& file
+		: std::filesystem::directory_iterator {"@TESTDATADIR@/testContext"})
+	{
+		if (file.path().extension() != ".lang") continue;
+		TU tu {file.path().string().c_str()};
+		const Passes nodes {runPasses(stack, tu, false)};
+		const Passes flat {runPasses(stack, tu, true)};
+		EXPECT_EQ(nodes._success, flat._success)
+			<< tu.GetPath() << " checked differently when flat.";
+		EXPECT_EQ(nodes._diag, flat._diag)
+			<< tu.GetPath() << " reported differently when flat.";
+		EXPECT_EQ(nodes._printed, flat._printed)
+			<< tu.GetPath() << " printed differently when flat.";
+		++ files;
+	}
+	carb_stack_cleanup(&stack);
+	EXPECT_LT(0, files) << "No test sources found.";
+}
+
+
+// Every child of a loop and of an if statement is resolved: the condition,
+// increment and body of a loop and the else branch of an if.
+TEST(ContextTest, Scope_LoopAndIfChildren)
+{
+	const Passes res {checkSource(
+		"main() -> int\n{\n\tint i = 0;\n"
+		"\tfor (i = 0; i < first; i = i + second) { i = third; };\n"
+		"\tif (i == 0) i = 1; else i = fourth;\n\treturn i;\n}\n")};
+	EXPECT_FALSE(res._success) << "Expected unknown symbols to fail the check.";
+	for (const char* name : {"first", "second", "third", "fourth"})
+	{
+		EXPECT_NE(std::string::npos,
+			res._diag.find(std::string {"Unkown symbol: "} + name))
+			<< "Expected " << name << " to be resolved:\n" << res._diag;
+	}
+}
+
+
+// A break count must be at least one and at most the number of enclosing
+// loops, and counts loops outwards from the innermost.
+TEST(ContextTest, Validate_BreakCountRange)
+{
+	const Passes res {checkSource(
+		"main() -> int\n{\n"
+		"\tloop { break<0>; };\n"
+		"\tloop { loop { break<3>; }; break; };\n"
+		"\tloop { loop { break<2> 1; }; break 2; };\n"
+		"\treturn 0;\n}\n")};
+	EXPECT_FALSE(res._success) << "Expected break counts to fail the check.";
+	EXPECT_NE(std::string::npos,
+		res._diag.find("Break count exceeds breakable depth: 0"))
+		<< "Expected a break count of zero to be rejected.";
+	EXPECT_NE(std::string::npos,
+		res._diag.find("Break count exceeds breakable depth: 3"))
+		<< "Expected a break count past the loops to be rejected.";
+	EXPECT_EQ(std::string::npos, res._diag.find("break expression"))
+		<< "Expected break<2> to leave the outer loop:\n" << res._diag;
+	const size_t outer {res._printed.find("LoopExpression(Type = int)")};
+	ASSERT_NE(std::string::npos, outer)
+		<< "Expected break<2> to give the outer loop a value.";
+	EXPECT_NE(std::string::npos,
+		res._printed.find("LoopExpression(Type = void)", outer))
+		<< "Expected the inner loop to have no value.";
+}
+
+
+// Statements after the first returning one are reported at the first of
+// them, even when the last statement also returns.
+TEST(ContextTest, Validate_UnreachableCode)
+{
+	const Passes res {checkSource(
+		"main() -> int\n{\n\treturn 1;\n\tint a = 2;\n\treturn a;\n}\n")};
+	EXPECT_FALSE(res._success)
+		<< "Expected unreachable code to fail the check.";
+	EXPECT_EQ(0, res._diag.find("(4, "))
+		<< "Expected the statement after the return to be reported:\n"
+		<< res._diag;
+	EXPECT_NE(std::string::npos, res._diag.find("Unreachable code"))
+		<< "Expected unreachable code:\n" << res._diag;
+}
+
+
+// A function is defined before its body is resolved, so it may call itself.
+TEST(ContextTest, Scope_RecursiveFunction)
+{
+	const Passes res {checkSource(
+		"down(int n) -> int\n{\n\treturn down(n - 1);\n}\n\n"
+		"main() -> int\n{\n\treturn down(3);\n}\n")};
+	EXPECT_TRUE(res._success && res._diag.empty())
+		<< "Unexpected errors in a recursive function:\n" << res._diag;
+}
+
+
+// A variable is not in scope within its own initializer.
+TEST(ContextTest, Scope_InitializerExcludesVariable)
+{
+	const Passes res {checkSource(
+		"main() -> int\n{\n\tint b = b;\n\treturn b;\n}\n")};
+	EXPECT_FALSE(res._success)
+		<< "Expected a self-referencing initializer to fail the check.";
+	EXPECT_NE(std::string::npos, res._diag.find("Unkown symbol: b"))
+		<< "Expected the initializer's variable to be unknown:\n"
+		<< res._diag;
+}
+
+
+// An arithmetic operand of the wrong type is reported as expecting an int.
+TEST(ContextTest, Validate_IntOperandMessage)
+{
+	const Passes res {checkSource(
+		"main() -> int\n{\n\treturn 1 + true;\n}\n")};
+	EXPECT_FALSE(res._success) << "Expected a bool operand to fail the check.";
+	EXPECT_NE(std::string::npos,
+		res._diag.find("Expected right operand of type int, found: bool"))
+		<< "Expected an int operand to be asked for:\n" << res._diag;
+}
+
+
+// Comparing operands of different types fails the check, not just reports.
+TEST(ContextTest, Validate_MismatchedComparison)
+{
+	const Passes res {checkSource(
+		"main() -> int\n{\n\tbool b = 1 == true;\n\treturn 0;\n}\n")};
+	EXPECT_FALSE(res._success)
+		<< "Expected mismatched operands to fail the check.";
+	EXPECT_NE(std::string::npos, res._diag.find(
+		"Expected operands of matching types, found: int and bool"))
+		<< "Expected mismatched operands:\n" << res._diag;
+}
+
+
+// Expressions print before they are validated, their types shown as void.
+TEST(ContextTest, Print_Unvalidated)
+{
+	TU tu {"main() -> int\n{\n\treturn add(-1, 2) + 3;\n}\n"sv,
+		"source.lang"sv};
+	carb_stack stack;
+	carb_stack_init(&stack);
+	AST ast;
+	DiagnosticEngine diag {&tu};
+	const bool parsed {Parser::getAST(stack, tu, ast, diag)};
+	carb_stack_cleanup(&stack);
+	ASSERT_TRUE(parsed) << "Unexpected errors:\n" << diag.ToString();
+
+	std::ostringstream nodes, flat;
+	for (SyntaxTreeNode* node : ast) node->Print(nodes, "  ");
+	FlatAST {ast}.Print(flat, "  ");
+	const std::string printed {nodes.str()};
+	for (const char* expected : {"BinaryExpression(Op = +, Type = void)",
+		"InvokeExpression(Function = add, Type = void)",
+		"UnaryExpr(Op = -, Type = void)"})
+	{
+		EXPECT_NE(std::string::npos, printed.find(expected))
+			<< "Expected " << expected << " in:\n" << printed;
+	}
+	EXPECT_EQ(printed, flat.str()) << "The flat AST printed differently.";
+}
+
+
+// Once the error limit is reached, further errors are dropped and a single
+// note that the compilation stopped is reported, by either kind of check.
+TEST(ContextTest, Check_ErrorLimit)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	const Result separate {compile(stack, sources[2], 8, false, 1)};
+	const Result fused {compile(stack, sources[2], 1, true, 1)};
+	const Result unlimited {compile(stack, sources[2], 1, false, 0)};
+	carb_stack_cleanup(&stack);
+
+	for (const Result* res : {&separate, &fused})
+	{
+		EXPECT_TRUE(res->_parsed && !res->_checked)
+			<< "Expected the error limit to fail the check.";
+		EXPECT_NE(std::string::npos, res->_diag.find("Symbol collision"))
+			<< "Expected the first error to be reported.";
+		EXPECT_EQ(std::string::npos, res->_diag.find("missing"))
+			<< "Expected errors past the limit to be dropped.";
+		EXPECT_NE(std::string::npos, res->_diag.find("Too many errors"))
+			<< "Expected the limit to be reported.";
+	}
+	EXPECT_NE(std::string::npos, unlimited._diag.find("missing"))
+		<< "Expected every error to be reported without a limit.";
+	EXPECT_EQ(std::string::npos, unlimited._diag.find("Too many errors"))
+		<< "Unexpected limit reported without a limit.";
+}
+
+
+// Diagnostics rendered as JSON Lines carry the message ID, its arguments and
+// the position of the error, one object per line.
+TEST(ContextTest, Check_JSONDiagnostics)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	const Result valid {compile(stack, sources[0])};
+	const Result type_errors {compile(stack, sources[1])};
+	carb_stack_cleanup(&stack);
+
+	EXPECT_TRUE(valid._json.empty())
+		<< "Unexpected diagnostics for a valid program.";
+
+	std::istringstream lines (type_errors._json);
+	std::string first;
+	ASSERT_TRUE(std::getline(lines, first)) << "Expected a diagnostic.";
+	EXPECT_EQ(0, first.find(
+		"{\"severity\":\"error\",\"id\":\"initializer-type\","))
+		<< "Expected an initializer type error first:\n" << first;
+	EXPECT_NE(std::string::npos, first.find("\"args\":[\"bool\",\"int\"]"))
+		<< "Expected the types as arguments:\n" << first;
+	EXPECT_NE(std::string::npos, first.find("type_errors.lang\",\"line\":3,"))
+		<< "Expected the file and line of the error:\n" << first;
+	EXPECT_EQ('}', first.back()) << "Expected one object per line.";
+}
+
+
+// Passes walk the AST with an explicit stack, so an expression nested far
+// deeper than the native stack allows is checked and printed.
+TEST(ContextTest, Check_DeepExpression)
+{
+	const size_t terms {500000};
+	const std::string path {(std::filesystem::path(testing::TempDir())
+		/ "deep_expression.lang").string()};
+	{
+		std::ofstream out (path);
+		out << "main() -> int\n{\n\tint a = 1;\n\treturn a";
+		for (size_t i {1}; i < terms; ++ i) out << " + a";
+		out << ";\n}\n";
+	}
+
+	carb_stack stack;
+	carb_stack_init(&stack);
+	const Result separate {compile(stack, path.c_str())};
+	const Result fused {compile(stack, path.c_str(), 1, true)};
+
+	TU tu (path.c_str());
+	CompilerContext ctx;
+	std::ostringstream os;
+	if (ctx.Parse(stack, tu) && ctx.Check(tu))
+		for (SyntaxTreeNode* node : ctx.GetAST()) node->Print(os, "");
+	carb_stack_cleanup(&stack);
+	std::filesystem::remove(path);
+
+	EXPECT_TRUE(separate._parsed && separate._checked)
+		<< "Unexpected errors in a deep expression:\n" << separate._diag;
+	EXPECT_TRUE(fused._parsed && fused._checked)
+		<< "Unexpected errors in a deep expression:\n" << fused._diag;
+
+	const std::string printed {os.str()};
+	const std::string_view op {"BinaryExpression"};
+	size_t count {0};
+	for (size_t pos {printed.find(op)}; pos != std::string::npos;
+		pos = printed.find(op, pos + 1))
+		++ count;
+	EXPECT_EQ(terms - 1, count) << "Incorrect number of printed operators.";
+}
+
+
+// The passes of a flat AST handle an expression too deep for recursion, as the
+// passes of the nodes do.
+TEST(ContextTest, Flat_DeepExpression)
+{
+	const size_t terms {500000};
+	std::string text {"main() -> int\n{\n\tint a = 1;\n\treturn a"};
+	for (size_t i {1}; i < terms; ++ i) text += " + a";
+	text += ";\n}\n";
+
+	TU tu {text, "deep_expression.lang"sv};
+	carb_stack stack;
+	carb_stack_init(&stack);
+	const Passes nodes {runPasses(stack, tu, false, ""sv)};
+	const Passes flat {runPasses(stack, tu, true, ""sv)};
+	carb_stack_cleanup(&stack);
+
+	EXPECT_TRUE(flat._success)
+		<< "Unexpected errors in a deep expression:\n" << flat._diag;
+	EXPECT_TRUE(nodes._printed == flat._printed)
+		<< "The flat passes disagree on a deep expression.";
+}
+
+
+// Streaming checks each global as soon as it is parsed, and reports exactly
+// what parsing and checking the whole program does.
+TEST(ContextTest, Stream_MatchesCheck)
+{
+	carb_stack stack;
+	carb_stack_init(&stack);
+	for (const char* src : sources)
+	{
+		const Result batch {compile(stack, src)};
+		TU tu (src);
+		CompilerContext ctx;
+		size_t globals {0};
+		const bool checked {ctx.Stream(stack, tu,
+			[&globals](SyntaxTreeNode* node) { ++ globals; })};
+		EXPECT_EQ(batch._checked, checked)
+			<< src << " checked differently when streamed.";
+		EXPECT_EQ(batch._diag, ctx.GetDiagnostics())
+			<< src << " reported differently when streamed.";
+		EXPECT_EQ(batch._globals, globals)
+			<< src << " streamed an incorrect number of globals.";
+	}
+	carb_stack_cleanup(&stack);
+}
+
+
+// A streamed program holds only one global's nodes and a chunk of its tokens
+// at a time, so the peak memory of a streamed compilation stays within the
+// size of the source, however large the whole AST grows.
+TEST(ContextTest, Stream_BoundedMemory)
+{
+	const size_t functions {2000};
+	const size_t statements {200};
+	const std::string path {(std::filesystem::path(testing::TempDir())
+		/ "many_functions.lang").string()};
+	[[maybe_unused]] size_t src_size;	// Peak memory is measured on POSIX.
+	{
+		std::ofstream out (path);
+		out << "f0(int a) -> int\n{\n\treturn a;\n}\n";
+		for (size_t i {1}; i < functions; ++ i)
+		{
+			out << 'f' << i << "(int a) -> int\n{\n\tint x = f" << i - 1
+				<< "(a);\n";
+			for (size_t j {0}; j < statements; ++ j) out << "\tx = x + a;\n";
+			out << "\treturn x;\n}\n";
+		}
+		out << "main() -> int\n{\n\treturn f" << functions - 1
+			<< "(1);\n}\n";
+		src_size = static_cast<size_t>(out.tellp());
+	}
+
+	// Compiles the program, streamed or whole, in a context of its own.
+	auto compileAlone = [&path](bool stream)
+	{
+		carb_stack stack;
+		carb_stack_init(&stack);
+		TU tu (path.c_str());
+		CompilerContext ctx;
+		if (stream) ctx.Stream(stack, tu, [](SyntaxTreeNode*) {});
+		else if (ctx.Parse(stack, tu)) ctx.Check(tu);
+		carb_stack_cleanup(&stack);
+	};
+#ifdef LANG_HAVE_RUSAGE
+	const size_t streamed_growth {
+		childPeakGrowth([&compileAlone]() { compileAlone(true); })};
+	const size_t batch_growth {
+		childPeakGrowth([&compileAlone]() { compileAlone(false); })};
+#endif
+
+	carb_stack stack;
+	carb_stack_init(&stack);
+	TU tu (path.c_str());
+	[[maybe_unused]] const size_t lines {tu.GetLineCount()};
+	CompilerContext batch;
+	const bool batch_checked {batch.Parse(stack, tu) && batch.Check(tu)};
+	std::ostringstream batch_print;
+	for (SyntaxTreeNode* node : batch.GetAST()) node->Print(batch_print, "");
+	CompilerContext streamed;
+	std::ostringstream streamed_print;
+	const bool streamed_checked {streamed.Stream(stack, tu,
+		[&streamed_print](SyntaxTreeNode* node)
+		{ node->Print(streamed_print, ""); })};
+	carb_stack_cleanup(&stack);
+	std::filesystem::remove(path);
+
+	EXPECT_TRUE(batch_checked && streamed_checked)
+		<< "Unexpected errors in a valid program:\n"
+		<< batch.GetDiagnostics() << streamed.GetDiagnostics();
+	EXPECT_EQ(batch_print.str(), streamed_print.str())
+		<< "Streamed globals printed differently.";
+
+#ifdef LANG_HAVE_RUSAGE
+	// The source and its line index are expected; allow for the index's
+	// growth, the signatures of the globals and a little more, but nothing
+	// per token or per statement.
+	const size_t bound {src_size + 2 * lines * sizeof(size_t) + (8 << 20)};
+	EXPECT_LE(streamed_growth, bound)
+		<< "Streaming grew the peak memory by " << streamed_growth
+		<< " bytes, against " << batch_growth << " for the whole AST.";
+	EXPECT_LT(bound, batch_growth)
+		<< "The program is too small to tell streaming from the whole AST.";
+#endif
+}
+
+
+// Contexts on separate threads share no mutable state, so concurrent
+// compilations report exactly what a lone compilation does. Run a
+// ThreadSanitizer build (LANG_TSAN) to also check for data races.
+TEST(ContextTest, Concurrent_Compilations)
+{
+	const size_t threads {8};
+	const size_t rounds {25};
+	const size_t count {std::size(sources)};
+
+	std::vector<Result> expected;
+	carb_stack stack;
+	carb_stack_init(&stack);
+	for (const char* src : sources) expected.push_back(compile(stack, src));
+	carb_stack_cleanup(&stack);
+
+	std::vector<std::vector<Result>> results (threads);
+	std::vector<std::thread> pool;
+	for (size_t t {0}; t < threads; ++ t)
+	{
+		pool.emplace_back([&results, t, rounds, count]()
+		{
+			carb_stack stack;
+			carb_stack_init(&stack);
+			// Stagger the files so threads compile different ones at once.
+			for (size_t i {0}; i < rounds * count; ++ i)
+				results[t].push_back(compile(stack, sources[(t + i) % count]));
+			carb_stack_cleanup(&stack);
+		});
+	}
+	for (std::thread& thread : pool) thread.join();
+
+	for (size_t t {0}; t < threads; ++ t)
+	{
+		for (size_t i {0}; i < results[t].size(); ++ i)
+		{
+			const Result& res {results[t][i]};
+			const Result& exp {expected[(t + i) % count]};
+			ASSERT_EQ(exp._parsed, res._parsed)
+				<< "Thread " << t << " round " << i << " parsed differently.";
+			ASSERT_EQ(exp._checked, res._checked)
+				<< "Thread " << t << " round " << i << " checked differently.";
+			ASSERT_EQ(exp._diag, res._diag)
+				<< "Thread " << t << " round " << i << " reported differently.";
+			ASSERT_EQ(exp._globals, res._globals)
+				<< "Thread " << t << " round " << i << " parsed differently.";
+		}
+	}
+}
+
+
+// An exception thrown on a worker thread reaches the caller once every
+// worker has stopped, rather than terminating the process.
+TEST(ContextTest, ParallelFor_Rethrows)
+{
+	EXPECT_THROW(parallelFor(1000, 4, [](size_t i)
+	{
+		if (i == 10) throw std::runtime_error("Failed.");
+	}), std::runtime_error);
+}
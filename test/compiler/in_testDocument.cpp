@@ -0,0 +1,211 @@
+#include "gtest/gtest.h"
+
+#include "context.hpp"
+#include "document.hpp"
+#include "parser/parser.h"
+#include "syntaxTree/globals.hpp"
+#include "utilities.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_view_literals;
+
+
+// Source files whose diagnostics a document must reproduce.
+const char* const sources[] {
+	"@TESTDATADIR@/testContext/valid.lang",
+	"@TESTDATADIR@/testContext/type_errors.lang",
+	"@TESTDATADIR@/testContext/scope_errors.lang",
+	"@TESTDATADIR@/testContext/order_errors.lang",
+	"@TESTDATADIR@/testContext/mixed_errors.lang",
+};
+
+
+// Program edited by the tests.
+const std::string_view program {
+	"int scale = 3;\n"
+	"\n"
+	"twice(int a) -> int\n"
+	"{\n"
+	"	return a * 2;\n"
+	"}\n"
+	"\n"
+	"area(int w, int h) -> int\n"
+	"{\n"
+	"	int size = twice(w) * h;\n"
+	"	size = size * scale;\n"
+	"	return size;\n"
+	"}\n"
+	"\n"
+	"main() -> int\n"
+	"{\n"
+	"	return area(2, 4);\n"
+	"}\n"
+};
+
+
+// Test fixture holding a parser stack.
+class DocumentTest
+	: public testing::Test
+{
+protected:
+	carb_stack _stack;	// Parser structure.
+
+	DocumentTest()
+	{
+		carb_stack_init(&_stack);
+	}
+
+	~DocumentTest()
+	{
+		carb_stack_cleanup(&_stack);
+	}
+
+	/**
+	 * Parses and checks a source in a fresh context.
+	 * @param text The source.
+	 * @return Diagnostics reported, rendered as text.
+	 */
+	std::string Compile(std::string_view text)
+	{
+		TU tu {text, "test.lang"sv};
+		CompilerContext ctx;
+		if (ctx.Parse(_stack, tu)) ctx.Check(tu);
+		return ctx.GetDiagnostics();
+	}
+
+	/**
+	 * @param doc A document.
+	 * @return Current source of the document.
+	 */
+	static std::string GetText(const Document& doc)
+	{
+		return std::string(doc.GetTU().GetBuf(), doc.GetTU().GetSize());
+	}
+
+	/**
+	 * @param text Text to search in.
+	 * @param str Text to find, which occurs in text.
+	 * @param skip Number of characters of str to move past its start.
+	 * @return Offset of the character skip characters into the first
+	 * occurrence of str.
+	 */
+	static uint32_t At(std::string_view text, std::string_view str,
+		size_t skip = 0)
+	{
+		return static_cast<uint32_t>(text.find(str) + skip);
+	}
+};
+
+
+// A document reports what parsing and checking its source does, before and
+// after edits move, add and remove globals.
+TEST_F(DocumentTest, Diagnostics_MatchCheck)
+{
+	for (const char* src : sources)
+	{
+		std::ifstream file {src};
+		std::stringstream text;
+		text << file.rdbuf();
+		Document doc {"test.lang"sv};
+		doc.Open(_stack, text.str());
+		EXPECT_EQ(Compile(text.str()), doc.GetDiagnosticEngine().ToString())
+			<< src << " reported differently by a document.";
+
+		const std::vector<std::vector<TextEdit>> edits {
+			{TextEdit {0, 0, "\n\n"}},
+			{TextEdit {0, 0, "int pad = 1;\n"}},
+			{TextEdit {0, 13, ""}},
+			{TextEdit {static_cast<uint32_t>(doc.GetTU().GetSize()), 0,
+				"\nextra() -> int\n{\n\treturn 0;\n}\n"}},
+		};
+		for (const std::vector<TextEdit>& edit : edits)
+		{
+			doc.Edit(_stack, edit);
+			EXPECT_EQ(Compile(GetText(doc)),
+				doc.GetDiagnosticEngine().ToString())
+				<< src << " reported differently after an edit:\n"
+				<< GetText(doc);
+		}
+	}
+}
+
+
+// Hovering names a declaration's signature or an expression's type, and the
+// definition of a name is the declaration it resolves to.
+TEST_F(DocumentTest, HoverAndDefinition)
+{
+	Document doc {"test.lang"sv};
+	doc.Open(_stack, program);
+	EXPECT_TRUE(doc.GetDiagnosticEngine().GetDiagnostics().empty())
+		<< doc.GetDiagnosticEngine().ToString();
+
+	std::string text;
+	SourceLocation loc;
+	ASSERT_TRUE(doc.Describe(At(program, "twice(w)"sv, 1), text, loc));
+	EXPECT_EQ("twice(int a) -> int", text);
+	ASSERT_TRUE(doc.Describe(At(program, "* scale"sv, 2), text, loc));
+	EXPECT_EQ("int scale", text);
+	ASSERT_TRUE(doc.Describe(At(program, "* h"sv), text, loc));
+	EXPECT_EQ("int", text);
+	EXPECT_EQ(At(program, "* h"sv), loc._off);
+	ASSERT_TRUE(doc.Describe(At(program, "int h"sv), text, loc));
+	EXPECT_EQ("int h", text);
+
+	const Declaration* size {doc.FindDefinition(At(program, "size ="sv))};
+	ASSERT_NE(nullptr, size);
+	EXPECT_EQ(At(program, "size ="sv), size->_name->_off);
+	const Declaration* area {doc.FindDefinition(At(program, "area(2"sv))};
+	ASSERT_NE(nullptr, area);
+	EXPECT_EQ(At(program, "area("sv), area->_name->_off);
+	EXPECT_EQ(nullptr, doc.FindDefinition(At(program, "2;"sv)));
+	EXPECT_EQ(nullptr, doc.Find(At(program, "\n\ntwice"sv)));
+}
+
+
+// Editing a function's body checks that function alone, while globals the
+// edit moves keep their results and report what a full check does.
+TEST_F(DocumentTest, Edit_RechecksEditedFunction)
+{
+	Document doc {"test.lang"sv};
+	doc.Open(_stack, program);
+	EXPECT_EQ(3, doc.GetCheckedCount());
+
+	// Lengthen a literal in twice(), moving the functions after it.
+	doc.Edit(_stack, {TextEdit {At(program, "2;"sv), 1, "20"}});
+	EXPECT_EQ(1, doc.GetCheckedCount());
+	std::string text {GetText(doc)};
+	EXPECT_EQ(Compile(text), doc.GetDiagnosticEngine().ToString());
+
+	// The moved globals are located where the edit put them.
+	const Declaration* area {doc.FindDefinition(At(text, "area(2"sv))};
+	ASSERT_NE(nullptr, area);
+	EXPECT_EQ(At(text, "area("sv), area->_name->_off);
+	const Declaration* size {doc.FindDefinition(At(text, "size ="sv, 1))};
+	ASSERT_NE(nullptr, size);
+	EXPECT_EQ(At(text, "size ="sv), size->_name->_off);
+	std::string type;
+	SourceLocation loc;
+	ASSERT_TRUE(doc.Describe(At(text, "* h"sv), type, loc));
+	EXPECT_EQ(At(text, "* h"sv), loc._off);
+
+	// Replace the global variable without changing its type: functions
+	// referring to it are pointed at the new one rather than rechecked.
+	doc.Edit(_stack, {TextEdit {At(text, "3;"sv), 1, "4"}});
+	EXPECT_EQ(0, doc.GetCheckedCount());
+	text = GetText(doc);
+	const Declaration* scale {doc.FindDefinition(At(text, "* scale"sv, 2))};
+	ASSERT_NE(nullptr, scale);
+	EXPECT_EQ(doc.FindDefinition(At(text, "scale"sv)), scale);
+
+	// Changing a signature rechecks the functions that may see it.
+	doc.Edit(_stack, {TextEdit {At(text, "int a"sv), 3, "bool"}});
+	EXPECT_EQ(3, doc.GetCheckedCount());
+	text = GetText(doc);
+	EXPECT_EQ(Compile(text), doc.GetDiagnosticEngine().ToString());
+	EXPECT_FALSE(doc.GetDiagnosticEngine().GetDiagnostics().empty());
+}
@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+
+#include "parser/lexer.hpp"
+#include "parser/parserTools.hpp"
+#include "utilities.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std::string_view_literals;
+namespace fs = std::filesystem;
+
+
+// Test fixture comparing the hand-written lexer with the Carburetta scanner.
+class LexerTest
+	: public testing::Test
+{
+protected:
+	/**
+	 * Expects the hand-written lexer to find the same tokens as the
+	 * Carburetta scanner, measuring runs in every width of blocks the
+	 * processor supports.
+	 * @param tu Translation unit to scan.
+	 */
+	void ExpectSameTokens(const TU& tu)
+	{
+		std::vector<Token> expected;
+		Parser::scan(tu, LexerKind::Carburetta, expected);
+		for (VectorWidth width
+			: {VectorWidth::None, VectorWidth::SSE2, VectorWidth::AVX2})
+		{
+			if (width > Lexer::Widest()) break;
+			std::vector<Token> tokens;
+			Lexer {std::string_view(tu.GetBuf(), tu.GetSize()), width}
+				.ScanAll(tokens);
+			ASSERT_EQ(expected.size(), tokens.size())
+				<< "Different token count in " << tu.GetPath();
+			for (size_t i {0}; i < tokens.size(); ++ i)
+			{
+				EXPECT_EQ(expected[i]._off, tokens[i]._off);
+				EXPECT_EQ(expected[i]._len, tokens[i]._len)
+					<< "Token " << tu.GetText(tokens[i]._off, tokens[i]._len)
+					<< " in " << tu.GetPath();
+				EXPECT_EQ(expected[i]._kind, tokens[i]._kind)
+					<< "Token " << tu.GetText(tokens[i]._off, tokens[i]._len)
+					<< " in " << tu.GetPath();
+			}
+		}
+	}
+};
+
+
+// Every test source scans to the same tokens.
+TEST_F(LexerTest, MatchesScanner_TestData)
+{
+	size_t files {0};
+	for (const fs::directory_entry& file
+		: fs::recursive_directory_iterator {"@TESTDATADIR@"})
+	{
+		if (file.path().extension() != ".lang") continue;
+		const TU tu {file.path().string().c_str()};
+		ExpectSameTokens(tu);
+		++ files;
+	}
+	EXPECT_LT(0, files) << "No test sources found.";
+}
+
+
+// Every operator and keyword, keywords within identifiers, strings, and runs
+// longer than a vector block, ending at the end of the source.
+TEST_F(LexerTest, MatchesScanner_EveryToken)
+{
+	const std::string run (70, 'z');
+	const std::string src {
+		"= ; , + - * / % ++ -- & | ^ ~ >> << && || ! == != > < >= <= "
+		"( ) { } <- -> ===<<=<-->>=&&&|||+++--->"
+		"if else match for loop while true false break return "
+		"iff _if else2 matches fo loops whilex True falsey breaks returned "
+		"x1 _ A_b 0 123 0x12 12ab\n\"\"\n\"a\" \"b\"\r\n\"a\"b\" c\r\n"
+		+ std::string(50, ' ') + std::string(40, '\t') + run + ' '
+		+ std::string(70, '7') + "\n\t" + run + "_9" + run};
+	const TU tu {src, "tokens.lang"sv};
+	ExpectSameTokens(tu);
+}
+
+
+// Tokens written to a binary token file are read back as they were, and only
+// for the source they were scanned from.
+TEST_F(LexerTest, TokenFile_RoundTrip)
+{
+	const TU tu {"@TESTDATADIR@/testContext/valid.lang"};
+	const std::string_view src {tu.GetBuf(), tu.GetSize()};
+	std::vector<Token> tokens;
+	Lexer {src}.ScanAll(tokens);
+	std::ostringstream os;
+	TokenFile::write(src, tokens, os);
+	const std::string data {os.str()};
+	EXPECT_EQ(24 + 8 * tokens.size(), data.size());
+
+	std::vector<Token> loaded;
+	TokenFile::load(TU {data, "valid.tok"sv}, src, loaded);
+	ASSERT_EQ(tokens.size(), loaded.size());
+	for (size_t i {0}; i < tokens.size(); ++ i)
+	{
+		EXPECT_EQ(tokens[i]._off, loaded[i]._off);
+		EXPECT_EQ(tokens[i]._len, loaded[i]._len);
+		EXPECT_EQ(tokens[i]._kind, loaded[i]._kind);
+	}
+
+	std::string edited {src};
+	edited.back() = edited.back() == ' ' ? '\t' : ' ';
+	EXPECT_THROW(TokenFile::load(TU {data, "valid.tok"sv}, edited, loaded),
+		std::runtime_error) << "Expected a file for another source rejected.";
+	EXPECT_THROW(TokenFile::load(TU {data.substr(0, data.size() - 1),
+		"valid.tok"sv}, src, loaded), std::runtime_error);
+	std::string swapped {data};
+	std::swap_ranges(swapped.end() - 8, swapped.end(), swapped.end() - 16);
+	EXPECT_THROW(TokenFile::load(TU {swapped, "valid.tok"sv}, src, loaded),
+		std::runtime_error) << "Expected tokens out of order rejected.";
+}
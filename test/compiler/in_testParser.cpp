@@ -3,10 +3,26 @@
 #include "parser/parser.h"
 #include "parser/parserTools.hpp"
 #include "syntaxTree/base.hpp"
+#include "syntaxTree/flat.hpp"
 #include "syntaxTree/globals.hpp"
 #include "utilities.hpp"
 
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define LANG_HAVE_RUSAGE
+#include <sys/resource.h>
+#endif
+
+using namespace std::string_view_literals;
 
 
 // Test fixture for testing parser output.
@@ -28,11 +44,28 @@ protected:
 		carb_stack_cleanup(&_stack);
 	}
 
+#ifdef LANG_HAVE_RUSAGE
+	/**
+	 * @return Peak resident set size of the process so far, in bytes.
+	 */
+	static size_t PeakRSS()
+	{
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss);	// Already in bytes.
+#else
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+	}
+#endif
+
 	void Load(const char* src_path)
 	{
 		TU tu (src_path);
-		carb_set_input(&_stack, tu.GetBuf(), tu.GetSize(), tu.IsFinal());
-		_success = Parser::getAST(_stack, tu, _ast);
+		DiagnosticEngine diag {&tu};
+		_success = Parser::getAST(_stack, tu, _ast, diag);
+		diag.Render(std::cerr);
 	}
 };
 
@@ -45,10 +78,10 @@ TEST_F(ParserTest, Function_Empty)
 		<< "An error occured constructing the AST.";
 	ASSERT_EQ(1, _ast.size())
 		<< "Incorrect number of top-level AST nodes.";
-	Function* fn {dynamic_cast<Function*>(_ast[0].get())};
+	Function* fn {dyn_cast<Function>(_ast[0])};
 	ASSERT_NE(fn, nullptr)
 		<< "Expected a function node.";
-	EXPECT_STREQ("empty", fn->_name->_id.c_str())
+	EXPECT_EQ("empty"sv, fn->_name->_id.View())
 		<< "Expected a function called 'empty'.";
 	EXPECT_TRUE(fn->_type->IsVoid())
 		<< "Expected a function of type void.";
@@ -57,3 +90,230 @@ TEST_F(ParserTest, Function_Empty)
 	EXPECT_EQ(0, fn->_body.size())
 		<< "Unexpected function body statements.";
 }
+
+
+// Function body of one million statements. Lists are built left-recursively,
+// so the parser stack stays shallow and the only memory that grows with the
+// body is the AST itself and the statement list under construction.
+TEST_F(ParserTest, Function_MillionStatements)
+{
+	const size_t count {1000000};
+	const std::string path {testing::TempDir() + "fn_million.lang"};
+	[[maybe_unused]] size_t src_size;	// Peak memory is measured on POSIX.
+	{
+		std::ofstream src {path};
+		src << "million() -> void {\n\tfirst;\n"sv;
+		for (size_t i {2}; i < count; ++ i) src << "\tx;\n"sv;
+		src << "\tlast;\n}\n"sv;
+		src_size = static_cast<size_t>(src.tellp());
+	}
+
+#ifdef LANG_HAVE_RUSAGE
+	const size_t before {PeakRSS()};
+#endif
+	Load(path.c_str());
+#ifdef LANG_HAVE_RUSAGE
+	const size_t growth {PeakRSS() - before};
+#endif
+	std::remove(path.c_str());
+
+	ASSERT_TRUE(_success)
+		<< "An error occured constructing the AST.";
+	ASSERT_EQ(1, _ast.size())
+		<< "Incorrect number of top-level AST nodes.";
+	Function* fn {dyn_cast<Function>(_ast[0])};
+	ASSERT_NE(fn, nullptr)
+		<< "Expected a function node.";
+	ASSERT_EQ(count, fn->_body.size())
+		<< "Incorrect number of function body statements.";
+	Literal* first {dyn_cast<Literal>(fn->_body[0])};
+	Literal* last {dyn_cast<Literal>(fn->_body[count - 1])};
+	ASSERT_TRUE(first != nullptr && last != nullptr)
+		<< "Expected expression statements.";
+	EXPECT_EQ("first"sv, first->_rawValue.View())
+		<< "Expected statements in source order.";
+	EXPECT_EQ("last"sv, last->_rawValue.View())
+		<< "Expected statements in source order.";
+
+#ifdef LANG_HAVE_RUSAGE
+	// The AST and source are expected; allow for the statement vector's
+	// growth and a little more, but nothing per statement on the stack.
+	const size_t bound {_ast._arena.GetBytesUsed() + src_size
+		+ 2 * count * sizeof(Statement*) + (8 << 20)};
+	EXPECT_LE(growth, bound)
+		<< "Parser memory grows faster than the AST.";
+#endif
+}
+
+
+// Editing one function reparses it alone. The globals around it are kept and
+// moved to where the edit puts them once accessed, so the AST matches a full
+// parse.
+TEST_F(ParserTest, Reparse_MatchesFullParse)
+{
+	const std::string src {
+		"int limit = 10;\n"
+		"first(int a) -> int\n{\n\treturn a;\n}\n\n"
+		"second() -> void\n{\n\tfirst(limit);\n}\n\n"
+		"third(bool b) -> bool\n{\n\treturn b;\n}\n"};
+	TU old_tu {src, "reparse.lang"sv};
+	DiagnosticEngine diag {&old_tu};
+	ASSERT_TRUE(Parser::getAST(_stack, old_tu, _ast, diag))
+		<< "An error occured constructing the AST.";
+	ASSERT_EQ(4, _ast.size())
+		<< "Incorrect number of top-level AST nodes.";
+	const std::vector<SyntaxTreeNode*> old {_ast.begin(), _ast.end()};
+	const uint32_t last_off {old[3]->_off};
+
+	const uint32_t off {static_cast<uint32_t>(src.find("limit);"sv))};
+	const std::vector<TextEdit> edits {{off, 5, "limit * 100"}};
+	TU tu {old_tu, edits};
+	_success = Parser::reparse(_stack, old_tu, tu, _ast, edits, diag);
+	AST full;
+	ASSERT_TRUE(Parser::getAST(_stack, tu, full, diag))
+		<< "An error occured constructing the edited AST:\n"
+		<< diag.ToString();
+
+	ASSERT_TRUE(_success)
+		<< "An error occured reparsing the AST:\n" << diag.ToString();
+	ASSERT_EQ(full.size(), _ast.size())
+		<< "Incorrect number of top-level AST nodes.";
+	EXPECT_EQ(last_off, _ast._globals[3]->_off)
+		<< "Expected a kept global to be moved only once accessed.";
+	EXPECT_TRUE(old[0] == _ast[0] && old[1] == _ast[1] && old[3] == _ast[3])
+		<< "Expected the globals untouched by the edit to be kept.";
+	EXPECT_NE(old[2], _ast[2])
+		<< "Expected the edited function to be reparsed.";
+	for (size_t i {0}; i < full.size(); ++ i)
+	{
+		std::ostringstream expected, actual;
+		full[i]->Print(expected, "  "sv);
+		_ast[i]->Print(actual, "  "sv);
+		EXPECT_EQ(expected.str(), actual.str())
+			<< "Global " << i << " differs from a full parse.";
+		const Declaration* full_decl {cast<Declaration>(full[i])};
+		const Declaration* decl {cast<Declaration>(_ast[i])};
+		EXPECT_TRUE(full_decl->_off == decl->_off
+			&& full_decl->_name->_off == decl->_name->_off)
+			<< "Global " << i << " is not located as in a full parse.";
+	}
+}
+
+
+// The grammar parses the tokens of either scanner alike: every test source
+// gives the same AST and diagnostics.
+TEST_F(ParserTest, Lexers_SameAST)
+{
+	size_t files {0};
+	for (const std::filesystem::directory_entry& file
+		: std::filesystem::recursive_directory_iterator {"@TESTDATADIR@"})
+	{
+		if (file.path().extension() != ".lang") continue;
+		TU tu {file.path().string().c_str()};
+		std::string printed[2];
+		std::string diagnostics[2];
+		for (LexerKind lexer : {LexerKind::Carburetta, LexerKind::Direct})
+		{
+			AST ast;
+			DiagnosticEngine diag {&tu};
+			Parser::getAST(_stack, tu, ast, diag, lexer);
+			std::ostringstream os;
+			for (SyntaxTreeNode* node : ast) node->Print(os, "  "sv);
+			printed[static_cast<size_t>(lexer)] = os.str();
+			diagnostics[static_cast<size_t>(lexer)] = diag.ToString();
+		}
+		EXPECT_EQ(printed[0], printed[1])
+			<< "Different AST parsed from " << tu.GetPath();
+		EXPECT_EQ(diagnostics[0], diagnostics[1])
+			<< "Different diagnostics parsing " << tu.GetPath();
+		++ files;
+	}
+	EXPECT_LT(0, files) << "No test sources found.";
+}
+
+
+// Tokens written to a binary token file and read back are parsed through the
+// token-fed entry point into the AST a parse of the source gives.
+TEST_F(ParserTest, TokenFile_SameAST)
+{
+	Load("@TESTDATADIR@/testContext/valid.lang");
+	ASSERT_TRUE(_success)
+		<< "An error occured constructing the AST.";
+	TU tu {"@TESTDATADIR@/testContext/valid.lang"};
+	const std::string_view src {tu.GetBuf(), tu.GetSize()};
+	std::vector<Token> scanned;
+	Parser::scan(tu, LexerKind::Carburetta, scanned);
+	std::ostringstream written;
+	TokenFile::write(src, scanned, written);
+
+	std::vector<Token> tokens;
+	TU file {written.str(), "valid.tokens"sv};
+	TokenFile::load(file, src, tokens);
+	AST ast;
+	DiagnosticEngine diag {&tu};
+	ASSERT_TRUE(Parser::parseTokens(_stack, tu, tokens, ast, diag))
+		<< "An error occured parsing the loaded tokens:\n" << diag.ToString();
+	ASSERT_EQ(_ast.size(), ast.size())
+		<< "Incorrect number of top-level AST nodes.";
+	for (size_t i {0}; i < ast.size(); ++ i)
+	{
+		std::ostringstream expected, actual;
+		_ast[i]->Print(expected, "  "sv);
+		ast[i]->Print(actual, "  "sv);
+		EXPECT_EQ(expected.str(), actual.str())
+			<< "Global " << i << " differs from a parse of the source.";
+	}
+}
+
+
+// A binary AST file rebuilds the AST it was written from, writing that AST
+// again gives the same file, and a damaged file is rejected.
+TEST_F(ParserTest, BinaryAST_RoundTrip)
+{
+	Load("@TESTDATADIR@/testContext/valid.lang");
+	ASSERT_TRUE(_success)
+		<< "An error occured constructing the AST.";
+	std::ostringstream written;
+	FlatAST {_ast}.Write(written);
+	const std::string bytes {written.str()};
+	const std::string path {testing::TempDir() + "valid.ast"};
+	{
+		std::ofstream file {path, std::ios::binary};
+		file << bytes;
+	}
+
+	AST loaded;
+	{
+		TU file (path.c_str());
+		FlatAST::Load(file, loaded);
+	}
+	std::remove(path.c_str());
+	ASSERT_EQ(_ast.size(), loaded.size())
+		<< "Incorrect number of top-level AST nodes.";
+	for (size_t i {0}; i < _ast.size(); ++ i)
+	{
+		std::ostringstream expected, actual;
+		_ast[i]->Print(expected, "  "sv);
+		loaded[i]->Print(actual, "  "sv);
+		EXPECT_EQ(expected.str(), actual.str())
+			<< "Global " << i << " differs from the parsed AST.";
+		EXPECT_TRUE(_ast[i]->_off == loaded[i]->_off
+			&& _ast[i]->_len == loaded[i]->_len)
+			<< "Global " << i << " is not located as in the parsed AST.";
+	}
+	std::ostringstream rewritten;
+	FlatAST {loaded}.Write(rewritten);
+	EXPECT_EQ(bytes, rewritten.str())
+		<< "Writing a loaded AST changed the file.";
+
+	// Truncate the file, and point the last global at no node.
+	std::string damaged[] {bytes.substr(0, bytes.size() - 4), bytes};
+	damaged[1].replace(bytes.size() - 4, 4, 4, '\xFF');
+	for (const std::string& text : damaged)
+	{
+		TU file {text, "damaged.ast"sv};
+		AST out;
+		EXPECT_THROW(FlatAST::Load(file, out), std::runtime_error)
+			<< "Expected a damaged file to be rejected.";
+	}
+}